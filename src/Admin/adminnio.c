@@ -23,6 +23,8 @@
 #define MAX_STRING_IP_LENGTH 50
 
 #define BUFFER_SIZE_SCTP 4112
+/** Tamaño maximo del reporte de estadísticas, debe entrar en un mensaje RAP. */
+#define STATISTICS_SIZE 2048
 #define ATTACHMENT(key) ( (struct admin *)(key)->data)
 #define ETAG 0;
 
@@ -113,6 +115,10 @@ unsigned getReplaceMsg(requestRAP req, MultiplexorKey key);
 unsigned addReplaceMsg(requestRAP req, MultiplexorKey key);
 unsigned setErrorFilePath(requestRAP req, MultiplexorKey key);
 unsigned getErrorFilePath(requestRAP req, MultiplexorKey key);
+unsigned getStatistics(requestRAP req, MultiplexorKey key);
+unsigned invalidateCapaCache(requestRAP req, MultiplexorKey key);
+unsigned getFilterLimit(requestRAP req, MultiplexorKey key);
+unsigned setFilterLimit(requestRAP req, MultiplexorKey key);
 // end definitions
 
 
@@ -124,6 +130,13 @@ static const eventHandler adminHandler = {
     .timeout = adminTimeout,
 };
 
+/** Operaciones registradas por main. */
+static adminProxyOperations proxyOperations;
+
+void adminRegisterProxy(const adminProxyOperations * operations) {
+    proxyOperations = *operations;
+}
+
 /**
  * Pool de `struct admin', para ser reusados.
  *
@@ -198,13 +211,10 @@ void adminPassiveAccept(MultiplexorKey key)
     socklen_t                     client_addr_len = sizeof(clientAddr);
     admin * clientAdmin = NULL;
 
-    const int clientFd = accept(key->fd, (struct sockaddr*) &clientAddr, &client_addr_len);
+    const int clientFd = fdAccept(key->fd, (struct sockaddr*) &clientAddr, &client_addr_len);
     if(clientFd == -1) {
         goto fail;
     }
-    if(fdSetNIO(clientFd) == -1) {
-        goto fail;
-    }
     logInfo("Accepting new admin");
     
     clientAdmin = newAdmin(clientFd, BUFFER_SIZE_SCTP);
@@ -503,6 +513,18 @@ static int checkRequest(MultiplexorKey key) {
         case GET_ERROR_FILE:
             ret = getErrorFilePath(req, key);
             break;
+        case GET_STATISTICS:
+            ret = getStatistics(req, key);
+            break;
+        case INVALIDATE_CAPA_CACHE:
+            ret = invalidateCapaCache(req, key);
+            break;
+        case GET_FILTER_LIMIT:
+            ret = getFilterLimit(req, key);
+            break;
+        case SET_FILTER_LIMIT:
+            ret = setFilterLimit(req, key);
+            break;
         default:
             ret = handleErrorMsg(req, key);
             break;
@@ -629,14 +651,16 @@ unsigned setFilterCommand(requestRAP req, MultiplexorKey key) {
 }
 
 unsigned getFilterCommand(requestRAP req, MultiplexorKey key) {
+    /** Con -i y sin -t no hay comando. */
+    const char * command = (proxyConf.filterCommand != NULL)? proxyConf.filterCommand : "";
     responseRAP resp = newResponse();
     resp->respCode                  = RESP_OK;
     resp->etag                      = (proxyConf.etags)[transformCommandEtag];
     resp->encoding                  = TEXT_TYPE;
-    resp->data                      = calloc(strlen(proxyConf.filterCommand)+1, sizeof(char));
+    resp->data                      = calloc(strlen(command)+1, sizeof(char));
     checkAreNotEquals(resp->data, NULL, "out of memory, calloc throw null");
-    resp->dataLength                = strlen(proxyConf.filterCommand);
-    memcpy(resp->data, proxyConf.filterCommand, resp->dataLength);
+    resp->dataLength                = strlen(command);
+    memcpy(resp->data, command, resp->dataLength);
     
     admin * adm = ATTACHMENT(key);
     size_t size;
@@ -970,6 +994,93 @@ unsigned getErrorFilePath(requestRAP req, MultiplexorKey key) {
     return TRANSACTION;
 }
 
+/* Devuelve en texto las estadísticas de los componentes del proxy */
+unsigned getStatistics(requestRAP req, MultiplexorKey key) {
+    char statistics[STATISTICS_SIZE] = "";
+    responseRAP resp = newResponse();
+    size_t length    = 0;
+    if(proxyOperations.statistics != NULL)
+        length = proxyOperations.statistics(statistics, sizeof(statistics));
+    resp->respCode                  = RESP_OK;
+    resp->etag                      = 0;
+    resp->encoding                  = TEXT_TYPE;
+    resp->dataLength                = length + 1;
+    resp->data                      = statistics;
+    admin * adm = ATTACHMENT(key);
+    bufferADT buffer = adm->writeBuffer;
+    size_t size;
+    uint8_t * ptr = getWritePtr(buffer, &size);
+    prepareResponse(resp,(char *) ptr);
+    updateWriteAndProcessPtr(buffer, responseSize(resp));
+    destroyResponse(resp);
+    return TRANSACTION;
+}
+
+/* Olvida las capacidades guardadas de los origin servers */
+unsigned invalidateCapaCache(requestRAP req, MultiplexorKey key) {
+    responseRAP resp = newResponse();
+    if(proxyOperations.invalidateCapabilities != NULL)
+        proxyOperations.invalidateCapabilities();
+    admin * adm = ATTACHMENT(key);
+    logInfo("admin %s invalidated the capabilities cache", adm->clientAddress);
+    resp->respCode                  = RESP_OK;
+    resp->etag                      = 0;
+    size_t size;
+    prepareResponse(resp, (char*) getWritePtr(adm->writeBuffer, &size));
+    updateWriteAndProcessPtr(adm->writeBuffer, responseSize(resp));
+    destroyResponse(resp);
+    return TRANSACTION;
+}
+
+unsigned getFilterLimit(requestRAP req, MultiplexorKey key) {
+    responseRAP resp = newResponse();
+    int data = htonl((proxyOperations.filterLimitMax != NULL)? proxyOperations.filterLimitMax() : 0);
+    resp->respCode                  = RESP_OK;
+    resp->etag                      = (proxyConf.etags)[filterLimitEtag];
+    resp->encoding                  = INT_TYPE;
+    resp->data                      = &data;
+    resp->dataLength                = sizeof(int);
+
+    admin * adm = ATTACHMENT(key);
+    size_t size;
+    char * ptr = (char *) getWritePtr(adm->writeBuffer, &size);
+    prepareResponse(resp, ptr);
+    updateWriteAndProcessPtr(adm->writeBuffer, responseSize(resp));
+    destroyResponse(resp);
+    return TRANSACTION;
+}
+
+/**
+ * Cambia la cantidad máxima de filtros a la vez, 0 es sin límite. Los
+ * filtros que ya se ejecutan siguen; si sube, se inician los que esperaban.
+ */
+unsigned setFilterLimit(requestRAP req, MultiplexorKey key) {
+    responseRAP resp = newResponse();
+    admin * adm = ATTACHMENT(key);
+    if(proxyOperations.filterLimitSetMax != NULL && (proxyConf.etags)[filterLimitEtag] == req->etag &&
+       req->encoding == INT_TYPE && req->dataLength >= sizeof(uint32_t)) {
+        const int newLimit = (int) ntohl(*((uint32_t *) req->data));
+        if(newLimit >= 0) {
+            proxyConf.filterLimit = newLimit;
+            proxyOperations.filterLimitSetMax(proxyConf.filterLimit);
+            (proxyConf.etags)[filterLimitEtag]++;
+            logInfo("admin %s successfully changed the filter limit to %d", adm->clientAddress, newLimit);
+            resp->respCode              = RESP_OK;
+        } else
+            resp->respCode              = RESP_SET_FILTER_LIMIT_ERROR;
+    } else {
+        resp->respCode                  = RESP_SET_FILTER_LIMIT_ERROR;
+    }
+    resp->etag                      = (proxyConf.etags)[filterLimitEtag];
+
+    size_t size;
+    char * ptr = (char *) getWritePtr(adm->writeBuffer, &size);
+    prepareResponse(resp, ptr);
+    updateWriteAndProcessPtr(adm->writeBuffer, responseSize(resp));
+    destroyResponse(resp);
+    return TRANSACTION;
+}
+
 unsigned sendTransactionResponse(MultiplexorKey key) {
     admin * adm = ATTACHMENT(key);
     sendMsg(key);
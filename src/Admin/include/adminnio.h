@@ -1,9 +1,29 @@
 #ifndef ADMIN_H
 #define ADMIN_H
 
+#include <stddef.h>
+
 #include "multiplexor.h"
 
+/**
+ * Operaciones del proxy que atiende la administración. Las registra main
+ * con adminRegisterProxy, así adminnio no depende de los módulos del
+ * proxy y puede enlazarse sin ellos. Una operación en NULL no se ofrece.
+ */
+typedef struct adminProxyOperations {
+    /** Escribe en `buffer' las estadísticas de los componentes, retorna los bytes escritos. */
+    size_t      (*statistics)(char * buffer, const size_t size);
+    /** Olvida las capacidades guardadas de los origin servers. */
+    void        (*invalidateCapabilities)(void);
+    /** Cantidad máxima de filtros a la vez, 0 es sin límite. */
+    size_t      (*filterLimitMax)(void);
+    void        (*filterLimitSetMax)(const size_t max);
+} adminProxyOperations;
+
 void adminPassiveAccept(MultiplexorKey key);
 void poolAdminDestroy(void);
+
+/** Registra las operaciones del proxy, se copian. */
+void adminRegisterProxy(const adminProxyOperations * operations);
 #endif
 
@@ -41,6 +41,9 @@ typedef enum opCodeType {
         ADD_REPLACE_MSG         = 19,
         SET_ERROR_FILE          = 20,
         GET_ERROR_FILE          = 21,
+        INVALIDATE_CAPA_CACHE   = 22,
+        GET_FILTER_LIMIT        = 23,
+        SET_FILTER_LIMIT        = 24,
         
 } opCodeType;
 
@@ -57,6 +60,7 @@ typedef enum opCodeType {
 #define RESP_ADD_REPLACE_MSG_ERROR  1901
 #define RESP_SET_ERROR_FILE_ERROR   2001
 #define RESP_GET_ERROR_FILE_ERROR   2101
+#define RESP_SET_FILTER_LIMIT_ERROR 2401
 
 #define RESP_OK 200
 
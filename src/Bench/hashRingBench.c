@@ -0,0 +1,53 @@
+/**
+ * hashRingBench.c - mide el costo de elegir el origin de un usuario en el
+ *                   anillo de hashing consistente.
+ *
+ * Uso: hashRingBench.out [origins] [lookups]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hashRing.h"
+
+#define VIRTUAL_NODES 160
+#define USERS 4096
+
+static double elapsed(const struct timespec * start, const struct timespec * end) {
+    return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+int main(int argc, const char * argv[]) {
+    const size_t origins = (argc > 1)? (size_t) atol(argv[1]) : 16;
+    const size_t lookups = (argc > 2)? (size_t) atol(argv[2]) : 10000000;
+    static char   users[USERS][24];
+    static size_t lengths[USERS];
+    char          name[48];
+    size_t        node, checksum = 0;
+    struct timespec start, end;
+
+    hashRingADT ring = createHashRing(VIRTUAL_NODES);
+    if(ring == NULL)
+        return 1;
+    for(size_t i = 0; i < origins; i++) {
+        snprintf(name, sizeof(name), "origin%zu.example.org", i);
+        if(!hashRingAdd(ring, i, name))
+            return 1;
+    }
+    for(size_t i = 0; i < USERS; i++)
+        lengths[i] = (size_t) snprintf(users[i], sizeof(users[i]), "user%zu@example.org", i);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(size_t i = 0; i < lookups; i++) {
+        const size_t user = i % USERS;
+        if(hashRingLookup(ring, (const uint8_t *) users[user], lengths[user], &node))
+            checksum += node;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("hashRing: %zu origins, %zu points, %zu lookups, %.1f ns/lookup (checksum %zu)\n",
+           origins, hashRingPoints(ring), lookups, elapsed(&start, &end) / lookups, checksum);
+    deleteHashRing(ring);
+    return 0;
+}
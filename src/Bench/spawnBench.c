@@ -0,0 +1,140 @@
+/**
+ * spawnBench.c - mide la latencia de lanzar un filtro con fork más el cierre
+ *                de descriptores anterior y con processSpawn, con distintas
+ *                cantidades de sesiones abiertas.
+ *
+ * Cada sesión abre dos sockets (cliente y origin) y reserva la memoria de
+ * sus buffers, como en el proxy. Se mide el tiempo que el proceso que lanza
+ * queda bloqueado y el tiempo hasta que el hijo (/bin/true) termina.
+ *
+ * Uso: spawnBench.out [launches] [sessions ...]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#include "processSpawn.h"
+
+#define SESSION_MEMORY (2 * 4096)
+#define CHILD_PATH "/bin/true"
+
+typedef pid_t (*launcher)(const int nullFd);
+
+static double elapsed(const struct timespec * start, const struct timespec * end) {
+    return (end->tv_sec - start->tv_sec) * 1e6 + (end->tv_nsec - start->tv_nsec) / 1e3;
+}
+
+/** Como lanzaba los filtros el proxy antes de processSpawn. */
+static pid_t forkLauncher(const int nullFd) {
+    const pid_t pid = fork();
+    if(pid == 0) {
+        dup2(nullFd, STDIN_FILENO);
+        dup2(nullFd, STDOUT_FILENO);
+        for(int i = 3; i < 1024; i++)
+            close(i);
+        execl(CHILD_PATH, "true", (char *) 0);
+        _exit(1);
+    }
+    return pid;
+}
+
+static pid_t spawnLauncher(const int nullFd) {
+    char * const argv[] = {"true", NULL};
+    return processSpawn(CHILD_PATH, argv, nullFd, nullFd, NULL, NULL, NULL, 0);
+}
+
+static void measure(const char * name, const launcher launch, const int nullFd, const size_t launches, const size_t sessions) {
+    struct timespec start, launched, end;
+    double blocked = 0, total = 0;
+
+    for(size_t i = 0; i < launches; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        const pid_t pid = launch(nullFd);
+        clock_gettime(CLOCK_MONOTONIC, &launched);
+        if(pid < 0) {
+            printf("spawn: %s failed\n", name);
+            return;
+        }
+        waitpid(pid, NULL, 0);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        blocked += elapsed(&start, &launched);
+        total   += elapsed(&start, &end);
+    }
+    printf("spawn: %6zu sessions, %-12s blocked %8.1f us, until exit %8.1f us\n",
+           sessions, name, blocked / launches, total / launches);
+}
+
+/** Abre `sessions' sesiones. Retorna cuántas pudo abrir. */
+static size_t openSessions(const size_t sessions, int * fds, uint8_t ** memory) {
+    struct rlimit limit;
+    const rlim_t needed = 2 * sessions + 16;
+
+    if(getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < needed) {
+        limit.rlim_cur = needed;
+        if(limit.rlim_max < needed)
+            limit.rlim_max = needed;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    for(size_t i = 0; i < sessions; i++) {
+        if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds + 2 * i) < 0 || (memory[i] = malloc(SESSION_MEMORY)) == NULL) {
+            printf("spawn: only %zu sessions could be opened\n", i);
+            return i;
+        }
+        memset(memory[i], 0xAB, SESSION_MEMORY);
+    }
+    return sessions;
+}
+
+static void closeSessions(const size_t sessions, int * fds, uint8_t ** memory) {
+    for(size_t i = 0; i < sessions; i++) {
+        close(fds[2 * i]);
+        close(fds[2 * i + 1]);
+        free(memory[i]);
+    }
+}
+
+int main(int argc, const char * argv[]) {
+    const size_t launches  = (argc > 1)? (size_t) atol(argv[1]) : 200;
+    const size_t defaults[] = {100, 10000};
+    const size_t * counts  = defaults;
+    size_t countsSize      = sizeof(defaults) / sizeof(defaults[0]);
+    size_t * parsed        = NULL;
+
+    if(argc > 2) {
+        parsed = malloc((argc - 2) * sizeof(*parsed));
+        if(parsed == NULL)
+            return 1;
+        for(int i = 2; i < argc; i++)
+            parsed[i - 2] = (size_t) atol(argv[i]);
+        counts     = parsed;
+        countsSize = argc - 2;
+    }
+
+    const int nullFd = open("/dev/null", O_RDWR | O_CLOEXEC);
+    if(nullFd < 0 || launches == 0)
+        return 1;
+    for(size_t c = 0; c < countsSize; c++) {
+        int      * fds    = malloc(2 * counts[c] * sizeof(*fds));
+        uint8_t ** memory = malloc(counts[c] * sizeof(*memory));
+        if(fds == NULL || memory == NULL)
+            return 1;
+
+        const size_t sessions = openSessions(counts[c], fds, memory);
+        measure("fork+close", forkLauncher, nullFd, launches, sessions);
+        measure("processSpawn", spawnLauncher, nullFd, launches, sessions);
+        closeSessions(sessions, fds, memory);
+        free(fds);
+        free(memory);
+    }
+    close(nullFd);
+    free(parsed);
+    return 0;
+}
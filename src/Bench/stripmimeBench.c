@@ -0,0 +1,128 @@
+/**
+ * stripmimeBench.c - mide el throughput del stripmime con mensajes de
+ *                    varios MiB, escribiendo la salida con stdio (como lo
+ *                    hacía antes) y con fdWriter.
+ *
+ * El mensaje es multipart: una parte text/plain que pasa y una image/png
+ * que se reemplaza, cada una con la mitad del tamaño. La entrada se entrega
+ * de a 64 KiB, como la lee el filtro, y la salida va a /dev/null.
+ *
+ * Uso: stripmimeBench.out [MiB] [rounds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "fdWriter.h"
+#include "stripmimeEngine.h"
+
+#define FEED_SIZE (64 * 1024)
+#define LINE_LENGTH 76
+#define MEDIA_RANGE "image/png"
+
+typedef struct benchOutput {
+    FILE *          stream;
+    fdWriterADT     writer;
+    size_t          calls;
+} benchOutput;
+
+static double elapsed(const struct timespec * start, const struct timespec * end) {
+    return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void writeStdio(const uint8_t * data, const size_t length, void * writerData) {
+    benchOutput * output = writerData;
+    output->calls++;
+    fwrite(data, sizeof(*data), length, output->stream);
+}
+
+static void writeFd(const uint8_t * data, const size_t length, void * writerData) {
+    benchOutput * output = writerData;
+    output->calls++;
+    fdWriterWrite(output->writer, data, length);
+}
+
+/** Agrega a `message' una parte de `bytes' bytes en lineas de LINE_LENGTH. */
+static size_t appendPart(char * message, size_t length, const char * type, const size_t bytes) {
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    length += sprintf(message + length, "--frontier\r\nContent-Type: %s\r\n\r\n", type);
+    for(size_t written = 0; written < bytes; written += LINE_LENGTH + 2) {
+        for(size_t i = 0; i < LINE_LENGTH; i++)
+            message[length++] = alphabet[(written + i * 7) % (sizeof(alphabet) - 1)];
+        message[length++] = '\r';
+        message[length++] = '\n';
+    }
+    return length;
+}
+
+static char * buildMessage(const size_t bytes, size_t * length) {
+    char * message = malloc(bytes + 4096);
+    if(message == NULL)
+        return NULL;
+    *length = sprintf(message, "From: bench@example.org\r\nSubject: bench\r\nMIME-Version: 1.0\r\n"
+                               "Content-Type: multipart/mixed; boundary=\"frontier\"\r\n\r\n");
+    *length = appendPart(message, *length, "text/plain", bytes / 2);
+    *length = appendPart(message, *length, "image/png", bytes / 2);
+    *length += sprintf(message + *length, "--frontier--\r\n");
+    return message;
+}
+
+static void measure(const char * name, const stripmimeWriter write, benchOutput * output,
+                    const char * message, const size_t length, const size_t rounds) {
+    struct timespec start, end;
+
+    output->calls = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(size_t r = 0; r < rounds; r++) {
+        stripmimeADT stripmime = createStripmime(MEDIA_RANGE, "Parte remplazada", write, output);
+        if(stripmime == NULL) {
+            printf("stripmime: cannot create the engine\n");
+            return;
+        }
+        for(size_t offset = 0; offset < length; offset += FEED_SIZE) {
+            const size_t size = (length - offset < FEED_SIZE)? length - offset : FEED_SIZE;
+            stripmimeFeed(stripmime, (const uint8_t *) message + offset, size);
+        }
+        deleteStripmime(stripmime);
+        if(output->stream != NULL)
+            fflush(output->stream);
+        else
+            fdWriterFlush(output->writer);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const double seconds = elapsed(&start, &end);
+    printf("stripmime: %-9s %8.1f MiB/s, %8.1f writer calls per MiB",
+           name, rounds * length / (1024.0 * 1024.0) / seconds, output->calls / (rounds * length / (1024.0 * 1024.0)));
+    if(output->writer != NULL)
+        printf(", %6.1f syscalls per MiB", fdWriterSyscalls(output->writer) / (rounds * length / (1024.0 * 1024.0)));
+    printf("\n");
+}
+
+int main(int argc, const char * argv[]) {
+    const size_t mebibytes = (argc > 1)? (size_t) atol(argv[1]) : 8;
+    const size_t rounds    = (argc > 2)? (size_t) atol(argv[2]) : 10;
+    size_t length;
+
+    char * message = buildMessage(mebibytes * 1024 * 1024, &length);
+    const int nullFd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if(message == NULL || nullFd < 0 || rounds == 0)
+        return 1;
+
+    benchOutput stdio = { .stream = fdopen(dup(nullFd), "w") };
+    benchOutput fd    = { .writer = createFdWriter(nullFd, FD_WRITER_CAPACITY) };
+    if(stdio.stream == NULL || fd.writer == NULL)
+        return 1;
+    measure("stdio", writeStdio, &stdio, message, length, rounds);
+    measure("fdWriter", writeFd, &fd, message, length, rounds);
+
+    fclose(stdio.stream);
+    deleteFdWriter(fd.writer);
+    close(nullFd);
+    free(message);
+    return 0;
+}
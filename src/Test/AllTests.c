@@ -8,6 +8,29 @@
 #include "stateMachineTest.h"
 #include "bufferTest.h"
 #include "sockaddrToStringTest.h"
+#include "parserTest.h"
+#include "capaCacheTest.h"
+#include "happyEyeballsTest.h"
+#include "originSetTest.h"
+#include "originPoolTest.h"
+#include "hashRingTest.h"
+#include "retrPrefetchTest.h"
+#include "filterCacheTest.h"
+#include "filterPoolTest.h"
+#include "filterBypassTest.h"
+#include "filterLimitTest.h"
+#include "filterWatchdogTest.h"
+#include "stripmimeEngineTest.h"
+#include "fdWriterTest.h"
+#include "timerFdTest.h"
+#include "mediaTypeContainerTest.h"
+#include "mimeHeaderNameTest.h"
+#include "processSpawnTest.h"
+#include "resolverTest.h"
+#include "deferredConnectTest.h"
+#include "filterStuffTest.h"
+#include "filterFrameTest.h"
+#include "sha256Test.h"
 
 
 CuSuite* CuGetSuite();
@@ -26,6 +49,29 @@ void RunAllTests(void)
 	CuSuiteAddSuite(suite, getSateMachineTest());
 	CuSuiteAddSuite(suite, getBufferTest());
 	CuSuiteAddSuite(suite, getSockaddrToStringTest());
+	CuSuiteAddSuite(suite, getParserTest());
+	CuSuiteAddSuite(suite, getCapaCacheTest());
+	CuSuiteAddSuite(suite, getHappyEyeballsTest());
+	CuSuiteAddSuite(suite, getOriginSetTest());
+	CuSuiteAddSuite(suite, getOriginPoolTest());
+	CuSuiteAddSuite(suite, getHashRingTest());
+	CuSuiteAddSuite(suite, getRetrPrefetchTest());
+	CuSuiteAddSuite(suite, getFilterCacheTest());
+	CuSuiteAddSuite(suite, getFilterPoolTest());
+	CuSuiteAddSuite(suite, getFilterBypassTest());
+	CuSuiteAddSuite(suite, getFilterLimitTest());
+	CuSuiteAddSuite(suite, getFilterWatchdogTest());
+	CuSuiteAddSuite(suite, getStripmimeEngineTest());
+	CuSuiteAddSuite(suite, getFdWriterTest());
+	CuSuiteAddSuite(suite, getTimerFdTest());
+	CuSuiteAddSuite(suite, getMediaTypeContainerTest());
+	CuSuiteAddSuite(suite, getMimeHeaderNameTest());
+	CuSuiteAddSuite(suite, getProcessSpawnTest());
+	CuSuiteAddSuite(suite, getResolverTest());
+	CuSuiteAddSuite(suite, getDeferredConnectTest());
+	CuSuiteAddSuite(suite, getFilterStuffTest());
+	CuSuiteAddSuite(suite, getFilterFrameTest());
+	CuSuiteAddSuite(suite, getSha256Test());
 
 	
 	CuSuiteRun(suite);
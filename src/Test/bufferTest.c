@@ -202,11 +202,34 @@ void testBufferMiscWithProcess(CuTest* tc) {
 
 }
 
+void testBufferMoveUnprocessed(CuTest* tc) {
+    bufferADT from = createBuffer(8);
+    bufferADT to   = createBuffer(4);
+    size_t    count;
+
+    memcpy(from->writePtr, "ab123456", 8);
+    updateWritePtr(from, 8);
+    updateProcessPtr(from, 2);
+
+    CuAssertIntEquals(tc, 4, moveUnprocessed(from, to));
+    CuAssertTrue(tc, memcmp(getProcessPtr(to, &count), "1234", 4) == 0);
+    CuAssertIntEquals(tc, 4, count);
+    CuAssertTrue(tc, memcmp(getProcessPtr(from, &count), "56", 2) == 0);
+    CuAssertIntEquals(tc, 2, count);
+    CuAssertTrue(tc, memcmp(getReadPtr(from, &count), "ab", 2) == 0);
+    CuAssertIntEquals(tc, 2, count);
+
+    CuAssertIntEquals(tc, 0, moveUnprocessed(from, to));
+    deleteBuffer(from);
+    deleteBuffer(to);
+}
+
 CuSuite * getBufferTest(void) {
     CuSuite* suite = CuSuiteNew();
     
     SUITE_ADD_TEST(suite, testBufferMisc);
     SUITE_ADD_TEST(suite, testBufferMiscWithProcess);
+    SUITE_ADD_TEST(suite, testBufferMoveUnprocessed);
     return suite;
 }
 
@@ -0,0 +1,75 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "CuTest.h"
+#include "capaCache.h"
+#include "capaCacheTest.h"
+
+static struct sockaddr_in origin(uint32_t ip, uint16_t port) {
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port   = htons(port),
+    };
+    addr.sin_addr.s_addr = htonl(ip);
+    return addr;
+}
+
+void testCapaCacheHitAndMiss(CuTest* tc) {
+    capaCacheADT cache = createCapaCache(60);
+    struct sockaddr_in first  = origin(0x7F000001, 110);
+    struct sockaddr_in second = origin(0x7F000001, 1110);
+    capabilities stored = { .pipelining = true }, found = { .pipelining = false };
+
+    CuAssertTrue(tc, !capaCacheGet(cache, (struct sockaddr *) &first, 0, &found));
+    capaCachePut(cache, (struct sockaddr *) &first, &stored, 0);
+    CuAssertTrue(tc, capaCacheGet(cache, (struct sockaddr *) &first, 10, &found));
+    CuAssertTrue(tc, found.pipelining);
+    /** Mismo host en otro puerto es otro origin. */
+    CuAssertTrue(tc, !capaCacheGet(cache, (struct sockaddr *) &second, 10, &found));
+
+    CuAssertIntEquals(tc, 1, capaCacheHits(cache));
+    CuAssertIntEquals(tc, 2, capaCacheMisses(cache));
+    deleteCapaCache(cache);
+}
+
+void testCapaCacheTtl(CuTest* tc) {
+    capaCacheADT cache = createCapaCache(60);
+    struct sockaddr_in addr = origin(0x0A000001, 110);
+    capabilities stored = { .pipelining = true }, found;
+
+    capaCachePut(cache, (struct sockaddr *) &addr, &stored, 100);
+    CuAssertTrue(tc, capaCacheGet(cache, (struct sockaddr *) &addr, 159, &found));
+    CuAssertTrue(tc, !capaCacheGet(cache, (struct sockaddr *) &addr, 160, &found));
+    /** La entrada vencida se descarta. */
+    CuAssertTrue(tc, !capaCacheGet(cache, (struct sockaddr *) &addr, 100, &found));
+    deleteCapaCache(cache);
+}
+
+void testCapaCacheInvalidate(CuTest* tc) {
+    capaCacheADT cache = createCapaCache(60);
+    capabilities stored = { .pipelining = false }, found;
+
+    for(uint32_t i = 0; i <= CAPA_CACHE_SIZE; i++) {
+        struct sockaddr_in addr = origin(0x0A000000 + i, 110);
+        capaCachePut(cache, (struct sockaddr *) &addr, &stored, i);
+    }
+    /** Al llenarse se reemplaza la entrada más antigua. */
+    struct sockaddr_in oldest = origin(0x0A000000, 110);
+    struct sockaddr_in newest = origin(0x0A000000 + CAPA_CACHE_SIZE, 110);
+    CuAssertTrue(tc, !capaCacheGet(cache, (struct sockaddr *) &oldest, 20, &found));
+    CuAssertTrue(tc, capaCacheGet(cache, (struct sockaddr *) &newest, 20, &found));
+
+    capaCacheInvalidate(cache);
+    CuAssertTrue(tc, !capaCacheGet(cache, (struct sockaddr *) &newest, 20, &found));
+    deleteCapaCache(cache);
+}
+
+CuSuite * getCapaCacheTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testCapaCacheHitAndMiss);
+    SUITE_ADD_TEST(suite, testCapaCacheTtl);
+    SUITE_ADD_TEST(suite, testCapaCacheInvalidate);
+    return suite;
+}
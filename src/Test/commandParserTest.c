@@ -95,14 +95,79 @@ void testParseCommands(CuTest * tc) {
     currentCommand = processQueue(commands);
     CuAssertIntEquals(tc, CMD_RETR,  currentCommand->type);
 
+    currentCommand = processQueue(commands);
+    CuAssertIntEquals(tc, CMD_DELE,  currentCommand->type);
+
+    currentCommand = processQueue(commands);
+    CuAssertIntEquals(tc, CMD_QUIT,  currentCommand->type);
+
+    currentCommand = processQueue(commands);
+    CuAssertIntEquals(tc, CMD_APOP,  currentCommand->type); 
+}
+
+void testRfcCommands(CuTest * tc) {
+    commandParser parser;
+    commandParserInit(&parser);
+    queueADT commands = createQueue();
+    commandStruct * currentCommand;
+
+    char * testCommands = "STAT\r\nnoop\r\nRSET\nSTLS\r\nAUTH\r\nAUTH PLAIN\r\nAUTH PLAIN dGVzdA==\r\nSTAT 1\r\nDELE\r\nQUIT\n";
+    bufferADT buffer = createBuffer(strlen(testCommands));
+
+    size_t size;
+    bool pipelining = true, newCommand = false;
+    uint8_t * ptr = getWritePtr(buffer, &size);
+    memcpy(ptr, testCommands, size);
+    updateWritePtr(buffer, size);
+
+    commandParserConsume(&parser, buffer, commands, pipelining, &newCommand);
+    CuAssertIntEquals(tc, 10, getQueueSize(commands));
+    CuAssertIntEquals(tc, true, newCommand);
+
+    //STAT\r\n
+    currentCommand = peekProcessed(commands);
+    CuAssertIntEquals(tc, CMD_STAT, currentCommand->type);
+    CuAssertIntEquals(tc, false, currentCommand->isMultiline);
+
+    //noop\r\n
+    currentCommand = processQueue(commands);
+    CuAssertIntEquals(tc, CMD_NOOP, currentCommand->type);
+
+    //RSET\n
+    currentCommand = processQueue(commands);
+    CuAssertIntEquals(tc, CMD_RSET, currentCommand->type);
+
+    //STLS\r\n
+    currentCommand = processQueue(commands);
+    CuAssertIntEquals(tc, CMD_STLS, currentCommand->type);
+    CuAssertIntEquals(tc, false, currentCommand->isMultiline);
+
+    //AUTH\r\n
+    currentCommand = processQueue(commands);
+    CuAssertIntEquals(tc, CMD_AUTH, currentCommand->type);
+    CuAssertIntEquals(tc, true, currentCommand->isMultiline);
+
+    //AUTH PLAIN\r\n
+    currentCommand = processQueue(commands);
+    CuAssertIntEquals(tc, CMD_AUTH, currentCommand->type);
+    CuAssertIntEquals(tc, false, currentCommand->isMultiline);
+
+    //AUTH PLAIN dGVzdA==\r\n
+    currentCommand = processQueue(commands);
+    CuAssertIntEquals(tc, CMD_AUTH, currentCommand->type);
+    CuAssertIntEquals(tc, false, currentCommand->isMultiline);
+
+    //STAT 1\r\n
     currentCommand = processQueue(commands);
     CuAssertIntEquals(tc, CMD_OTHER, currentCommand->type);
 
+    //DELE\r\n
     currentCommand = processQueue(commands);
     CuAssertIntEquals(tc, CMD_OTHER, currentCommand->type);
 
+    //QUIT\n
     currentCommand = processQueue(commands);
-    CuAssertIntEquals(tc, CMD_APOP,  currentCommand->type); 
+    CuAssertIntEquals(tc, CMD_QUIT, currentCommand->type);
 }
 
 void testInvalidCommands(CuTest * tc) {
@@ -308,6 +373,7 @@ CuSuite * getCommandParserTest(void) {
     SUITE_ADD_TEST(suite, testGetUsernameUser);
     SUITE_ADD_TEST(suite, testGetUsernameApop);
     SUITE_ADD_TEST(suite, testParseCommands);
+    SUITE_ADD_TEST(suite, testRfcCommands);
     SUITE_ADD_TEST(suite, testInvalidCommands);
     SUITE_ADD_TEST(suite, testMultilinesCommands);
     SUITE_ADD_TEST(suite, testWithoutCarrigeReturnCommands);
@@ -0,0 +1,127 @@
+#include <string.h>
+
+#include "CuTest.h"
+#include "deferredConnect.h"
+#include "deferredConnectTest.h"
+
+#define CAPA_PLAIN "+OK\r\nUSER\r\n.\r\n"
+#define CAPA_PIPELINING "+OK\r\nUSER\r\nPIPELINING\r\n.\r\n"
+
+static void put(deferredCapaADT capa, const size_t origin, const char * response) {
+    deferredCapaPut(capa, origin, (const uint8_t *) response, strlen(response));
+}
+
+static deferredAction lineAction(deferredCapaADT capa, const char * line, const uint8_t ** answer, size_t * length) {
+    return deferredLineAction(capa, (const uint8_t *) line, strlen(line), answer, length);
+}
+
+void testDeferredCapaSingleOrigin(CuTest* tc) {
+    deferredCapaADT capa = createDeferredCapa(1);
+    size_t length = 0;
+
+    CuAssertPtrNotNull(tc, capa);
+    CuAssertPtrEquals(tc, NULL, (void *) deferredCapaAnswer(capa, &length));
+
+    put(capa, 0, CAPA_PIPELINING);
+    const uint8_t * answer = deferredCapaAnswer(capa, &length);
+    CuAssertPtrNotNull(tc, answer);
+    CuAssertIntEquals(tc, strlen(CAPA_PIPELINING), length);
+    CuAssertTrue(tc, memcmp(answer, CAPA_PIPELINING, length) == 0);
+
+    /** Una respuesta negativa descarta la anterior. */
+    put(capa, 0, "-ERR\r\n");
+    CuAssertPtrEquals(tc, NULL, (void *) deferredCapaAnswer(capa, &length));
+
+    put(capa, 0, CAPA_PLAIN);
+    CuAssertPtrNotNull(tc, deferredCapaAnswer(capa, &length));
+    deferredCapaInvalidate(capa);
+    CuAssertPtrEquals(tc, NULL, (void *) deferredCapaAnswer(capa, &length));
+
+    /** Un origin fuera de rango se ignora. */
+    put(capa, 1, CAPA_PLAIN);
+    CuAssertPtrEquals(tc, NULL, (void *) deferredCapaAnswer(capa, &length));
+    deleteDeferredCapa(capa);
+}
+
+void testDeferredCapaOriginsDiffer(CuTest* tc) {
+    deferredCapaADT capa = createDeferredCapa(2);
+    const uint8_t * answer;
+    size_t length;
+
+    /** Sin la respuesta del segundo origin no se sabe qué capacidades tendrá la sesión. */
+    put(capa, 0, CAPA_PIPELINING);
+    CuAssertPtrEquals(tc, NULL, (void *) deferredCapaAnswer(capa, &length));
+
+    /** Con respuestas distintas CAPA necesita conectar al origin elegido. */
+    put(capa, 1, CAPA_PLAIN);
+    CuAssertPtrEquals(tc, NULL, (void *) deferredCapaAnswer(capa, &length));
+    CuAssertIntEquals(tc, DEFERRED_CONNECT, lineAction(capa, "CAPA\r\n", &answer, &length));
+    deleteDeferredCapa(capa);
+}
+
+void testDeferredCapaOriginsAgree(CuTest* tc) {
+    deferredCapaADT capa = createDeferredCapa(3);
+    const uint8_t * answer;
+    size_t length;
+
+    put(capa, 0, CAPA_PLAIN);
+    put(capa, 1, CAPA_PLAIN);
+    put(capa, 2, CAPA_PLAIN);
+    CuAssertIntEquals(tc, DEFERRED_ANSWER, lineAction(capa, "capa\r\n", &answer, &length));
+    CuAssertIntEquals(tc, strlen(CAPA_PLAIN), length);
+    CuAssertTrue(tc, memcmp(answer, CAPA_PLAIN, length) == 0);
+
+    /** Cuando un origin cambia sus capacidades deja de coincidir. */
+    put(capa, 1, CAPA_PIPELINING);
+    CuAssertIntEquals(tc, DEFERRED_CONNECT, lineAction(capa, "CAPA\r\n", &answer, &length));
+    deleteDeferredCapa(capa);
+}
+
+void testDeferredLineAction(CuTest* tc) {
+    const uint8_t * answer;
+    size_t length;
+
+    CuAssertIntEquals(tc, DEFERRED_CONNECT, lineAction(NULL, "CAPA\r\n", &answer, &length));
+    CuAssertIntEquals(tc, DEFERRED_CONNECT, lineAction(NULL, "USER juan\r\n", &answer, &length));
+    CuAssertIntEquals(tc, DEFERRED_CONNECT, lineAction(NULL, "AUTH PLAIN\r\n", &answer, &length));
+    CuAssertIntEquals(tc, DEFERRED_CONNECT, lineAction(NULL, "STLS\r\n", &answer, &length));
+
+    CuAssertIntEquals(tc, DEFERRED_QUIT, lineAction(NULL, "QUIT\r\n", &answer, &length));
+    CuAssertIntEquals(tc, strlen("+OK Bye.\r\n"), length);
+    CuAssertTrue(tc, memcmp(answer, "+OK", 3) == 0);
+
+    CuAssertIntEquals(tc, DEFERRED_APOP, lineAction(NULL, "APOP juan c4c9334bac560ecc979e58001b3e22fb\r\n", &answer, &length));
+    CuAssertTrue(tc, memcmp(answer, "-ERR", 4) == 0);
+
+    /** Los comandos de la transacción se rechazan sin conectar. */
+    CuAssertIntEquals(tc, DEFERRED_ANSWER, lineAction(NULL, "RETR 1\r\n", &answer, &length));
+    CuAssertTrue(tc, memcmp(answer, "-ERR", 4) == 0);
+    CuAssertIntEquals(tc, (int) strlen((const char *) answer), (int) length);
+}
+
+void testDeferredUsername(CuTest* tc) {
+    char name[8];
+    const char * line = "USER  juan extra\r\n";
+
+    deferredUsername((const uint8_t *) line, strlen(line), name, sizeof(name));
+    CuAssertStrEquals(tc, "juan", name);
+
+    line = "USER\r\n";
+    deferredUsername((const uint8_t *) line, strlen(line), name, sizeof(name));
+    CuAssertStrEquals(tc, "", name);
+
+    /** Un nombre largo se trunca al tamaño disponible. */
+    line = "USER abcdefghijk\r\n";
+    deferredUsername((const uint8_t *) line, strlen(line), name, sizeof(name));
+    CuAssertStrEquals(tc, "abcdefg", name);
+}
+
+CuSuite * getDeferredConnectTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testDeferredCapaSingleOrigin);
+    SUITE_ADD_TEST(suite, testDeferredCapaOriginsDiffer);
+    SUITE_ADD_TEST(suite, testDeferredCapaOriginsAgree);
+    SUITE_ADD_TEST(suite, testDeferredLineAction);
+    SUITE_ADD_TEST(suite, testDeferredUsername);
+    return suite;
+}
@@ -0,0 +1,77 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "CuTest.h"
+#include "fdWriter.h"
+#include "fdWriterTest.h"
+
+#define PIPE_DATA 4096
+
+/** Lee del pipe todo lo escrito, hasta `size' bytes. */
+static size_t drain(const int fd, char * data, const size_t size) {
+    size_t length = 0;
+    ssize_t n;
+
+    while(length < size && (n = read(fd, data + length, size - length)) > 0)
+        length += n;
+    return length;
+}
+
+void testFdWriterBuffering(CuTest* tc) {
+    char data[PIPE_DATA];
+    int fds[2];
+
+    CuAssertIntEquals(tc, 0, pipe(fds));
+    fdWriterADT writer = createFdWriter(fds[1], 16);
+    CuAssertPtrNotNull(tc, writer);
+
+    /** Las corridas chicas se juntan hasta llenar el buffer. */
+    CuAssertTrue(tc, fdWriterWrite(writer, (const uint8_t *) "hola ", 5));
+    CuAssertTrue(tc, fdWriterWrite(writer, (const uint8_t *) "mundo", 5));
+    CuAssertIntEquals(tc, 0, (int) fdWriterSyscalls(writer));
+    CuAssertTrue(tc, fdWriterWrite(writer, (const uint8_t *) "!\r\n", 3));
+    CuAssertTrue(tc, fdWriterFlush(writer));
+    CuAssertIntEquals(tc, 1, (int) fdWriterSyscalls(writer));
+    /** Sin nada acumulado el flush no escribe. */
+    CuAssertTrue(tc, fdWriterFlush(writer));
+    CuAssertIntEquals(tc, 1, (int) fdWriterSyscalls(writer));
+
+    deleteFdWriter(writer);
+    close(fds[1]);
+    const size_t length = drain(fds[0], data, sizeof(data));
+    close(fds[0]);
+    CuAssertIntEquals(tc, 13, (int) length);
+    CuAssertTrue(tc, memcmp(data, "hola mundo!\r\n", 13) == 0);
+}
+
+void testFdWriterLargeRun(CuTest* tc) {
+    char data[PIPE_DATA], expected[PIPE_DATA];
+    int fds[2];
+
+    for(int i = 0; i < 1000; i++)
+        expected[i] = 'a' + i % 26;
+    CuAssertIntEquals(tc, 0, pipe(fds));
+    fdWriterADT writer = createFdWriter(fds[1], 64);
+
+    /** Lo acumulado y la corrida que no entra salen en un solo writev. */
+    CuAssertTrue(tc, fdWriterWrite(writer, (const uint8_t *) expected, 10));
+    CuAssertTrue(tc, fdWriterWrite(writer, (const uint8_t *) expected + 10, 990));
+    CuAssertIntEquals(tc, 1, (int) fdWriterSyscalls(writer));
+    CuAssertTrue(tc, fdWriterFlush(writer));
+    CuAssertIntEquals(tc, 1, (int) fdWriterSyscalls(writer));
+
+    deleteFdWriter(writer);
+    close(fds[1]);
+    const size_t length = drain(fds[0], data, sizeof(data));
+    close(fds[0]);
+    CuAssertIntEquals(tc, 1000, (int) length);
+    CuAssertTrue(tc, memcmp(data, expected, 1000) == 0);
+}
+
+CuSuite * getFdWriterTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testFdWriterBuffering);
+    SUITE_ADD_TEST(suite, testFdWriterLargeRun);
+    return suite;
+}
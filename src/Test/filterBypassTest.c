@@ -0,0 +1,118 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "CuTest.h"
+#include "filterBypass.h"
+#include "filterBypassTest.h"
+
+#define MEDIA_RANGE "image/*, application/pdf"
+
+static bool matches(const char * mediaRange, const char * type, const char * subtype) {
+    return filterMediaRangeMatches(mediaRange, type, strlen(type), subtype, strlen(subtype));
+}
+
+static filterSniffDecision sniff(filterSniffer * sniffer, const char * data) {
+    return filterSnifferConsume(sniffer, MEDIA_RANGE, (const uint8_t *) data, strlen(data));
+}
+
+/** Decisión para un cuerpo entero, enviado de a un byte. */
+static filterSniffDecision sniffBytes(const char * data) {
+    filterSniffer sniffer;
+    filterSniffDecision decision = FILTER_SNIFF_PENDING;
+
+    filterSnifferInit(&sniffer);
+    for(size_t i = 0; data[i] != 0; i++)
+        decision = filterSnifferConsume(&sniffer, MEDIA_RANGE, (const uint8_t *) data + i, 1);
+    return decision;
+}
+
+void testFilterMediaRangeMatches(CuTest* tc) {
+    CuAssertTrue(tc, matches(MEDIA_RANGE, "image", "png"));
+    CuAssertTrue(tc, matches(MEDIA_RANGE, "Application", "PDF"));
+    CuAssertTrue(tc, !matches(MEDIA_RANGE, "application", "pdfx"));
+    CuAssertTrue(tc, !matches(MEDIA_RANGE, "text", "plain"));
+    CuAssertTrue(tc, matches("text/plain;q=0.5", "text", "plain"));
+    CuAssertTrue(tc, matches("*/*", "text", "plain"));
+    CuAssertTrue(tc, !matches(NULL, "text", "plain"));
+
+    /** Una entrada sin '/' acepta cualquier media type. */
+    CuAssertTrue(tc, matches("image/png,text", "video", "mp4"));
+}
+
+void testFilterSnifferSinglePart(CuTest* tc) {
+    filterSniffer sniffer;
+
+    /** Se decide al terminar los headers, sin leer el cuerpo. */
+    filterSnifferInit(&sniffer);
+    CuAssertIntEquals(tc, FILTER_SNIFF_PENDING, sniff(&sniffer, "Subject: hola\r\nContent-Type: text/html;\r\n"));
+    CuAssertIntEquals(tc, FILTER_SNIFF_PENDING, sniff(&sniffer, " charset=utf-8\r\n"));
+    CuAssertIntEquals(tc, FILTER_SNIFF_BYPASS, sniff(&sniffer, "\r\ncuerpo"));
+
+    /** Un Content-Type en el media range, con lineas de continuación. */
+    CuAssertIntEquals(tc, FILTER_SNIFF_FILTER, sniffBytes("Content-Type:\r\n\tIMAGE/png\r\n\r\n"));
+
+    /** Sin Content-Type la parte es text/plain. */
+    CuAssertIntEquals(tc, FILTER_SNIFF_BYPASS, sniffBytes("Subject: a\r\n\r\nhola\r\n.\r\n"));
+
+    /** Un mensaje sin cuerpo termina con la linea de terminación. */
+    CuAssertIntEquals(tc, FILTER_SNIFF_BYPASS, sniffBytes("Subject: a\r\n.\r\n"));
+}
+
+void testFilterSnifferMultipart(CuTest* tc) {
+    const char * attachment =
+        "Content-Type: multipart/mixed; boundary=\"b1\"\r\n\r\n"
+        "preambulo\r\n--b1\r\nContent-Type: text/plain\r\n\r\n--b1x\r\n"
+        "--b1 \r\nContent-Type: multipart/alternative; boundary=b2\r\n\r\n"
+        "--b2\r\n\r\ntexto\r\n--b2--\r\n"
+        "--b1\r\nContent-Type: image/png\r\n\r\niVBOR\r\n--b1--\r\n.\r\n";
+    const char * text =
+        "Content-Type: multipart/alternative; boundary=\"=_b\"\r\n\r\n"
+        "--=_b\r\nContent-Type: text/plain\r\n\r\n...texto\r\n"
+        "--=_b\r\nContent-Type: text/html\r\n\r\n<p>\r\n--=_b--\r\n";
+
+    CuAssertIntEquals(tc, FILTER_SNIFF_FILTER, sniffBytes(attachment));
+
+    /** Se decide al cerrarse el multipart más externo. */
+    CuAssertIntEquals(tc, FILTER_SNIFF_BYPASS, sniffBytes(text));
+
+    /** Hasta ver el último boundary puede venir otra parte. */
+    filterSniffer sniffer;
+    filterSnifferInit(&sniffer);
+    CuAssertIntEquals(tc, FILTER_SNIFF_PENDING, filterSnifferConsume(&sniffer, MEDIA_RANGE, (const uint8_t *) text, strlen(text) - 9));
+}
+
+void testFilterSnifferConservative(CuTest* tc) {
+    char field[FILTER_SNIFF_HEADER_SIZE + 64];
+
+    /** Un multipart sin boundary y un mensaje adjunto se filtran. */
+    CuAssertIntEquals(tc, FILTER_SNIFF_FILTER, sniffBytes("Content-Type: multipart/mixed\r\n\r\n"));
+    CuAssertIntEquals(tc, FILTER_SNIFF_FILTER, sniffBytes("Content-Type: message/rfc822\r\n\r\n"));
+
+    /** En un multipart/digest las partes son message/rfc822 por defecto. */
+    CuAssertIntEquals(tc, FILTER_SNIFF_FILTER, sniffBytes("Content-Type: multipart/digest; boundary=d\r\n\r\n--d\r\n\r\n"));
+
+    /** Un Content-Type que no se puede leer. */
+    CuAssertIntEquals(tc, FILTER_SNIFF_FILTER, sniffBytes("Content-Type: text\r\n\r\n"));
+    CuAssertIntEquals(tc, FILTER_SNIFF_FILTER, sniffBytes("Content-Type: multipart/mixed; boundary=\"b\r\n\r\n"));
+
+    /** Un Content-Type que no entra. */
+    strcpy(field, "Content-Type: text/plain; name=\"");
+    memset(field + strlen(field), 'a', FILTER_SNIFF_HEADER_SIZE);
+    field[sizeof(field) - 8] = 0;
+    strcat(field, "\"\r\n\r\n");
+    CuAssertIntEquals(tc, FILTER_SNIFF_FILTER, sniffBytes(field));
+
+    /** Sin media range no se puede saber qué censura el filtro. */
+    filterSniffer sniffer;
+    filterSnifferInit(&sniffer);
+    CuAssertIntEquals(tc, FILTER_SNIFF_FILTER, filterSnifferConsume(&sniffer, NULL, (const uint8_t *) "\r\n", 2));
+}
+
+CuSuite * getFilterBypassTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testFilterMediaRangeMatches);
+    SUITE_ADD_TEST(suite, testFilterSnifferSinglePart);
+    SUITE_ADD_TEST(suite, testFilterSnifferMultipart);
+    SUITE_ADD_TEST(suite, testFilterSnifferConservative);
+    return suite;
+}
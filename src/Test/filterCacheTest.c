@@ -0,0 +1,197 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "CuTest.h"
+#include "filterCache.h"
+#include "filterCacheTest.h"
+
+#define ENTRY_SIZE 100
+
+static filterCacheKey keyOf(const char * body, const uint64_t config) {
+    filterCacheKey key = {
+        .body   = filterCacheHash(FILTER_CACHE_HASH_SEED, (const uint8_t *) body, strlen(body)),
+        .config = config,
+        .length = strlen(body),
+    };
+    sha256Context digest;
+    sha256Init(&digest);
+    sha256Update(&digest, (const uint8_t *) body, strlen(body));
+    sha256Final(&digest, key.digest);
+    return key;
+}
+
+/** Guarda `count' entradas de ENTRY_SIZE bytes llenas con 'a' + i. */
+static void putEntries(filterCacheADT cache, const unsigned count) {
+    uint8_t output[ENTRY_SIZE];
+    char    body[2] = {0};
+
+    for(unsigned i = 0; i < count; i++) {
+        body[0] = 'a' + i;
+        memset(output, 'a' + i, sizeof(output));
+        const filterCacheKey key = keyOf(body, 0);
+        filterCachePut(cache, &key, output, sizeof(output));
+    }
+}
+
+static bool holds(filterCacheADT cache, const char letter, filterCacheBytes * output) {
+    const char body[2] = {letter, 0};
+    const filterCacheKey key = keyOf(body, 0);
+
+    if(!filterCacheGet(cache, &key, output) || output->length != ENTRY_SIZE)
+        return false;
+    for(size_t i = 0; i < output->length; i++)
+        if(output->data[i] != letter)
+            return false;
+    return true;
+}
+
+void testFilterCacheHitAndMiss(CuTest* tc) {
+    filterCacheADT cache    = createFilterCache(4 * ENTRY_SIZE, NULL, 0);
+    filterCacheBytes output = {0};
+    const filterCacheKey key = keyOf("+OK\r\nhola\r\n.\r\n", 1);
+    const filterCacheKey otherConfig = keyOf("+OK\r\nhola\r\n.\r\n", 2);
+
+    /** El hash se puede calcular por partes. */
+    uint64_t hash = filterCacheHash(FILTER_CACHE_HASH_SEED, (const uint8_t *) "+OK\r\nho", 7);
+    CuAssertTrue(tc, filterCacheHash(hash, (const uint8_t *) "la\r\n.\r\n", 7) == key.body);
+
+    CuAssertTrue(tc, !filterCacheGet(cache, &key, &output));
+    filterCachePut(cache, &key, (const uint8_t *) "filtrado\r\n.\r\n", 13);
+    CuAssertTrue(tc, filterCacheGet(cache, &key, &output));
+    CuAssertIntEquals(tc, 13, output.length);
+    CuAssertTrue(tc, memcmp(output.data, "filtrado\r\n.\r\n", 13) == 0);
+    /** Otra configuración del filtro es otra entrada. */
+    CuAssertTrue(tc, !filterCacheGet(cache, &otherConfig, &output));
+
+    /** Las salidas que superan la fracción máxima no se guardan. */
+    uint8_t large[ENTRY_SIZE + 1] = {0};
+    filterCachePut(cache, &otherConfig, large, sizeof(large));
+    CuAssertTrue(tc, !filterCacheGet(cache, &otherConfig, &output));
+
+    filterCacheBytesFree(&output);
+    deleteFilterCache(cache);
+}
+
+void testFilterCacheSessionScope(CuTest* tc) {
+    filterCacheADT cache    = createFilterCache(4 * ENTRY_SIZE, NULL, 0);
+    filterCacheBytes output = {0};
+    const char * body       = "+OK\r\nhola\r\n.\r\n";
+    const filterCacheKey alice       = keyOf(body, filterCacheSessionConfig(1, "alice", "10.0.0.1"));
+    const filterCacheKey bob         = keyOf(body, filterCacheSessionConfig(1, "bob", "10.0.0.1"));
+    const filterCacheKey otherOrigin = keyOf(body, filterCacheSessionConfig(1, "alice", "10.0.0.2"));
+    /** El separador evita que se confundan usuario y origin. */
+    const filterCacheKey shifted     = keyOf(body, filterCacheSessionConfig(1, "alice1", "0.0.0.1"));
+
+    filterCachePut(cache, &alice, (const uint8_t *) "de alice\r\n.\r\n", 13);
+    CuAssertTrue(tc, filterCacheGet(cache, &alice, &output));
+    CuAssertTrue(tc, !filterCacheGet(cache, &bob, &output));
+    CuAssertTrue(tc, !filterCacheGet(cache, &otherOrigin, &output));
+    CuAssertTrue(tc, !filterCacheGet(cache, &shifted, &output));
+    CuAssertTrue(tc, filterCacheSessionConfig(1, NULL, "x") != filterCacheSessionConfig(1, "", "x"));
+
+    filterCacheBytesFree(&output);
+    deleteFilterCache(cache);
+}
+
+void testFilterCacheEviction(CuTest* tc) {
+    filterCacheADT cache    = createFilterCache(4 * ENTRY_SIZE, NULL, 0);
+    filterCacheBytes output = {0};
+
+    putEntries(cache, 4);
+    /** 'a' pasa a ser la más usada, se descarta 'b'. */
+    CuAssertTrue(tc, holds(cache, 'a', &output));
+    putEntries(cache, 5);
+    CuAssertTrue(tc, holds(cache, 'a', &output));
+    CuAssertTrue(tc, !holds(cache, 'b', &output));
+    CuAssertTrue(tc, holds(cache, 'e', &output));
+
+    filterCacheBytesFree(&output);
+    deleteFilterCache(cache);
+}
+
+void testFilterCacheDiskTier(CuTest* tc) {
+    char directory[]        = "/tmp/filterCacheTestXXXXXX";
+    filterCacheBytes output = {0};
+
+    CuAssertPtrNotNull(tc, mkdtemp(directory));
+    CuAssertPtrEquals(tc, NULL, createFilterCache(4 * ENTRY_SIZE, "/nonexistent/filterCache", 0));
+    filterCacheADT cache = createFilterCache(4 * ENTRY_SIZE, directory, 2 * ENTRY_SIZE);
+
+    /** 'a' y 'b' pasan al disco; al usar 'a' vuelve a memoria y baja 'c'. */
+    putEntries(cache, 6);
+    CuAssertTrue(tc, holds(cache, 'a', &output));
+    /** 'd' baja al disco lleno y se borra 'b', la menos usada. */
+    putEntries(cache, 7);
+    CuAssertTrue(tc, !holds(cache, 'b', &output));
+    CuAssertTrue(tc, holds(cache, 'c', &output));
+    CuAssertTrue(tc, holds(cache, 'g', &output));
+
+    /** Al liberar el cache se borran sus archivos. */
+    deleteFilterCache(cache);
+    CuAssertIntEquals(tc, 0, rmdir(directory));
+    filterCacheBytesFree(&output);
+}
+
+void testFilterCacheSpoolLimit(CuTest* tc) {
+    filterCacheADT cache = createFilterCache(4 * ENTRY_SIZE, NULL, 0);
+    char statistics[512];
+
+    /** Las sesiones comparten la memoria del cache, aunque cada una junte menos que una entrada. */
+    CuAssertTrue(tc, filterCacheSpoolReserve(cache, ENTRY_SIZE));
+    CuAssertTrue(tc, filterCacheSpoolReserve(cache, 3 * ENTRY_SIZE));
+    CuAssertTrue(tc, !filterCacheSpoolReserve(cache, 1));
+    filterCacheSpoolRelease(cache, ENTRY_SIZE);
+    CuAssertTrue(tc, !filterCacheSpoolReserve(cache, ENTRY_SIZE + 1));
+    CuAssertTrue(tc, filterCacheSpoolReserve(cache, ENTRY_SIZE));
+    CuAssertTrue(tc, filterCacheStatistics(cache, statistics, sizeof(statistics)) > 0);
+    CuAssertPtrNotNull(tc, strstr(statistics, "spool-full 2 "));
+    CuAssertPtrNotNull(tc, strstr(statistics, "spooled 400/400 bytes"));
+    filterCacheSpoolRelease(cache, 4 * ENTRY_SIZE);
+    CuAssertTrue(tc, filterCacheSpoolReserve(cache, 4 * ENTRY_SIZE));
+    CuAssertTrue(tc, !filterCacheSpoolReserve(NULL, 1));
+
+    deleteFilterCache(cache);
+}
+
+void testFilterCacheCollision(CuTest* tc) {
+    char directory[]        = "/tmp/filterCacheTestXXXXXX";
+    filterCacheBytes output = {0};
+    uint8_t first[ENTRY_SIZE], second[ENTRY_SIZE];
+    const filterCacheKey original = keyOf("+OK\r\nhola\r\n.\r\n", 1);
+    /** Otro cuerpo del mismo largo con el mismo FNV-1a, como lo armaría un atacante. */
+    filterCacheKey forged = keyOf("+OK\r\nchau\r\n.\r\n", 1);
+    forged.body = original.body;
+
+    CuAssertPtrNotNull(tc, mkdtemp(directory));
+    filterCacheADT cache = createFilterCache(4 * ENTRY_SIZE, directory, 2 * ENTRY_SIZE);
+    memset(first, '1', sizeof(first));
+    memset(second, '2', sizeof(second));
+
+    filterCachePut(cache, &original, first, sizeof(first));
+    CuAssertTrue(tc, !filterCacheGet(cache, &forged, &output));
+    CuAssertIntEquals(tc, 0, output.length);
+
+    /** Las dos entradas conviven, también como archivos distintos en el disco. */
+    filterCachePut(cache, &forged, second, sizeof(second));
+    putEntries(cache, 4);
+    CuAssertTrue(tc, filterCacheGet(cache, &original, &output));
+    CuAssertTrue(tc, output.length == ENTRY_SIZE && memcmp(output.data, first, ENTRY_SIZE) == 0);
+    CuAssertTrue(tc, filterCacheGet(cache, &forged, &output));
+    CuAssertTrue(tc, output.length == ENTRY_SIZE && memcmp(output.data, second, ENTRY_SIZE) == 0);
+
+    deleteFilterCache(cache);
+    CuAssertIntEquals(tc, 0, rmdir(directory));
+    filterCacheBytesFree(&output);
+}
+
+CuSuite * getFilterCacheTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testFilterCacheHitAndMiss);
+    SUITE_ADD_TEST(suite, testFilterCacheSessionScope);
+    SUITE_ADD_TEST(suite, testFilterCacheEviction);
+    SUITE_ADD_TEST(suite, testFilterCacheDiskTier);
+    SUITE_ADD_TEST(suite, testFilterCacheSpoolLimit);
+    SUITE_ADD_TEST(suite, testFilterCacheCollision);
+    return suite;
+}
@@ -0,0 +1,115 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "CuTest.h"
+#include "filterFrame.h"
+#include "filterFrameTest.h"
+
+/** Junta lo que recibe un filterFrameWriter. */
+typedef struct collected {
+    char        data[256];
+    size_t      length;
+} collected;
+
+static void collect(const uint8_t * data, const size_t length, void * writerData) {
+    collected * out = writerData;
+    memcpy(out->data + out->length, data, length);
+    out->length += length;
+    out->data[out->length] = 0;
+}
+
+/** Decodifica `data' de a `step' bytes. Retorna cuántos se consumieron. */
+static size_t decodeAll(filterFrameDecoder * decoder, const char * data, const size_t step, collected * out) {
+    const size_t length = strlen(data);
+    size_t consumed = 0;
+
+    while(consumed < length && !decoder->done) {
+        const size_t chunk = (length - consumed < step)? length - consumed : step;
+        consumed += filterFrameDecode(decoder, (const uint8_t *) data + consumed, chunk, collect, out);
+    }
+    return consumed;
+}
+
+void testFilterFrameReadHeader(CuTest* tc) {
+    const char message[] = "\0\0\0\x1a" "FILTER_MEDIAS=text/html\0X=";
+    char header[64];
+    int fds[2];
+
+    CuAssertIntEquals(tc, 0, pipe(fds));
+    CuAssertIntEquals(tc, 0, fcntl(fds[0], F_SETFD, FD_CLOEXEC));
+    CuAssertIntEquals(tc, 0, fcntl(fds[1], F_SETFD, FD_CLOEXEC));
+    CuAssertIntEquals(tc, (int) sizeof(message) - 1, (int) write(fds[1], message, sizeof(message) - 1));
+    CuAssertIntEquals(tc, 0x1a, (int) filterFrameReadHeader(fds[0], header, sizeof(header)));
+    CuAssertStrEquals(tc, "text/html", filterFrameValue(header, 0x1a, "FILTER_MEDIAS"));
+    CuAssertStrEquals(tc, "", filterFrameValue(header, 0x1a, "X"));
+    /** Un nombre que es prefijo de otro no coincide. */
+    CuAssertPtrEquals(tc, NULL, (void *) filterFrameValue(header, 0x1a, "FILTER"));
+
+    /** Un header que no entra, o cortado, es inválido. */
+    CuAssertIntEquals(tc, (int) sizeof(message) - 1, (int) write(fds[1], message, sizeof(message) - 1));
+    CuAssertIntEquals(tc, -1, (int) filterFrameReadHeader(fds[0], header, 0x1a));
+    close(fds[1]);
+    CuAssertIntEquals(tc, -1, (int) filterFrameReadHeader(fds[0], header, sizeof(header)));
+    close(fds[0]);
+}
+
+void testFilterFrameDecode(CuTest* tc) {
+    filterFrameDecoder decoder;
+    collected out = { .length = 0 };
+
+    filterFrameDecoderInit(&decoder);
+    const char * data = "a\r\n..b\r\n...\r\n.\rc\r\n.\r\nHEADER";
+    /** Se detiene después de la linea de terminación, sin entregarla. */
+    CuAssertIntEquals(tc, (int) strlen(data) - 6, (int) decodeAll(&decoder, data, 64, &out));
+    CuAssertTrue(tc, decoder.done);
+    CuAssertStrEquals(tc, "a\r\n.b\r\n..\r\n\rc\r\n", out.data);
+
+    /** Un cuerpo vacío. */
+    out.length = 0;
+    out.data[0] = 0;
+    filterFrameDecoderInit(&decoder);
+    CuAssertIntEquals(tc, 3, (int) decodeAll(&decoder, ".\r\n", 64, &out));
+    CuAssertTrue(tc, decoder.done);
+    CuAssertIntEquals(tc, 0, (int) out.length);
+}
+
+void testFilterFrameDecodeSplit(CuTest* tc) {
+    const char * data = "uno\r\n..\r\n.\r\n";
+
+    for(size_t step = 1; step <= 4; step++) {
+        filterFrameDecoder decoder;
+        collected out = { .length = 0 };
+        filterFrameDecoderInit(&decoder);
+        CuAssertIntEquals(tc, (int) strlen(data), (int) decodeAll(&decoder, data, step, &out));
+        CuAssertTrue(tc, decoder.done);
+        CuAssertStrEquals(tc, "uno\r\n.\r\n", out.data);
+    }
+}
+
+void testFilterFrameEncode(CuTest* tc) {
+    filterFrameEncoder encoder;
+    collected out = { .length = 0 };
+
+    filterFrameEncoderInit(&encoder);
+    filterFrameEncode(&encoder, (const uint8_t *) ".a\r", 3, collect, &out);
+    filterFrameEncode(&encoder, (const uint8_t *) "\n.\r\nb\nsin fin", 13, collect, &out);
+    filterFrameEncodeEnd(&encoder, collect, &out);
+    CuAssertStrEquals(tc, "..a\r\n..\r\nb\r\nsin fin\r\n.\r\n", out.data);
+
+    /** Terminar reinicia el encoder para el mensaje siguiente. */
+    out.length = 0;
+    filterFrameEncode(&encoder, (const uint8_t *) ".\r\n", 3, collect, &out);
+    filterFrameEncodeEnd(&encoder, collect, &out);
+    CuAssertStrEquals(tc, "..\r\n.\r\n", out.data);
+}
+
+CuSuite * getFilterFrameTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testFilterFrameReadHeader);
+    SUITE_ADD_TEST(suite, testFilterFrameDecode);
+    SUITE_ADD_TEST(suite, testFilterFrameDecodeSplit);
+    SUITE_ADD_TEST(suite, testFilterFrameEncode);
+    return suite;
+}
@@ -0,0 +1,113 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "CuTest.h"
+#include "filterLimit.h"
+#include "filterLimitTest.h"
+
+/** Orden en que se despertó a las sesiones. */
+static int woken[8];
+static size_t wokenCount;
+
+static void wake(void * data) {
+    woken[wokenCount++] = *(int *) data;
+}
+
+static void resetLimit(filterLimitWaiter * waiters, const size_t count, const size_t max) {
+    memset(waiters, 0, count * sizeof(*waiters));
+    wokenCount = 0;
+    filterLimitSetMax(max);
+}
+
+void testFilterLimitFifo(CuTest* tc) {
+    filterLimitWaiter waiters[4];
+    int ids[] = {0, 1, 2, 3};
+
+    resetLimit(waiters, 4, 2);
+    CuAssertTrue(tc, filterLimitAcquire(&waiters[0], wake, &ids[0]));
+    CuAssertTrue(tc, filterLimitAcquire(&waiters[1], wake, &ids[1]));
+    CuAssertTrue(tc, !filterLimitAcquire(&waiters[2], wake, &ids[2]));
+    CuAssertTrue(tc, !filterLimitAcquire(&waiters[3], wake, &ids[3]));
+    /** Pedirlo de nuevo no cambia su lugar en la cola. */
+    CuAssertTrue(tc, !filterLimitAcquire(&waiters[2], wake, &ids[2]));
+    CuAssertIntEquals(tc, 2, (int) filterLimitActive());
+    CuAssertIntEquals(tc, 2, (int) filterLimitQueued());
+
+    filterLimitRelease(&waiters[1]);
+    CuAssertIntEquals(tc, 1, (int) wokenCount);
+    CuAssertIntEquals(tc, 2, woken[0]);
+    CuAssertTrue(tc, filterLimitAcquire(&waiters[2], wake, &ids[2]));
+
+    filterLimitRelease(&waiters[0]);
+    CuAssertIntEquals(tc, 2, (int) wokenCount);
+    CuAssertIntEquals(tc, 3, woken[1]);
+    CuAssertIntEquals(tc, 0, (int) filterLimitQueued());
+
+    filterLimitRelease(&waiters[2]);
+    filterLimitRelease(&waiters[3]);
+    /** Liberar dos veces no hace nada. */
+    filterLimitRelease(&waiters[3]);
+    CuAssertIntEquals(tc, 0, (int) filterLimitActive());
+}
+
+void testFilterLimitQueuedRelease(CuTest* tc) {
+    filterLimitWaiter waiters[3];
+    int ids[] = {0, 1, 2};
+
+    resetLimit(waiters, 3, 1);
+    CuAssertTrue(tc, filterLimitAcquire(&waiters[0], wake, &ids[0]));
+    CuAssertTrue(tc, !filterLimitAcquire(&waiters[1], wake, &ids[1]));
+    CuAssertTrue(tc, !filterLimitAcquire(&waiters[2], wake, &ids[2]));
+
+    /** Una sesión que se cierra mientras espera sale de la cola sin despertar a nadie. */
+    filterLimitRelease(&waiters[1]);
+    CuAssertIntEquals(tc, 0, (int) wokenCount);
+    CuAssertIntEquals(tc, 1, (int) filterLimitQueued());
+    CuAssertIntEquals(tc, 1, (int) filterLimitActive());
+
+    filterLimitRelease(&waiters[0]);
+    CuAssertIntEquals(tc, 1, (int) wokenCount);
+    CuAssertIntEquals(tc, 2, woken[0]);
+    filterLimitRelease(&waiters[2]);
+    CuAssertIntEquals(tc, 0, (int) filterLimitActive());
+}
+
+void testFilterLimitSetMax(CuTest* tc) {
+    filterLimitWaiter waiters[4];
+    int ids[] = {0, 1, 2, 3};
+
+    resetLimit(waiters, 4, 1);
+    CuAssertTrue(tc, filterLimitAcquire(&waiters[0], wake, &ids[0]));
+    CuAssertTrue(tc, !filterLimitAcquire(&waiters[1], wake, &ids[1]));
+    CuAssertTrue(tc, !filterLimitAcquire(&waiters[2], wake, &ids[2]));
+
+    /** Al subir el máximo se admite a los que esperan, en orden. */
+    filterLimitSetMax(2);
+    CuAssertIntEquals(tc, 1, (int) wokenCount);
+    CuAssertIntEquals(tc, 1, woken[0]);
+    filterLimitSetMax(0);
+    CuAssertIntEquals(tc, 2, (int) wokenCount);
+    CuAssertIntEquals(tc, 2, woken[1]);
+    CuAssertTrue(tc, filterLimitAcquire(&waiters[3], wake, &ids[3]));
+    CuAssertIntEquals(tc, 4, (int) filterLimitActive());
+
+    /** Al bajarlo los filtros activos siguen, los nuevos esperan. */
+    filterLimitSetMax(1);
+    filterLimitRelease(&waiters[3]);
+    CuAssertIntEquals(tc, 3, (int) filterLimitActive());
+    CuAssertTrue(tc, !filterLimitAcquire(&waiters[3], wake, &ids[3]));
+    for(int i = 0; i < 3; i++)
+        filterLimitRelease(&waiters[i]);
+    CuAssertIntEquals(tc, 3, (int) wokenCount);
+    filterLimitRelease(&waiters[3]);
+    CuAssertIntEquals(tc, 0, (int) filterLimitActive());
+    filterLimitSetMax(0);
+}
+
+CuSuite * getFilterLimitTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testFilterLimitFifo);
+    SUITE_ADD_TEST(suite, testFilterLimitQueuedRelease);
+    SUITE_ADD_TEST(suite, testFilterLimitSetMax);
+    return suite;
+}
@@ -0,0 +1,208 @@
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+#include "CuTest.h"
+#include "multiplexor.h"
+#include "filterPool.h"
+#include "filterPoolTest.h"
+
+/** Los tests se ejecutan desde src, como en el Makefile. */
+#define STRIPMIME_WORKER "exec ./stripmime/stripmime.out"
+#define WRAPPER_PATH "./pop3filter/FilterWrapper/filterWrapper.out"
+#define ROUND_TRIP_TIMEOUT 5
+/** Vueltas de muxSelect de hasta un segundo que se espera un reemplazo. */
+#define MAX_SELECTS 5
+
+static bool scan(filterPoolScanner * scanner, const char * data) {
+    return filterPoolScannerConsume(scanner, (const uint8_t *) data, strlen(data));
+}
+
+void testFilterPoolHeader(CuTest* tc) {
+    uint8_t header[64];
+    const char * const names[]  = { FILTER_FRAME_COMMAND, "FILTER_MEDIAS", "POP3_USERNAME" };
+    const char * const values[] = { "cat", NULL, "bob" };
+    const char entries[] = FILTER_FRAME_COMMAND "=cat\0POP3_USERNAME=bob";
+
+    /** Los valores NULL se omiten y cada entrada termina en '\0'. */
+    const size_t length = filterPoolHeader(header, sizeof(header), names, values, 3);
+    CuAssertIntEquals(tc, 4 + sizeof(entries), length);
+    CuAssertIntEquals(tc, 0, header[0] | header[1] | header[2]);
+    CuAssertIntEquals(tc, sizeof(entries), header[3]);
+    CuAssertTrue(tc, memcmp(header + 4, entries, sizeof(entries)) == 0);
+
+    /** Un header que no entra no se arma. */
+    CuAssertIntEquals(tc, 0, filterPoolHeader(header, 20, names, values, 3));
+}
+
+void testFilterPoolScanner(CuTest* tc) {
+    filterPoolScanner scanner;
+
+    /** Una salida vacía es solo la linea de terminación. */
+    filterPoolScannerInit(&scanner);
+    CuAssertTrue(tc, scan(&scanner, ".\r\n"));
+
+    /** Las lineas con dot-stuffing no terminan la salida. */
+    filterPoolScannerInit(&scanner);
+    CuAssertTrue(tc, !scan(&scanner, "Subject: a.\r\n..\r\n.."));
+    CuAssertTrue(tc, !scan(&scanner, "dot\r\n"));
+
+    /** La linea de terminación puede llegar partida. */
+    CuAssertTrue(tc, !scan(&scanner, "fin\r\n."));
+    CuAssertTrue(tc, !scan(&scanner, "\r"));
+    CuAssertTrue(tc, scan(&scanner, "\n"));
+}
+
+/** Arma el header de un mensaje con las entradas `names'/`values'. */
+static size_t header(uint8_t * data, const size_t size, const char * const names[], const char * const values[], const size_t count) {
+    return filterPoolHeader(data, size, names, values, count);
+}
+
+/**
+ * Envía `body' a un worker ya tomado y deja en `output' su salida, hasta la
+ * linea de terminación. Retorna false si no llegó a tiempo.
+ */
+static bool roundTrip(const int fd, const char * body, char * output, const size_t size) {
+    struct timeval timeout = { .tv_sec = ROUND_TRIP_TIMEOUT, .tv_usec = 0 };
+    filterPoolScanner scanner;
+    size_t length = 0;
+    fd_set readSet;
+
+    if(send(fd, body, strlen(body), MSG_NOSIGNAL) != (ssize_t) strlen(body))
+        return false;
+    filterPoolScannerInit(&scanner);
+    while(!scanner.done && length < size - 1) {
+        FD_ZERO(&readSet);
+        FD_SET(fd, &readSet);
+        if(select(fd + 1, &readSet, NULL, NULL, &timeout) != 1)
+            return false;
+        const ssize_t n = read(fd, output + length, size - 1 - length);
+        if(n <= 0)
+            return false;
+        filterPoolScannerConsume(&scanner, (const uint8_t *) output + length, n);
+        length += n;
+    }
+    output[length] = 0;
+    return scanner.done;
+}
+
+void testFilterPoolNativeRoundTrip(CuTest* tc) {
+    const char * const names[]  = { FILTER_FRAME_COMMAND, "FILTER_MEDIAS", "FILTER_MSG" };
+    const char * const values[] = { STRIPMIME_WORKER, "text/html", "quitado" };
+    const char * body = "Content-Type: text/html\r\n\r\n<p>hola</p>\r\n.\r\n";
+    const char * plain = "Subject: a\r\n\r\n..punto\r\n.\r\n";
+    uint8_t data[256];
+    char output[256];
+    size_t worker;
+    int fd;
+
+    CuAssertTrue(tc, filterPoolInit(NULL, NULL, STRIPMIME_WORKER, NULL, 1));
+    const size_t length = header(data, sizeof(data), names, values, 3);
+    fd = filterPoolAcquire(STRIPMIME_WORKER, NULL, data, length, &worker);
+    CuAssertTrue(tc, fd >= 0);
+    const pid_t pid = filterPoolWorkerPid(worker);
+    CuAssertTrue(tc, roundTrip(fd, body, output, sizeof(output)));
+    CuAssertStrEquals(tc, "Content-Type:text/plain; charset=\"UTF-8\"\r\n"
+                          "Content-Transfer-Encoding: quoted-printable\r\nquitado\r\n.\r\n", output);
+    filterPoolRelease(worker, true);
+
+    /** El mismo proceso atiende el mensaje siguiente. */
+    fd = filterPoolAcquire(STRIPMIME_WORKER, NULL, data, length, &worker);
+    CuAssertTrue(tc, fd >= 0);
+    CuAssertIntEquals(tc, pid, filterPoolWorkerPid(worker));
+    CuAssertTrue(tc, roundTrip(fd, plain, output, sizeof(output)));
+    CuAssertStrEquals(tc, plain, output);
+    filterPoolRelease(worker, true);
+
+    /** Con todos ocupados el mensaje se filtra sin pool. */
+    CuAssertTrue(tc, filterPoolAcquire(STRIPMIME_WORKER, NULL, data, length, &worker) >= 0);
+    CuAssertIntEquals(tc, -1, filterPoolAcquire(STRIPMIME_WORKER, NULL, data, length, &worker));
+    filterPoolDestroy();
+}
+
+void testFilterPoolCompatRoundTrip(CuTest* tc) {
+    const char * const names[]  = { FILTER_FRAME_COMMAND };
+    const char * const values[] = { "tr a-z A-Z" };
+    uint8_t data[64];
+    char output[256];
+    size_t worker;
+
+    CuAssertTrue(tc, filterPoolInit(NULL, WRAPPER_PATH, NULL, NULL, 1));
+    const size_t length = header(data, sizeof(data), names, values, 1);
+    const int fd = filterPoolAcquire(NULL, NULL, data, length, &worker);
+    CuAssertTrue(tc, fd >= 0);
+    CuAssertTrue(tc, roundTrip(fd, "hola\r\n..punto\r\n.\r\n", output, sizeof(output)));
+    CuAssertStrEquals(tc, "HOLA\r\n..PUNTO\r\n.\r\n", output);
+    filterPoolRelease(worker, true);
+
+    /** Pasar a modo nativo reemplaza al worker libre. */
+    const pid_t pid = filterPoolWorkerPid(worker);
+    CuAssertTrue(tc, filterPoolAcquire(STRIPMIME_WORKER, NULL, data, length, &worker) >= 0);
+    CuAssertTrue(tc, pid != filterPoolWorkerPid(worker));
+    filterPoolRelease(worker, false);
+    filterPoolDestroy();
+}
+
+/** Atiende el multiplexor hasta que el worker deja de tener el pid `pid'. */
+static bool waitReplaced(MultiplexorADT mux, const pid_t pid) {
+    for(unsigned i = 0; i < MAX_SELECTS && filterPoolWorkerPid(0) == pid; i++)
+        if(MUX_SUCCESS != muxSelect(mux))
+            return false;
+    return filterPoolWorkerPid(0) != pid;
+}
+
+void testFilterPoolWorkerCrash(CuTest* tc) {
+    const struct multiplexorInit init = {
+        .signal        = SIGALRM,
+        .selectTimeout = { .tv_sec = 1, .tv_nsec = 0 },
+    };
+    const char * const names[]  = { "FILTER_MEDIAS" };
+    const char * const values[] = { "text/html" };
+    char statistics[512];
+    uint8_t data[64];
+    char output[64];
+    size_t worker;
+
+    CuAssertIntEquals(tc, MUX_SUCCESS, multiplexorInit(&init));
+    MultiplexorADT mux = createMultiplexorADT(FDS_MAX_SIZE / 4);
+    CuAssertPtrNotNull(tc, mux);
+    CuAssertTrue(tc, filterPoolInit(mux, NULL, STRIPMIME_WORKER, NULL, 1));
+
+    /** Un worker libre que termina se reemplaza sin esperar a usarlo. */
+    const pid_t pid = filterPoolWorkerPid(0);
+    CuAssertTrue(tc, pid > 0);
+    kill(pid, SIGKILL);
+    CuAssertTrue(tc, waitReplaced(mux, pid));
+    const pid_t replaced = filterPoolWorkerPid(0);
+    CuAssertTrue(tc, replaced > 0);
+    filterPoolStatistics(statistics, sizeof(statistics));
+    CuAssertTrue(tc, strstr(statistics, "restarts 1") != NULL);
+
+    /** Si vuelve a terminar enseguida se lanza recién al usarlo. */
+    kill(replaced, SIGKILL);
+    CuAssertTrue(tc, waitReplaced(mux, replaced));
+    CuAssertIntEquals(tc, 0, filterPoolWorkerPid(0));
+    const size_t length = header(data, sizeof(data), names, values, 1);
+    const int fd = filterPoolAcquire(STRIPMIME_WORKER, NULL, data, length, &worker);
+    CuAssertTrue(tc, fd >= 0);
+    CuAssertTrue(tc, roundTrip(fd, "Subject: a\r\n\r\nhola\r\n.\r\n", output, sizeof(output)));
+    CuAssertStrEquals(tc, "Subject: a\r\n\r\nhola\r\n.\r\n", output);
+    filterPoolRelease(worker, true);
+
+    filterPoolDestroy();
+    deleteMultiplexorADT(mux);
+    multiplexorClose();
+}
+
+CuSuite * getFilterPoolTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testFilterPoolHeader);
+    SUITE_ADD_TEST(suite, testFilterPoolScanner);
+    SUITE_ADD_TEST(suite, testFilterPoolNativeRoundTrip);
+    SUITE_ADD_TEST(suite, testFilterPoolCompatRoundTrip);
+    SUITE_ADD_TEST(suite, testFilterPoolWorkerCrash);
+    return suite;
+}
@@ -0,0 +1,217 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+
+#include "CuTest.h"
+#include "buffer.h"
+#include "filterStuff.h"
+#include "filterStuffTest.h"
+
+#define BODY_SIZE 64
+
+static void setUp(filterStuffStruct * stuff, bufferADT * body) {
+    memset(stuff, 0, sizeof(*stuff));
+    filterStuffReset(stuff);
+    *body = createBuffer(BODY_SIZE + 1);
+}
+
+static void tearDown(filterStuffStruct * stuff, bufferADT body) {
+    filterStuffFree(stuff);
+    deleteBuffer(body);
+}
+
+/** Quita el dot-stuffing de `data' entregándolo de a `step' bytes y deja el cuerpo en `out'. */
+static size_t unstuffAll(filterStuffStruct * stuff, bufferADT body, const char * data, const size_t step, char * out) {
+    const size_t length = strlen(data);
+    size_t consumed = 0, outLength = 0, size;
+
+    while(consumed < length) {
+        const size_t chunk = (length - consumed < step)? length - consumed : step;
+        const size_t n = filterUnstuff(stuff, body, (const uint8_t *) data + consumed, chunk);
+        const uint8_t * ptr = getReadPtr(body, &size);
+        memcpy(out + outLength, ptr, size);
+        outLength += size;
+        reset(body);
+        consumed += n;
+    }
+    out[outLength] = 0;
+    return consumed;
+}
+
+static void assertOutput(CuTest * tc, const char * expected, const filterStuffStruct * stuff) {
+    CuAssertIntEquals(tc, (int) strlen(expected), (int) stuff->output.length);
+    CuAssertTrue(tc, memcmp(expected, stuff->output.data, stuff->output.length) == 0);
+}
+
+void testFilterUnstuff(CuTest* tc) {
+    filterStuffStruct stuff;
+    bufferADT body;
+    char out[128];
+
+    setUp(&stuff, &body);
+    const char * data = "Subject: a\r\n\r\n..punto\r\n...\r\nfin\r\n.\r\n";
+    CuAssertIntEquals(tc, (int) strlen(data), (int) unstuffAll(&stuff, body, data, BODY_SIZE, out));
+    CuAssertStrEquals(tc, "Subject: a\r\n\r\n.punto\r\n..\r\nfin\r\n", out);
+    tearDown(&stuff, body);
+}
+
+void testFilterUnstuffSplitEnd(CuTest* tc) {
+    filterStuffStruct stuff;
+    bufferADT body;
+    char out[128];
+
+    /** La linea de terminación partida en todas las lecturas posibles. */
+    for(size_t step = 1; step <= 6; step++) {
+        setUp(&stuff, &body);
+        const char * data = "hola\r\n.\r\n+OK siguiente\r\n";
+        CuAssertIntEquals(tc, (int) strlen(data), (int) unstuffAll(&stuff, body, data, step, out));
+        /** Lo que sigue a la linea de terminación se consume sin copiarlo. */
+        CuAssertStrEquals(tc, "hola\r\n", out);
+        tearDown(&stuff, body);
+    }
+}
+
+/** Crea un pipe no bloqueante sin heredar en los procesos que lancen otros tests. */
+static void nonBlockingPipe(CuTest * tc, int fds[2]) {
+    CuAssertIntEquals(tc, 0, pipe(fds));
+    for(int i = 0; i < 2; i++) {
+        CuAssertIntEquals(tc, 0, fcntl(fds[i], F_SETFD, FD_CLOEXEC));
+        CuAssertIntEquals(tc, 0, fcntl(fds[i], F_SETFL, O_NONBLOCK));
+    }
+}
+
+void testFilterStuffToCommand(CuTest* tc) {
+    filterStuffStruct stuff;
+    bufferADT body;
+    char out[128] = {0};
+    int fds[2];
+
+    setUp(&stuff, &body);
+    nonBlockingPipe(tc, fds);
+    const char * data = "..uno\r\ndos\r\n.\r\n";
+    CuAssertIntEquals(tc, 7, (int) filterStuffToCommand(&stuff, body, fds[1], (const uint8_t *) data, 7));
+    CuAssertIntEquals(tc, (int) strlen(data) - 7, (int) filterStuffToCommand(&stuff, body, fds[1], (const uint8_t *) data + 7, strlen(data) - 7));
+    CuAssertTrue(tc, !stuff.inputClosed);
+    CuAssertIntEquals(tc, 0, (int) stuff.input.length);
+    CuAssertIntEquals(tc, 11, (int) read(fds[0], out, sizeof(out)));
+    CuAssertStrEquals(tc, ".uno\r\ndos\r\n", out);
+
+    close(fds[0]);
+    close(fds[1]);
+    tearDown(&stuff, body);
+}
+
+void testFilterStuffToCommandPending(CuTest* tc) {
+    filterStuffStruct stuff;
+    bufferADT body;
+    char out[128] = {0}, filler[4096];
+    int fds[2];
+
+    setUp(&stuff, &body);
+    nonBlockingPipe(tc, fds);
+    memset(filler, 'x', sizeof(filler));
+    size_t full = 0;
+    ssize_t n;
+    while((n = write(fds[1], filler, sizeof(filler))) > 0)
+        full += n;
+
+    /** Lo que el comando no acepta se guarda y el cuerpo se da por consumido. */
+    const char * data = "hola\r\n.\r\n";
+    CuAssertIntEquals(tc, (int) strlen(data), (int) filterStuffToCommand(&stuff, body, fds[1], (const uint8_t *) data, strlen(data)));
+    CuAssertIntEquals(tc, 6, (int) (stuff.input.length - stuff.inputSent));
+    /** Con la entrada llena no se consume más. */
+    CuAssertIntEquals(tc, 0, (int) filterStuffToCommand(&stuff, body, fds[1], (const uint8_t *) data, strlen(data)));
+
+    while(full > 0 && (n = read(fds[0], filler, (full < sizeof(filler))? full : sizeof(filler))) > 0)
+        full -= n;
+    CuAssertIntEquals(tc, 0, (int) filterStuffToCommand(&stuff, body, fds[1], NULL, 0));
+    CuAssertIntEquals(tc, 0, (int) stuff.input.length);
+    CuAssertIntEquals(tc, 6, (int) read(fds[0], out, sizeof(out)));
+    CuAssertStrEquals(tc, "hola\r\n", out);
+
+    close(fds[0]);
+    close(fds[1]);
+    tearDown(&stuff, body);
+}
+
+void testFilterStuffToCommandClosed(CuTest* tc) {
+    filterStuffStruct stuff;
+    bufferADT body;
+    int fds[2];
+    void (*previous)(int) = signal(SIGPIPE, SIG_IGN);
+
+    setUp(&stuff, &body);
+    nonBlockingPipe(tc, fds);
+    close(fds[0]);
+    /** Si el comando cerró su entrada el resto del cuerpo se consume igual. */
+    const char * data = "uno\r\ndos\r\n.\r\n";
+    CuAssertIntEquals(tc, 5, (int) filterStuffToCommand(&stuff, body, fds[1], (const uint8_t *) data, 5));
+    CuAssertTrue(tc, stuff.inputClosed);
+    CuAssertIntEquals(tc, (int) strlen(data) - 5, (int) filterStuffToCommand(&stuff, body, fds[1], (const uint8_t *) data + 5, strlen(data) - 5));
+    CuAssertIntEquals(tc, 0, (int) stuff.input.length);
+
+    close(fds[1]);
+    signal(SIGPIPE, previous);
+    tearDown(&stuff, body);
+}
+
+void testFilterStuffOutput(CuTest* tc) {
+    filterStuffStruct stuff;
+    bufferADT body;
+
+    setUp(&stuff, &body);
+    /** El '\r' y el '\n' pueden llegar en lecturas distintas. */
+    filterStuffOutput(&stuff, (const uint8_t *) "uno\r", 4);
+    filterStuffOutput(&stuff, (const uint8_t *) "\n.dos\r\n", 7);
+    filterStuffOutput(&stuff, (const uint8_t *) "tres\ncuatro\n", 12);
+    CuAssertTrue(tc, !stuff.complete);
+    filterStuffOutput(&stuff, NULL, 0);
+    CuAssertTrue(tc, stuff.complete);
+    assertOutput(tc, "uno\r\n..dos\r\ntres\r\ncuatro\r\n.\r\n", &stuff);
+    tearDown(&stuff, body);
+}
+
+void testFilterStuffOutputDotLine(CuTest* tc) {
+    filterStuffStruct stuff;
+    bufferADT body;
+
+    setUp(&stuff, &body);
+    /** Una salida que empieza con la linea de terminación no termina el mensaje. */
+    filterStuffOutput(&stuff, (const uint8_t *) ".", 1);
+    filterStuffOutput(&stuff, (const uint8_t *) "\r\n..\r\n", 6);
+    filterStuffOutput(&stuff, NULL, 0);
+    assertOutput(tc, "..\r\n...\r\n.\r\n", &stuff);
+    tearDown(&stuff, body);
+}
+
+void testFilterStuffOutputNoFinalCRLF(CuTest* tc) {
+    filterStuffStruct stuff;
+    bufferADT body;
+
+    setUp(&stuff, &body);
+    filterStuffOutput(&stuff, (const uint8_t *) "uno\r\nsin fin", 12);
+    filterStuffOutput(&stuff, NULL, 0);
+    assertOutput(tc, "uno\r\nsin fin\r\n.\r\n", &stuff);
+    filterStuffFree(&stuff);
+
+    /** Una salida vacía es un cuerpo vacío. */
+    filterStuffReset(&stuff);
+    filterStuffEnd(&stuff);
+    assertOutput(tc, ".\r\n", &stuff);
+    tearDown(&stuff, body);
+}
+
+CuSuite * getFilterStuffTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testFilterUnstuff);
+    SUITE_ADD_TEST(suite, testFilterUnstuffSplitEnd);
+    SUITE_ADD_TEST(suite, testFilterStuffToCommand);
+    SUITE_ADD_TEST(suite, testFilterStuffToCommandPending);
+    SUITE_ADD_TEST(suite, testFilterStuffToCommandClosed);
+    SUITE_ADD_TEST(suite, testFilterStuffOutput);
+    SUITE_ADD_TEST(suite, testFilterStuffOutputDotLine);
+    SUITE_ADD_TEST(suite, testFilterStuffOutputNoFinalCRLF);
+    return suite;
+}
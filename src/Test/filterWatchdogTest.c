@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "CuTest.h"
+#include "filterWatchdog.h"
+#include "filterWatchdogTest.h"
+
+/** `now' corrido `ms' milisegundos. */
+static struct timespec shifted(const struct timespec * now, const long ms) {
+    struct timespec ret = *now;
+    long long nanos = ret.tv_nsec + ms * 1000000LL;
+
+    ret.tv_sec += nanos / 1000000000LL;
+    nanos      %= 1000000000LL;
+    if(nanos < 0) {
+        nanos += 1000000000LL;
+        ret.tv_sec--;
+    }
+    ret.tv_nsec = nanos;
+    return ret;
+}
+
+void testFilterWatchdogParse(CuTest* tc) {
+    unsigned firstByte, total, perMiB;
+    filterWatchdogFallback fallback;
+
+    CuAssertTrue(tc, filterWatchdogParseDeadlines("500,2000", &firstByte, &total, &perMiB));
+    CuAssertIntEquals(tc, 500, (int) firstByte);
+    CuAssertIntEquals(tc, 2000, (int) total);
+    CuAssertIntEquals(tc, 0, (int) perMiB);
+    CuAssertTrue(tc, filterWatchdogParseDeadlines("0,100,25", &firstByte, &total, &perMiB));
+    CuAssertIntEquals(tc, 0, (int) firstByte);
+    CuAssertIntEquals(tc, 25, (int) perMiB);
+    CuAssertTrue(tc, !filterWatchdogParseDeadlines("500", &firstByte, &total, &perMiB));
+    CuAssertTrue(tc, !filterWatchdogParseDeadlines("500,", &firstByte, &total, &perMiB));
+    CuAssertTrue(tc, !filterWatchdogParseDeadlines("-1,200", &firstByte, &total, &perMiB));
+    CuAssertTrue(tc, !filterWatchdogParseDeadlines("1,2,3,4", &firstByte, &total, &perMiB));
+    CuAssertTrue(tc, !filterWatchdogParseDeadlines("1,2ms", &firstByte, &total, &perMiB));
+
+    CuAssertTrue(tc, filterWatchdogParseFallback("replace", &fallback));
+    CuAssertIntEquals(tc, FILTER_FALLBACK_REPLACE, fallback);
+    CuAssertTrue(tc, filterWatchdogParseFallback("error", &fallback));
+    CuAssertIntEquals(tc, FILTER_FALLBACK_ERROR, fallback);
+    CuAssertTrue(tc, filterWatchdogParseFallback("pass", &fallback));
+    CuAssertIntEquals(tc, FILTER_FALLBACK_PASS, fallback);
+    CuAssertTrue(tc, !filterWatchdogParseFallback("drop", &fallback));
+}
+
+void testFilterWatchdogDeadlines(CuTest* tc) {
+    filterWatchdog watchdog;
+    struct timespec now;
+    unsigned remaining;
+
+    filterWatchdogSetDeadlines(100, 1000, 500);
+    filterWatchdogStart(&watchdog);
+
+    now = shifted(&watchdog.start, 40);
+    CuAssertIntEquals(tc, FILTER_WATCHDOG_RUNNING, filterWatchdogCheck(&watchdog, &now, &remaining));
+    CuAssertIntEquals(tc, 60, (int) remaining);
+    now = shifted(&watchdog.start, 100);
+    CuAssertIntEquals(tc, FILTER_WATCHDOG_FIRST_BYTE, filterWatchdogCheck(&watchdog, &now, &remaining));
+
+    /** Con salida solo queda el plazo total, que crece con el cuerpo entregado. */
+    watchdog.output = true;
+    CuAssertIntEquals(tc, FILTER_WATCHDOG_RUNNING, filterWatchdogCheck(&watchdog, &now, &remaining));
+    CuAssertIntEquals(tc, 900, (int) remaining);
+    now = shifted(&watchdog.start, 1200);
+    CuAssertIntEquals(tc, FILTER_WATCHDOG_TOTAL, filterWatchdogCheck(&watchdog, &now, &remaining));
+    filterWatchdogFed(&watchdog, 1024 * 1024);
+    CuAssertIntEquals(tc, FILTER_WATCHDOG_RUNNING, filterWatchdogCheck(&watchdog, &now, &remaining));
+    CuAssertIntEquals(tc, 300, (int) remaining);
+
+    filterWatchdogStop(&watchdog);
+    now = shifted(&watchdog.start, 100000);
+    CuAssertIntEquals(tc, FILTER_WATCHDOG_RUNNING, filterWatchdogCheck(&watchdog, &now, &remaining));
+    CuAssertIntEquals(tc, 0, (int) remaining);
+
+    filterWatchdogSetDeadlines(0, 0, 0);
+    CuAssertTrue(tc, !filterWatchdogEnabled());
+}
+
+void testFilterWatchdogBatch(CuTest* tc) {
+    filterWatchdog watchdog;
+    struct timespec now;
+    unsigned remaining;
+
+    filterWatchdogSetDeadlines(100, 1000, 500);
+    /** Mientras se junta el cuerpo no corre ningún plazo, pero cuentan los bytes. */
+    filterWatchdogCollect(&watchdog);
+    filterWatchdogFed(&watchdog, 1024 * 1024);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    now.tv_sec += 60;
+    CuAssertIntEquals(tc, FILTER_WATCHDOG_RUNNING, filterWatchdogCheck(&watchdog, &now, &remaining));
+    CuAssertIntEquals(tc, 0, (int) remaining);
+
+    /** Al lanzar el comando el primer byte se mide desde ese momento. */
+    filterWatchdogLaunch(&watchdog);
+    now = shifted(&watchdog.start, 40);
+    CuAssertIntEquals(tc, FILTER_WATCHDOG_RUNNING, filterWatchdogCheck(&watchdog, &now, &remaining));
+    CuAssertIntEquals(tc, 60, (int) remaining);
+    watchdog.output = true;
+    CuAssertIntEquals(tc, FILTER_WATCHDOG_RUNNING, filterWatchdogCheck(&watchdog, &now, &remaining));
+    CuAssertIntEquals(tc, 1460, (int) remaining);
+
+    filterWatchdogStop(&watchdog);
+    filterWatchdogSetDeadlines(0, 0, 0);
+}
+
+void testFilterWatchdogFallback(CuTest* tc) {
+    filterWatchdog watchdog;
+
+    filterWatchdogSetDeadlines(100, 0, 0);
+    filterWatchdogSetFallback(FILTER_FALLBACK_PASS);
+    filterWatchdogStart(&watchdog);
+    CuAssertIntEquals(tc, FILTER_FALLBACK_PASS, filterWatchdogExpire(&watchdog, FILTER_WATCHDOG_FIRST_BYTE, true));
+    CuAssertTrue(tc, !watchdog.running);
+    /** Sin el cuerpo guardado se envía el reemplazo. */
+    filterWatchdogStart(&watchdog);
+    CuAssertIntEquals(tc, FILTER_FALLBACK_REPLACE, filterWatchdogExpire(&watchdog, FILTER_WATCHDOG_FIRST_BYTE, false));
+    /** Con parte de la salida enviada el cuerpo no se puede completar. */
+    filterWatchdogStart(&watchdog);
+    watchdog.output = true;
+    CuAssertIntEquals(tc, FILTER_FALLBACK_ERROR, filterWatchdogExpire(&watchdog, FILTER_WATCHDOG_TOTAL, true));
+    filterWatchdogSetFallback(FILTER_FALLBACK_REPLACE);
+    filterWatchdogStart(&watchdog);
+    CuAssertIntEquals(tc, FILTER_FALLBACK_REPLACE, filterWatchdogExpire(&watchdog, FILTER_WATCHDOG_FIRST_BYTE, true));
+    filterWatchdogSetFallback(FILTER_FALLBACK_PASS);
+    filterWatchdogSetDeadlines(0, 0, 0);
+}
+
+void testFilterWatchdogPercentiles(CuTest* tc) {
+    filterWatchdog watchdog;
+
+    filterWatchdogReset();
+    CuAssertTrue(tc, filterWatchdogFirstBytePercentile(50) == 0.0);
+    for(int i = 0; i < 100; i++) {
+        filterWatchdogStart(&watchdog);
+        watchdog.start = shifted(&watchdog.start, (i < 90)? -1 : -100);
+        filterWatchdogOutput(&watchdog);
+        /** Solo cuenta el primer byte. */
+        filterWatchdogOutput(&watchdog);
+        filterWatchdogDone(&watchdog);
+    }
+    /** Cada intervalo abarca un cuarto de potencia de 2, el error es menor al 25%. */
+    CuAssertTrue(tc, filterWatchdogFirstBytePercentile(50) >= 1.0 && filterWatchdogFirstBytePercentile(50) < 1.3);
+    CuAssertTrue(tc, filterWatchdogFirstBytePercentile(90) < 1.3);
+    CuAssertTrue(tc, filterWatchdogFirstBytePercentile(99) >= 100.0 && filterWatchdogFirstBytePercentile(99) < 130.0);
+    CuAssertTrue(tc, filterWatchdogTotalPercentile(99) >= 100.0 && filterWatchdogTotalPercentile(99) < 130.0);
+
+    char buffer[512];
+    CuAssertTrue(tc, filterWatchdogStatistics(buffer, sizeof(buffer)) > 0);
+    CuAssertTrue(tc, strstr(buffer, "first-byte-p99-ms") != NULL);
+    filterWatchdogReset();
+}
+
+CuSuite * getFilterWatchdogTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testFilterWatchdogParse);
+    SUITE_ADD_TEST(suite, testFilterWatchdogDeadlines);
+    SUITE_ADD_TEST(suite, testFilterWatchdogBatch);
+    SUITE_ADD_TEST(suite, testFilterWatchdogFallback);
+    SUITE_ADD_TEST(suite, testFilterWatchdogPercentiles);
+    return suite;
+}
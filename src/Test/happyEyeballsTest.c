@@ -0,0 +1,90 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "CuTest.h"
+#include "happyEyeballs.h"
+#include "happyEyeballsTest.h"
+
+static socklen_t ipv4(struct sockaddr_storage * storage, uint32_t ip) {
+    struct sockaddr_in * addr = (struct sockaddr_in *) storage;
+    memset(storage, 0, sizeof(*storage));
+    addr->sin_family      = AF_INET;
+    addr->sin_port        = htons(110);
+    addr->sin_addr.s_addr = htonl(ip);
+    return sizeof(*addr);
+}
+
+static socklen_t ipv6(struct sockaddr_storage * storage, uint8_t last) {
+    struct sockaddr_in6 * addr = (struct sockaddr_in6 *) storage;
+    memset(storage, 0, sizeof(*storage));
+    addr->sin6_family           = AF_INET6;
+    addr->sin6_port             = htons(110);
+    addr->sin6_addr.s6_addr[0]  = 0x20;
+    addr->sin6_addr.s6_addr[15] = last;
+    return sizeof(*addr);
+}
+
+static sa_family_t family(const happyEyeballsStruct * eyeballs, const size_t i) {
+    return eyeballs->addresses[i].ss_family;
+}
+
+void testHappyEyeballsInterleavesFamilies(CuTest* tc) {
+    struct sockaddr_storage addresses[4];
+    socklen_t               lengths[4];
+    happyEyeballsStruct     eyeballs;
+
+    lengths[0] = ipv6(addresses + 0, 1);
+    lengths[1] = ipv6(addresses + 1, 2);
+    lengths[2] = ipv6(addresses + 2, 3);
+    lengths[3] = ipv4(addresses + 3, 0x0A000001);
+    happyEyeballsInit(&eyeballs, addresses, lengths, 4, 1000);
+
+    CuAssertIntEquals(tc, 4, eyeballs.count);
+    CuAssertIntEquals(tc, AF_INET6, family(&eyeballs, 0));
+    CuAssertIntEquals(tc, AF_INET, family(&eyeballs, 1));
+    CuAssertIntEquals(tc, AF_INET6, family(&eyeballs, 2));
+    CuAssertIntEquals(tc, AF_INET6, family(&eyeballs, 3));
+    /** Dentro de cada familia se respeta el orden del resolver. */
+    CuAssertTrue(tc, 0 == memcmp(eyeballs.addresses + 2, addresses + 1, lengths[1]));
+    CuAssertIntEquals(tc, -1, eyeballs.timerFd);
+    CuAssertIntEquals(tc, -1, happyEyeballsFind(&eyeballs, 3));
+}
+
+void testHappyEyeballsFailedLast(CuTest* tc) {
+    struct sockaddr_storage addresses[3];
+    socklen_t               lengths[3];
+    happyEyeballsStruct     eyeballs;
+
+    lengths[0] = ipv4(addresses + 0, 0x0A000101);
+    lengths[1] = ipv4(addresses + 1, 0x0A000102);
+    lengths[2] = ipv4(addresses + 2, 0x0A000103);
+    happyEyeballsFailed((struct sockaddr *) addresses, 2000);
+    happyEyeballsInit(&eyeballs, addresses, lengths, 3, 2010);
+
+    CuAssertTrue(tc, 0 == memcmp(eyeballs.addresses + 0, addresses + 1, lengths[1]));
+    CuAssertTrue(tc, 0 == memcmp(eyeballs.addresses + 1, addresses + 2, lengths[2]));
+    /** La dirección que falló se intenta igual, pero al final. */
+    CuAssertTrue(tc, 0 == memcmp(eyeballs.addresses + 2, addresses + 0, lengths[0]));
+
+    happyEyeballsSucceeded((struct sockaddr *) addresses);
+    CuAssertTrue(tc, !happyEyeballsRecentlyFailed((struct sockaddr *) addresses, 2010));
+}
+
+void testHappyEyeballsFailureExpires(CuTest* tc) {
+    struct sockaddr_storage address;
+    ipv6(&address, 0x42);
+
+    happyEyeballsFailed((struct sockaddr *) &address, 3000);
+    CuAssertTrue(tc, happyEyeballsRecentlyFailed((struct sockaddr *) &address, 3000 + HAPPY_EYEBALLS_FAILURE_TTL - 1));
+    CuAssertTrue(tc, !happyEyeballsRecentlyFailed((struct sockaddr *) &address, 3000 + HAPPY_EYEBALLS_FAILURE_TTL));
+}
+
+CuSuite * getHappyEyeballsTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testHappyEyeballsInterleavesFamilies);
+    SUITE_ADD_TEST(suite, testHappyEyeballsFailedLast);
+    SUITE_ADD_TEST(suite, testHappyEyeballsFailureExpires);
+    return suite;
+}
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "CuTest.h"
+#include "hashRing.h"
+#include "hashRingTest.h"
+
+#define KEYS 2000
+
+static size_t lookup(hashRingADT ring, const char * key) {
+    size_t node = (size_t) -1;
+    hashRingLookup(ring, (const uint8_t *) key, strlen(key), &node);
+    return node;
+}
+
+static hashRingADT createTestRing(const size_t nodes) {
+    char        name[48];
+    hashRingADT ring = createHashRing(160);
+    for(size_t i = 0; i < nodes; i++) {
+        snprintf(name, sizeof(name), "origin%zu.example.org", i);
+        hashRingAdd(ring, i, name);
+    }
+    return ring;
+}
+
+static bool rejectFirst(const size_t node, void * data) {
+    return node != *(const size_t *) data;
+}
+
+void testHashRingStableLookup(CuTest* tc) {
+    hashRingADT ring  = createTestRing(4);
+    size_t      other = 0;
+
+    CuAssertIntEquals(tc, 4 * 160, hashRingPoints(ring));
+    CuAssertTrue(tc, lookup(ring, "alice") < 4);
+    CuAssertIntEquals(tc, lookup(ring, "alice"), lookup(ring, "alice"));
+
+    hashRingADT copy  = createTestRing(4);
+    hashRingADT empty = createHashRing(1);
+    CuAssertIntEquals(tc, lookup(ring, "alice"), lookup(copy, "alice"));
+    CuAssertTrue(tc, !hashRingLookup(empty, (const uint8_t *) "a", 1, &other));
+
+    deleteHashRing(empty);
+    deleteHashRing(copy);
+    deleteHashRing(ring);
+}
+
+void testHashRingMinimalMovement(CuTest* tc) {
+    char        key[32];
+    size_t      before[KEYS];
+    hashRingADT ring  = createTestRing(4);
+    unsigned    moved = 0;
+
+    for(size_t i = 0; i < KEYS; i++) {
+        snprintf(key, sizeof(key), "user%zu", i);
+        before[i] = lookup(ring, key);
+    }
+    hashRingRemove(ring, 2);
+    for(size_t i = 0; i < KEYS; i++) {
+        snprintf(key, sizeof(key), "user%zu", i);
+        const size_t after = lookup(ring, key);
+        CuAssertTrue(tc, after != 2);
+        if(after != before[i]) {
+            /** Solo se mueven las claves del nodo quitado. */
+            CuAssertIntEquals(tc, 2, before[i]);
+            moved++;
+        }
+    }
+    CuAssertTrue(tc, moved > 0);
+    deleteHashRing(ring);
+}
+
+void testHashRingBalance(CuTest* tc) {
+    char        key[32];
+    unsigned    counts[4] = { 0 };
+    hashRingADT ring = createTestRing(4);
+
+    for(size_t i = 0; i < KEYS; i++) {
+        snprintf(key, sizeof(key), "user%zu", i);
+        counts[lookup(ring, key)]++;
+    }
+    /** Con 160 puntos por nodo cada uno recibe cerca de un cuarto. */
+    for(size_t i = 0; i < 4; i++)
+        CuAssertTrue(tc, counts[i] > KEYS / 8 && counts[i] < KEYS / 2);
+    deleteHashRing(ring);
+}
+
+void testHashRingFilterSkipsNode(CuTest* tc) {
+    hashRingADT ring = createTestRing(3);
+    size_t      preferred = lookup(ring, "bob"), chosen;
+
+    CuAssertTrue(tc, hashRingLookupFiltered(ring, (const uint8_t *) "bob", 3, rejectFirst, &preferred, &chosen));
+    CuAssertTrue(tc, chosen != preferred);
+
+    hashRingRemove(ring, 0);
+    hashRingRemove(ring, 1);
+    hashRingRemove(ring, 2);
+    CuAssertIntEquals(tc, 0, hashRingPoints(ring));
+    CuAssertTrue(tc, !hashRingLookup(ring, (const uint8_t *) "bob", 3, &chosen));
+    deleteHashRing(ring);
+}
+
+CuSuite * getHashRingTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testHashRingStableLookup);
+    SUITE_ADD_TEST(suite, testHashRingMinimalMovement);
+    SUITE_ADD_TEST(suite, testHashRingBalance);
+    SUITE_ADD_TEST(suite, testHashRingFilterSkipsNode);
+    return suite;
+}
@@ -7,5 +7,7 @@ CuSuite * getBufferTest(void);
 
 void testBufferMisc(CuTest* tc);
 
+void testBufferMoveUnprocessed(CuTest* tc);
+
 #endif
 
@@ -0,0 +1,14 @@
+#ifndef CAPA_CACHE_TEST
+#define CAPA_CACHE_TEST
+
+#include "CuTest.h"
+
+CuSuite * getCapaCacheTest(void);
+
+void testCapaCacheHitAndMiss(CuTest* tc);
+
+void testCapaCacheTtl(CuTest* tc);
+
+void testCapaCacheInvalidate(CuTest* tc);
+
+#endif
@@ -11,6 +11,8 @@ void testGetUsernameApop(CuTest * tc);
 
 void testParseCommands(CuTest * tc);
 
+void testRfcCommands(CuTest * tc);
+
 void testInvalidCommands(CuTest * tc);
 
 #endif
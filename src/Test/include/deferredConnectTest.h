@@ -0,0 +1,18 @@
+#ifndef DEFERRED_CONNECT_TEST
+#define DEFERRED_CONNECT_TEST
+
+#include "CuTest.h"
+
+CuSuite * getDeferredConnectTest(void);
+
+void testDeferredCapaSingleOrigin(CuTest* tc);
+
+void testDeferredCapaOriginsDiffer(CuTest* tc);
+
+void testDeferredCapaOriginsAgree(CuTest* tc);
+
+void testDeferredLineAction(CuTest* tc);
+
+void testDeferredUsername(CuTest* tc);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef FD_WRITER_TEST
+#define FD_WRITER_TEST
+
+#include "CuTest.h"
+
+CuSuite * getFdWriterTest(void);
+
+void testFdWriterBuffering(CuTest* tc);
+
+void testFdWriterLargeRun(CuTest* tc);
+
+#endif
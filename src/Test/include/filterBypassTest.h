@@ -0,0 +1,16 @@
+#ifndef FILTER_BYPASS_TEST
+#define FILTER_BYPASS_TEST
+
+#include "CuTest.h"
+
+CuSuite * getFilterBypassTest(void);
+
+void testFilterMediaRangeMatches(CuTest* tc);
+
+void testFilterSnifferSinglePart(CuTest* tc);
+
+void testFilterSnifferMultipart(CuTest* tc);
+
+void testFilterSnifferConservative(CuTest* tc);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef FILTER_CACHE_TEST
+#define FILTER_CACHE_TEST
+
+#include "CuTest.h"
+
+CuSuite * getFilterCacheTest(void);
+
+void testFilterCacheHitAndMiss(CuTest* tc);
+
+void testFilterCacheSessionScope(CuTest* tc);
+
+void testFilterCacheEviction(CuTest* tc);
+
+void testFilterCacheDiskTier(CuTest* tc);
+
+void testFilterCacheSpoolLimit(CuTest* tc);
+
+void testFilterCacheCollision(CuTest* tc);
+
+#endif
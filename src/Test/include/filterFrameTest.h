@@ -0,0 +1,16 @@
+#ifndef FILTER_FRAME_TEST
+#define FILTER_FRAME_TEST
+
+#include "CuTest.h"
+
+CuSuite * getFilterFrameTest(void);
+
+void testFilterFrameReadHeader(CuTest* tc);
+
+void testFilterFrameDecode(CuTest* tc);
+
+void testFilterFrameDecodeSplit(CuTest* tc);
+
+void testFilterFrameEncode(CuTest* tc);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef FILTER_LIMIT_TEST
+#define FILTER_LIMIT_TEST
+
+#include "CuTest.h"
+
+CuSuite * getFilterLimitTest(void);
+
+void testFilterLimitFifo(CuTest* tc);
+
+void testFilterLimitQueuedRelease(CuTest* tc);
+
+void testFilterLimitSetMax(CuTest* tc);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef FILTER_POOL_TEST
+#define FILTER_POOL_TEST
+
+#include "CuTest.h"
+
+CuSuite * getFilterPoolTest(void);
+
+void testFilterPoolHeader(CuTest* tc);
+
+void testFilterPoolScanner(CuTest* tc);
+
+void testFilterPoolNativeRoundTrip(CuTest* tc);
+
+void testFilterPoolCompatRoundTrip(CuTest* tc);
+
+void testFilterPoolWorkerCrash(CuTest* tc);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef FILTER_STUFF_TEST
+#define FILTER_STUFF_TEST
+
+#include "CuTest.h"
+
+CuSuite * getFilterStuffTest(void);
+
+void testFilterUnstuff(CuTest* tc);
+
+void testFilterUnstuffSplitEnd(CuTest* tc);
+
+void testFilterStuffToCommand(CuTest* tc);
+
+void testFilterStuffToCommandPending(CuTest* tc);
+
+void testFilterStuffToCommandClosed(CuTest* tc);
+
+void testFilterStuffOutput(CuTest* tc);
+
+void testFilterStuffOutputDotLine(CuTest* tc);
+
+void testFilterStuffOutputNoFinalCRLF(CuTest* tc);
+
+#endif
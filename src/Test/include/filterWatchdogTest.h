@@ -0,0 +1,18 @@
+#ifndef FILTER_WATCHDOG_TEST
+#define FILTER_WATCHDOG_TEST
+
+#include "CuTest.h"
+
+CuSuite * getFilterWatchdogTest(void);
+
+void testFilterWatchdogParse(CuTest* tc);
+
+void testFilterWatchdogDeadlines(CuTest* tc);
+
+void testFilterWatchdogBatch(CuTest* tc);
+
+void testFilterWatchdogFallback(CuTest* tc);
+
+void testFilterWatchdogPercentiles(CuTest* tc);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef HAPPY_EYEBALLS_TEST
+#define HAPPY_EYEBALLS_TEST
+
+#include "CuTest.h"
+
+CuSuite * getHappyEyeballsTest(void);
+
+void testHappyEyeballsInterleavesFamilies(CuTest* tc);
+
+void testHappyEyeballsFailedLast(CuTest* tc);
+
+void testHappyEyeballsFailureExpires(CuTest* tc);
+
+#endif
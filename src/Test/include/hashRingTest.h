@@ -0,0 +1,16 @@
+#ifndef HASH_RING_TEST
+#define HASH_RING_TEST
+
+#include "CuTest.h"
+
+CuSuite * getHashRingTest(void);
+
+void testHashRingStableLookup(CuTest* tc);
+
+void testHashRingMinimalMovement(CuTest* tc);
+
+void testHashRingBalance(CuTest* tc);
+
+void testHashRingFilterSkipsNode(CuTest* tc);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef MEDIA_TYPE_CONTAINER_TEST
+#define MEDIA_TYPE_CONTAINER_TEST
+
+#include "CuTest.h"
+
+CuSuite * getMediaTypeContainerTest(void);
+
+void testMediaTypeContainerInsert(CuTest* tc);
+
+void testMediaTypeContainerMatch(CuTest* tc);
+
+#endif
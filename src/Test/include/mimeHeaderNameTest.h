@@ -0,0 +1,10 @@
+#ifndef MIME_HEADER_NAME_TEST
+#define MIME_HEADER_NAME_TEST
+
+#include "CuTest.h"
+
+CuSuite * getMimeHeaderNameTest(void);
+
+void testMimeHeaderNameClassify(CuTest* tc);
+
+#endif
@@ -10,6 +10,8 @@ void testEnsureCapacity (CuTest * tc);
 void testRegisterFd (CuTest * tc);
 void testSelectorRegisterUnregisterRegister(CuTest * tc);
 
+void testNotifyBlock (CuTest * tc);
+
 
 #endif
 
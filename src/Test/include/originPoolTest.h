@@ -0,0 +1,16 @@
+#ifndef ORIGIN_POOL_TEST
+#define ORIGIN_POOL_TEST
+
+#include "CuTest.h"
+
+CuSuite * getOriginPoolTest(void);
+
+void testOriginPoolTake(CuTest* tc);
+
+void testOriginPoolExpired(CuTest* tc);
+
+void testOriginPoolDropped(CuTest* tc);
+
+void testOriginPoolBadGreeting(CuTest* tc);
+
+#endif
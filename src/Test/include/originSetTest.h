@@ -0,0 +1,14 @@
+#ifndef ORIGIN_SET_TEST
+#define ORIGIN_SET_TEST
+
+#include "CuTest.h"
+
+CuSuite * getOriginSetTest(void);
+
+void testOriginSetParse(CuTest* tc);
+
+void testOriginSetLeastLoaded(CuTest* tc);
+
+void testOriginSetEjection(CuTest* tc);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef PARSER_TEST
+#define PARSER_TEST
+
+#include "CuTest.h"
+
+CuSuite * getParserTest(void);
+
+void testFeedParserSpanMerge(CuTest* tc);
+
+void testFeedParserSpanStop(CuTest* tc);
+
+void testFeedParserSpanCapacity(CuTest* tc);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef PROCESS_SPAWN_TEST
+#define PROCESS_SPAWN_TEST
+
+#include "CuTest.h"
+
+CuSuite * getProcessSpawnTest(void);
+
+void testProcessSpawnBatch(CuTest* tc);
+
+void testProcessSpawnBatchOutlived(CuTest* tc);
+
+void testProcessExited(CuTest* tc);
+
+void testProcessSpawnEnvironment(CuTest* tc);
+
+void testProcessSpawnErrorFile(CuTest* tc);
+
+void testProcessSpawnFailure(CuTest* tc);
+
+void testProcessPipe(CuTest* tc);
+
+void testProcessCloseFrom(CuTest* tc);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef RESOLVER_TEST
+#define RESOLVER_TEST
+
+#include "CuTest.h"
+
+CuSuite * getResolverTest(void);
+
+void testResolverResolveAndCache(CuTest * tc);
+
+void testResolverCoalesce(CuTest * tc);
+
+void testResolverCancelAndReuse(CuTest * tc);
+
+#endif
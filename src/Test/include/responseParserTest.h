@@ -15,5 +15,7 @@ void testInvalidTrickyResponse(CuTest * tc);
 
 void testValidTrickyResponse(CuTest * tc);
 
+void testFeedSpan(CuTest * tc);
+
 #endif
 
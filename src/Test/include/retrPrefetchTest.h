@@ -0,0 +1,16 @@
+#ifndef RETR_PREFETCH_TEST
+#define RETR_PREFETCH_TEST
+
+#include "CuTest.h"
+
+CuSuite * getRetrPrefetchTest(void);
+
+void testRetrPrefetchParseRetr(CuTest* tc);
+
+void testRetrPrefetchHit(CuTest* tc);
+
+void testRetrPrefetchMiss(CuTest* tc);
+
+void testRetrPrefetchSkipLarge(CuTest* tc);
+
+#endif
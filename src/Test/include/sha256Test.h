@@ -0,0 +1,12 @@
+#ifndef SHA256_TEST
+#define SHA256_TEST
+
+#include "CuTest.h"
+
+CuSuite * getSha256Test(void);
+
+void testSha256Vectors(CuTest* tc);
+
+void testSha256Incremental(CuTest* tc);
+
+#endif
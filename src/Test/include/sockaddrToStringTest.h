@@ -9,5 +9,7 @@ void testSockAddrToStringIPV4(CuTest* tc);
 
 void testSockAddrToStringIPV6(CuTest* tc);
 
+void testSockaddrSameHost(CuTest* tc);
+
 #endif
 
@@ -0,0 +1,16 @@
+#ifndef STRIPMIME_ENGINE_TEST
+#define STRIPMIME_ENGINE_TEST
+
+#include "CuTest.h"
+
+CuSuite * getStripmimeEngineTest(void);
+
+void testStripmimeReplacesPart(CuTest* tc);
+
+void testStripmimeSpans(CuTest* tc);
+
+void testStripmimeSkipsReplacedPart(CuTest* tc);
+
+void testStripmimeErrors(CuTest* tc);
+
+#endif
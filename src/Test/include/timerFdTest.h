@@ -0,0 +1,12 @@
+#ifndef TIMER_FD_TEST
+#define TIMER_FD_TEST
+
+#include "CuTest.h"
+
+CuSuite * getTimerFdTest(void);
+
+void testTimerFdArm(CuTest* tc);
+
+void testTimerFdPeriodic(CuTest* tc);
+
+#endif
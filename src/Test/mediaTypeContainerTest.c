@@ -0,0 +1,71 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "CuTest.h"
+#include "mediaTypeContainer.h"
+#include "mediaTypeContainerTest.h"
+
+static mediaTypeStatus insert(mediaTypeContainer container, const char * type, const char * subtype) {
+    mediaType_t mediaType = { .type = (char *) type, .subtype = (char *) subtype };
+    return insertMediaType(container, mediaType);
+}
+
+/** Reconoce `string' de a un caracter, como lo hace stripmime. */
+static bool matches(mediaTypeContainer container, const char * string) {
+    unsigned state = MEDIA_TYPE_MATCH_START;
+    for(; *string != 0; string++)
+        state = mediaTypeContainerMatch(container, state, (uint8_t) *string);
+    return mediaTypeContainerMatches(container, state);
+}
+
+void testMediaTypeContainerInsert(CuTest* tc) {
+    mediaTypeContainer container = createMediaTypeContainer("*");
+    CuAssertPtrNotNull(tc, container);
+    CuAssertTrue(tc, mediaTypeContainerIsEmpty(container));
+
+    CuAssertIntEquals(tc, MEDIA_TYPE_ERROR, insert(container, "*", "png"));
+    CuAssertIntEquals(tc, MEDIA_TYPE_ERROR, insert(container, "image", "p ng"));
+    CuAssertTrue(tc, mediaTypeContainerIsEmpty(container));
+
+    CuAssertIntEquals(tc, MEDIA_TYPE_SUCCESS, insert(container, "image", "png"));
+    CuAssertIntEquals(tc, MEDIA_TYPE_ERROR, insert(container, "IMAGE", "PNG"));
+    CuAssertIntEquals(tc, MEDIA_TYPE_SUCCESS, insert(container, "image", "*"));
+    /** El comodín ya cubre cualquier subtipo del tipo. */
+    CuAssertIntEquals(tc, MEDIA_TYPE_ERROR, insert(container, "image", "gif"));
+    CuAssertIntEquals(tc, MEDIA_TYPE_ERROR, insert(container, "image", "*"));
+    CuAssertTrue(tc, !mediaTypeContainerIsEmpty(container));
+    deleteMediaTypeContainer(container);
+}
+
+void testMediaTypeContainerMatch(CuTest* tc) {
+    mediaTypeContainer container = createMediaTypeContainer("*");
+    CuAssertIntEquals(tc, MEDIA_TYPE_SUCCESS, insert(container, "text", "plain"));
+    CuAssertIntEquals(tc, MEDIA_TYPE_SUCCESS, insert(container, "text", "html"));
+    CuAssertIntEquals(tc, MEDIA_TYPE_SUCCESS, insert(container, "application", "pdf"));
+    CuAssertIntEquals(tc, MEDIA_TYPE_SUCCESS, insert(container, "image", "*"));
+
+    CuAssertTrue(tc, matches(container, "text/plain"));
+    CuAssertTrue(tc, matches(container, "Text/HTML"));
+    CuAssertTrue(tc, matches(container, "application/pdf"));
+    CuAssertTrue(tc, matches(container, "image/png"));
+    CuAssertTrue(tc, matches(container, "IMAGE/x-icon"));
+    /** Solo coincide el media type completo, no un prefijo ni una extensión. */
+    CuAssertTrue(tc, !matches(container, "text/plai"));
+    CuAssertTrue(tc, !matches(container, "text/plainx"));
+    CuAssertTrue(tc, !matches(container, "tex/plain"));
+    CuAssertTrue(tc, !matches(container, "text"));
+    CuAssertTrue(tc, !matches(container, "audio/mpeg"));
+    CuAssertTrue(tc, !matches(container, "imagex/png"));
+
+    unsigned state = mediaTypeContainerMatch(container, MEDIA_TYPE_MATCH_START, 'x');
+    CuAssertIntEquals(tc, MEDIA_TYPE_MATCH_FAILED, state);
+    CuAssertIntEquals(tc, MEDIA_TYPE_MATCH_FAILED, mediaTypeContainerMatch(container, state, 't'));
+    deleteMediaTypeContainer(container);
+}
+
+CuSuite * getMediaTypeContainerTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testMediaTypeContainerInsert);
+    SUITE_ADD_TEST(suite, testMediaTypeContainerMatch);
+    return suite;
+}
@@ -0,0 +1,41 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "CuTest.h"
+#include "mimeHeaderName.h"
+#include "mimeHeaderNameTest.h"
+
+static mimeHeader classify(const char * name) {
+    mimeHeaderName headerName;
+
+    mimeHeaderNameReset(&headerName);
+    for(; *name != 0; name++)
+        mimeHeaderNameFeed(&headerName, (uint8_t) *name);
+    return mimeHeaderNameClassify(&headerName);
+}
+
+void testMimeHeaderNameClassify(CuTest* tc) {
+    char longName[2 * MIME_HEADER_NAME_SIZE];
+
+    CuAssertIntEquals(tc, MIME_HEADER_CONTENT_TYPE, classify("Content-Type"));
+    CuAssertIntEquals(tc, MIME_HEADER_CONTENT_TYPE, classify("CONTENT-TYPE"));
+    CuAssertIntEquals(tc, MIME_HEADER_CONTENT_TRANSFER_ENCODING, classify("content-transfer-encoding"));
+    CuAssertIntEquals(tc, MIME_HEADER_CONTENT_DISPOSITION, classify("Content-Disposition"));
+    CuAssertIntEquals(tc, MIME_HEADER_CONTENT_ID, classify("Content-ID"));
+    /** Solo el nombre completo. */
+    CuAssertIntEquals(tc, MIME_HEADER_OTHER, classify("Content-Typ"));
+    CuAssertIntEquals(tc, MIME_HEADER_OTHER, classify("Content-Types"));
+    CuAssertIntEquals(tc, MIME_HEADER_OTHER, classify("Subject"));
+    CuAssertIntEquals(tc, MIME_HEADER_OTHER, classify(""));
+
+    memset(longName, 'a', sizeof(longName) - 1);
+    longName[sizeof(longName) - 1] = 0;
+    memcpy(longName, "content-type", 12);
+    CuAssertIntEquals(tc, MIME_HEADER_OTHER, classify(longName));
+}
+
+CuSuite * getMimeHeaderNameTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testMimeHeaderNameClassify);
+    return suite;
+}
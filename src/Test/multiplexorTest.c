@@ -1,3 +1,5 @@
+/* multiplexor.c usa accept4, que es una extensión de glibc. */
+#define _GNU_SOURCE
 #include <stdlib.h>
 
 #include "CuTest.h"
@@ -105,11 +107,56 @@ void testRegisterFd (CuTest * tc) {
 }
 
 
+static unsigned blockCount[2];
+
+static void countBlock(MultiplexorKey key) {
+    blockCount[*((int *) key->data)]++;
+}
+
+void testNotifyBlock (CuTest * tc) {
+    const struct multiplexorInit init = {
+        .signal        = SIGALRM,
+        .selectTimeout = { .tv_sec = 1, .tv_nsec = 0 },
+    };
+    const eventHandler h = {
+        .block  = countBlock,
+    };
+    int first = 0, second = 1;
+
+    CuAssertIntEquals(tc, MUX_SUCCESS, multiplexorInit(&init));
+    MultiplexorADT mux = createMultiplexorADT(INITIAL_SIZE);
+    CuAssertPtrNotNull(tc, mux);
+    CuAssertIntEquals(tc, MUX_SUCCESS, registerFd(mux, 10, &h, NO_INTEREST, &first));
+    CuAssertIntEquals(tc, MUX_SUCCESS, registerFd(mux, 11, &h, NO_INTEREST, &second));
+    CuAssertIntEquals(tc, MUX_INVALID_ARGUMENTS, notifyBlock(mux, FDS_MAX_SIZE));
+
+    /** Las notificaciones a un mismo fd se agrupan. */
+    blockCount[0] = blockCount[1] = 0;
+    CuAssertIntEquals(tc, MUX_SUCCESS, notifyBlock(mux, 10));
+    CuAssertIntEquals(tc, MUX_SUCCESS, notifyBlock(mux, 10));
+    CuAssertIntEquals(tc, MUX_SUCCESS, notifyBlock(mux, 11));
+    manageBlockNotifications(mux);
+    CuAssertIntEquals(tc, 1, blockCount[0]);
+    CuAssertIntEquals(tc, 1, blockCount[1]);
+
+    /** La notificación pendiente no llega a quien registra el fd después. */
+    CuAssertIntEquals(tc, MUX_SUCCESS, notifyBlock(mux, 10));
+    CuAssertIntEquals(tc, MUX_SUCCESS, unregisterFd(mux, 10));
+    CuAssertIntEquals(tc, MUX_SUCCESS, registerFd(mux, 10, &h, NO_INTEREST, &second));
+    manageBlockNotifications(mux);
+    CuAssertIntEquals(tc, 1, blockCount[0]);
+    CuAssertIntEquals(tc, 1, blockCount[1]);
+
+    deleteMultiplexorADT(mux);
+}
+
+
 CuSuite * getMultiplexorTest(void) {
     CuSuite* suite = CuSuiteNew();
     
     SUITE_ADD_TEST(suite, testNextCapacity);
     SUITE_ADD_TEST(suite, testEnsureCapacity);
     SUITE_ADD_TEST(suite, testRegisterFd);
+    SUITE_ADD_TEST(suite, testNotifyBlock);
     return suite;
 }
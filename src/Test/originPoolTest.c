@@ -0,0 +1,205 @@
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "CuTest.h"
+#include "multiplexor.h"
+#include "originPool.h"
+#include "originPoolTest.h"
+
+/** Vueltas de muxSelect de hasta un segundo que se espera un cambio del pool. */
+#define MAX_SELECTS 5
+#define STATISTICS_SIZE 512
+
+static const char * greeting = "+OK hola\r\n";
+static const char * capa     = "+OK\r\nUSER\r\nPIPELINING\r\n.\r\n";
+
+/** Origin falso: el socket que escucha y la conexión que abrió el pool. */
+typedef struct fakeOrigin {
+    int             listener;
+    int             fd;
+    addressData     address;
+    MultiplexorADT  mux;
+} fakeOrigin;
+
+static bool fakeOriginInit(fakeOrigin * origin) {
+    const struct multiplexorInit init = {
+        .signal        = SIGALRM,
+        .selectTimeout = { .tv_sec = 1, .tv_nsec = 0 },
+    };
+    struct sockaddr_in address = {
+        .sin_family = AF_INET,
+        .sin_port   = 0,
+        .sin_addr   = { .s_addr = htonl(INADDR_LOOPBACK) },
+    };
+    socklen_t length = sizeof(address);
+
+    memset(origin, 0, sizeof(*origin));
+    origin->fd       = -1;
+    origin->listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    if(origin->listener < 0 || bind(origin->listener, (struct sockaddr *) &address, length) < 0 ||
+       listen(origin->listener, 4) < 0 || getsockname(origin->listener, (struct sockaddr *) &address, &length) < 0)
+        return false;
+    origin->address.type       = ADDR_IPV4;
+    origin->address.domain     = AF_INET;
+    origin->address.addrLength = length;
+    origin->address.port       = address.sin_port;
+    memcpy(&origin->address.addr.addrStorage, &address, length);
+
+    if(multiplexorInit(&init) != MUX_SUCCESS)
+        return false;
+    origin->mux = createMultiplexorADT(FDS_MAX_SIZE / 4);
+    return origin->mux != NULL;
+}
+
+static void fakeOriginDestroy(fakeOrigin * origin, originPoolADT pool) {
+    deleteOriginPool(pool);
+    deleteMultiplexorADT(origin->mux);
+    multiplexorClose();
+    if(origin->fd != -1)
+        close(origin->fd);
+    close(origin->listener);
+}
+
+/** Indica si las estadísticas del pool contienen `expected'. */
+static bool statisticsContain(originPoolADT pool, const char * expected) {
+    char statistics[STATISTICS_SIZE];
+
+    originPoolStatistics(pool, statistics, sizeof(statistics));
+    return strstr(statistics, expected) != NULL;
+}
+
+/** Atiende el multiplexor hasta que las estadísticas contienen `expected'. */
+static bool waitFor(fakeOrigin * origin, originPoolADT pool, const char * expected) {
+    for(unsigned i = 0; i < MAX_SELECTS && !statisticsContain(pool, expected); i++)
+        if(MUX_SUCCESS != muxSelect(origin->mux))
+            return false;
+    return statisticsContain(pool, expected);
+}
+
+/** Acepta la conexión del pool y le envía `hello'. */
+static bool sendGreeting(fakeOrigin * origin, const char * hello) {
+    origin->fd = accept(origin->listener, NULL, NULL);
+    return origin->fd >= 0 && send(origin->fd, hello, strlen(hello), MSG_NOSIGNAL) == (ssize_t) strlen(hello);
+}
+
+/** Espera el CAPA del pool y le responde. */
+static bool answerCapa(fakeOrigin * origin, originPoolADT pool) {
+    char command[16] = {0};
+    size_t length = 0;
+
+    while(length < strlen("CAPA\r\n")) {
+        if(MUX_SUCCESS != muxSelect(origin->mux))
+            return false;
+        const ssize_t n = recv(origin->fd, command + length, sizeof(command) - 1 - length, MSG_DONTWAIT);
+        if(n > 0)
+            length += n;
+        else if(n == 0)
+            return false;
+    }
+    return strcmp(command, "CAPA\r\n") == 0 &&
+           send(origin->fd, capa, strlen(capa), MSG_NOSIGNAL) == (ssize_t) strlen(capa) &&
+           waitFor(origin, pool, "ready 1");
+}
+
+/** Crea un pool de una conexión y la deja lista. */
+static originPoolADT readyPool(CuTest * tc, fakeOrigin * origin, const time_t maxIdleAge) {
+    CuAssertTrue(tc, fakeOriginInit(origin));
+    originPoolADT pool = createOriginPool(origin->mux, &origin->address, 1, maxIdleAge);
+    CuAssertPtrNotNull(tc, pool);
+    /** Un accept alcanza para que el pool quiera una conexión. */
+    originPoolAccepted(pool);
+    CuAssertTrue(tc, statisticsContain(pool, "warming 1 target 1"));
+    CuAssertTrue(tc, sendGreeting(origin, greeting));
+    CuAssertTrue(tc, answerCapa(origin, pool));
+    return pool;
+}
+
+void testOriginPoolTake(CuTest* tc) {
+    pooledOrigin taken;
+    fakeOrigin origin;
+    char data[8];
+
+    originPoolADT pool = readyPool(tc, &origin, ORIGIN_POOL_MAX_IDLE_AGE);
+    CuAssertTrue(tc, originPoolTake(pool, &taken));
+    CuAssertIntEquals(tc, strlen(greeting), taken.greetingLength);
+    CuAssertTrue(tc, memcmp(greeting, taken.greeting, taken.greetingLength) == 0);
+    CuAssertTrue(tc, taken.capabilities.pipelining);
+    CuAssertTrue(tc, statisticsContain(pool, "hits 1 misses 0"));
+
+    /** El fd entregado sigue conectado con el origin. */
+    CuAssertIntEquals(tc, 6, (int) send(taken.fd, "NOOP\r\n", 6, MSG_NOSIGNAL));
+    CuAssertIntEquals(tc, 6, (int) recv(origin.fd, data, sizeof(data), 0));
+    close(taken.fd);
+
+    /** Sin conexiones listas es un miss y se abre otra. */
+    CuAssertTrue(tc, !originPoolTake(pool, &taken));
+    CuAssertTrue(tc, statisticsContain(pool, "misses 1"));
+    CuAssertTrue(tc, statisticsContain(pool, "warming 1"));
+    fakeOriginDestroy(&origin, pool);
+}
+
+void testOriginPoolExpired(CuTest* tc) {
+    pooledOrigin taken;
+    fakeOrigin origin;
+
+    /** Con edad máxima 0 toda conexión lista ya venció. */
+    originPoolADT pool = readyPool(tc, &origin, 0);
+    CuAssertTrue(tc, !originPoolTake(pool, &taken));
+    CuAssertTrue(tc, statisticsContain(pool, "expired 1"));
+    CuAssertTrue(tc, statisticsContain(pool, "hits 0 misses 1"));
+    fakeOriginDestroy(&origin, pool);
+
+    /** También se descarta al revisar los timeouts, sin esperar a un cliente. */
+    pool = readyPool(tc, &origin, 0);
+    checkTimeout(origin.mux);
+    CuAssertTrue(tc, statisticsContain(pool, "expired 1"));
+    CuAssertTrue(tc, statisticsContain(pool, "ready 0"));
+    fakeOriginDestroy(&origin, pool);
+}
+
+void testOriginPoolDropped(CuTest* tc) {
+    pooledOrigin taken;
+    fakeOrigin origin;
+
+    /** Una conexión lista que el origin cerró no se entrega. */
+    originPoolADT pool = readyPool(tc, &origin, ORIGIN_POOL_MAX_IDLE_AGE);
+    close(origin.fd);
+    origin.fd = -1;
+    CuAssertTrue(tc, waitFor(&origin, pool, "dropped 1"));
+    CuAssertTrue(tc, statisticsContain(pool, "ready 0"));
+    CuAssertTrue(tc, !originPoolTake(pool, &taken));
+    fakeOriginDestroy(&origin, pool);
+}
+
+void testOriginPoolBadGreeting(CuTest* tc) {
+    const char * greetings[] = {"-ERR ocupado\r\n", "+OK hola\r\n+OK de mas\r\n"};
+    pooledOrigin taken;
+    fakeOrigin origin;
+
+    /** Un saludo que no es +OK, o seguido de datos, descarta la conexión. */
+    for(size_t i = 0; i < sizeof(greetings) / sizeof(greetings[0]); i++) {
+        CuAssertTrue(tc, fakeOriginInit(&origin));
+        originPoolADT pool = createOriginPool(origin.mux, &origin.address, 1, ORIGIN_POOL_MAX_IDLE_AGE);
+        CuAssertPtrNotNull(tc, pool);
+        originPoolAccepted(pool);
+        CuAssertTrue(tc, sendGreeting(&origin, greetings[i]));
+        CuAssertTrue(tc, waitFor(&origin, pool, "failed 1"));
+        CuAssertTrue(tc, statisticsContain(pool, "ready 0 warming 0"));
+        CuAssertTrue(tc, !originPoolTake(pool, &taken));
+        fakeOriginDestroy(&origin, pool);
+    }
+}
+
+CuSuite * getOriginPoolTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testOriginPoolTake);
+    SUITE_ADD_TEST(suite, testOriginPoolExpired);
+    SUITE_ADD_TEST(suite, testOriginPoolDropped);
+    SUITE_ADD_TEST(suite, testOriginPoolBadGreeting);
+    return suite;
+}
@@ -0,0 +1,65 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "CuTest.h"
+#include "originSet.h"
+#include "originSetTest.h"
+
+void testOriginSetParse(CuTest* tc) {
+    originSetADT set = createOriginSet("127.0.0.1,::1,pop.example.org", 110);
+
+    CuAssertPtrNotNull(tc, set);
+    CuAssertIntEquals(tc, 3, originSetSize(set));
+    CuAssertIntEquals(tc, ADDR_IPV4, originSetAddress(set, 0)->type);
+    CuAssertIntEquals(tc, ADDR_IPV6, originSetAddress(set, 1)->type);
+    CuAssertIntEquals(tc, ADDR_DOMAIN, originSetAddress(set, 2)->type);
+    CuAssertStrEquals(tc, "pop.example.org", originSetAddress(set, 2)->addr.fqdn);
+    CuAssertIntEquals(tc, 110, originSetAddress(set, 2)->port);
+    CuAssertStrEquals(tc, "::1", originSetName(set, 1));
+    CuAssertStrEquals(tc, "pop.example.org", originSetName(set, 2));
+    deleteOriginSet(set);
+
+    CuAssertPtrEquals(tc, NULL, createOriginSet("", 110));
+    CuAssertPtrEquals(tc, NULL, createOriginSet("127.0.0.1,", 110));
+    CuAssertPtrEquals(tc, NULL, createOriginSet("127.0.0.1,,::1", 110));
+}
+
+void testOriginSetLeastLoaded(CuTest* tc) {
+    originSetADT set = createOriginSet("10.0.0.1,10.0.0.2", 110);
+
+    const size_t first  = originSetAcquire(set);
+    const size_t second = originSetAcquire(set);
+    /** Con dos origins sanos siempre se comparan ambos. */
+    CuAssertTrue(tc, first != second);
+
+    originSetRelease(set, second);
+    CuAssertIntEquals(tc, second, originSetAcquire(set));
+    deleteOriginSet(set);
+}
+
+void testOriginSetEjection(CuTest* tc) {
+    originSetADT set = createOriginSet("10.0.0.1,10.0.0.2", 110);
+
+    for(unsigned i = 0; i < ORIGIN_HEALTH_FAILS; i++)
+        originSetFailed(set, 0);
+    CuAssertTrue(tc, !originSetIsHealthy(set, 0));
+    CuAssertTrue(tc, originSetIsHealthy(set, 1));
+    for(unsigned i = 0; i < 8; i++)
+        CuAssertIntEquals(tc, 1, originSetAcquire(set));
+
+    /** Sin origins sanos se usan todos. */
+    for(unsigned i = 0; i < ORIGIN_HEALTH_FAILS; i++)
+        originSetFailed(set, 1);
+    CuAssertIntEquals(tc, 0, originSetAcquire(set));
+    deleteOriginSet(set);
+}
+
+CuSuite * getOriginSetTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testOriginSetParse);
+    SUITE_ADD_TEST(suite, testOriginSetLeastLoaded);
+    SUITE_ADD_TEST(suite, testOriginSetEjection);
+    return suite;
+}
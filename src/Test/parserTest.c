@@ -0,0 +1,89 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "CuTest.h"
+#include "parser.h"
+#include "parserUtils.h"
+#include "parserTest.h"
+
+#define EVENTS_SIZE 8
+
+void testFeedParserSpanMerge(CuTest* tc) {
+    parserDefinition definition = stringCompareParserUtils("hola");
+    parserADT parser = initializeParser(noClassesParser(), &definition);
+    const uint8_t * span = (const uint8_t *) "HoLa mundo";
+    parserSpanEvent events[EVENTS_SIZE];
+    size_t consumed;
+
+    size_t eventsQty = feedParserSpan(parser, span, strlen((const char *) span), events, EVENTS_SIZE, 0, &consumed);
+    CuAssertIntEquals(tc, strlen((const char *) span), consumed);
+    CuAssertIntEquals(tc, 2, eventsQty);
+
+    CuAssertIntEquals(tc, STRING_CMP_EQ, events[0].type);
+    CuAssertIntEquals(tc, true, events[0].literal);
+    CuAssertPtrEquals(tc, (void *) span, (void *) events[0].ptr);
+    CuAssertIntEquals(tc, 4, events[0].length);
+
+    CuAssertIntEquals(tc, STRING_CMP_NEQ, events[1].type);
+    CuAssertIntEquals(tc, true, events[1].literal);
+    CuAssertPtrEquals(tc, (void *) (span + 4), (void *) events[1].ptr);
+    CuAssertIntEquals(tc, 6, events[1].length);
+
+    destroyParser(parser);
+    destroyStringCompareParserUtils(&definition);
+}
+
+void testFeedParserSpanStop(CuTest* tc) {
+    parserDefinition definition = stringCompareParserUtils("hola");
+    parserADT parser = initializeParser(noClassesParser(), &definition);
+    const uint8_t * span = (const uint8_t *) "hoy es lunes";
+    parserSpanEvent events[EVENTS_SIZE];
+    size_t consumed;
+
+    size_t eventsQty = feedParserSpan(parser, span, strlen((const char *) span), events, EVENTS_SIZE, 1U << STRING_CMP_NEQ, &consumed);
+    CuAssertIntEquals(tc, 3, consumed);
+    CuAssertIntEquals(tc, 2, eventsQty);
+    CuAssertIntEquals(tc, STRING_CMP_EQ,  events[0].type);
+    CuAssertIntEquals(tc, 2, events[0].length);
+    CuAssertIntEquals(tc, STRING_CMP_NEQ, events[1].type);
+    CuAssertIntEquals(tc, 1, events[1].length);
+
+    resetParser(parser);
+    eventsQty = feedParserSpan(parser, span + consumed, strlen((const char *) span) - consumed, events, EVENTS_SIZE, 1U << STRING_CMP_NEQ, &consumed);
+    CuAssertIntEquals(tc, 1, consumed);
+    CuAssertIntEquals(tc, 1, eventsQty);
+    CuAssertIntEquals(tc, STRING_CMP_NEQ, events[0].type);
+
+    destroyParser(parser);
+    destroyStringCompareParserUtils(&definition);
+}
+
+void testFeedParserSpanCapacity(CuTest* tc) {
+    parserDefinition definition = stringCompareParserUtils("ab");
+    parserADT parser = initializeParser(noClassesParser(), &definition);
+    const uint8_t * span = (const uint8_t *) "abcd";
+    parserSpanEvent events[2];
+    size_t consumed;
+
+    // con lugar para dos eventos solo se consume un caracter por vez
+    size_t eventsQty = feedParserSpan(parser, span, strlen((const char *) span), events, 2, 0, &consumed);
+    CuAssertIntEquals(tc, 1, consumed);
+    CuAssertIntEquals(tc, 1, eventsQty);
+    CuAssertIntEquals(tc, 'a', *events[0].ptr);
+
+    eventsQty = feedParserSpan(parser, span + 1, 3, events, 2, 0, &consumed);
+    CuAssertIntEquals(tc, 1, consumed);
+    CuAssertIntEquals(tc, STRING_CMP_EQ, events[0].type);
+
+    destroyParser(parser);
+    destroyStringCompareParserUtils(&definition);
+}
+
+CuSuite * getParserTest(void) {
+    CuSuite* suite = CuSuiteNew();
+
+    SUITE_ADD_TEST(suite, testFeedParserSpanMerge);
+    SUITE_ADD_TEST(suite, testFeedParserSpanStop);
+    SUITE_ADD_TEST(suite, testFeedParserSpanCapacity);
+    return suite;
+}
@@ -0,0 +1,226 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/select.h>
+#include <sys/wait.h>
+
+#include "CuTest.h"
+#include "processSpawn.h"
+#include "processSpawnTest.h"
+
+#define SHELL_PATH "/bin/sh"
+#define ERROR_FILE_TEMPLATE "/tmp/processSpawnTestXXXXXX"
+
+/** Espera hasta `ms' milisegundos a que el pidfd sea legible. */
+static bool waitExit(const int pidfd, const long ms) {
+    struct timeval timeout = { .tv_sec = ms / 1000, .tv_usec = (ms % 1000) * 1000 };
+    fd_set readSet;
+
+    FD_ZERO(&readSet);
+    FD_SET(pidfd, &readSet);
+    return select(pidfd + 1, &readSet, NULL, NULL, &timeout) == 1;
+}
+
+/** Lanza `command' como en modo batch: `body' en un memfd de entrada y otro memfd de salida. */
+static pid_t spawnBatch(const char * command, const char * body, int * output) {
+    char * const argv[] = {"sh", "-c", (char *) command, NULL};
+    const int input = processMemfd("test-body");
+
+    *output = processMemfd("test-output");
+    if(input < 0 || *output < 0 || write(input, body, strlen(body)) != (ssize_t) strlen(body) || lseek(input, 0, SEEK_SET) != 0)
+        return -1;
+    const int fds[] = {input, *output};
+    const pid_t pid = processSpawnFds(SHELL_PATH, argv, fds, 2, NULL, NULL, NULL, 0);
+    close(input);
+    return pid;
+}
+
+void testProcessSpawnBatch(CuTest* tc) {
+    char data[64] = {0};
+    int output;
+
+    const pid_t pid = spawnBatch("tr a-z A-Z", "hola\r\n.\r\n", &output);
+    CuAssertTrue(tc, pid > 0);
+    const int pidfd = processPidfd(pid);
+    CuAssertTrue(tc, pidfd >= 0);
+
+    CuAssertTrue(tc, waitExit(pidfd, 5000));
+    CuAssertTrue(tc, processExited(pidfd));
+    /** La salida se lee del memfd aunque el comando nunca la cerró. */
+    CuAssertIntEquals(tc, 9, (int) pread(output, data, sizeof(data), 0));
+    CuAssertStrEquals(tc, "HOLA\r\n.\r\n", data);
+
+    waitpid(pid, NULL, 0);
+    close(pidfd);
+    close(output);
+}
+
+void testProcessSpawnBatchOutlived(CuTest* tc) {
+    char data[64] = {0};
+    int output;
+
+    /** Un proceso que hereda los descriptores y sigue corriendo no demora la salida. */
+    const pid_t pid = spawnBatch("sleep 3 & cat", "hola\r\n", &output);
+    CuAssertTrue(tc, pid > 0);
+    const int pidfd = processPidfd(pid);
+    CuAssertTrue(tc, pidfd >= 0);
+
+    CuAssertTrue(tc, waitExit(pidfd, 2000));
+    CuAssertIntEquals(tc, 6, (int) pread(output, data, sizeof(data), 0));
+    CuAssertStrEquals(tc, "hola\r\n", data);
+
+    waitpid(pid, NULL, 0);
+    close(pidfd);
+    close(output);
+}
+
+void testProcessExited(CuTest* tc) {
+    char * const argv[] = {"sh", "-c", "read line", NULL};
+    const int nullFd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    int fds[2];
+
+    CuAssertIntEquals(tc, 0, processPipe(fds));
+    const pid_t pid = processSpawn(SHELL_PATH, argv, fds[0], nullFd, NULL, NULL, NULL, 0);
+    CuAssertTrue(tc, pid > 0);
+    const int pidfd = processPidfd(pid);
+    CuAssertTrue(tc, pidfd >= 0);
+    close(fds[0]);
+    close(nullFd);
+
+    /** Cerrar la salida antes de terminar no cuenta como terminar. */
+    CuAssertTrue(tc, !processExited(pidfd));
+    CuAssertTrue(tc, !waitExit(pidfd, 100));
+    close(fds[1]);
+    CuAssertTrue(tc, waitExit(pidfd, 5000));
+    /** Sigue legible después de que lo espera el manejador de SIGCHLD. */
+    CuAssertIntEquals(tc, pid, waitpid(pid, NULL, 0));
+    CuAssertTrue(tc, processExited(pidfd));
+    close(pidfd);
+}
+
+/**
+ * Ejecuta `command' con las variables `names'/`values' y la salida de error
+ * en `errorFile', y deja su salida en `data'. Retorna el largo de la salida.
+ */
+static ssize_t runCommand(const char * command, const char * errorFile, const char * const names[], const char * const values[],
+                          const size_t count, char * data, const size_t size) {
+    char * const argv[] = {"sh", "-c", (char *) command, NULL};
+    const int nullFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    const int output = processMemfd("test-output");
+    ssize_t length = -1;
+
+    const pid_t pid = processSpawn(SHELL_PATH, argv, nullFd, output, errorFile, names, values, count);
+    if(pid > 0 && waitpid(pid, NULL, 0) == pid)
+        length = pread(output, data, size - 1, 0);
+    if(length >= 0)
+        data[length] = 0;
+    close(nullFd);
+    close(output);
+    return length;
+}
+
+void testProcessSpawnEnvironment(CuTest* tc) {
+    const char * const names[]  = {"SPAWN_TEST_NEW", "SPAWN_TEST_REPLACED", "SPAWN_TEST_KEPT"};
+    const char * const values[] = {"nueva", "reemplazada", NULL};
+    char data[128];
+
+    CuAssertIntEquals(tc, 0, setenv("SPAWN_TEST_REPLACED", "original", 1));
+    CuAssertIntEquals(tc, 0, setenv("SPAWN_TEST_KEPT", "heredada", 1));
+    /** Las nuevas se agregan, las del mismo nombre se reemplazan y con NULL se hereda la del proceso. */
+    runCommand("printf '%s,%s,%s,%s' \"$SPAWN_TEST_NEW\" \"$SPAWN_TEST_REPLACED\" \"$SPAWN_TEST_KEPT\" \"${PATH:+path}\"",
+               NULL, names, values, 3, data, sizeof(data));
+    CuAssertStrEquals(tc, "nueva,reemplazada,heredada,path", data);
+    /** Una variable reemplazada no queda dos veces. */
+    runCommand("env | grep -c '^SPAWN_TEST_REPLACED='", NULL, names, values, 3, data, sizeof(data));
+    CuAssertStrEquals(tc, "1\n", data);
+    /** Sin variables el hijo recibe el entorno del proceso tal cual. */
+    runCommand("printf '%s' \"$SPAWN_TEST_REPLACED\"", NULL, NULL, NULL, 0, data, sizeof(data));
+    CuAssertStrEquals(tc, "original", data);
+    unsetenv("SPAWN_TEST_REPLACED");
+    unsetenv("SPAWN_TEST_KEPT");
+}
+
+void testProcessSpawnErrorFile(CuTest* tc) {
+    char errorFile[] = ERROR_FILE_TEMPLATE;
+    char data[64] = {0};
+
+    const int fd = mkstemp(errorFile);
+    CuAssertTrue(tc, fd >= 0);
+    CuAssertIntEquals(tc, 6, (int) write(fd, "antes\n", 6));
+    /** La salida de error se agrega al final del archivo. */
+    CuAssertTrue(tc, runCommand("echo error >&2; echo salida", errorFile, NULL, NULL, 0, data, sizeof(data)) > 0);
+    CuAssertStrEquals(tc, "salida\n", data);
+    CuAssertIntEquals(tc, 12, (int) pread(fd, data, sizeof(data) - 1, 0));
+    data[12] = 0;
+    CuAssertStrEquals(tc, "antes\nerror\n", data);
+    close(fd);
+    unlink(errorFile);
+
+    /** Si no se puede abrir, el hijo corre con la salida de error cerrada. */
+    runCommand("[ -e /proc/self/fd/2 ] && echo abierta || echo cerrada",
+               "/nonexistent/processSpawnTest", NULL, NULL, 0, data, sizeof(data));
+    CuAssertStrEquals(tc, "cerrada\n", data);
+}
+
+void testProcessSpawnFailure(CuTest* tc) {
+    char * const argv[] = {"nonexistent", NULL};
+
+    CuAssertIntEquals(tc, -1, processSpawn("/nonexistent/command", argv, -1, -1, NULL, NULL, NULL, 0));
+}
+
+void testProcessPipe(CuTest* tc) {
+    char command[128];
+    char data[16];
+    int fds[2];
+
+    CuAssertIntEquals(tc, 0, processPipe(fds));
+    CuAssertTrue(tc, (fcntl(fds[0], F_GETFD) & FD_CLOEXEC) != 0);
+    CuAssertTrue(tc, (fcntl(fds[1], F_GETFD) & FD_CLOEXEC) != 0);
+    /** El hijo no hereda ninguno de los extremos. */
+    snprintf(command, sizeof(command), "[ -e /proc/self/fd/%d ] || [ -e /proc/self/fd/%d ] && echo si || echo no", fds[0], fds[1]);
+    runCommand(command, NULL, NULL, NULL, 0, data, sizeof(data));
+    CuAssertStrEquals(tc, "no\n", data);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+void testProcessCloseFrom(CuTest* tc) {
+    int status = -1;
+    int fds[2];
+
+    CuAssertIntEquals(tc, 0, pipe(fds));
+    const int high = fcntl(fds[0], F_DUPFD, 100);
+    CuAssertTrue(tc, high >= 100);
+    /** Se cierra en un hijo creado con fork, como lo usa el proxy. */
+    const pid_t pid = fork();
+    CuAssertTrue(tc, pid >= 0);
+    if(pid == 0) {
+        processCloseFrom(fds[1]);
+        const bool closed = fcntl(fds[1], F_GETFD) == -1 && errno == EBADF && fcntl(high, F_GETFD) == -1 && errno == EBADF;
+        _exit((closed && fcntl(fds[0], F_GETFD) != -1 && fcntl(STDERR_FILENO, F_GETFD) != -1)? 0 : 1);
+    }
+    CuAssertIntEquals(tc, pid, waitpid(pid, &status, 0));
+    CuAssertTrue(tc, WIFEXITED(status));
+    CuAssertIntEquals(tc, 0, WEXITSTATUS(status));
+    /** En el padre siguen abiertos. */
+    CuAssertTrue(tc, fcntl(high, F_GETFD) != -1);
+    close(fds[0]);
+    close(fds[1]);
+    close(high);
+}
+
+CuSuite * getProcessSpawnTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testProcessSpawnBatch);
+    SUITE_ADD_TEST(suite, testProcessSpawnBatchOutlived);
+    SUITE_ADD_TEST(suite, testProcessExited);
+    SUITE_ADD_TEST(suite, testProcessSpawnEnvironment);
+    SUITE_ADD_TEST(suite, testProcessSpawnErrorFile);
+    SUITE_ADD_TEST(suite, testProcessSpawnFailure);
+    SUITE_ADD_TEST(suite, testProcessPipe);
+    SUITE_ADD_TEST(suite, testProcessCloseFrom);
+    return suite;
+}
@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include "CuTest.h"
+#include "multiplexor.h"
+#include "resolver.h"
+#include "resolverTest.h"
+
+#define POP3_PORT 110
+/** Vueltas de muxSelect de hasta un segundo que se espera una resolución. */
+#define MAX_SELECTS 10
+
+/** Sesión de prueba: un pipe registrado que cuenta sus notificaciones. */
+typedef struct session {
+    int                 fds[2];
+    unsigned            blocks;
+    resolverRequest     request;
+} session;
+
+static void sessionBlock(MultiplexorKey key) {
+    ((session *) key->data)->blocks++;
+}
+
+/** Como el proxy, cancela la resolución al cerrar. */
+static void sessionClose(MultiplexorKey key) {
+    resolverCancel(&((session *) key->data)->request);
+}
+
+static const eventHandler sessionHandler = {
+    .block  = sessionBlock,
+    .close  = sessionClose,
+};
+
+static MultiplexorADT setUp(CuTest * tc, const time_t ttl) {
+    const struct multiplexorInit init = {
+        .signal        = SIGALRM,
+        .selectTimeout = { .tv_sec = 1, .tv_nsec = 0 },
+    };
+
+    CuAssertIntEquals(tc, MUX_SUCCESS, multiplexorInit(&init));
+    MultiplexorADT mux = createMultiplexorADT(FDS_MAX_SIZE / 4);
+    CuAssertPtrNotNull(tc, mux);
+    CuAssertTrue(tc, resolverInit(2, ttl));
+    return mux;
+}
+
+static void openSession(CuTest * tc, MultiplexorADT mux, session * s) {
+    memset(s, 0, sizeof(*s));
+    CuAssertIntEquals(tc, 0, pipe(s->fds));
+    CuAssertIntEquals(tc, MUX_SUCCESS, registerFd(mux, s->fds[0], &sessionHandler, NO_INTEREST, s));
+}
+
+static void closeSession(MultiplexorADT mux, session * s) {
+    unregisterFd(mux, s->fds[0]);
+    close(s->fds[0]);
+    close(s->fds[1]);
+}
+
+/** Atiende el multiplexor hasta que `s' recibe una notificación. */
+static bool waitBlock(MultiplexorADT mux, session * s) {
+    for(unsigned i = 0; i < MAX_SELECTS && s->blocks == 0; i++)
+        if(MUX_SUCCESS != muxSelect(mux))
+            return false;
+    return s->blocks > 0;
+}
+
+void testResolverResolveAndCache(CuTest * tc) {
+    MultiplexorADT mux = setUp(tc, 60);
+    session s;
+    char statistics[256];
+
+    openSession(tc, mux, &s);
+    CuAssertIntEquals(tc, RESOLVER_PENDING, resolverResolve(&s.request, mux, s.fds[0], "127.0.0.1", POP3_PORT));
+    CuAssertTrue(tc, waitBlock(mux, &s));
+    CuAssertIntEquals(tc, 1, s.blocks);
+    CuAssertIntEquals(tc, RESOLVER_DONE, resolverPoll(&s.request));
+    CuAssertTrue(tc, s.request.answer.count > 0);
+    const struct sockaddr_in * address = (const struct sockaddr_in *) s.request.answer.addresses;
+    CuAssertIntEquals(tc, AF_INET, address->sin_family);
+    CuAssertIntEquals(tc, POP3_PORT, ntohs(address->sin_port));
+
+    /** La segunda vez se responde del cache, sin notificar. */
+    CuAssertIntEquals(tc, RESOLVER_DONE, resolverResolve(&s.request, mux, s.fds[0], "127.0.0.1", POP3_PORT));
+    CuAssertTrue(tc, s.request.answer.count > 0);
+    resolverStatistics(statistics, sizeof(statistics));
+    CuAssertTrue(tc, strstr(statistics, "lookups 1 ") != NULL);
+    CuAssertTrue(tc, strstr(statistics, "cache-hits 1 ") != NULL);
+
+    /** Un nombre que no entra en el pedido falla sin consultar. */
+    char name[0x200];
+    memset(name, 'a', sizeof(name) - 1);
+    name[sizeof(name) - 1] = 0;
+    CuAssertIntEquals(tc, RESOLVER_FAILED, resolverResolve(&s.request, mux, s.fds[0], name, POP3_PORT));
+
+    closeSession(mux, &s);
+    resolverDestroy();
+    deleteMultiplexorADT(mux);
+}
+
+void testResolverCoalesce(CuTest * tc) {
+    MultiplexorADT mux = setUp(tc, 0);
+    session first, second;
+    char statistics[256];
+
+    openSession(tc, mux, &first);
+    openSession(tc, mux, &second);
+    CuAssertIntEquals(tc, RESOLVER_PENDING, resolverResolve(&first.request, mux, first.fds[0], "127.0.0.2", POP3_PORT));
+    CuAssertIntEquals(tc, RESOLVER_PENDING, resolverResolve(&second.request, mux, second.fds[0], "127.0.0.2", POP3_PORT));
+    CuAssertTrue(tc, waitBlock(mux, &first));
+    CuAssertTrue(tc, waitBlock(mux, &second));
+    CuAssertIntEquals(tc, RESOLVER_DONE, resolverPoll(&first.request));
+    CuAssertIntEquals(tc, RESOLVER_DONE, resolverPoll(&second.request));
+
+    /** Con TTL 0 no se guarda, la consulta siguiente vuelve a resolver. */
+    CuAssertIntEquals(tc, RESOLVER_PENDING, resolverResolve(&first.request, mux, first.fds[0], "127.0.0.2", POP3_PORT));
+    resolverCancel(&first.request);
+    resolverStatistics(statistics, sizeof(statistics));
+    CuAssertTrue(tc, strstr(statistics, "coalesced 1 ") != NULL);
+
+    closeSession(mux, &first);
+    closeSession(mux, &second);
+    resolverDestroy();
+    deleteMultiplexorADT(mux);
+}
+
+void testResolverCancelAndReuse(CuTest * tc) {
+    MultiplexorADT mux = setUp(tc, 0);
+    session cancelled, reused, other;
+
+    openSession(tc, mux, &cancelled);
+    openSession(tc, mux, &other);
+    CuAssertIntEquals(tc, RESOLVER_PENDING, resolverResolve(&cancelled.request, mux, cancelled.fds[0], "127.0.0.3", POP3_PORT));
+
+    /** Se cierra la sesión y otra registra el mismo fd, como al aceptar una conexión nueva. */
+    const int fd = cancelled.fds[0];
+    unregisterFd(mux, fd);
+    memset(&reused, 0, sizeof(reused));
+    CuAssertIntEquals(tc, MUX_SUCCESS, registerFd(mux, fd, &sessionHandler, NO_INTEREST, &reused));
+
+    /** Cuando termina otra resolución posterior, la cancelada ya terminó. */
+    CuAssertIntEquals(tc, RESOLVER_PENDING, resolverResolve(&other.request, mux, other.fds[0], "127.0.0.3", POP3_PORT + 1));
+    CuAssertTrue(tc, waitBlock(mux, &other));
+    muxSelect(mux);
+    CuAssertIntEquals(tc, 0, cancelled.blocks);
+    CuAssertIntEquals(tc, 0, reused.blocks);
+    CuAssertIntEquals(tc, RESOLVER_PENDING, cancelled.request.status);
+
+    unregisterFd(mux, fd);
+    close(cancelled.fds[0]);
+    close(cancelled.fds[1]);
+    closeSession(mux, &other);
+    resolverDestroy();
+    deleteMultiplexorADT(mux);
+}
+
+CuSuite * getResolverTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testResolverResolveAndCache);
+    SUITE_ADD_TEST(suite, testResolverCoalesce);
+    SUITE_ADD_TEST(suite, testResolverCancelAndReuse);
+    return suite;
+}
@@ -315,6 +315,50 @@ void testValidTrickyResponse(CuTest * tc) {
     deleteQueue(commands);
 }
 
+/** Entrega `response' de a spans y retorna el estado final, con `ends' respuestas terminadas. */
+static responseState feedSpans(const char * response, commandStruct * commandsArray, const int count, int * ends) {
+    responseParser parser;
+    queueADT commands = createQueue();
+    const size_t length = strlen(response);
+    size_t offset = 0;
+
+    responseParserInit(&parser);
+    for(int i = 0; i < count; i++)
+        offer(commands, commandsArray + i);
+    *ends = 0;
+    while(offset < length && parser.state != RESPONSE_ERROR) {
+        offset += responseParserFeedSpan(&parser, (const uint8_t *) response + offset, length - offset, commands);
+        if(parser.state == RESPONSE_INIT)
+            (*ends)++;
+    }
+    deleteQueue(commands);
+    return parser.state;
+}
+
+void testFeedSpan(CuTest * tc) {
+    commandStruct commandsArray[2] = {{.type = CMD_LIST, .isMultiline = true}, {.isMultiline = false}};
+    char line[600];
+    char response[700];
+    int ends;
+
+    /** Se detiene al final de cada respuesta. */
+    CuAssertIntEquals(tc, RESPONSE_INIT, feedSpans("+OK\r\nuno\r\n..dos\r\n.\r\n+OK\r\n", commandsArray, 2, &ends));
+    CuAssertIntEquals(tc, 2, ends);
+    CuAssertIntEquals(tc, true, commandsArray[0].indicator);
+    CuAssertIntEquals(tc, true, commandsArray[1].indicator);
+
+    /** El largo máximo de una linea del cuerpo es el mismo que byte por byte. */
+    memset(line, 'a', 510);
+    line[510] = 0;
+    snprintf(response, sizeof(response), "+OK\r\n%s\r\n.\r\n", line);
+    CuAssertIntEquals(tc, RESPONSE_INIT, feedSpans(response, commandsArray, 1, &ends));
+    CuAssertIntEquals(tc, 1, ends);
+    memset(line, 'a', 520);
+    line[520] = 0;
+    snprintf(response, sizeof(response), "+OK\r\n%s\r\n.\r\n", line);
+    CuAssertIntEquals(tc, RESPONSE_ERROR, feedSpans(response, commandsArray, 1, &ends));
+}
+
 CuSuite * getResponseParserTest(void) {
     CuSuite* suite = CuSuiteNew();
     
@@ -323,6 +367,7 @@ CuSuite * getResponseParserTest(void) {
     SUITE_ADD_TEST(suite, testSingleLineAndMultiline);
     SUITE_ADD_TEST(suite, testInvalidTrickyResponse);
     SUITE_ADD_TEST(suite, testValidTrickyResponse);
+    SUITE_ADD_TEST(suite, testFeedSpan);
 
     return suite;
 }
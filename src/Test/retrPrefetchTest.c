@@ -0,0 +1,178 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "CuTest.h"
+#include "retrPrefetch.h"
+#include "retrPrefetchTest.h"
+
+#define FIRST_RESPONSE  "+OK\r\nuno\r\n.\r\n"
+#define SECOND_RESPONSE "+OK\r\ndos\r\n.\r\n"
+#define LIST_RESPONSE   "+OK 3 messages\r\n1 5\r\n2 5\r\n3 1000\r\n.\r\n"
+
+typedef struct session {
+    bufferADT           requests;
+    bufferADT           responses;
+    queueADT            commands;
+    commandParser       commandParser;
+    responseParser      responseParser;
+    retrPrefetchStruct  prefetch;
+} session;
+
+static void writeString(bufferADT buffer, const char * data) {
+    size_t    space;
+    uint8_t * ptr = getWritePtr(buffer, &space);
+    memcpy(ptr, data, strlen(data));
+    updateWritePtr(buffer, strlen(data));
+}
+
+static void pollResponses(session * s) {
+    while(isProcessedReadyQueue(s->commands))
+        deleteCommand(poll(s->commands));
+}
+
+/** Envía al origin todo lo que se puede de los comandos del cliente. */
+static void sendRequests(session * s) {
+    size_t size;
+    bool   newCommand;
+
+    if(!retrPrefetchHoldsClient(&s->prefetch))
+        commandParserConsume(&s->commandParser, s->requests, s->commands, true, &newCommand);
+    uint8_t * ptr = getReadPtr(s->requests, &size);
+    size = retrPrefetchSendable(&s->prefetch, size);
+    retrPrefetchRequestSent(&s->prefetch, ptr, size);
+    updateReadPtr(s->requests, size);
+}
+
+static bool readable(bufferADT buffer, const char * expected) {
+    size_t          size;
+    const uint8_t * ptr = getReadPtr(buffer, &size);
+    return size == strlen(expected) && memcmp(ptr, expected, size) == 0;
+}
+
+/** El cliente pide RETR 1, se piden los tamaños con LIST y se especula RETR 2. */
+static void startSession(CuTest * tc, session * s) {
+    memset(s, 0, sizeof(*s));
+    s->requests  = createBuffer(256);
+    s->responses = createBuffer(256);
+    s->commands  = createQueue();
+    commandParserInit(&s->commandParser);
+    responseParserInit(&s->responseParser);
+    retrPrefetchInit(&s->prefetch, 256);
+
+    writeString(s->requests, "RETR 1\r\n");
+    sendRequests(s);
+    CuAssertIntEquals(tc, 2, s->prefetch.next);
+    CuAssertTrue(tc, retrPrefetchStart(&s->prefetch, s->requests, &s->commandParser, s->commands));
+    CuAssertTrue(tc, s->prefetch.listing);
+    /** El cliente no espera la respuesta a LIST. */
+    CuAssertTrue(tc, !retrPrefetchHoldsClient(&s->prefetch));
+    sendRequests(s);
+
+    writeString(s->responses, FIRST_RESPONSE LIST_RESPONSE);
+    CuAssertTrue(tc, retrPrefetchProcess(&s->prefetch, s->responses, &s->responseParser, s->commands));
+    pollResponses(s);
+    CuAssertIntEquals(tc, PREFETCH_IDLE, s->prefetch.state);
+    CuAssertIntEquals(tc, 3, s->prefetch.messages);
+    CuAssertTrue(tc, readable(s->responses, FIRST_RESPONSE));
+
+    CuAssertTrue(tc, retrPrefetchStart(&s->prefetch, s->requests, &s->commandParser, s->commands));
+    CuAssertIntEquals(tc, PREFETCH_SENT, s->prefetch.state);
+    CuAssertIntEquals(tc, 2, s->prefetch.message);
+    sendRequests(s);
+    CuAssertTrue(tc, !canRead(s->requests));
+
+    writeString(s->responses, SECOND_RESPONSE);
+    CuAssertTrue(tc, retrPrefetchProcess(&s->prefetch, s->responses, &s->responseParser, s->commands));
+    pollResponses(s);
+    CuAssertIntEquals(tc, PREFETCH_HOLDING, s->prefetch.state);
+}
+
+static void finishSession(session * s) {
+    retrPrefetchDestroy(&s->prefetch);
+    pollResponses(s);
+    while(!isEmptyQueue(s->commands)) {
+        processQueue(s->commands);
+        deleteCommand(poll(s->commands));
+    }
+    deleteQueue(s->commands);
+    deleteBuffer(s->requests);
+    deleteBuffer(s->responses);
+}
+
+void testRetrPrefetchParseRetr(CuTest* tc) {
+    unsigned long message = 0;
+
+    CuAssertTrue(tc, retrPrefetchParseRetr((const uint8_t *) "RETR 3\r\n", 8, &message));
+    CuAssertIntEquals(tc, 3, message);
+    CuAssertTrue(tc, retrPrefetchParseRetr((const uint8_t *) "retr  12\n", 9, &message));
+    CuAssertIntEquals(tc, 12, message);
+    CuAssertTrue(tc, !retrPrefetchParseRetr((const uint8_t *) "RETR 3 4\r\n", 10, &message));
+    CuAssertTrue(tc, !retrPrefetchParseRetr((const uint8_t *) "RETR\r\n", 6, &message));
+    CuAssertTrue(tc, !retrPrefetchParseRetr((const uint8_t *) "RETR 0\r\n", 8, &message));
+    CuAssertTrue(tc, !retrPrefetchParseRetr((const uint8_t *) "LIST 1\r\n", 8, &message));
+}
+
+void testRetrPrefetchHit(CuTest* tc) {
+    session s;
+    startSession(tc, &s);
+
+    /** Solo la respuesta pedida por el cliente está lista para enviarse. */
+    CuAssertTrue(tc, readable(s.responses, FIRST_RESPONSE));
+
+    writeString(s.requests, "RETR 2\r\n");
+    retrPrefetchClientRequest(&s.prefetch, s.requests);
+    CuAssertTrue(tc, !canProcess(s.requests));
+    CuAssertIntEquals(tc, PREFETCH_DRAINING, s.prefetch.state);
+    CuAssertIntEquals(tc, 3, s.prefetch.next);
+
+    CuAssertTrue(tc, retrPrefetchProcess(&s.prefetch, s.responses, &s.responseParser, s.commands));
+    CuAssertIntEquals(tc, PREFETCH_IDLE, s.prefetch.state);
+    CuAssertTrue(tc, readable(s.responses, FIRST_RESPONSE SECOND_RESPONSE));
+    finishSession(&s);
+}
+
+void testRetrPrefetchMiss(CuTest* tc) {
+    session s;
+    startSession(tc, &s);
+
+    writeString(s.requests, "LIST\r\n");
+    retrPrefetchClientRequest(&s.prefetch, s.requests);
+    CuAssertIntEquals(tc, PREFETCH_DISCARDING, s.prefetch.state);
+    CuAssertTrue(tc, !retrPrefetchHoldsClient(&s.prefetch));
+    CuAssertTrue(tc, canProcess(s.requests));
+
+    CuAssertTrue(tc, retrPrefetchProcess(&s.prefetch, s.responses, &s.responseParser, s.commands));
+    pollResponses(&s);
+    CuAssertIntEquals(tc, PREFETCH_IDLE, s.prefetch.state);
+    CuAssertTrue(tc, readable(s.responses, FIRST_RESPONSE));
+    CuAssertTrue(tc, isEmptyQueue(s.commands));
+    finishSession(&s);
+}
+
+void testRetrPrefetchSkipLarge(CuTest* tc) {
+    session s;
+    startSession(tc, &s);
+
+    writeString(s.requests, "RETR 2\r\n");
+    retrPrefetchClientRequest(&s.prefetch, s.requests);
+    CuAssertTrue(tc, retrPrefetchProcess(&s.prefetch, s.responses, &s.responseParser, s.commands));
+    CuAssertIntEquals(tc, PREFETCH_IDLE, s.prefetch.state);
+    CuAssertIntEquals(tc, 3, s.prefetch.next);
+    /** Según LIST el mensaje 3 no entra en el buffer, no se pide. */
+    CuAssertTrue(tc, !retrPrefetchStart(&s.prefetch, s.requests, &s.commandParser, s.commands));
+    CuAssertIntEquals(tc, 0, s.prefetch.next);
+    CuAssertIntEquals(tc, PREFETCH_IDLE, s.prefetch.state);
+    /** Tampoco uno que LIST no nombra. */
+    s.prefetch.next = 4;
+    CuAssertTrue(tc, !retrPrefetchStart(&s.prefetch, s.requests, &s.commandParser, s.commands));
+    finishSession(&s);
+}
+
+CuSuite * getRetrPrefetchTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testRetrPrefetchParseRetr);
+    SUITE_ADD_TEST(suite, testRetrPrefetchHit);
+    SUITE_ADD_TEST(suite, testRetrPrefetchMiss);
+    SUITE_ADD_TEST(suite, testRetrPrefetchSkipLarge);
+    return suite;
+}
@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "CuTest.h"
+#include "sha256.h"
+#include "sha256Test.h"
+
+/** Escribe `digest' en hexadecimal sobre `hex'. */
+static void toHex(const uint8_t digest[SHA256_DIGEST_SIZE], char hex[2 * SHA256_DIGEST_SIZE + 1]) {
+    for(size_t i = 0; i < SHA256_DIGEST_SIZE; i++)
+        sprintf(hex + 2 * i, "%02x", digest[i]);
+}
+
+static void hashOf(const char * message, char hex[2 * SHA256_DIGEST_SIZE + 1]) {
+    sha256Context context;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+
+    sha256Init(&context);
+    sha256Update(&context, (const uint8_t *) message, strlen(message));
+    sha256Final(&context, digest);
+    toHex(digest, hex);
+}
+
+void testSha256Vectors(CuTest* tc) {
+    char hex[2 * SHA256_DIGEST_SIZE + 1];
+
+    hashOf("", hex);
+    CuAssertStrEquals(tc, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", hex);
+    hashOf("abc", hex);
+    CuAssertStrEquals(tc, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", hex);
+    hashOf("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", hex);
+    CuAssertStrEquals(tc, "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1", hex);
+}
+
+void testSha256Incremental(CuTest* tc) {
+    sha256Context context;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    char hex[2 * SHA256_DIGEST_SIZE + 1];
+    const uint8_t chunk[7] = "aaaaaaa";
+
+    /** Un millón de 'a' en trozos que no se alinean con el bloque. */
+    sha256Init(&context);
+    for(size_t i = 0; i < 1000000 / sizeof(chunk); i++)
+        sha256Update(&context, chunk, sizeof(chunk));
+    sha256Update(&context, chunk, 1000000 % sizeof(chunk));
+    sha256Final(&context, digest);
+    toHex(digest, hex);
+    CuAssertStrEquals(tc, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0", hex);
+}
+
+CuSuite * getSha256Test(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testSha256Vectors);
+    SUITE_ADD_TEST(suite, testSha256Incremental);
+    return suite;
+}
@@ -79,12 +79,38 @@ void testSockAddrToStringIPV6(CuTest* tc) {
     CuAssertStrEquals(tc, buffer, "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff:9898");
 }
 
+void testSockaddrSameHost(CuTest* tc) {
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_port = htons(110) };
+    struct sockaddr_in b = { .sin_family = AF_INET, .sin_port = htons(4321) };
+    struct sockaddr_in6 a6 = { .sin6_family = AF_INET6, .sin6_port = htons(110) };
+    struct sockaddr_in6 b6 = { .sin6_family = AF_INET6, .sin6_port = htons(4321) };
 
+    a.sin_addr.s_addr = htonl(0x7F000001);
+    b.sin_addr.s_addr = htonl(0x7F000001);
+    a6.sin6_addr = in6addr_loopback;
+    b6.sin6_addr = in6addr_loopback;
+
+    /** El puerto no cuenta para el host, si para la igualdad. */
+    CuAssertTrue(tc, sockaddrSameHost((struct sockaddr *) &a, (struct sockaddr *) &b));
+    CuAssertTrue(tc, !sockaddrEquals((struct sockaddr *) &a, (struct sockaddr *) &b));
+    CuAssertTrue(tc, sockaddrSameHost((struct sockaddr *) &a6, (struct sockaddr *) &b6));
+    CuAssertTrue(tc, !sockaddrEquals((struct sockaddr *) &a6, (struct sockaddr *) &b6));
+
+    b.sin_addr.s_addr = htonl(0x7F000002);
+    CuAssertTrue(tc, !sockaddrSameHost((struct sockaddr *) &a, (struct sockaddr *) &b));
+    b6.sin6_addr.s6_addr[0] = 0xFE;
+    CuAssertTrue(tc, !sockaddrSameHost((struct sockaddr *) &a6, (struct sockaddr *) &b6));
+
+    /** Familias distintas nunca son el mismo host. */
+    CuAssertTrue(tc, !sockaddrSameHost((struct sockaddr *) &a, (struct sockaddr *) &a6));
+    CuAssertTrue(tc, !sockaddrSameHost(NULL, (struct sockaddr *) &a));
+}
 
 CuSuite * getSockaddrToStringTest(void) {
     CuSuite* suite = CuSuiteNew();
     
     SUITE_ADD_TEST(suite, testSockAddrToStringIPV4);
     SUITE_ADD_TEST(suite, testSockAddrToStringIPV6);
+    SUITE_ADD_TEST(suite, testSockaddrSameHost);
     return suite;
 }
@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "CuTest.h"
+#include "stripmimeEngine.h"
+#include "stripmimeEngineTest.h"
+
+#define OUTPUT_SIZE 1024
+
+typedef struct testOutput {
+    char        data[OUTPUT_SIZE];
+    size_t      length;
+    size_t      writes;
+} testOutput;
+
+static void testWriter(const uint8_t * data, const size_t length, void * writerData) {
+    testOutput * output = writerData;
+    if(output->length + length < OUTPUT_SIZE) {
+        memcpy(output->data + output->length, data, length);
+        output->length += length;
+        output->data[output->length] = 0;
+    }
+    output->writes++;
+}
+
+static const char * message =
+    "Subject: test\r\n"
+    "Content-Type: multipart/mixed; boundary=\"XYZ\"\r\n"
+    "\r\n"
+    "--XYZ\r\n"
+    "Content-Type: text/plain\r\n"
+    "\r\n"
+    "texto\r\n"
+    "--XYZ\r\n"
+    "Content-Type: image/png\r\n"
+    "\r\n"
+    "iVBORw0KGgo=\r\n"
+    "--XYZ--\r\n";
+
+/** Parte censurada con lineas que el detector de boundaries mira de cerca. */
+static const char * skipMessage =
+    "Subject: test\r\n"
+    "Content-Type: multipart/mixed; boundary=\"XYZ\"\r\n"
+    "\r\n"
+    "--XYZ\r\n"
+    "Content-Type: image/png\r\n"
+    "\r\n"
+    "iVBORw0KGgo=\r\n"
+    "\r\n"
+    "-- firma\r\n"
+    "--XY-\r\n"
+    "AAAA\r\n"
+    "--xyz\r\n"
+    "Content-Type: text/plain\r\n"
+    "\r\n"
+    "texto\r\n"
+    "--XYZ\r\n"
+    "Content-Type: image/gif\r\n"
+    "\r\n"
+    "R0lGODlh\r\n"
+    "R0lGODlh\r\n"
+    "--XYZ--\r\n";
+
+/** Filtra `input' de a corridas de `step' bytes. */
+static void filterMessage(CuTest * tc, testOutput * output, const char * input, const char * mediaRange, const size_t step) {
+    const size_t length = strlen(input);
+
+    memset(output, 0, sizeof(*output));
+    stripmimeADT stripmime = createStripmime(mediaRange, "censurado", testWriter, output);
+    CuAssertPtrNotNull(tc, stripmime);
+    for(size_t i = 0; i < length; i += step)
+        CuAssertTrue(tc, stripmimeFeed(stripmime, (const uint8_t *) input + i, (length - i < step)? length - i : step));
+    deleteStripmime(stripmime);
+}
+
+static void filter(CuTest * tc, testOutput * output, const char * mediaRange, const size_t step) {
+    filterMessage(tc, output, message, mediaRange, step);
+}
+
+void testStripmimeReplacesPart(CuTest* tc) {
+    testOutput output;
+
+    filter(tc, &output, "image/png", strlen(message));
+    CuAssertTrue(tc, strstr(output.data, "texto\r\n") != NULL);
+    CuAssertTrue(tc, strstr(output.data, "censurado\r\n") != NULL);
+    CuAssertTrue(tc, strstr(output.data, "iVBORw0KGgo=") == NULL);
+
+    /** Sin partes censurables la salida es el mensaje. */
+    filter(tc, &output, "application/pdf", strlen(message));
+    CuAssertStrEquals(tc, message, output.data);
+}
+
+void testStripmimeSpans(CuTest* tc) {
+    testOutput whole, split;
+
+    /** La salida no depende de cómo se parte la entrada. */
+    filter(tc, &whole, "image/*", strlen(message));
+    for(size_t step = 1; step < 16; step++) {
+        filter(tc, &split, "image/*", step);
+        CuAssertStrEquals(tc, whole.data, split.data);
+    }
+
+    /** Las corridas del cuerpo se escriben de una vez. */
+    CuAssertTrue(tc, whole.writes < whole.length);
+}
+
+void testStripmimeSkipsReplacedPart(CuTest* tc) {
+    testOutput whole, split;
+
+    /**
+     * De a un byte no hay lineas completas para saltear, la salida tiene que
+     * ser la misma que procesando todo el mensaje de una vez.
+     */
+    filterMessage(tc, &whole, skipMessage, "image/*", strlen(skipMessage));
+    filterMessage(tc, &split, skipMessage, "image/*", 1);
+    CuAssertStrEquals(tc, split.data, whole.data);
+    CuAssertTrue(tc, strstr(whole.data, "texto\r\n") != NULL);
+    CuAssertTrue(tc, strstr(whole.data, "AAAA") == NULL);
+    CuAssertTrue(tc, strstr(whole.data, "R0lGODlh") == NULL);
+    for(size_t step = 2; step < 16; step++) {
+        filterMessage(tc, &split, skipMessage, "image/*", step);
+        CuAssertStrEquals(tc, whole.data, split.data);
+    }
+}
+
+void testStripmimeErrors(CuTest* tc) {
+    testOutput output;
+    char header[3000];
+
+    CuAssertPtrEquals(tc, NULL, createStripmime(NULL, "censurado", testWriter, &output));
+    CuAssertPtrEquals(tc, NULL, createStripmime("image", "censurado", testWriter, &output));
+
+    /** Un header demasiado largo es un error fatal. */
+    memset(&output, 0, sizeof(output));
+    stripmimeADT stripmime = createStripmime("image/png", "censurado", testWriter, &output);
+    CuAssertPtrNotNull(tc, stripmime);
+    memset(header, 'a', sizeof(header));
+    memcpy(header, "X-Long: ", 8);
+    CuAssertTrue(tc, !stripmimeFeed(stripmime, (const uint8_t *) header, sizeof(header)));
+    const size_t length = output.length;
+    CuAssertTrue(tc, !stripmimeFeed(stripmime, (const uint8_t *) "\r\n\r\nbody\r\n", 10));
+    CuAssertIntEquals(tc, length, output.length);
+    deleteStripmime(stripmime);
+}
+
+CuSuite * getStripmimeEngineTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testStripmimeReplacesPart);
+    SUITE_ADD_TEST(suite, testStripmimeSpans);
+    SUITE_ADD_TEST(suite, testStripmimeSkipsReplacedPart);
+    SUITE_ADD_TEST(suite, testStripmimeErrors);
+    return suite;
+}
@@ -0,0 +1,56 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/select.h>
+
+#include "CuTest.h"
+#include "timerFd.h"
+#include "timerFdTest.h"
+
+/** Indica si `fd' se vuelve legible antes de `ms' milisegundos. */
+static bool readable(const int fd, const long ms) {
+    struct timeval timeout = { .tv_sec = ms / 1000, .tv_usec = (ms % 1000) * 1000 };
+    fd_set readSet;
+
+    FD_ZERO(&readSet);
+    FD_SET(fd, &readSet);
+    return select(fd + 1, &readSet, NULL, NULL, &timeout) == 1;
+}
+
+void testTimerFdArm(CuTest* tc) {
+    const int fd = timerFdCreate();
+
+    CuAssertTrue(tc, fd >= 0);
+    /** Desarmado no vence, y consumirlo sin vencimientos no es un error. */
+    CuAssertTrue(tc, !readable(fd, 20));
+    CuAssertTrue(tc, timerFdClear(fd));
+
+    CuAssertIntEquals(tc, 0, timerFdArm(fd, 10));
+    CuAssertTrue(tc, readable(fd, 1000));
+    CuAssertTrue(tc, timerFdClear(fd));
+    CuAssertTrue(tc, !readable(fd, 30));
+
+    /** Armarlo con 0 lo desarma. */
+    CuAssertIntEquals(tc, 0, timerFdArm(fd, 10));
+    CuAssertIntEquals(tc, 0, timerFdArm(fd, 0));
+    CuAssertTrue(tc, !readable(fd, 30));
+    close(fd);
+}
+
+void testTimerFdPeriodic(CuTest* tc) {
+    const int fd = timerFdCreate();
+
+    CuAssertTrue(tc, fd >= 0);
+    CuAssertIntEquals(tc, 0, timerFdArmPeriodic(fd, 10));
+    for(int i = 0; i < 3; i++) {
+        CuAssertTrue(tc, readable(fd, 1000));
+        CuAssertTrue(tc, timerFdClear(fd));
+    }
+    close(fd);
+}
+
+CuSuite * getTimerFdTest(void) {
+    CuSuite * suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, testTimerFdArm);
+    SUITE_ADD_TEST(suite, testTimerFdPeriodic);
+    return suite;
+}
@@ -153,6 +153,20 @@ void compact(bufferADT buffer)
 	}
 }
 
+size_t moveUnprocessed(bufferADT from, bufferADT to)
+{
+	size_t size, space;
+	uint8_t * src = getProcessPtr(from, &size);
+	uint8_t * dst = getWritePtr(to, &space);
+	const size_t moved = (size < space)? size : space;
+
+	memcpy(dst, src, moved);
+	updateWritePtr(to, moved);
+	memmove(src, src + moved, size - moved);
+	from->writePtr -= moved;
+	return moved;
+}
+
 inline uint8_t readAByte(bufferADT buffer)
 {
     uint8_t byte;
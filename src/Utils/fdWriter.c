@@ -0,0 +1,90 @@
+/**
+ * fdWriter.c - salida con buffer propio sobre un descriptor bloqueante.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "fdWriter.h"
+
+struct fdWriterCDT {
+    int         fd;
+    bool        failed;
+    size_t      syscalls;
+    size_t      length;
+    size_t      capacity;
+    uint8_t     data[];
+};
+
+/** Escribe los `count' vectores completos, reintentando las escrituras parciales. */
+static bool writeVectors(fdWriterADT writer, struct iovec * vectors, int count) {
+    while(count > 0) {
+        const ssize_t n = (count == 1)? write(writer->fd, vectors->iov_base, vectors->iov_len)
+                                      : writev(writer->fd, vectors, count);
+        writer->syscalls++;
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return false;
+        size_t written = n;
+        while(count > 0 && written >= vectors->iov_len) {
+            written -= vectors->iov_len;
+            vectors++;
+            count--;
+        }
+        if(count > 0) {
+            vectors->iov_base = (uint8_t *) vectors->iov_base + written;
+            vectors->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+fdWriterADT createFdWriter(const int fd, const size_t capacity) {
+    fdWriterADT writer = malloc(sizeof(*writer) + capacity);
+    if(writer == NULL)
+        return NULL;
+    writer->fd       = fd;
+    writer->failed   = false;
+    writer->syscalls = 0;
+    writer->length   = 0;
+    writer->capacity = capacity;
+    return writer;
+}
+
+bool fdWriterWrite(fdWriterADT writer, const uint8_t * data, const size_t length) {
+    if(writer->failed)
+        return false;
+    if(writer->length + length <= writer->capacity) {
+        memcpy(writer->data + writer->length, data, length);
+        writer->length += length;
+        return true;
+    }
+    struct iovec vectors[] = {
+        { .iov_base = writer->data,     .iov_len = writer->length },
+        { .iov_base = (uint8_t *) data, .iov_len = length },
+    };
+    const bool pending = writer->length > 0;
+    writer->failed = !writeVectors(writer, vectors + !pending, 1 + pending);
+    writer->length = 0;
+    return !writer->failed;
+}
+
+bool fdWriterFlush(fdWriterADT writer) {
+    if(writer->failed || writer->length == 0)
+        return !writer->failed;
+    struct iovec vector = { .iov_base = writer->data, .iov_len = writer->length };
+    writer->failed = !writeVectors(writer, &vector, 1);
+    writer->length = 0;
+    return !writer->failed;
+}
+
+size_t fdWriterSyscalls(const fdWriterADT writer) {
+    return writer->syscalls;
+}
+
+void deleteFdWriter(fdWriterADT writer) {
+    free(writer);
+}
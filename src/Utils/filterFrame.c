@@ -0,0 +1,132 @@
+/**
+ * filterFrame.c - lado del worker del protocolo del pool de filtros.
+ */
+#include <string.h>
+#include <unistd.h>
+
+#include "filterFrame.h"
+
+/** Estados de filterFrameDecoder. */
+enum decoderState {
+    LINE_START,
+    LINE,
+    DOT,
+    DOT_CR,
+};
+
+static bool readAll(const int fd, uint8_t * data, size_t length) {
+    while(length > 0) {
+        const ssize_t n = read(fd, data, length);
+        if(n <= 0)
+            return false;
+        data   += n;
+        length -= n;
+    }
+    return true;
+}
+
+ssize_t filterFrameReadHeader(const int fd, char * header, const size_t size) {
+    uint8_t lengthBytes[4];
+
+    if(!readAll(fd, lengthBytes, sizeof(lengthBytes)))
+        return -1;
+    const size_t length = ((size_t) lengthBytes[0] << 24) | ((size_t) lengthBytes[1] << 16)
+                        | ((size_t) lengthBytes[2] << 8) | lengthBytes[3];
+    if(length >= size || !readAll(fd, (uint8_t *) header, length))
+        return -1;
+    header[length] = '\0';
+    return length;
+}
+
+const char * filterFrameValue(const char * header, const size_t length, const char * name) {
+    const size_t nameLength = strlen(name);
+
+    for(size_t i = 0; i < length; i += strlen(header + i) + 1)
+        if(strncmp(header + i, name, nameLength) == 0 && header[i + nameLength] == '=')
+            return header + i + nameLength + 1;
+    return NULL;
+}
+
+void filterFrameDecoderInit(filterFrameDecoder * decoder) {
+    decoder->state = LINE_START;
+    decoder->done  = false;
+}
+
+size_t filterFrameDecode(filterFrameDecoder * decoder, const uint8_t * data, const size_t length, filterFrameWriter writer, void * writerData) {
+    size_t start = 0, i;
+
+    for(i = 0; i < length && !decoder->done; i++) {
+        const uint8_t c = data[i];
+        switch(decoder->state) {
+            case LINE_START:
+                if(c == '.') {
+                    /** El punto de una linea con dot-stuffing no es del cuerpo. */
+                    if(i > start)
+                        writer(data + start, i - start, writerData);
+                    start = i + 1;
+                    decoder->state = DOT;
+                } else
+                    decoder->state = (c == '\n')? LINE_START : LINE;
+                break;
+            case DOT:
+                if(c == '\r') {
+                    /** Puede ser la linea de terminación, el '\r' se retiene. */
+                    start = i + 1;
+                    decoder->state = DOT_CR;
+                } else
+                    decoder->state = (c == '\n')? LINE_START : LINE;
+                break;
+            case DOT_CR:
+                if(c == '\n') {
+                    decoder->done = true;
+                    start = i + 1;
+                    break;
+                }
+                writer((const uint8_t *) "\r", 1, writerData);
+                start = i;
+                decoder->state = LINE;
+                break;
+            default:
+                if(c == '\n')
+                    decoder->state = LINE_START;
+                break;
+        }
+    }
+    if(!decoder->done && i > start)
+        writer(data + start, i - start, writerData);
+    return i;
+}
+
+void filterFrameEncoderInit(filterFrameEncoder * encoder) {
+    encoder->lineStart = true;
+    encoder->lastCR    = false;
+}
+
+void filterFrameEncode(filterFrameEncoder * encoder, const uint8_t * data, const size_t length, filterFrameWriter writer, void * writerData) {
+    size_t start = 0;
+
+    for(size_t i = 0; i < length; i++) {
+        if(encoder->lineStart && data[i] == '.') {
+            if(i > start)
+                writer(data + start, i - start, writerData);
+            writer((const uint8_t *) ".", 1, writerData);
+            start = i;
+        } else if(data[i] == '\n' && !encoder->lastCR) {
+            if(i > start)
+                writer(data + start, i - start, writerData);
+            writer((const uint8_t *) "\r\n", 2, writerData);
+            start = i + 1;
+        }
+        encoder->lineStart = data[i] == '\n';
+        encoder->lastCR    = data[i] == '\r';
+    }
+    if(length > start)
+        writer(data + start, length - start, writerData);
+}
+
+void filterFrameEncodeEnd(filterFrameEncoder * encoder, filterFrameWriter writer, void * writerData) {
+    if(!encoder->lineStart)
+        writer((const uint8_t *) "\r\n", 2, writerData);
+    writer((const uint8_t *) ".\r\n", 3, writerData);
+    filterFrameEncoderInit(encoder);
+}
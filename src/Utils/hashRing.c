@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hashRing.h"
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME  0x100000001b3ULL
+#define POINT_NAME_SIZE 300
+
+typedef struct ringPoint {
+    uint64_t    hash;
+    size_t      node;
+} ringPoint;
+
+typedef struct hashRingCDT {
+    ringPoint * points;
+    size_t      size;
+    size_t      capacity;
+    size_t      virtualNodes;
+} hashRingCDT;
+
+
+hashRingADT createHashRing(const size_t virtualNodes) {
+    hashRingADT ring = calloc(1, sizeof(hashRingCDT));
+    if(ring != NULL)
+        ring->virtualNodes = (virtualNodes == 0)? 1 : virtualNodes;
+    return ring;
+}
+
+void deleteHashRing(hashRingADT ring) {
+    if(ring != NULL) {
+        free(ring->points);
+        free(ring);
+    }
+}
+
+/**
+ * FNV-1a con el mezclado final de splitmix64, FNV solo distribuye mal los
+ * nombres que difieren en los últimos bytes.
+ */
+uint64_t hashRingHash(const uint8_t * key, const size_t length) {
+    uint64_t hash = FNV_OFFSET;
+    for(size_t i = 0; i < length; i++) {
+        hash ^= key[i];
+        hash *= FNV_PRIME;
+    }
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+static int comparePoints(const void * first, const void * second) {
+    const ringPoint * a = first, * b = second;
+    if(a->hash != b->hash)
+        return (a->hash < b->hash)? -1 : 1;
+    /** Ante colisiones el orden no depende del orden de inserción. */
+    return (a->node < b->node)? -1 : (a->node > b->node);
+}
+
+bool hashRingAdd(hashRingADT ring, const size_t node, const char * name) {
+    char pointName[POINT_NAME_SIZE];
+
+    if(ring->size + ring->virtualNodes > ring->capacity) {
+        const size_t capacity = ring->size + ring->virtualNodes;
+        ringPoint *  points   = realloc(ring->points, capacity * sizeof(*points));
+        if(points == NULL)
+            return false;
+        ring->points   = points;
+        ring->capacity = capacity;
+    }
+    for(size_t i = 0; i < ring->virtualNodes; i++) {
+        const int length = snprintf(pointName, sizeof(pointName), "%s#%zu", name, i);
+        const size_t size = (length < 0 || (size_t) length >= sizeof(pointName))? sizeof(pointName) - 1 : (size_t) length;
+        ring->points[ring->size].hash = hashRingHash((const uint8_t *) pointName, size);
+        ring->points[ring->size].node = node;
+        ring->size++;
+    }
+    qsort(ring->points, ring->size, sizeof(*ring->points), comparePoints);
+    return true;
+}
+
+void hashRingRemove(hashRingADT ring, const size_t node) {
+    size_t kept = 0;
+    for(size_t i = 0; i < ring->size; i++)
+        if(ring->points[i].node != node)
+            ring->points[kept++] = ring->points[i];
+    ring->size = kept;
+}
+
+size_t hashRingPoints(hashRingADT ring) {
+    return ring->size;
+}
+
+/** Primer punto con hash mayor o igual a `hash', o `size' si no hay. */
+static size_t lowerBound(hashRingADT ring, const uint64_t hash) {
+    size_t low = 0, high = ring->size;
+    while(low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if(ring->points[middle].hash < hash)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+bool hashRingLookupFiltered(hashRingADT ring, const uint8_t * key, const size_t length,
+                            hashRingFilter filter, void * data, size_t * node) {
+    if(ring == NULL || ring->size == 0)
+        return false;
+
+    size_t position = lowerBound(ring, hashRingHash(key, length));
+    for(size_t step = 0; step < ring->size; step++, position++) {
+        const ringPoint * point = ring->points + position % ring->size;
+        if(filter == NULL || filter(point->node, data)) {
+            *node = point->node;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool hashRingLookup(hashRingADT ring, const uint8_t * key, const size_t length, size_t * node) {
+    return hashRingLookupFiltered(ring, key, length, NULL, NULL, node);
+}
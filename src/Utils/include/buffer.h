@@ -35,6 +35,12 @@ void updateWriteAndProcessPtr(bufferADT buffer, ssize_t writedBytes);
 
 void compact(bufferADT buffer);
 
+/**
+ * Mueve al final de `to' los bytes sin procesar de `from', tantos como
+ * entren, y los quita de `from'. Retorna la cantidad de bytes movidos.
+ */
+size_t moveUnprocessed(bufferADT from, bufferADT to);
+
 uint8_t readAByte(bufferADT buffer);
 
 uint8_t processAByte(bufferADT buffer);
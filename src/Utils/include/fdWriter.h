@@ -0,0 +1,41 @@
+#ifndef FD_WRITER_H
+#define FD_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * fdWriter.h - salida con buffer propio sobre un descriptor bloqueante.
+ *
+ * Junta las corridas chicas en un buffer y escribe con write o writev solo
+ * cuando la corrida no entra o al vaciarlo con fdWriterFlush. Una corrida
+ * que no entra se escribe junto con lo acumulado en un solo writev, sin
+ * copiarla. A diferencia de stdio el tamaño del buffer no depende del tipo
+ * de descriptor.
+ */
+
+/** Capacidad recomendada para filtros que escriben mensajes completos. */
+#define FD_WRITER_CAPACITY (64 * 1024)
+
+typedef struct fdWriterCDT * fdWriterADT;
+
+/** Crea la salida sobre `fd' con un buffer de `capacity' bytes. Retorna NULL si no hay memoria. */
+fdWriterADT createFdWriter(const int fd, const size_t capacity);
+
+/**
+ * Escribe `length' bytes de `data'. Retorna false si falló una escritura;
+ * desde entonces no se escribe nada más.
+ */
+bool fdWriterWrite(fdWriterADT writer, const uint8_t * data, const size_t length);
+
+/** Escribe lo acumulado. Retorna false si falló alguna escritura. */
+bool fdWriterFlush(fdWriterADT writer);
+
+/** Cantidad de llamadas a write y writev hechas. */
+size_t fdWriterSyscalls(const fdWriterADT writer);
+
+/** Libera la salida sin escribir lo acumulado. */
+void deleteFdWriter(fdWriterADT writer);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef FILTER_FRAME_H
+#define FILTER_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/**
+ * filterFrame.h - lado del worker del protocolo del pool de filtros.
+ *
+ * Un worker atiende por stdin y stdout un mensaje tras otro. Cada mensaje
+ * empieza con un header: un largo de 4 bytes en big endian seguido de
+ * entradas "NOMBRE=valor" terminadas en '\0'. Le sigue el cuerpo con
+ * dot-stuffing, terminado en ".\r\n". El worker responde la salida con
+ * dot-stuffing, terminada en ".\r\n", y espera el header siguiente.
+ *
+ * Un filtro nativo implementa este protocolo con `filterFrameReadHeader',
+ * un `filterFrameDecoder' para el cuerpo y un `filterFrameEncoder' para la
+ * salida; los demás se ejecutan una vez por mensaje desde el filterWrapper.
+ */
+
+/** Variable de entorno con la que se lanza a un worker. */
+#define FILTER_WORKER_ENV "POP3FILTER_WORKER"
+/** Tamaño máximo del header de un mensaje, incluyendo el largo. */
+#define FILTER_FRAME_HEADER_SIZE 8192
+/** Entradas del header que no son variables de entorno del comando. */
+#define FILTER_FRAME_COMMAND "FILTER_COMMAND"
+#define FILTER_FRAME_ERROR_FILE "FILTER_ERROR_FILE"
+
+/** Recibe una corrida de bytes. */
+typedef void (*filterFrameWriter)(const uint8_t * data, const size_t length, void * writerData);
+
+/** Quita el dot-stuffing del cuerpo de un mensaje. */
+typedef struct filterFrameDecoder {
+    unsigned        state;
+    /** Se consumió la linea de terminación. */
+    bool            done;
+} filterFrameDecoder;
+
+/** Agrega el dot-stuffing a la salida de un mensaje. */
+typedef struct filterFrameEncoder {
+    bool            lineStart;
+    bool            lastCR;
+} filterFrameEncoder;
+
+/**
+ * Lee de `fd' el header de un mensaje y lo deja en `header' terminado en
+ * '\0'. Retorna el largo de las entradas, o -1 si se cerró `fd' o el header
+ * no entra en `size'.
+ */
+ssize_t filterFrameReadHeader(const int fd, char * header, const size_t size);
+
+/** Valor de la entrada `name' del header, o NULL si no está. */
+const char * filterFrameValue(const char * header, const size_t length, const char * name);
+
+void filterFrameDecoderInit(filterFrameDecoder * decoder);
+
+/**
+ * Entrega a `writer' el cuerpo sin dot-stuffing que hay en `data'. Retorna
+ * cuántos bytes se consumieron: al llegar a la linea de terminación, que no
+ * se entrega, se detiene y marca `done'.
+ */
+size_t filterFrameDecode(filterFrameDecoder * decoder, const uint8_t * data, const size_t length, filterFrameWriter writer, void * writerData);
+
+void filterFrameEncoderInit(filterFrameEncoder * encoder);
+
+/**
+ * Entrega a `writer' `data' con dot-stuffing. A un '\n' sin '\r' lo
+ * reemplaza por "\r\n".
+ */
+void filterFrameEncode(filterFrameEncoder * encoder, const uint8_t * data, const size_t length, filterFrameWriter writer, void * writerData);
+
+/** Termina la salida con la linea de terminación. */
+void filterFrameEncodeEnd(filterFrameEncoder * encoder, filterFrameWriter writer, void * writerData);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef HASH_RING_H
+#define HASH_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * hashRing.h - hashing consistente con nodos virtuales.
+ *
+ * Cada nodo ocupa `virtualNodes' puntos del anillo, derivados de su nombre.
+ * Una clave corresponde al primer punto en sentido horario desde su hash,
+ * por lo que agregar o quitar un nodo solo mueve las claves de ese nodo.
+ */
+
+typedef struct hashRingCDT * hashRingADT;
+
+/** Indica si un nodo puede recibir claves. */
+typedef bool (*hashRingFilter)(const size_t node, void * data);
+
+hashRingADT createHashRing(const size_t virtualNodes);
+
+void deleteHashRing(hashRingADT ring);
+
+/** Agrega el nodo `node' con los puntos derivados de `name'. */
+bool hashRingAdd(hashRingADT ring, const size_t node, const char * name);
+
+/** Quita todos los puntos del nodo `node'. */
+void hashRingRemove(hashRingADT ring, const size_t node);
+
+/** Cantidad de puntos en el anillo. */
+size_t hashRingPoints(hashRingADT ring);
+
+/**
+ * Busca el nodo de la clave. Retorna false si el anillo está vacío.
+ */
+bool hashRingLookup(hashRingADT ring, const uint8_t * key, const size_t length, size_t * node);
+
+/**
+ * Busca el nodo de la clave salteando los nodos que `filter' rechaza.
+ * Retorna false si ningún nodo es aceptado.
+ */
+bool hashRingLookupFiltered(hashRingADT ring, const uint8_t * key, const size_t length,
+                            hashRingFilter filter, void * data, size_t * node);
+
+uint64_t hashRingHash(const uint8_t * key, const size_t length);
+
+#endif
@@ -2,6 +2,7 @@
 #define NET_UTILS_H
 
 #include <stdlib.h>
+#include <stdbool.h>
 
 typedef enum addressType {
     ADDR_IPV4   = 0x01,
@@ -29,5 +30,11 @@ void setAddress(addressData * address, const char * strIP);
 
 void sockaddrToString(char * buffer, const size_t bufferSize, const struct sockaddr * address);
 
+/** Indica si dos direcciones IPv4 o IPv6 corresponden al mismo host, sin importar el puerto. */
+bool sockaddrSameHost(const struct sockaddr * address, const struct sockaddr * other);
+
+/** Indica si dos direcciones IPv4 o IPv6 tienen el mismo host y el mismo puerto. */
+bool sockaddrEquals(const struct sockaddr * address, const struct sockaddr * other);
+
 #endif
 
@@ -12,6 +12,7 @@
  */
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 typedef struct parserCDT * parserADT;
 /**
@@ -30,6 +31,29 @@ typedef struct parserEvent {
     struct parserEvent * next;
 } parserEvent;
 
+/**
+ * Evento que retorna el parser al ser alimentado con un span de bytes.
+ *
+ * Los eventos consecutivos del mismo tipo cuyos datos son exactamente los
+ * bytes que los originaron (por ejemplo el cuerpo de un mensaje) se fusionan
+ * en un único evento que referencia el rango del span, en lugar de copiar
+ * los datos en `data'.
+ */
+typedef struct parserSpanEvent {
+    /** Tipo de evento */
+    unsigned        type;
+    /** Inicio del rango del span que originó el evento */
+    const uint8_t * ptr;
+    /** Cantidad de bytes del span que abarca el evento */
+    size_t          length;
+    /** true si los datos del evento son los bytes de [ptr, ptr + length) */
+    bool            literal;
+    /** Caracteres generados por la acción, válidos solo si !literal */
+    uint8_t         data[3];
+    /** Cantidad de datos en el buffer `data' */
+    uint8_t         n;
+} parserSpanEvent;
+
 /** Describe una transición entre estados  */
 typedef struct parserStateTransition {
     /* Condición: un caracter o una clase de caracter. Por ej: '\r' */
@@ -77,6 +101,23 @@ void resetParser(parserADT parser);
  */
 const parserEvent * feedParser(parserADT parser, const uint8_t character);
 
+/**
+ * Alimenta el parser con los `length' bytes de `span' y agrega los eventos
+ * resultantes en `events' (de capacidad `eventsSize', al menos 2).
+ *
+ * El parseo se detiene cuando no hay lugar para más eventos, cuando se
+ * consume todo el span o luego de emitir un evento cuyo tipo (menor a 32)
+ * esté presente en la máscara `stopMask'. Esto último permite al usuario
+ * resetear el parser ante ciertos eventos antes de seguir alimentándolo.
+ *
+ * Retorna la cantidad de eventos agregados y deja en `consumed' la cantidad
+ * de bytes consumidos del span. Los eventos referencian al span, por lo que
+ * son válidos mientras lo sea el span.
+ */
+size_t feedParserSpan(parserADT parser, const uint8_t * span, const size_t length,
+                      parserSpanEvent * events, const size_t eventsSize,
+                      const unsigned stopMask, size_t * consumed);
+
 /**
  * En caso de la aplicacion no necesite clases caracteres, se
  * provee dicho arreglo para ser usando en `initializeParser'
@@ -0,0 +1,93 @@
+#ifndef PROCESS_SPAWN_H
+#define PROCESS_SPAWN_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+/**
+ * processSpawn.h - lanzamiento de procesos sin fork.
+ *
+ * Usa posix_spawn, que en Linux crea el hijo con vfork: no se copian las
+ * tablas de páginas del padre, por lo que el costo de lanzar un filtro no
+ * crece con la memoria del proxy. El hijo solo hereda stdin, stdout y
+ * stderr si el resto de los descriptores tiene CLOEXEC: el kernel los
+ * cierra al ejecutar `path', cuando el padre ya siguió. Cerrarlos antes del
+ * exec (closefrom) dejaría al padre bloqueado mientras tanto, y con miles
+ * de conexiones abiertas eso cuesta más que el lanzamiento mismo.
+ *
+ * El hijo arranca sin señales bloqueadas, aunque el proceso bloquee
+ * SIGCHLD para esperar a sus hijos solo en el multiplexor.
+ */
+
+/** Tamaño de cada lectura de processCopy cuando no puede usar splice. */
+#define PROCESS_COPY_BUFFER_SIZE (64 * 1024)
+
+/**
+ * Ejecuta `path' con `argv' con `inFd' y `outFd' como entrada y salida
+ * estándar. Con `errorFile' distinto de NULL la salida de error se abre en
+ * ese archivo en modo append (si no se puede abrir queda cerrada); con NULL
+ * se hereda. El entorno es el del proceso más las `count' variables
+ * `names'/`values', que reemplazan a las del mismo nombre; los valores NULL
+ * se omiten. SIGPIPE vuelve a su acción por defecto en el hijo aunque el
+ * proceso lo ignore. Retorna el pid del hijo, o -1 si no se pudo ejecutar
+ * `path'.
+ */
+pid_t processSpawn(const char * path, char * const argv[], const int inFd, const int outFd, const char * errorFile,
+                   const char * const names[], const char * const values[], const size_t count);
+
+/**
+ * Igual que processSpawn, pero el hijo recibe cada uno de los `fdCount'
+ * descriptores de `fds' con el número de su posición. La posición de stderr
+ * y los descriptores -1 se ignoran.
+ */
+pid_t processSpawnFds(const char * path, char * const argv[], const int fds[], const size_t fdCount, const char * errorFile,
+                      const char * const names[], const char * const values[], const size_t count);
+
+/**
+ * Crea un pipe con CLOEXEC en ambos extremos, con pipe2 para que ningún
+ * hijo lanzado desde otro hilo llegue a heredarlo. Retorna -1 si no se pudo
+ * crear.
+ */
+int processPipe(int fds[2]);
+
+/**
+ * Crea un archivo anónimo en memoria (memfd) con CLOEXEC, que se puede
+ * pasar a otro proceso y mapear. Retorna -1 si no se pudo crear.
+ */
+int processMemfd(const char * name);
+
+/**
+ * Abre un pidfd del hijo `pid', con CLOEXEC: se vuelve legible cuando el
+ * hijo termina, aunque el manejador de SIGCHLD ya lo haya esperado. Se debe
+ * abrir antes de que se lo pueda esperar, si no `pid' puede ser de otro
+ * proceso. Retorna -1 si no se pudo abrir o el sistema no tiene pidfd.
+ */
+int processPidfd(const pid_t pid);
+
+/** Indica, sin bloquear, si terminó el proceso del pidfd `pidfd'. */
+bool processExited(const int pidfd);
+
+/**
+ * Copia `inFd' en `outFd' hasta el fin de la entrada, para los hijos que
+ * reemplazan a un comando que no se pudo ejecutar. Entre pipes usa splice,
+ * sin pasar los datos por el proceso; si no, read y write de a
+ * PROCESS_COPY_BUFFER_SIZE bytes. Retorna false si hubo un error.
+ */
+bool processCopy(const int inFd, const int outFd);
+
+/**
+ * Cambia la capacidad del pipe de `fd' a al menos `size' bytes (el kernel
+ * la redondea a páginas, sin superar /proc/sys/fs/pipe-max-size para los
+ * procesos sin privilegios). Retorna la capacidad nueva, o -1 si no se pudo
+ * cambiar.
+ */
+int processSetPipeSize(const int fd, const size_t size);
+
+/**
+ * Cierra los descriptores desde `lowFd' en adelante. Para los hijos que se
+ * crean con fork, con close_range si está disponible.
+ */
+void processCloseFrom(const int lowFd);
+
+#endif
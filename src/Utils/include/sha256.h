@@ -0,0 +1,32 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * sha256.h - SHA-256 (FIPS 180-4) incremental.
+ *
+ * Se usa donde un hash debe resistir colisiones buscadas a propósito, por
+ * ejemplo para reconocer cuerpos de mensajes que llegan de afuera.
+ */
+
+#define SHA256_DIGEST_SIZE 32
+#define SHA256_BLOCK_SIZE  64
+
+typedef struct sha256Context {
+    uint32_t    state[8];
+    uint64_t    length;
+    uint8_t     block[SHA256_BLOCK_SIZE];
+    size_t      used;
+} sha256Context;
+
+void sha256Init(sha256Context * context);
+
+/** Agrega `length' bytes de `data' al mensaje. */
+void sha256Update(sha256Context * context, const uint8_t * data, size_t length);
+
+/** Deja en `digest' el hash del mensaje. El contexto debe inicializarse de nuevo para reusarlo. */
+void sha256Final(sha256Context * context, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+#endif
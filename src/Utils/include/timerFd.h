@@ -0,0 +1,34 @@
+#ifndef TIMER_FD_H
+#define TIMER_FD_H
+
+#include <stdbool.h>
+
+/**
+ * timerFd.h - timers que se atienden en el multiplexor como un fd más.
+ *
+ * Cada timer es un timerfd no bloqueante y con CLOEXEC sobre
+ * CLOCK_MONOTONIC: se vuelve legible al vencer y se registra con interés
+ * de lectura, sin señales ni hilos. Lo usan los plazos que el proxy mide
+ * por sesión y los que repite por proceso.
+ */
+
+/** Crea un timer desarmado. Retorna -1 si no se pudo crear. */
+int timerFdCreate(void);
+
+/**
+ * Programa el timer para vencer una vez dentro de `milliseconds', o lo
+ * desarma con 0. Retorna -1 si falla.
+ */
+int timerFdArm(const int timerFd, const unsigned milliseconds);
+
+/** Programa el timer para vencer cada `milliseconds', desde dentro de `milliseconds'. */
+int timerFdArmPeriodic(const int timerFd, const unsigned milliseconds);
+
+/**
+ * Consume los vencimientos pendientes para que el timer deje de estar
+ * legible. Retorna false si falló la lectura; sin vencimientos no es un
+ * error.
+ */
+bool timerFdClear(const int timerFd);
+
+#endif
@@ -81,6 +81,10 @@ logStatus vlogLogger(int level, const char * file, int line, const char *fmt, va
 	struct tm localTm;
 	struct tm *tm = localtime_r(&t, &localTm);
 
+	/* Los argumentos se recorren una vez por destino. */
+	va_list fileArgs;
+	va_copy(fileArgs, args);
+
 	/* Log to stderr */
 	if (!logger.quiet) {
 		char buf[64];
@@ -100,11 +104,13 @@ logStatus vlogLogger(int level, const char * file, int line, const char *fmt, va
 		char buf[64];
 		buf[strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", tm)] = '\0';
 		fprintf(logger.fileLevel[level], "%s %-6s %s:%d: ", buf, levelNames[level], file, line);
-		vfprintf(logger.fileLevel[level], fmt, args);
+		vfprintf(logger.fileLevel[level], fmt, fileArgs);
 		fprintf(logger.fileLevel[level], "\n");
 		fflush(logger.fileLevel[level]);
 	}
 
+	va_end(fileArgs);
+
 	/* Release lock */
 	unlock();
 	return LOG_SUCCESS;
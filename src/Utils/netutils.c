@@ -92,3 +92,29 @@ void sockaddrToString(char * buffer, const size_t bufferSize, const struct socka
 
     return;
 }
+
+bool sockaddrSameHost(const struct sockaddr * address, const struct sockaddr * other) {
+    if(address == NULL || other == NULL || address->sa_family != other->sa_family)
+        return false;
+
+    switch(address->sa_family) {
+        case AF_INET:
+            return ((const struct sockaddr_in *) address)->sin_addr.s_addr == ((const struct sockaddr_in *) other)->sin_addr.s_addr;
+        case AF_INET6:
+            return memcmp(&((const struct sockaddr_in6 *) address)->sin6_addr, &((const struct sockaddr_in6 *) other)->sin6_addr, sizeof(struct in6_addr)) == 0;
+    }
+    return false;
+}
+
+bool sockaddrEquals(const struct sockaddr * address, const struct sockaddr * other) {
+    if(!sockaddrSameHost(address, other))
+        return false;
+
+    switch(address->sa_family) {
+        case AF_INET:
+            return ((const struct sockaddr_in *) address)->sin_port == ((const struct sockaddr_in *) other)->sin_port;
+        case AF_INET6:
+            return ((const struct sockaddr_in6 *) address)->sin6_port == ((const struct sockaddr_in6 *) other)->sin6_port;
+    }
+    return false;
+}
@@ -41,40 +41,105 @@ void resetParser(parserADT parser) {
     parser->state   = parser->definition->startState;
 }
 
-const parserEvent * feedParser(parserADT parser, const uint8_t character) {
-    const unsigned type = parser->classes[character];
-
-    parser->event1.next = parser->event2.next = 0;
-
-    const parserStateTransition * state = parser->definition->states[parser->state];
-    const size_t n                      = parser->definition->statesQty[parser->state];
-    bool matched   = false;
-
+/** Retorna la primera de las `n' transiciones de `state' que acepta el caracter, o NULL. */
+static inline const parserStateTransition * matchTransition(const parserStateTransition * state, const size_t n,
+                                                            const unsigned type, const uint8_t character) {
     for(unsigned i = 0; i < n ; i++) {
         const int when = state[i].when;
-        if (state[i].when <= 0xFF) {
+        bool matched;
+        if (when <= 0xFF) {
             matched = (character == when);
-        } else if(state[i].when == ANY) {
+        } else if(when == ANY) {
             matched = true;
-        } else if(state[i].when > 0xFF) {
-            matched = (type & when);
         } else {
-            matched = false;
+            matched = (type & when);
         }
+        if(matched)
+            return state + i;
+    }
+    return NULL;
+}
 
-        if(matched) {
-            state[i].action1(&parser->event1, character);
-            if(state[i].action2 != NULL) {
-                parser->event1.next = &parser->event2;
-                state[i].action2(&parser->event2, character);
-            }
-            parser->state = state[i].destination;
-            break;
-        }
+/** Ejecuta las acciones de `transition' sobre los eventos del parser. */
+static inline void runTransition(parserADT parser, const parserStateTransition * transition, const uint8_t character) {
+    parser->event1.next = parser->event2.next = 0;
+    if(transition == NULL)
+        return;
+    transition->action1(&parser->event1, character);
+    if(transition->action2 != NULL) {
+        parser->event1.next = &parser->event2;
+        transition->action2(&parser->event2, character);
     }
+}
+
+const parserEvent * feedParser(parserADT parser, const uint8_t character) {
+    const parserStateTransition * transition = matchTransition(parser->definition->states[parser->state],
+                                                               parser->definition->statesQty[parser->state],
+                                                               parser->classes[character], character);
+    runTransition(parser, transition, character);
+    if(transition != NULL)
+        parser->state = transition->destination;
     return &parser->event1;
 }
 
+/** Agrega el evento a la lista, fusionandolo con el anterior si es posible */
+static size_t appendSpanEvent(parserSpanEvent * events, size_t count, const parserEvent * event, const uint8_t * ptr) {
+    const bool literal = event->n == 1 && event->data[0] == *ptr;
+
+    if(count > 0) {
+        parserSpanEvent * last = events + count - 1;
+        if(literal && last->literal && last->type == event->type && last->ptr + last->length == ptr) {
+            last->length++;
+            return count;
+        }
+    }
+
+    parserSpanEvent * spanEvent = events + count;
+    spanEvent->type    = event->type;
+    spanEvent->ptr     = ptr;
+    spanEvent->length  = 1;
+    spanEvent->literal = literal;
+    spanEvent->n       = event->n;
+    memcpy(spanEvent->data, event->data, sizeof(spanEvent->data));
+    return count + 1;
+}
+
+size_t feedParserSpan(parserADT parser, const uint8_t * span, const size_t length,
+                      parserSpanEvent * events, const size_t eventsSize,
+                      const unsigned stopMask, size_t * consumed) {
+    assert(eventsSize >= 2);
+    const parserDefinition * definition = parser->definition;
+    const unsigned * classes            = parser->classes;
+    unsigned current                    = parser->state;
+    const parserStateTransition * state = definition->states[current];
+    size_t n                            = definition->statesQty[current];
+    size_t count = 0, i = 0;
+    bool stop = false;
+
+    /**
+     * Igual que feedParser pero con el estado en variables locales: las
+     * transiciones del estado solo se vuelven a buscar cuando cambia.
+     * Cada caracter puede generar a lo sumo dos eventos.
+     */
+    while(i < length && count + 2 <= eventsSize && !stop) {
+        const uint8_t * ptr = span + i++;
+        const parserStateTransition * transition = matchTransition(state, n, classes[*ptr], *ptr);
+        runTransition(parser, transition, *ptr);
+        if(transition != NULL && transition->destination != current) {
+            current = transition->destination;
+            state   = definition->states[current];
+            n       = definition->statesQty[current];
+        }
+        for(const parserEvent * event = &parser->event1; event != NULL; event = event->next) {
+            count = appendSpanEvent(events, count, event, ptr);
+            if(event->type < 32 && (stopMask & (1U << event->type)))
+                stop = true;
+        }
+    }
+    parser->state = current;
+    *consumed = i;
+    return count;
+}
 
 static const unsigned classes[0xFF] = {0x00};
 
@@ -0,0 +1,233 @@
+/**
+ * processSpawn.c - lanzamiento de procesos sin fork.
+ */
+/* close_range, pipe2, splice, F_SETPIPE_SZ, memfd_create y syscall son extensiones de glibc. */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "processSpawn.h"
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34))
+#define HAS_CLOSE_RANGE
+#endif
+
+extern char ** environ;
+
+/** Indica si la entrada `entry' del entorno es la variable `name'. */
+static bool isVariable(const char * entry, const char * name) {
+    const size_t length = strlen(name);
+    return strncmp(entry, name, length) == 0 && entry[length] == '=';
+}
+
+/**
+ * Arma el entorno del hijo en un solo bloque: el arreglo de punteros seguido
+ * de las entradas "NOMBRE=valor" nuevas. Retorna NULL si no hay memoria.
+ */
+static char ** buildEnvironment(const char * const names[], const char * const values[], const size_t count) {
+    size_t entries = 0, bytes = 0, n = 0;
+
+    while(environ[entries] != NULL)
+        entries++;
+    for(size_t i = 0; i < count; i++)
+        if(values[i] != NULL)
+            bytes += strlen(names[i]) + strlen(values[i]) + 2;
+
+    char ** envp = malloc((entries + count + 1) * sizeof(*envp) + bytes);
+    if(envp == NULL)
+        return NULL;
+    char * next = (char *) (envp + entries + count + 1);
+
+    for(size_t i = 0; i < entries; i++) {
+        bool replaced = false;
+        for(size_t j = 0; j < count && !replaced; j++)
+            replaced = values[j] != NULL && isVariable(environ[i], names[j]);
+        if(!replaced)
+            envp[n++] = environ[i];
+    }
+    for(size_t i = 0; i < count; i++) {
+        if(values[i] == NULL)
+            continue;
+        const size_t nameLength  = strlen(names[i]);
+        const size_t valueLength = strlen(values[i]);
+        envp[n++] = next;
+        memcpy(next, names[i], nameLength);
+        next[nameLength] = '=';
+        memcpy(next + nameLength + 1, values[i], valueLength + 1);
+        next += nameLength + valueLength + 2;
+    }
+    envp[n] = NULL;
+    return envp;
+}
+
+pid_t processSpawn(const char * path, char * const argv[], const int inFd, const int outFd, const char * errorFile,
+                   const char * const names[], const char * const values[], const size_t count) {
+    const int fds[] = {inFd, outFd};
+    return processSpawnFds(path, argv, fds, 2, errorFile, names, values, count);
+}
+
+pid_t processSpawnFds(const char * path, char * const argv[], const int fds[], const size_t fdCount, const char * errorFile,
+                      const char * const names[], const char * const values[], const size_t count) {
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attributes;
+    sigset_t defaults, mask;
+    char ** envp  = environ;
+    int errorFd   = -1;
+    pid_t pid     = -1;
+
+    if(count > 0 && (envp = buildEnvironment(names, values, count)) == NULL)
+        return -1;
+    if(errorFile != NULL)
+        errorFd = open(errorFile, O_WRONLY | O_APPEND | O_CLOEXEC);
+    if(posix_spawn_file_actions_init(&actions) != 0) {
+        if(errorFd != -1)
+            close(errorFd);
+        if(envp != environ)
+            free(envp);
+        return -1;
+    }
+    if(posix_spawnattr_init(&attributes) != 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        if(errorFd != -1)
+            close(errorFd);
+        if(envp != environ)
+            free(envp);
+        return -1;
+    }
+
+    /* dup2 quita el CLOEXEC del descriptor destino. */
+    bool ok = true;
+    for(size_t i = 0; i < fdCount && ok; i++)
+        if(i != STDERR_FILENO && fds[i] != -1)
+            ok = posix_spawn_file_actions_adddup2(&actions, fds[i], (int) i) == 0;
+    if(ok && errorFd != -1)
+        ok = posix_spawn_file_actions_adddup2(&actions, errorFd, STDERR_FILENO) == 0;
+    else if(ok && errorFile != NULL)
+        ok = posix_spawn_file_actions_addclose(&actions, STDERR_FILENO) == 0;
+    /* El proxy ignora SIGPIPE y bloquea SIGCHLD, el hijo los recibe como cualquier programa. */
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    sigemptyset(&mask);
+    if(ok)
+        ok = posix_spawnattr_setsigdefault(&attributes, &defaults) == 0
+          && posix_spawnattr_setsigmask(&attributes, &mask) == 0
+          && posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK) == 0;
+    if(!ok || posix_spawn(&pid, path, &actions, &attributes, argv, envp) != 0)
+        pid = -1;
+
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&actions);
+    if(errorFd != -1)
+        close(errorFd);
+    if(envp != environ)
+        free(envp);
+    return pid;
+}
+
+/** Escribe los `length' bytes de `data'. */
+static bool writeAll(const int fd, const uint8_t * data, size_t length) {
+    while(length > 0) {
+        const ssize_t n = write(fd, data, length);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return false;
+        data   += n;
+        length -= n;
+    }
+    return true;
+}
+
+bool processCopy(const int inFd, const int outFd) {
+    uint8_t data[PROCESS_COPY_BUFFER_SIZE];
+    ssize_t n;
+
+#ifdef __linux__
+    /* EINVAL indica que ninguno de los dos es un pipe. */
+    do {
+        n = splice(inFd, NULL, outFd, NULL, PROCESS_COPY_BUFFER_SIZE, SPLICE_F_MOVE);
+    } while(n > 0 || (n < 0 && errno == EINTR));
+    if(n == 0)
+        return true;
+    if(errno != EINVAL && errno != ENOSYS)
+        return false;
+#endif
+    do {
+        n = read(inFd, data, sizeof(data));
+        if(n > 0 && !writeAll(outFd, data, n))
+            return false;
+    } while(n > 0 || (n < 0 && errno == EINTR));
+    return n == 0;
+}
+
+int processSetPipeSize(const int fd, const size_t size) {
+#ifdef F_SETPIPE_SZ
+    return fcntl(fd, F_SETPIPE_SZ, (size > INT_MAX)? INT_MAX : (int) size);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+int processPipe(int fds[2]) {
+#ifdef O_CLOEXEC
+    return pipe2(fds, O_CLOEXEC);
+#else
+    if(pipe(fds) < 0)
+        return -1;
+    if(fcntl(fds[0], F_SETFD, FD_CLOEXEC) < 0 || fcntl(fds[1], F_SETFD, FD_CLOEXEC) < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    return 0;
+#endif
+}
+
+int processMemfd(const char * name) {
+#ifdef MFD_CLOEXEC
+    return memfd_create(name, MFD_CLOEXEC);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+int processPidfd(const pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int) syscall(SYS_pidfd_open, pid, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+bool processExited(const int pidfd) {
+    struct timeval now = {0};
+    fd_set readSet;
+
+    FD_ZERO(&readSet);
+    FD_SET(pidfd, &readSet);
+    return select(pidfd + 1, &readSet, NULL, NULL, &now) == 1;
+}
+
+void processCloseFrom(const int lowFd) {
+#ifdef HAS_CLOSE_RANGE
+    if(close_range(lowFd, ~0U, 0) == 0)
+        return;
+#endif
+    const long maxFd = sysconf(_SC_OPEN_MAX);
+    for(long fd = lowFd; fd < ((maxFd > 0)? maxFd : 1024); fd++)
+        close(fd);
+}
@@ -0,0 +1,97 @@
+/**
+ * sha256.c - SHA-256 (FIPS 180-4) incremental.
+ */
+#include <string.h>
+
+#include "sha256.h"
+
+#define ROTATE(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static const uint32_t constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static void compress(uint32_t state[8], const uint8_t block[SHA256_BLOCK_SIZE]) {
+    uint32_t w[64];
+    uint32_t v[8];
+
+    for(unsigned i = 0; i < 16; i++)
+        w[i] = (uint32_t) block[4 * i] << 24 | (uint32_t) block[4 * i + 1] << 16 |
+               (uint32_t) block[4 * i + 2] << 8 | (uint32_t) block[4 * i + 3];
+    for(unsigned i = 16; i < 64; i++) {
+        const uint32_t s0 = ROTATE(w[i - 15], 7) ^ ROTATE(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = ROTATE(w[i - 2], 17) ^ ROTATE(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    memcpy(v, state, sizeof(v));
+    for(unsigned i = 0; i < 64; i++) {
+        const uint32_t s1     = ROTATE(v[4], 6) ^ ROTATE(v[4], 11) ^ ROTATE(v[4], 25);
+        const uint32_t choose = (v[4] & v[5]) ^ (~v[4] & v[6]);
+        const uint32_t t1     = v[7] + s1 + choose + constants[i] + w[i];
+        const uint32_t s0     = ROTATE(v[0], 2) ^ ROTATE(v[0], 13) ^ ROTATE(v[0], 22);
+        const uint32_t major  = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+        memmove(v + 1, v, 7 * sizeof(v[0]));
+        v[4] += t1;
+        v[0]  = t1 + s0 + major;
+    }
+    for(unsigned i = 0; i < 8; i++)
+        state[i] += v[i];
+}
+
+void sha256Init(sha256Context * context) {
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+
+    memcpy(context->state, initial, sizeof(initial));
+    context->length = 0;
+    context->used   = 0;
+}
+
+void sha256Update(sha256Context * context, const uint8_t * data, size_t length) {
+    context->length += length;
+    if(context->used > 0) {
+        const size_t n = (length < SHA256_BLOCK_SIZE - context->used)? length : SHA256_BLOCK_SIZE - context->used;
+        memcpy(context->block + context->used, data, n);
+        context->used += n;
+        data          += n;
+        length        -= n;
+        if(context->used < SHA256_BLOCK_SIZE)
+            return;
+        compress(context->state, context->block);
+        context->used = 0;
+    }
+    /** Los bloques completos se procesan sin copiarlos. */
+    for(; length >= SHA256_BLOCK_SIZE; data += SHA256_BLOCK_SIZE, length -= SHA256_BLOCK_SIZE)
+        compress(context->state, data);
+    memcpy(context->block, data, length);
+    context->used = length;
+}
+
+void sha256Final(sha256Context * context, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    const uint64_t bits = context->length * 8;
+
+    context->block[context->used++] = 0x80;
+    if(context->used > SHA256_BLOCK_SIZE - 8) {
+        memset(context->block + context->used, 0, SHA256_BLOCK_SIZE - context->used);
+        compress(context->state, context->block);
+        context->used = 0;
+    }
+    memset(context->block + context->used, 0, SHA256_BLOCK_SIZE - 8 - context->used);
+    for(unsigned i = 0; i < 8; i++)
+        context->block[SHA256_BLOCK_SIZE - 1 - i] = (uint8_t) (bits >> (8 * i));
+    compress(context->state, context->block);
+    for(unsigned i = 0; i < 8; i++) {
+        digest[4 * i]     = (uint8_t) (context->state[i] >> 24);
+        digest[4 * i + 1] = (uint8_t) (context->state[i] >> 16);
+        digest[4 * i + 2] = (uint8_t) (context->state[i] >> 8);
+        digest[4 * i + 3] = (uint8_t) context->state[i];
+    }
+}
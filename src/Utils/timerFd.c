@@ -0,0 +1,44 @@
+/**
+ * timerFd.c - timers que se atienden en el multiplexor como un fd más.
+ */
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "timerFd.h"
+
+static struct timespec toTimespec(const unsigned milliseconds) {
+    const struct timespec spec = {
+        .tv_sec  = milliseconds / 1000,
+        .tv_nsec = (long) (milliseconds % 1000) * 1000000L,
+    };
+    return spec;
+}
+
+int timerFdCreate(void) {
+    return timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+}
+
+int timerFdArm(const int timerFd, const unsigned milliseconds) {
+    const struct itimerspec spec = {
+        .it_interval = { .tv_sec = 0, .tv_nsec = 0 },
+        .it_value    = toTimespec(milliseconds),
+    };
+    return timerfd_settime(timerFd, 0, &spec, NULL);
+}
+
+int timerFdArmPeriodic(const int timerFd, const unsigned milliseconds) {
+    const struct itimerspec spec = {
+        .it_interval = toTimespec(milliseconds),
+        .it_value    = toTimespec(milliseconds),
+    };
+    return timerfd_settime(timerFd, 0, &spec, NULL);
+}
+
+bool timerFdClear(const int timerFd) {
+    uint64_t expirations;
+
+    return read(timerFd, &expirations, sizeof(expirations)) == sizeof(expirations) || errno == EAGAIN;
+}
@@ -36,6 +36,7 @@ typedef enum etagIndex {
     replaceMsgSizeEtag      = 8,
     credentialEtag          = 9,
     bufferSizeEtag          = 10,
+    filterLimitEtag         = 11,
 } etagIndex;
 
 static void sendRequest(requestRAP req, int socket) {
@@ -678,3 +679,100 @@ int getErrorFilePathClient(int socket, void * answer) {
     return ret;
 }
 
+int getStatisticsClient(int socket, void * answer) {
+    requestRAP req = newRequest();
+    req->opCode                 = GET_STATISTICS;
+    sendRequest(req, socket);
+    printf("Getting statistics...\n");
+    responseRAP resp = newResponse();
+    receiveResponse(socket, resp);
+    int ret = 0;
+    if(resp->respCode == RESP_OK){
+        char * ptr = calloc((resp->dataLength) + 1, sizeof(char));
+        checkAreNotEquals(ptr, NULL, "Out of memory, calloc through null\n");
+        memcpy(ptr, resp->data, resp->dataLength);
+        * ((char **)answer) = ptr;
+        ret = 1;
+    }else{
+        fprintf(stderr, "[ERROR] Server answered with a code %d\n", resp->respCode);
+    }
+    if(resp->data != NULL)
+        free(resp->data);
+    destroyRequest(req);
+    destroyResponse(resp);
+    return ret;
+}
+
+int invalidateCapaCacheClient(int socket, void * arguments) {
+    requestRAP req = newRequest();
+    req->opCode                 = INVALIDATE_CAPA_CACHE;
+    sendRequest(req, socket);
+    printf("Invalidating capabilities cache...\n");
+    responseRAP resp = newResponse();
+    receiveResponse(socket, resp);
+    int ret = 0;
+    if(resp->respCode == RESP_OK){
+        ret = 1;
+    }else{
+        fprintf(stderr, "[ERROR] Server answered with a code %d\n", resp->respCode);
+    }
+    if(resp->data != NULL)
+        free(resp->data);
+    destroyRequest(req);
+    destroyResponse(resp);
+    return ret;
+}
+
+int getFilterLimitClient(int socket, void * limit) {
+    requestRAP req = newRequest();
+    req->opCode                 = GET_FILTER_LIMIT;
+    req->etag                   = 0;
+    req->encoding               = 0;
+    req->data                   = NULL;
+    req->dataLength             = 0;
+    sendRequest(req, socket);
+    printf("Getting filter limit...\n");
+    responseRAP resp = newResponse();
+    receiveResponse(socket, resp);
+    int ret = 0;
+    if(resp->respCode == RESP_OK){
+        *((int *) limit) = ntohl(*((int*)resp->data));
+        ret = 1;
+    }else{
+        fprintf(stderr, "[ERROR] Server answered a %d code\n", resp->respCode);
+    }
+    if(resp->data != NULL)
+        free(resp->data);
+    etags[filterLimitEtag] = resp->etag;
+    destroyRequest(req);
+    destroyResponse(resp);
+    return ret;
+}
+
+int setFilterLimitClient(int socket, void * limit) {
+    requestRAP req = newRequest();
+    int data = htonl(*((int*)limit));
+    req->opCode                 = SET_FILTER_LIMIT;
+    req->etag                   = etags[filterLimitEtag];
+    req->encoding               = INT_TYPE;
+    req->data                   = &data;
+    req->dataLength             = sizeof(uint32_t);
+
+    sendRequest(req, socket);
+    printf("Setting filter limit..\n");
+    responseRAP resp = newResponse();
+    receiveResponse(socket, resp);
+    int ret = 0;
+    if(resp->respCode == RESP_OK) {
+        ret = 1;
+    }else{
+        fprintf(stderr, "[ERROR] server answered a %d code\n", resp->respCode);
+        printf("E-tags for filter limit are now updated, try again\n");
+    }
+    if(resp->data != NULL)
+        free(resp->data);
+    etags[filterLimitEtag] = resp->etag;
+    destroyRequest(req);
+    destroyResponse(resp);
+    return ret;
+}
@@ -51,6 +51,14 @@ int addReplaceMsgClient(int socket, void * msg);
 int getErrorFilePathClient(int socket, void * answer);
 // le pasas el path en el que esta
 int setErrorFilePathClient(int socket, void * path);
+// le pasas un char * no init en el que te dejo el reporte de estadisticas
+int getStatisticsClient(int socket, void * answer);
+// descarta las capacidades de los origin guardadas en el proxy
+int invalidateCapaCacheClient(int socket, void * arguments);
+// esta le pasas un puntero a int donde te deja la cantidad maxima de filtros a la vez, 0 es sin limite
+int getFilterLimitClient(int socket, void * limit);
+// esta le pasas el puntero a un int con la cantidad maxima de filtros a la vez
+int setFilterLimitClient(int socket, void * limit);
 
 #endif
 
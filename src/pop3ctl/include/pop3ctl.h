@@ -5,7 +5,7 @@
 #define INVALID -1
 #define QUIT 1
 #define NO_QUIT 0
-#define COMMAND_QTY 19
+#define COMMAND_QTY 23
 #define BUFFER_LENGTH 256
 
 typedef struct {
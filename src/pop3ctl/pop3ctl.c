@@ -41,6 +41,10 @@ static command_t shellCommands[] = {
 	{"addReplaceMsg", "[MSG]", "Append message to the 'replace message' from server", addReplaceMsgClient, "addreplacemsg"},
 	{"setErrorFilePath","[PATH]", "Set the error path of the server", setErrorFilePathClient, "seterrorfilepath"},
 	{"getErrorFilePath",NULL, "Get the error path of the server", getErrorFilePathClient, "geterrorfilepath"},
+	{"viewStatistics", NULL, "View statistics of the proxy components", getStatisticsClient, "viewstatistics"},
+	{"invalidateCapaCache", NULL, "Forget the cached capabilities of the origin servers", invalidateCapaCacheClient, "invalidatecapacache"},
+	{"getFilterLimit", NULL, "View how many filters can run at once (0 is unlimited)", getFilterLimitClient, "getfilterlimit"},
+	{"setFilterLimit", "[MAX]", "Set how many filters can run at once, the rest wait in a queue (0 is unlimited)", setFilterLimitClient, "setfilterlimit"},
 };
 
 
@@ -473,6 +477,48 @@ int run(int command, char * arguments) {
 			else
 				fprintf(stderr, "[FAILURE] There was a problem getting the error path\n");
 			break;
+
+		case 19:
+
+			result = shellCommands[command].function(connSock, &answer);
+			if(result)
+				printf("[SUCCESS] Statistics:\n%s", answer);
+			else
+				fprintf(stderr, "[FAILURE] There was a problem getting the statistics\n");
+			free(answer);
+			answer = NULL;
+			break;
+
+		case 20:
+
+			result = shellCommands[command].function(connSock, arguments);
+			if(result)
+				printf("[SUCCESS] Capabilities cache invalidated!\n");
+			else
+				fprintf(stderr, "[FAILURE] There was a problem invalidating the capabilities cache\n");
+			break;
+
+		case 21:
+
+			result = shellCommands[command].function(connSock, &numericAnswer);
+			if(result)
+				printf("[SUCCESS] The filter limit is: %d\n", numericAnswer);
+			else
+				fprintf(stderr, "[FAILURE] There was an error fetching the filter limit\n");
+			break;
+
+		case 22:
+
+			numericAnswer = atoi(arguments);
+			if(numericAnswer < 0)
+				return INVALID;
+			result = shellCommands[command].function(connSock, &numericAnswer);
+			if(result)
+				printf("[SUCCESS] Filter limit updated!\n");
+			else
+				fprintf(stderr, "[FAILURE] There was a problem updating the filter limit\n");
+			numericAnswer = -1;
+			break;
 	}
 	return VALID;
 }
@@ -0,0 +1,261 @@
+/**
+ * filterWorker.c - modo worker del filterWrapper.
+ */
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <sys/select.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "buffer.h"
+#include "bodyPop3Parser.h"
+#include "filterFrame.h"
+#include "filterWorker.h"
+#include "processSpawn.h"
+
+#define WORKER_BUFFER_SIZE 4096
+
+static const char * terminationMsg     = ".\r\n";
+static const size_t terminationMsgSize = 3;
+
+/** Buffers y parsers de un mensaje, se reutilizan entre mensajes. */
+typedef struct workerStruct {
+    bufferADT           readBuffer;
+    bufferADT           skipBuffer;
+    bufferADT           addBuffer;
+    bufferADT           writeBuffer;
+    bodyPop3Parser      skipParser;
+    bodyPop3Parser      addParser;
+    size_t              sizeEndCopied;
+} workerStruct;
+
+/**
+ * Aplica (o con `apply' false quita) las variables de entorno del header.
+ * Deja en `command' y `errorFile' los valores que no son del entorno.
+ */
+static void applyHeader(char * header, const size_t length, const bool apply, const char ** command, const char ** errorFile) {
+    for(size_t i = 0; i < length; i += strlen(header + i) + 1) {
+        char * equals = strchr(header + i, '=');
+        if(equals == NULL)
+            continue;
+        *equals = '\0';
+        if(strcmp(header + i, FILTER_FRAME_COMMAND) == 0)
+            *command = equals + 1;
+        else if(strcmp(header + i, FILTER_FRAME_ERROR_FILE) == 0)
+            *errorFile = equals + 1;
+        else if(apply)
+            setenv(header + i, equals + 1, 1);
+        else
+            unsetenv(header + i);
+        *equals = '=';
+    }
+}
+
+/** Sin comando, copia la entrada en la salida. */
+static void copyInput(void) {
+    processCopy(STDIN_FILENO, STDOUT_FILENO);
+    _exit(1);
+}
+
+/**
+ * Ejecuta el comando con la entrada y salida indicadas. Si no se puede
+ * ejecutar copia la entrada en la salida.
+ */
+static pid_t startCommand(const char * command, const char * errorFile, int * inFd, int * outFd) {
+    char * const argv[] = {"sh", "-c", (char *) command, NULL};
+    int in[2], out[2];
+
+    if(processPipe(in) < 0)
+        return -1;
+    if(processPipe(out) < 0) {
+        close(in[0]);
+        close(in[1]);
+        return -1;
+    }
+    pid_t pid = processSpawn("/bin/sh", argv, in[0], out[1], errorFile, NULL, NULL, 0);
+    if(pid < 0) {
+        pid = fork();
+        if(pid == 0) {
+            dup2(in[0], STDIN_FILENO);
+            dup2(out[1], STDOUT_FILENO);
+            processCloseFrom(STDERR_FILENO + 1);
+            copyInput();
+        }
+    }
+    close(in[0]);
+    close(out[1]);
+    if(pid < 0 || fcntl(in[1], F_SETFL, O_NONBLOCK) < 0 || fcntl(out[0], F_SETFL, O_NONBLOCK) < 0) {
+        if(pid > 0)
+            kill(pid, SIGKILL);
+        close(in[1]);
+        close(out[0]);
+        return -1;
+    }
+    *inFd  = in[1];
+    *outFd = out[0];
+    return pid;
+}
+
+static void resetWorker(workerStruct * worker) {
+    reset(worker->readBuffer);
+    reset(worker->skipBuffer);
+    reset(worker->addBuffer);
+    reset(worker->writeBuffer);
+    bodyPop3ParserInit(&worker->skipParser);
+    bodyPop3ParserInit(&worker->addParser);
+    worker->sizeEndCopied = 0;
+}
+
+static void terminationToBuffer(workerStruct * worker) {
+    size_t    size;
+    uint8_t * ptr = getWritePtr(worker->writeBuffer, &size);
+
+    size = (size > terminationMsgSize - worker->sizeEndCopied)? terminationMsgSize - worker->sizeEndCopied : size;
+    memcpy(ptr, terminationMsg + worker->sizeEndCopied, size);
+    worker->sizeEndCopied += size;
+    updateWriteAndProcessPtr(worker->writeBuffer, size);
+}
+
+/**
+ * Filtra un mensaje: le pasa al comando el cuerpo que llega por stdin, sin
+ * dot-stuffing, y envía por stdout su salida con dot-stuffing y la linea de
+ * terminación. Lee siempre el cuerpo completo, aunque el comando termine
+ * antes, para quedar listo para el header siguiente. Retorna false si se
+ * perdió la conexión con el proxy o el cuerpo es inválido.
+ */
+static bool filterMessage(workerStruct * worker, const char * command, const char * errorFile) {
+    int inFd = -1, outFd = -1;
+    bool inputDone = false, outputDone = false, errored = false, ignored, ok = true;
+    size_t size;
+    uint8_t * ptr;
+    ssize_t n;
+
+    resetWorker(worker);
+    const pid_t pid = startCommand(command, errorFile, &inFd, &outFd);
+    if(pid < 0)
+        outputDone = true;
+
+    while(ok && !(inputDone && outputDone && worker->sizeEndCopied == terminationMsgSize && !canRead(worker->writeBuffer))) {
+        fd_set readFds, writeFds;
+        int maxFd = STDOUT_FILENO;
+
+        FD_ZERO(&readFds);
+        FD_ZERO(&writeFds);
+        getWritePtr(worker->skipBuffer, &size);
+        if(!inputDone && canWrite(worker->readBuffer) && size >= 2)
+            FD_SET(STDIN_FILENO, &readFds);
+        if(canRead(worker->skipBuffer) && inFd != -1) {
+            FD_SET(inFd, &writeFds);
+            maxFd = (inFd > maxFd)? inFd : maxFd;
+        }
+        getWritePtr(worker->writeBuffer, &size);
+        if(!outputDone && canWrite(worker->addBuffer) && size >= 2) {
+            FD_SET(outFd, &readFds);
+            maxFd = (outFd > maxFd)? outFd : maxFd;
+        }
+        if(canRead(worker->writeBuffer))
+            FD_SET(STDOUT_FILENO, &writeFds);
+        if(select(maxFd + 1, &readFds, &writeFds, NULL, NULL) < 0)
+            continue;
+
+        if(FD_ISSET(STDIN_FILENO, &readFds)) {
+            ptr = getWritePtr(worker->readBuffer, &size);
+            n = read(STDIN_FILENO, ptr, size);
+            if(n <= 0)
+                ok = false;
+            else
+                updateWritePtr(worker->readBuffer, n);
+        }
+        if(!inputDone && canProcess(worker->readBuffer)) {
+            inputDone = bodyPop3ParserConsume(&worker->skipParser, worker->readBuffer, worker->skipBuffer, true, &errored) == BODY_POP3_DONE;
+            ok = ok && !errored;
+        }
+
+        if(inFd != -1 && FD_ISSET(inFd, &writeFds)) {
+            ptr = getReadPtr(worker->skipBuffer, &size);
+            n = write(inFd, ptr, size);
+            /* Si el comando dejó de leer se descarta el resto del cuerpo. */
+            if(n >= 0 || errno != EAGAIN)
+                updateReadPtr(worker->skipBuffer, (n < 0)? (ssize_t) size : n);
+        }
+        if(inFd != -1 && (pid < 0 || (inputDone && !canRead(worker->skipBuffer)))) {
+            close(inFd);
+            inFd = -1;
+        }
+        if(pid < 0)
+            reset(worker->skipBuffer);
+
+        if(outFd != -1 && FD_ISSET(outFd, &readFds)) {
+            ptr = getWritePtr(worker->addBuffer, &size);
+            n = read(outFd, ptr, size);
+            if(n == 0 || (n < 0 && errno != EAGAIN)) {
+                close(outFd);
+                outFd      = -1;
+                outputDone = true;
+            } else if(n > 0)
+                updateWritePtr(worker->addBuffer, n);
+        }
+        bodyPop3ParserConsume(&worker->addParser, worker->addBuffer, worker->writeBuffer, false, &ignored);
+        if(outputDone && !canProcess(worker->addBuffer) && worker->sizeEndCopied < terminationMsgSize)
+            terminationToBuffer(worker);
+
+        if(FD_ISSET(STDOUT_FILENO, &writeFds)) {
+            ptr = getReadPtr(worker->writeBuffer, &size);
+            n = write(STDOUT_FILENO, ptr, size);
+            if(n <= 0)
+                ok = false;
+            else
+                updateReadPtr(worker->writeBuffer, n);
+        }
+    }
+
+    if(inFd != -1)
+        close(inFd);
+    if(outFd != -1)
+        close(outFd);
+    if(pid > 0) {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+    return ok;
+}
+
+int filterWorkerMain(void) {
+    char header[FILTER_FRAME_HEADER_SIZE];
+    workerStruct worker;
+    ssize_t length;
+    int ret = 0;
+
+    signal(SIGPIPE, SIG_IGN);
+    unsetenv(FILTER_WORKER_ENV);
+    worker.readBuffer  = createBuffer(WORKER_BUFFER_SIZE);
+    /* el parser para consumir necesita un espacio mas en el buffer destino */
+    worker.skipBuffer  = createBuffer(WORKER_BUFFER_SIZE + 1);
+    worker.addBuffer   = createBuffer(WORKER_BUFFER_SIZE);
+    worker.writeBuffer = createBuffer(WORKER_BUFFER_SIZE + 1);
+
+    while((length = filterFrameReadHeader(STDIN_FILENO, header, sizeof(header))) >= 0) {
+        const char * command   = "cat";
+        const char * errorFile = "/dev/null";
+
+        applyHeader(header, length, true, &command, &errorFile);
+        const bool ok = filterMessage(&worker, command, errorFile);
+        applyHeader(header, length, false, &command, &errorFile);
+        if(!ok) {
+            ret = 1;
+            break;
+        }
+    }
+
+    deleteBuffer(worker.readBuffer);
+    deleteBuffer(worker.skipBuffer);
+    deleteBuffer(worker.addBuffer);
+    deleteBuffer(worker.writeBuffer);
+    return ret;
+}
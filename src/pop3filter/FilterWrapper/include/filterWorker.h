@@ -0,0 +1,16 @@
+#ifndef FILTER_WORKER_H
+#define FILTER_WORKER_H
+
+/**
+ * filterWorker.h - modo worker del filterWrapper.
+ *
+ * Atiende, por stdin y stdout, los mensajes que le envía el pool de filtros
+ * del proxy (ver filterPool.h) hasta que el proxy cierra la conexión. Cada
+ * mensaje se filtra con el comando que indica su header, ejecutado con
+ * `/bin/sh -c' igual que sin pool.
+ */
+
+/** Atiende mensajes hasta el final de stdin. Retorna el código de salida. */
+int filterWorkerMain(void);
+
+#endif
@@ -20,15 +20,18 @@ typedef struct commandProps {
     size_t      length;
     size_t      argsQtyMin;
     size_t      argsQtyMax;
+    /** Por cada cantidad de argumentos, si la respuesta es multilinea */
+    unsigned    multilineArgs;
 } commandProps;
 
-#define IS_MULTILINE(command, argsQty) (command->type == CMD_CAPA       \
-                ||  (command->type == CMD_LIST && argsQty == 0)         \
-                ||  (command->type == CMD_TOP  && argsQty == 2)         \
-                ||  (command->type == CMD_RETR && argsQty == 1)         \
-                ||  (command->type == CMD_UIDL && argsQty == 0))        
+#define MULTILINE_WITH(argsQty) (1U << (argsQty))
+#define MULTILINE_ALWAYS        (~0U)
 
+#define IS_MULTILINE(command, argsQty) (command->type != CMD_OTHER                            \
+                && (commandTable[command->type].multilineArgs == MULTILINE_ALWAYS              \
+                ||  ((argsQty) < 32 && (commandTable[command->type].multilineArgs & MULTILINE_WITH(argsQty)))))
 
+/** Comandos de RFC 1939, RFC 2449, RFC 2595 (STLS) y RFC 5034 (AUTH), indexados por tipo */
 static const commandProps commandTable[] = {
     {
         .type = CMD_USER, .name = "USER", .length = 4, .argsQtyMin = 1, .argsQtyMax = 512 - 7,  //un user puede contener espacios
@@ -37,23 +40,58 @@ static const commandProps commandTable[] = {
     } , {        
         .type = CMD_APOP, .name = "APOP", .length = 4, .argsQtyMin = 2, .argsQtyMax = 512 - 7,
     } , {
-        .type = CMD_RETR, .name = "RETR", .length = 4, .argsQtyMin = 1, .argsQtyMax = 1,
+        .type = CMD_RETR, .name = "RETR", .length = 4, .argsQtyMin = 1, .argsQtyMax = 1,         .multilineArgs = MULTILINE_WITH(1),
     } , {
-        .type = CMD_LIST, .name = "LIST", .length = 4, .argsQtyMin = 0, .argsQtyMax = 1,
+        .type = CMD_LIST, .name = "LIST", .length = 4, .argsQtyMin = 0, .argsQtyMax = 1,         .multilineArgs = MULTILINE_WITH(0),
     } , {
-        .type = CMD_CAPA, .name = "CAPA", .length = 4, .argsQtyMin = 0, .argsQtyMax = 512 - 7,
+        .type = CMD_CAPA, .name = "CAPA", .length = 4, .argsQtyMin = 0, .argsQtyMax = 512 - 7,   .multilineArgs = MULTILINE_ALWAYS,
     } , {
-        .type = CMD_TOP,  .name = "TOP" , .length = 3, .argsQtyMin = 2, .argsQtyMax = 2,
+        .type = CMD_TOP,  .name = "TOP ", .length = 3, .argsQtyMin = 2, .argsQtyMax = 2,         .multilineArgs = MULTILINE_WITH(2),
     } , {
-        .type = CMD_UIDL, .name = "UIDL", .length = 4, .argsQtyMin = 0, .argsQtyMax = 1,
+        .type = CMD_UIDL, .name = "UIDL", .length = 4, .argsQtyMin = 0, .argsQtyMax = 1,         .multilineArgs = MULTILINE_WITH(0),
+    } , {
+        .type = CMD_STAT, .name = "STAT", .length = 4, .argsQtyMin = 0, .argsQtyMax = 0,
+    } , {
+        .type = CMD_DELE, .name = "DELE", .length = 4, .argsQtyMin = 1, .argsQtyMax = 1,
+    } , {
+        .type = CMD_NOOP, .name = "NOOP", .length = 4, .argsQtyMin = 0, .argsQtyMax = 0,
+    } , {
+        .type = CMD_RSET, .name = "RSET", .length = 4, .argsQtyMin = 0, .argsQtyMax = 0,
+    } , {
+        .type = CMD_QUIT, .name = "QUIT", .length = 4, .argsQtyMin = 0, .argsQtyMax = 0,
+    } , {
+        .type = CMD_STLS, .name = "STLS", .length = 4, .argsQtyMin = 0, .argsQtyMax = 0,
+    } , {
+        .type = CMD_AUTH, .name = "AUTH", .length = 4, .argsQtyMin = 0, .argsQtyMax = 2,         .multilineArgs = MULTILINE_WITH(0),    //sin mecanismo lista los soportados
     }
 };
 
+/**
+ * Hash perfecto de los primeros 4 bytes de cada comando: 
+ * ((nombre como entero big endian) * COMMAND_HASH_MULTIPLIER) >> (32 - COMMAND_HASH_BITS)
+ * Si se agrega un comando hay que verificar que no colisione o buscar otro multiplicador.
+ */
+#define COMMAND_HASH_MULTIPLIER 0x9E3779B5U
+#define COMMAND_HASH_BITS       5
+
+static const commandType commandHashTable[1 << COMMAND_HASH_BITS] = {
+    [ 0] = CMD_OTHER, [ 1] = CMD_TOP,   [ 2] = CMD_AUTH,  [ 3] = CMD_OTHER,
+    [ 4] = CMD_OTHER, [ 5] = CMD_OTHER, [ 6] = CMD_USER,  [ 7] = CMD_OTHER,
+    [ 8] = CMD_NOOP,  [ 9] = CMD_RSET,  [10] = CMD_LIST,  [11] = CMD_OTHER,
+    [12] = CMD_STLS,  [13] = CMD_QUIT,  [14] = CMD_OTHER, [15] = CMD_OTHER,
+    [16] = CMD_UIDL,  [17] = CMD_APOP,  [18] = CMD_OTHER, [19] = CMD_STAT,
+    [20] = CMD_OTHER, [21] = CMD_RETR,  [22] = CMD_OTHER, [23] = CMD_PASS,
+    [24] = CMD_OTHER, [25] = CMD_CAPA,  [26] = CMD_OTHER, [27] = CMD_OTHER,
+    [28] = CMD_OTHER, [29] = CMD_OTHER, [30] = CMD_OTHER, [31] = CMD_DELE,
+};
+
 static const char * crlfMsg     = "\r\n";
 static const int    crlfMsgSize = 2;
 
 static void initializeCommand(commandStruct * command);
 
+static commandType lookupCommand(const uint8_t name[COMMAND_NAME_SIZE]);
+
 static void hanndleCommandParsed(commandStruct * currentCommand, commandParser * parser, queueADT commands, bool * newCommand, bool notMatch);
 
 
@@ -70,33 +108,23 @@ commandState commandParserFeed(commandParser * parser, const uint8_t c, queueADT
     if(parser->lineSize == 0) {
         initializeCommand(currentCommand);
         parser->argsQty    = 0;
-        parser->invalidQty = 0;
-        for(int i = 0; i < CMD_TYPES_QTY; i++) 
-            parser->invalidType[i] = false;
     }
 
     switch(parser->state) {
         case COMMAND_TYPE: 
             if(c != crlfMsg[1]) {
-                for(size_t i = 0; i < CMD_TYPES_QTY; i++) {
-                    if(!parser->invalidType[i]) {
-                        if(toupper(c) != commandTable[i].name[parser->lineSize]) {
-                            parser->invalidType[i] = true;
-                            parser->invalidQty++;
-                        } else if(parser->lineSize == commandTable[i].length-1) {
-                            currentCommand->type = commandTable[i].type;
-                            parser->stateSize = 0;
-                            if(commandTable[i].argsQtyMax > 0) {
-                                if(currentCommand->type == CMD_USER || currentCommand->type == CMD_APOP)
-                                    currentCommand->data = malloc((MAX_ARG_SIZE + 1) * sizeof(uint8_t));    //NULL TERMINATED
-                                parser->state = COMMAND_ARGS;
-                            } else
-                                parser->state = COMMAND_CRLF;
-                            break;
-                        }
-                    }
-                    if(parser->invalidQty == CMD_TYPES_QTY) 
+                parser->name[parser->lineSize] = toupper(c);
+                if(parser->lineSize == COMMAND_NAME_SIZE - 1) {
+                    currentCommand->type = lookupCommand(parser->name);
+                    if(currentCommand->type == CMD_OTHER) {
                         parser->state = COMMAND_ERROR;
+                    } else {
+                        // los comandos de 3 letras ya consumieron el separador
+                        parser->stateSize = COMMAND_NAME_SIZE - commandTable[currentCommand->type].length;
+                        if(currentCommand->type == CMD_USER || currentCommand->type == CMD_APOP)
+                            currentCommand->data = malloc((MAX_ARG_SIZE + 1) * sizeof(uint8_t));    //NULL TERMINATED
+                        parser->state = COMMAND_ARGS;
+                    }
                 }
             } else 
                 hanndleCommandParsed(currentCommand, parser, commands, newCommand, true);
@@ -109,6 +137,8 @@ commandState commandParserFeed(commandParser * parser, const uint8_t c, queueADT
                 else if(parser->stateSize == 0) 
                     parser->stateSize++;
                 else if(parser->stateSize > 1 && parser->argsQty < commandTable[currentCommand->type].argsQtyMax) {
+                    if(parser->argsQty == 0 && (currentCommand->type == CMD_USER || currentCommand->type == CMD_APOP))
+                        ((uint8_t *)currentCommand->data)[parser->stateSize-1] = 0;     //username null terminated
                     parser->stateSize = 1;
                     parser->argsQty++;
                 }
@@ -178,6 +208,16 @@ commandState commandParserConsume(commandParser * parser, bufferADT buffer, queu
     return state;
 }
 
+commandType commandParserLookup(const uint8_t * line, const size_t length) {
+    uint8_t name[COMMAND_NAME_SIZE];
+
+    if(length < COMMAND_NAME_SIZE)
+        return CMD_OTHER;
+    for(size_t i = 0; i < COMMAND_NAME_SIZE; i++)
+        name[i] = toupper(line[i]);
+    return lookupCommand(name);
+}
+
 char * getUsername(const commandStruct command) {
     if(command.type == CMD_APOP || command.type == CMD_USER)
         return (char * ) command.data;
@@ -198,6 +238,15 @@ static void initializeCommand(commandStruct * command) {
     command->data = NULL;
 }
 
+static commandType lookupCommand(const uint8_t name[COMMAND_NAME_SIZE]) {
+    const uint32_t key = (uint32_t) name[0] << 24 | (uint32_t) name[1] << 16 | (uint32_t) name[2] << 8 | name[3];
+    const commandType type = commandHashTable[(uint32_t) (key * COMMAND_HASH_MULTIPLIER) >> (32 - COMMAND_HASH_BITS)];
+
+    if(type == CMD_OTHER || memcmp(commandTable[type].name, name, COMMAND_NAME_SIZE) != 0)
+        return CMD_OTHER;
+    return type;
+}
+
 static void hanndleCommandParsed(commandStruct * currentCommand, commandParser * parser, queueADT commands, bool * newCommand, bool notMatch) {
     commandStruct * offerCommand = malloc(sizeof(commandStruct));
     if(notMatch) {
@@ -17,9 +17,19 @@ typedef enum commandType {
     CMD_CAPA      =  5,
     CMD_TOP       =  6,
     CMD_UIDL      =  7,
-    CMD_TYPES_QTY =  8,
+    CMD_STAT      =  8,
+    CMD_DELE      =  9,
+    CMD_NOOP      = 10,
+    CMD_RSET      = 11,
+    CMD_QUIT      = 12,
+    CMD_STLS      = 13,
+    CMD_AUTH      = 14,
+    CMD_TYPES_QTY = 15,
 } commandType;
 
+/** Cantidad de bytes con los que se identifica un comando, "TOP " incluye el espacio */
+#define COMMAND_NAME_SIZE 4
+
 typedef struct commandStruct {
     commandType  type;
     bool         isMultiline;
@@ -38,8 +48,8 @@ typedef struct commandParser {
     size_t lineSize;    
     size_t stateSize;
     size_t argsQty;
-    size_t invalidQty;
-    bool   invalidType[CMD_TYPES_QTY];
+    /** Primeros bytes de la linea, en mayuscula, para identificar el comando */
+    uint8_t name[COMMAND_NAME_SIZE];
     commandState state;
     commandStruct currentCommand;
 } commandParser;
@@ -59,6 +69,12 @@ commandState commandParserFeed(commandParser * parser, const uint8_t c, queueADT
  */
 commandState commandParserConsume(commandParser * parser, bufferADT buffer, queueADT commands, bool pipelining, bool * newCommand);
 
+/**
+ * Identifica el comando de una linea a partir de sus primeros bytes, sin
+ * validar sus argumentos. Retorna CMD_OTHER si no es un comando conocido.
+ */
+commandType commandParserLookup(const uint8_t * line, const size_t length);
+
 char * getUsername(const commandStruct command);
 
 void deleteCommand(commandStruct * command);
@@ -34,6 +34,14 @@ void responseParserInit(responseParser * parser);
 /** Entrega un byte al parser. retorna true si se llego al final  */
 responseState responseParserFeed(responseParser * parser, const uint8_t c, queueADT commands);
 
+/**
+ * Entrega al parser hasta `length' bytes de `data' y retorna cuántos
+ * consumió. Se detiene después del byte que termina una respuesta o lleva
+ * a RESPONSE_ERROR. Dentro de una linea del cuerpo avanza sin pasar byte
+ * por byte por `responseParserFeed'.
+ */
+size_t responseParserFeedSpan(responseParser * parser, const uint8_t * data, const size_t length, queueADT commands);
+
 /**
  * Por cada elemento del buffer llama a `responseParserFeed' hasta que
  * el parseo se encuentra completo o se requieren mas bytes.
@@ -149,6 +149,27 @@ responseState responseParserFeed(responseParser * parser, const uint8_t c, queue
     return parser->state;
 }
 
+size_t responseParserFeedSpan(responseParser * parser, const uint8_t * data, const size_t length, queueADT commands) {
+    size_t i = 0;
+
+    while(i < length) {
+        /** Dentro de una linea del cuerpo solo importan el fin de linea y su largo máximo. */
+        if(parser->state == RESPONSE_BODY && parser->lineSize > 0 && parser->lineSize < MAX_MSG_SIZE) {
+            const size_t start = i;
+            const size_t end   = (length - i < MAX_MSG_SIZE - parser->lineSize)? length : i + MAX_MSG_SIZE - parser->lineSize;
+            while(i < end && data[i] != crlfInlineMsg[0] && data[i] != crlfInlineMsg[1])
+                i++;
+            parser->lineSize += i - start;
+            if(i == end)
+                continue;
+        }
+        const responseState state = responseParserFeed(parser, data[i++], commands);
+        if(state == RESPONSE_INIT || state == RESPONSE_ERROR)
+            break;
+    }
+    return i;
+}
+
 responseState responseParserConsume(responseParser * parser, bufferADT buffer, queueADT commands, bool * errored) {
     responseState state = parser->state;
     *errored = false;
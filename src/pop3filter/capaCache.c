@@ -0,0 +1,117 @@
+/**
+ * capaCache.c - cache de las capacidades de cada origin server.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "capaCache.h"
+#include "netutils.h"
+
+typedef struct capaCacheEntry {
+    bool                    used;
+    struct sockaddr_storage origin;
+    capabilities            capas;
+    time_t                  storedAt;
+} capaCacheEntry;
+
+struct capaCacheCDT {
+    capaCacheEntry          entries[CAPA_CACHE_SIZE];
+    time_t                  ttl;
+    unsigned long long      hits;
+    unsigned long long      misses;
+    unsigned long long      invalidations;
+};
+
+capaCacheADT createCapaCache(const time_t ttl) {
+    capaCacheADT cache = calloc(1, sizeof(*cache));
+    if(cache != NULL)
+        cache->ttl = ttl;
+    return cache;
+}
+
+void deleteCapaCache(capaCacheADT cache) {
+    free(cache);
+}
+
+static capaCacheEntry * findEntry(capaCacheADT cache, const struct sockaddr * origin) {
+    for(unsigned i = 0; i < CAPA_CACHE_SIZE; i++)
+        if(cache->entries[i].used && sockaddrEquals((const struct sockaddr *) &cache->entries[i].origin, origin))
+            return cache->entries + i;
+    return NULL;
+}
+
+bool capaCacheGet(capaCacheADT cache, const struct sockaddr * origin, const time_t now, capabilities * capas) {
+    if(cache == NULL)
+        return false;
+
+    capaCacheEntry * entry = findEntry(cache, origin);
+    if(entry != NULL && now - entry->storedAt >= cache->ttl) {
+        entry->used = false;
+        entry       = NULL;
+    }
+    if(entry == NULL) {
+        cache->misses++;
+        return false;
+    }
+    cache->hits++;
+    *capas = entry->capas;
+    return true;
+}
+
+void capaCachePut(capaCacheADT cache, const struct sockaddr * origin, const capabilities * capas, const time_t now) {
+    if(cache == NULL)
+        return;
+
+    capaCacheEntry * entry = findEntry(cache, origin);
+    for(unsigned i = 0; entry == NULL && i < CAPA_CACHE_SIZE; i++)
+        if(!cache->entries[i].used)
+            entry = cache->entries + i;
+    if(entry == NULL) {
+        entry = cache->entries;
+        for(unsigned i = 1; i < CAPA_CACHE_SIZE; i++)
+            if(cache->entries[i].storedAt < entry->storedAt)
+                entry = cache->entries + i;
+    }
+
+    const size_t originSize = (origin->sa_family == AF_INET6)? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+    memset(&entry->origin, 0, sizeof(entry->origin));
+    memcpy(&entry->origin, origin, originSize);
+    entry->used     = true;
+    entry->capas    = *capas;
+    entry->storedAt = now;
+}
+
+void capaCacheInvalidate(capaCacheADT cache) {
+    if(cache == NULL)
+        return;
+    for(unsigned i = 0; i < CAPA_CACHE_SIZE; i++)
+        cache->entries[i].used = false;
+    cache->invalidations++;
+}
+
+unsigned long long capaCacheHits(capaCacheADT cache) {
+    return (cache == NULL)? 0 : cache->hits;
+}
+
+unsigned long long capaCacheMisses(capaCacheADT cache) {
+    return (cache == NULL)? 0 : cache->misses;
+}
+
+size_t capaCacheStatistics(capaCacheADT cache, char * buffer, const size_t size) {
+    unsigned entries = 0;
+
+    if(cache == NULL || size == 0)
+        return 0;
+    for(unsigned i = 0; i < CAPA_CACHE_SIZE; i++)
+        if(cache->entries[i].used)
+            entries++;
+
+    const int n = snprintf(buffer, size, "capa cache: entries %u ttl %llds hits %llu misses %llu invalidations %llu\n",
+        entries, (long long) cache->ttl, cache->hits, cache->misses, cache->invalidations);
+    if(n < 0)
+        return 0;
+    return ((size_t) n >= size)? size - 1 : (size_t) n;
+}
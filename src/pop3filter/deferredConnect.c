@@ -0,0 +1,123 @@
+/**
+ * deferredConnect.c - atención del cliente en el modo de conexión diferida.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "deferredConnect.h"
+#include "commandParser.h"
+
+/** Tamaño máximo de una respuesta a CAPA que se guarda. */
+#define DEFERRED_CAPA_SIZE 1024
+
+static const char * localQuitMsg    = "+OK Bye.\r\n";
+static const char * localApopMsg    = "-ERR APOP unavailable, reconnect to use it.\r\n";
+static const char * localNotAuthMsg = "-ERR Not authenticated.\r\n";
+
+typedef struct capaResponse {
+    bool                valid;
+    uint8_t             data[DEFERRED_CAPA_SIZE];
+    size_t              length;
+} capaResponse;
+
+struct deferredCapaCDT {
+    capaResponse *      responses;
+    size_t              origins;
+};
+
+deferredCapaADT createDeferredCapa(const size_t origins) {
+    deferredCapaADT capa = malloc(sizeof(*capa));
+    if(capa == NULL)
+        return NULL;
+    capa->responses = calloc((origins > 0)? origins : 1, sizeof(*capa->responses));
+    if(capa->responses == NULL) {
+        free(capa);
+        return NULL;
+    }
+    capa->origins = origins;
+    return capa;
+}
+
+void deleteDeferredCapa(deferredCapaADT capa) {
+    if(capa == NULL)
+        return;
+    free(capa->responses);
+    free(capa);
+}
+
+void deferredCapaPut(deferredCapaADT capa, const size_t origin, const uint8_t * response, const size_t length) {
+    if(capa == NULL || origin >= capa->origins)
+        return;
+    capaResponse * current = capa->responses + origin;
+    if(length == 0 || length > DEFERRED_CAPA_SIZE || response[0] != '+') {
+        current->valid = false;
+        return;
+    }
+    memcpy(current->data, response, length);
+    current->length = length;
+    current->valid  = true;
+}
+
+void deferredCapaInvalidate(deferredCapaADT capa) {
+    if(capa == NULL)
+        return;
+    for(size_t i = 0; i < capa->origins; i++)
+        capa->responses[i].valid = false;
+}
+
+const uint8_t * deferredCapaAnswer(const deferredCapaADT capa, size_t * length) {
+    if(capa == NULL || capa->origins == 0)
+        return NULL;
+    const capaResponse * first = capa->responses;
+    for(size_t i = 0; i < capa->origins; i++) {
+        const capaResponse * current = capa->responses + i;
+        if(!current->valid || current->length != first->length || memcmp(current->data, first->data, first->length) != 0)
+            return NULL;
+    }
+    *length = first->length;
+    return first->data;
+}
+
+deferredAction deferredLineAction(const deferredCapaADT capa, const uint8_t * line, const size_t length,
+                                  const uint8_t ** answer, size_t * answerLength) {
+    const char * message;
+    deferredAction action;
+
+    switch(commandParserLookup(line, length)) {
+        case CMD_CAPA:
+            *answer = deferredCapaAnswer(capa, answerLength);
+            return (*answer != NULL)? DEFERRED_ANSWER : DEFERRED_CONNECT;
+        case CMD_QUIT:
+            message = localQuitMsg;
+            action  = DEFERRED_QUIT;
+            break;
+        case CMD_APOP:
+            message = localApopMsg;
+            action  = DEFERRED_APOP;
+            break;
+        case CMD_USER:
+        case CMD_AUTH:
+        case CMD_STLS:
+            return DEFERRED_CONNECT;
+        default:
+            message = localNotAuthMsg;
+            action  = DEFERRED_ANSWER;
+            break;
+    }
+    *answer       = (const uint8_t *) message;
+    *answerLength = strlen(message);
+    return action;
+}
+
+void deferredUsername(const uint8_t * line, const size_t length, char * name, const size_t size) {
+    size_t i = 4, nameLength = 0;
+
+    if(size == 0)
+        return;
+    while(i < length && line[i] == ' ')
+        i++;
+    while(i < length && nameLength < size - 1 && line[i] != ' ' && line[i] != '\r' && line[i] != '\n')
+        name[nameLength++] = (char) line[i++];
+    name[nameLength] = '\0';
+}
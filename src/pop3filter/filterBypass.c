@@ -0,0 +1,329 @@
+/**
+ * filterBypass.c - RETR que se envían sin pasar por el filtro.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "filterBypass.h"
+
+#define CONTENT_TYPE "content-type"
+#define IS_WSP(c) ((c) == ' ' || (c) == '\t')
+
+static struct {
+    unsigned long long      bypassed;
+    unsigned long long      filtered;
+    unsigned long long      sniffedBytes;
+} statistics;
+
+/** Compara `length' bytes de `a' con el string `b' sin distinguir mayúsculas. */
+static bool equalsIgnoreCase(const char * a, const size_t length, const char * b) {
+    return strlen(b) == length && strncasecmp(a, b, length) == 0;
+}
+
+bool filterMediaRangeMatches(const char * mediaRange, const char * type, const size_t typeLength,
+                             const char * subtype, const size_t subtypeLength) {
+    const char * entry = mediaRange;
+
+    if(mediaRange == NULL)
+        return false;
+    while(*entry != 0) {
+        while(IS_WSP(*entry))
+            entry++;
+        const char * end = entry;
+        while(*end != 0 && *end != ',')
+            end++;
+        const char * slash = memchr(entry, '/', end - entry);
+
+        if(slash == NULL) {
+            if(end > entry)
+                return true;
+        } else {
+            size_t rangeTypeLength = slash - entry, rangeSubtypeLength = 0;
+            const char * rangeSubtype = slash + 1;
+            while(rangeTypeLength > 0 && IS_WSP(entry[rangeTypeLength - 1]))
+                rangeTypeLength--;
+            while(rangeSubtype + rangeSubtypeLength < end && rangeSubtype[rangeSubtypeLength] != ';' &&
+                  !IS_WSP(rangeSubtype[rangeSubtypeLength]))
+                rangeSubtypeLength++;
+            const bool typeMatches    = equalsIgnoreCase(entry, rangeTypeLength, "*") ||
+                                        (rangeTypeLength == typeLength && strncasecmp(entry, type, typeLength) == 0);
+            const bool subtypeMatches = equalsIgnoreCase(rangeSubtype, rangeSubtypeLength, "*") ||
+                                        (rangeSubtypeLength == subtypeLength && strncasecmp(rangeSubtype, subtype, subtypeLength) == 0);
+            if(typeMatches && subtypeMatches)
+                return true;
+        }
+        entry = (*end == ',')? end + 1 : end;
+    }
+    return false;
+}
+
+void filterSnifferInit(filterSniffer * sniffer) {
+    sniffer->decision      = FILTER_SNIFF_PENDING;
+    sniffer->headers       = true;
+    sniffer->fieldLength   = 0;
+    sniffer->fieldOverflow = false;
+    sniffer->lineLength    = 0;
+    sniffer->lineOverflow  = false;
+    sniffer->lineStart     = true;
+    sniffer->lineDot       = false;
+    sniffer->typed         = false;
+    sniffer->multipart     = false;
+    sniffer->digest        = false;
+    sniffer->boundary.length = 0;
+    sniffer->depth         = 0;
+}
+
+/**
+ * Lee el valor de un Content-Type: el media type y, si lo tiene, el
+ * parámetro boundary. Retorna false si el valor no se puede leer o el
+ * media type está en el media range.
+ */
+static bool sniffContentType(filterSniffer * sniffer, const char * mediaRange, const char * value, const size_t length) {
+    size_t i = 0, typeLength = 0, subtypeLength = 0;
+
+    while(i < length && IS_WSP(value[i]))
+        i++;
+    const char * type = value + i;
+    while(i < length && value[i] != '/' && value[i] != ';' && !IS_WSP(value[i])) {
+        typeLength++;
+        i++;
+    }
+    if(typeLength == 0 || i == length || value[i] != '/')
+        return false;
+    const char * subtype = value + ++i;
+    while(i < length && value[i] != ';' && !IS_WSP(value[i])) {
+        subtypeLength++;
+        i++;
+    }
+    if(subtypeLength == 0 || filterMediaRangeMatches(mediaRange, type, typeLength, subtype, subtypeLength))
+        return false;
+    /** Un mensaje adjunto no se recorre, se filtra. */
+    if(equalsIgnoreCase(type, typeLength, "message"))
+        return false;
+
+    sniffer->typed     = true;
+    sniffer->multipart = equalsIgnoreCase(type, typeLength, "multipart");
+    sniffer->digest    = sniffer->multipart && equalsIgnoreCase(subtype, subtypeLength, "digest");
+    sniffer->boundary.length = 0;
+
+    while(true) {
+        char parameter[FILTER_SNIFF_BOUNDARY_SIZE];
+        size_t parameterLength = 0, nameLength = 0;
+        bool overflow = false;
+
+        while(i < length && IS_WSP(value[i]))
+            i++;
+        if(i == length)
+            break;
+        if(value[i++] != ';')
+            return false;
+        while(i < length && IS_WSP(value[i]))
+            i++;
+        if(i == length)
+            break;
+        const char * name = value + i;
+        while(i < length && value[i] != '=' && value[i] != ';' && !IS_WSP(value[i])) {
+            nameLength++;
+            i++;
+        }
+        while(i < length && IS_WSP(value[i]))
+            i++;
+        if(i == length || value[i++] != '=')
+            return false;
+        while(i < length && IS_WSP(value[i]))
+            i++;
+        const bool quoted = i < length && value[i] == '"';
+        if(quoted)
+            i++;
+        while(i < length) {
+            char c = value[i];
+            if(quoted && c == '"')
+                break;
+            if(!quoted && (c == ';' || IS_WSP(c)))
+                break;
+            if(quoted && c == '\\' && i + 1 < length)
+                c = value[++i];
+            if(parameterLength < sizeof(parameter))
+                parameter[parameterLength++] = c;
+            else
+                overflow = true;
+            i++;
+        }
+        if(quoted && (i == length || value[i++] != '"'))
+            return false;
+        if(equalsIgnoreCase(name, nameLength, "boundary")) {
+            if(parameterLength == 0 || overflow)
+                return false;
+            memcpy(sniffer->boundary.value, parameter, parameterLength);
+            sniffer->boundary.length = parameterLength;
+        }
+    }
+    return true;
+}
+
+/** Termina el header actual. Solo importa el Content-Type. */
+static void sniffField(filterSniffer * sniffer, const char * mediaRange) {
+    const size_t nameLength = strlen(CONTENT_TYPE);
+    size_t i = nameLength;
+
+    if(sniffer->fieldLength < nameLength || strncasecmp(sniffer->field, CONTENT_TYPE, nameLength) != 0) {
+        sniffer->fieldLength = 0;
+        return;
+    }
+    while(i < sniffer->fieldLength && IS_WSP(sniffer->field[i]))
+        i++;
+    if(i < sniffer->fieldLength && sniffer->field[i] == ':') {
+        if(sniffer->fieldOverflow || !sniffContentType(sniffer, mediaRange, sniffer->field + i + 1, sniffer->fieldLength - i - 1))
+            sniffer->decision = FILTER_SNIFF_FILTER;
+    }
+    sniffer->fieldLength = 0;
+}
+
+/**
+ * Terminan los headers de una parte. Un multipart abre un nivel; cualquier
+ * otra parte fuera de un multipart es el mensaje entero.
+ */
+static void sniffHeadersEnd(filterSniffer * sniffer, const char * mediaRange) {
+    const bool parentDigest = sniffer->depth > 0 && sniffer->stack[sniffer->depth - 1].digest;
+
+    sniffField(sniffer, mediaRange);
+    if(sniffer->decision != FILTER_SNIFF_PENDING)
+        return;
+    if(!sniffer->typed && (parentDigest || filterMediaRangeMatches(mediaRange, "text", 4, "plain", 5)))
+        sniffer->decision = FILTER_SNIFF_FILTER;
+    else if(sniffer->multipart) {
+        if(sniffer->boundary.length == 0 || sniffer->depth == FILTER_SNIFF_DEPTH)
+            sniffer->decision = FILTER_SNIFF_FILTER;
+        else {
+            sniffer->stack[sniffer->depth] = sniffer->boundary;
+            sniffer->stack[sniffer->depth++].digest = sniffer->digest;
+        }
+    } else if(sniffer->depth == 0)
+        sniffer->decision = FILTER_SNIFF_BYPASS;
+
+    sniffer->headers   = false;
+    sniffer->typed     = false;
+    sniffer->multipart = false;
+    sniffer->digest    = false;
+    sniffer->boundary.length = 0;
+}
+
+/**
+ * Una linea del cuerpo de una parte. Si es el boundary de un multipart
+ * abierto empieza otra parte o, con "--" al final, se cierra el multipart.
+ * Al cerrarse el más externo ya no quedan partes.
+ */
+static void sniffBodyLine(filterSniffer * sniffer) {
+    const char * line = sniffer->line;
+    const size_t length = sniffer->lineLength;
+
+    if(sniffer->lineOverflow || length < 2 || line[0] != '-' || line[1] != '-')
+        return;
+    for(size_t level = sniffer->depth; level-- > 0; ) {
+        const filterSniffBoundary * boundary = &sniffer->stack[level];
+        if(length - 2 < boundary->length || memcmp(line + 2, boundary->value, boundary->length) != 0)
+            continue;
+        size_t i = 2 + boundary->length;
+        const bool closing = length - i >= 2 && line[i] == '-' && line[i + 1] == '-';
+        if(closing)
+            i += 2;
+        while(i < length && IS_WSP(line[i]))
+            i++;
+        if(i < length)
+            continue;
+        if(closing) {
+            sniffer->depth = level;
+            if(level == 0)
+                sniffer->decision = FILTER_SNIFF_BYPASS;
+        } else {
+            sniffer->depth       = level + 1;
+            sniffer->headers     = true;
+            sniffer->fieldLength = 0;
+            sniffer->fieldOverflow = false;
+        }
+        return;
+    }
+}
+
+/** Termina una linea. La linea de terminación termina el mensaje. */
+static void sniffLineEnd(filterSniffer * sniffer, const char * mediaRange) {
+    const bool empty = sniffer->lineStart;
+
+    if(empty && sniffer->lineDot) {
+        if(sniffer->headers)
+            sniffHeadersEnd(sniffer, mediaRange);
+        if(sniffer->decision == FILTER_SNIFF_PENDING)
+            sniffer->decision = FILTER_SNIFF_BYPASS;
+    } else if(sniffer->headers) {
+        if(empty)
+            sniffHeadersEnd(sniffer, mediaRange);
+    } else
+        sniffBodyLine(sniffer);
+
+    sniffer->lineStart    = true;
+    sniffer->lineDot      = false;
+    sniffer->lineLength   = 0;
+    sniffer->lineOverflow = false;
+}
+
+filterSniffDecision filterSnifferConsume(filterSniffer * sniffer, const char * mediaRange, const uint8_t * data, const size_t length) {
+    if(mediaRange == NULL)
+        sniffer->decision = FILTER_SNIFF_FILTER;
+
+    for(size_t i = 0; i < length && sniffer->decision == FILTER_SNIFF_PENDING; i++) {
+        const char c = (char) data[i];
+        /** Los '\r' no cambian la decisión, se ignoran. */
+        if(c == '\r')
+            continue;
+        if(sniffer->lineStart && c == '.' && !sniffer->lineDot) {
+            sniffer->lineDot = true;
+            continue;
+        }
+        if(c == '\n') {
+            sniffLineEnd(sniffer, mediaRange);
+            continue;
+        }
+        if(sniffer->lineStart) {
+            sniffer->lineStart = false;
+            /** Un header nuevo termina el anterior; una linea que empieza con espacios lo continúa. */
+            if(sniffer->headers && !IS_WSP(c)) {
+                sniffField(sniffer, mediaRange);
+                sniffer->fieldOverflow = false;
+                if(sniffer->decision != FILTER_SNIFF_PENDING)
+                    break;
+            }
+        }
+        if(sniffer->headers) {
+            if(sniffer->fieldLength < sizeof(sniffer->field))
+                sniffer->field[sniffer->fieldLength++] = c;
+            else
+                sniffer->fieldOverflow = true;
+        } else if(sniffer->lineLength < sizeof(sniffer->line))
+            sniffer->line[sniffer->lineLength++] = c;
+        else
+            sniffer->lineOverflow = true;
+    }
+    return sniffer->decision;
+}
+
+void filterBypassRecord(const bool bypassed, const size_t sniffedBytes) {
+    if(bypassed)
+        statistics.bypassed++;
+    else
+        statistics.filtered++;
+    statistics.sniffedBytes += sniffedBytes;
+}
+
+size_t filterBypassStatistics(char * buffer, const size_t size) {
+    const unsigned long long sniffed = statistics.bypassed + statistics.filtered;
+
+    if(size == 0)
+        return 0;
+    const int n = snprintf(buffer, size, "filter bypass: bypassed %llu filtered %llu bypass-ratio %.2f sniffed-bytes %llu\n",
+        statistics.bypassed, statistics.filtered, sniffed? (double) statistics.bypassed / sniffed : 0.0,
+        statistics.sniffedBytes);
+    if(n < 0)
+        return 0;
+    return ((size_t) n >= size)? size - 1 : (size_t) n;
+}
@@ -0,0 +1,380 @@
+/**
+ * filterCache.c - cache de la salida del filtro para cada mensaje.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "filterCache.h"
+
+#define FNV_PRIME 0x100000001b3ULL
+#define ENTRY_PATH_SIZE 4096
+
+typedef enum filterCacheTier {
+    TIER_MEMORY,
+    TIER_DISK,
+} filterCacheTier;
+
+typedef struct filterCacheEntry {
+    filterCacheKey              key;
+    filterCacheTier             tier;
+    /** Salida del filtro, NULL si la entrada está en disco. */
+    uint8_t *                   data;
+    size_t                      length;
+    struct filterCacheEntry *   nextInBucket;
+    /** Lista de su nivel, de la más usada a la menos usada. */
+    struct filterCacheEntry *   previous;
+    struct filterCacheEntry *   next;
+} filterCacheEntry;
+
+typedef struct lruList {
+    filterCacheEntry *          first;
+    filterCacheEntry *          last;
+    size_t                      bytes;
+    size_t                      limit;
+    size_t                      entries;
+} lruList;
+
+struct filterCacheCDT {
+    filterCacheEntry *          buckets[FILTER_CACHE_BUCKETS];
+    lruList                     memory;
+    lruList                     disk;
+    /** Bytes que tienen reservados las sesiones, a lo sumo `memory.limit'. */
+    size_t                      spooled;
+    char *                      directory;
+    unsigned long long          hits;
+    unsigned long long          diskHits;
+    unsigned long long          misses;
+    unsigned long long          stores;
+    unsigned long long          oversized;
+    unsigned long long          spoolFull;
+    unsigned long long          evictions;
+};
+
+filterCacheADT createFilterCache(const size_t memoryLimit, const char * directory, const size_t diskLimit) {
+    if(memoryLimit == 0 || (directory != NULL && access(directory, R_OK | W_OK | X_OK) != 0))
+        return NULL;
+
+    filterCacheADT cache = calloc(1, sizeof(*cache));
+    if(cache == NULL)
+        return NULL;
+    cache->memory.limit = memoryLimit;
+    if(directory != NULL && diskLimit > 0) {
+        cache->directory  = strdup(directory);
+        cache->disk.limit = diskLimit;
+        if(cache->directory == NULL) {
+            free(cache);
+            return NULL;
+        }
+    }
+    return cache;
+}
+
+size_t filterCacheMaxEntry(filterCacheADT cache) {
+    return (cache == NULL)? 0 : cache->memory.limit / FILTER_CACHE_ENTRY_FRACTION;
+}
+
+uint64_t filterCacheHash(uint64_t hash, const uint8_t * data, const size_t length) {
+    for(size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/** Continúa `hash' con `string' y su terminador, o con un byte que no puede estar en él si es NULL. */
+static uint64_t hashString(const uint64_t hash, const char * string) {
+    if(string == NULL)
+        return filterCacheHash(hash, (const uint8_t *) "\xff", 1);
+    return filterCacheHash(hash, (const uint8_t *) string, strlen(string) + 1);
+}
+
+uint64_t filterCacheSessionConfig(const uint64_t config, const char * username, const char * origin) {
+    return hashString(hashString(config, username), origin);
+}
+
+static unsigned bucketOf(const filterCacheKey * key) {
+    const uint64_t hash = key->body ^ (key->config * FNV_PRIME) ^ key->length;
+    return (unsigned) ((hash ^ (hash >> 32)) & (FILTER_CACHE_BUCKETS - 1));
+}
+
+static bool keyEquals(const filterCacheKey * a, const filterCacheKey * b) {
+    return a->body == b->body && a->config == b->config && a->length == b->length
+        && memcmp(a->digest, b->digest, SHA256_DIGEST_SIZE) == 0;
+}
+
+static void entryPath(filterCacheADT cache, const filterCacheEntry * entry, char * path) {
+    char digest[2 * SHA256_DIGEST_SIZE + 1];
+    for(size_t i = 0; i < SHA256_DIGEST_SIZE; i++)
+        snprintf(digest + 2 * i, 3, "%02x", entry->key.digest[i]);
+    snprintf(path, ENTRY_PATH_SIZE, "%s/%s-%016llx-%zx", cache->directory,
+        digest, (unsigned long long) entry->key.config, entry->key.length);
+}
+
+static void listRemove(lruList * list, filterCacheEntry * entry, const size_t length) {
+    if(entry->previous != NULL)
+        entry->previous->next = entry->next;
+    else
+        list->first = entry->next;
+    if(entry->next != NULL)
+        entry->next->previous = entry->previous;
+    else
+        list->last = entry->previous;
+    entry->previous = entry->next = NULL;
+    list->bytes    -= length;
+    list->entries--;
+}
+
+static void listPush(lruList * list, filterCacheEntry * entry, const size_t length) {
+    entry->previous = NULL;
+    entry->next     = list->first;
+    if(list->first != NULL)
+        list->first->previous = entry;
+    else
+        list->last = entry;
+    list->first  = entry;
+    list->bytes += length;
+    list->entries++;
+}
+
+static filterCacheEntry * findEntry(filterCacheADT cache, const filterCacheKey * key) {
+    filterCacheEntry * entry = cache->buckets[bucketOf(key)];
+    while(entry != NULL && !keyEquals(&entry->key, key))
+        entry = entry->nextInBucket;
+    return entry;
+}
+
+/** Quita la entrada del índice y de su nivel y la libera. */
+static void removeEntry(filterCacheADT cache, filterCacheEntry * entry) {
+    char path[ENTRY_PATH_SIZE];
+    filterCacheEntry ** current = &cache->buckets[bucketOf(&entry->key)];
+
+    while(*current != entry)
+        current = &(*current)->nextInBucket;
+    *current = entry->nextInBucket;
+    if(entry->tier == TIER_MEMORY) {
+        listRemove(&cache->memory, entry, entry->length);
+        free(entry->data);
+    } else {
+        listRemove(&cache->disk, entry, entry->length);
+        entryPath(cache, entry, path);
+        unlink(path);
+    }
+    free(entry);
+}
+
+static bool writeAll(const int fd, const uint8_t * data, size_t length) {
+    while(length > 0) {
+        const ssize_t n = write(fd, data, length);
+        if(n <= 0)
+            return false;
+        data   += n;
+        length -= n;
+    }
+    return true;
+}
+
+static bool readAll(const int fd, uint8_t * data, size_t length) {
+    while(length > 0) {
+        const ssize_t n = read(fd, data, length);
+        if(n <= 0)
+            return false;
+        data   += n;
+        length -= n;
+    }
+    return true;
+}
+
+/** Pasa al disco la entrada de memoria menos usada o la descarta. */
+static void demote(filterCacheADT cache, filterCacheEntry * entry) {
+    char path[ENTRY_PATH_SIZE];
+    const size_t length = entry->length;
+
+    if(cache->directory == NULL || length > cache->disk.limit) {
+        cache->evictions++;
+        removeEntry(cache, entry);
+        return;
+    }
+    while(cache->disk.last != NULL && cache->disk.bytes + length > cache->disk.limit) {
+        cache->evictions++;
+        removeEntry(cache, cache->disk.last);
+    }
+
+    entryPath(cache, entry, path);
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    const bool written = fd >= 0 && writeAll(fd, entry->data, length);
+    if(fd >= 0)
+        close(fd);
+    if(!written) {
+        unlink(path);
+        cache->evictions++;
+        removeEntry(cache, entry);
+        return;
+    }
+    listRemove(&cache->memory, entry, length);
+    free(entry->data);
+    entry->data = NULL;
+    entry->tier = TIER_DISK;
+    listPush(&cache->disk, entry, length);
+}
+
+static void makeRoom(filterCacheADT cache, const size_t length) {
+    while(cache->memory.last != NULL && cache->memory.bytes + length > cache->memory.limit)
+        demote(cache, cache->memory.last);
+}
+
+/** Vuelve a memoria una entrada del disco. Si no se puede, la descarta. */
+static bool promote(filterCacheADT cache, filterCacheEntry * entry) {
+    char path[ENTRY_PATH_SIZE];
+    const size_t length = entry->length;
+    uint8_t * data      = malloc(length);
+    bool loaded         = false;
+
+    entryPath(cache, entry, path);
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(data != NULL && fd >= 0)
+        loaded = readAll(fd, data, length);
+    if(fd >= 0)
+        close(fd);
+    if(!loaded) {
+        free(data);
+        removeEntry(cache, entry);
+        return false;
+    }
+    unlink(path);
+    listRemove(&cache->disk, entry, length);
+    makeRoom(cache, length);
+    entry->data = data;
+    entry->tier = TIER_MEMORY;
+    listPush(&cache->memory, entry, length);
+    return true;
+}
+
+bool filterCacheGet(filterCacheADT cache, const filterCacheKey * key, filterCacheBytes * output) {
+    if(cache == NULL)
+        return false;
+
+    filterCacheEntry * entry = findEntry(cache, key);
+    if(entry != NULL && entry->tier == TIER_DISK) {
+        if(promote(cache, entry))
+            cache->diskHits++;
+        else
+            entry = NULL;
+    } else if(entry != NULL) {
+        listRemove(&cache->memory, entry, entry->length);
+        listPush(&cache->memory, entry, entry->length);
+    }
+    if(entry == NULL) {
+        cache->misses++;
+        return false;
+    }
+    output->length = 0;
+    if(!filterCacheBytesAppend(output, entry->data, entry->length, SIZE_MAX)) {
+        cache->misses++;
+        return false;
+    }
+    cache->hits++;
+    return true;
+}
+
+void filterCachePut(filterCacheADT cache, const filterCacheKey * key, const uint8_t * data, const size_t length) {
+    if(cache == NULL || findEntry(cache, key) != NULL)
+        return;
+    if(length > filterCacheMaxEntry(cache)) {
+        cache->oversized++;
+        return;
+    }
+
+    filterCacheEntry * entry = calloc(1, sizeof(*entry));
+    uint8_t * copy           = malloc(length);
+    if(entry == NULL || copy == NULL) {
+        free(entry);
+        free(copy);
+        return;
+    }
+    memcpy(copy, data, length);
+    makeRoom(cache, length);
+
+    entry->key        = *key;
+    entry->data       = copy;
+    entry->length     = length;
+    entry->tier       = TIER_MEMORY;
+    const unsigned bucket = bucketOf(key);
+    entry->nextInBucket   = cache->buckets[bucket];
+    cache->buckets[bucket] = entry;
+    listPush(&cache->memory, entry, length);
+    cache->stores++;
+}
+
+void filterCacheOversized(filterCacheADT cache) {
+    if(cache != NULL)
+        cache->oversized++;
+}
+
+bool filterCacheSpoolReserve(filterCacheADT cache, const size_t length) {
+    if(cache == NULL)
+        return false;
+    if(length > cache->memory.limit - cache->spooled) {
+        cache->spoolFull++;
+        return false;
+    }
+    cache->spooled += length;
+    return true;
+}
+
+void filterCacheSpoolRelease(filterCacheADT cache, const size_t length) {
+    if(cache != NULL)
+        cache->spooled -= (length > cache->spooled)? cache->spooled : length;
+}
+
+void deleteFilterCache(filterCacheADT cache) {
+    if(cache == NULL)
+        return;
+    for(unsigned i = 0; i < FILTER_CACHE_BUCKETS; i++)
+        while(cache->buckets[i] != NULL)
+            removeEntry(cache, cache->buckets[i]);
+    free(cache->directory);
+    free(cache);
+}
+
+size_t filterCacheStatistics(filterCacheADT cache, char * buffer, const size_t size) {
+    if(cache == NULL || size == 0)
+        return 0;
+
+    const unsigned long long lookups = cache->hits + cache->misses;
+    const int n = snprintf(buffer, size,
+        "filter cache: hits %llu disk-hits %llu misses %llu hit-ratio %.2f stores %llu oversized %llu spool-full %llu evictions %llu spooled %zu/%zu bytes memory %zu/%zu bytes %zu entries disk %zu/%zu bytes %zu entries\n",
+        cache->hits, cache->diskHits, cache->misses, lookups? (double) cache->hits / lookups : 0.0,
+        cache->stores, cache->oversized, cache->spoolFull, cache->evictions, cache->spooled, cache->memory.limit,
+        cache->memory.bytes, cache->memory.limit, cache->memory.entries,
+        cache->disk.bytes, cache->disk.limit, cache->disk.entries);
+    if(n < 0)
+        return 0;
+    return ((size_t) n >= size)? size - 1 : (size_t) n;
+}
+
+bool filterCacheBytesAppend(filterCacheBytes * bytes, const uint8_t * data, const size_t length, const size_t limit) {
+    if(length > limit || bytes->length > limit - length)
+        return false;
+    if(bytes->length + length > bytes->capacity) {
+        size_t capacity = (bytes->capacity > 0)? bytes->capacity : 4096;
+        while(capacity < bytes->length + length)
+            capacity = (capacity > SIZE_MAX / 2)? bytes->length + length : capacity * 2;
+        uint8_t * grown = realloc(bytes->data, capacity);
+        if(grown == NULL)
+            return false;
+        bytes->data     = grown;
+        bytes->capacity = capacity;
+    }
+    memcpy(bytes->data + bytes->length, data, length);
+    bytes->length += length;
+    return true;
+}
+
+void filterCacheBytesFree(filterCacheBytes * bytes) {
+    free(bytes->data);
+    memset(bytes, 0, sizeof(*bytes));
+}
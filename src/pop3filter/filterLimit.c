@@ -0,0 +1,125 @@
+/**
+ * filterLimit.c - límite de filtros externos ejecutándose a la vez.
+ */
+#include <stdio.h>
+
+#include "filterLimit.h"
+
+static struct {
+    size_t                  max;
+    size_t                  active;
+    size_t                  queued;
+    filterLimitWaiter *     first;
+    filterLimitWaiter *     last;
+    /** Lugares otorgados, y cuántos de ellos esperaron en la cola. */
+    unsigned long long      admitted;
+    unsigned long long      waited;
+    double                  totalWaitMs;
+    double                  maxWaitMs;
+} limit;
+
+static bool hasRoom(void) {
+    return limit.max == 0 || limit.active < limit.max;
+}
+
+static void dequeue(filterLimitWaiter * waiter) {
+    if(waiter->prev != NULL)
+        waiter->prev->next = waiter->next;
+    else
+        limit.first = waiter->next;
+    if(waiter->next != NULL)
+        waiter->next->prev = waiter->prev;
+    else
+        limit.last = waiter->prev;
+    waiter->next   = NULL;
+    waiter->prev   = NULL;
+    waiter->queued = false;
+    limit.queued--;
+}
+
+/** Admite a las sesiones en espera mientras haya lugares libres. */
+static void admitWaiting(void) {
+    struct timespec now;
+
+    while(limit.first != NULL && hasRoom()) {
+        filterLimitWaiter * waiter = limit.first;
+        dequeue(waiter);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        const double ms = (now.tv_sec - waiter->since.tv_sec) * 1000.0
+                        + (now.tv_nsec - waiter->since.tv_nsec) / 1000000.0;
+        limit.totalWaitMs += ms;
+        if(ms > limit.maxWaitMs)
+            limit.maxWaitMs = ms;
+        limit.waited++;
+        limit.admitted++;
+        limit.active++;
+        waiter->admitted = true;
+        if(waiter->wake != NULL)
+            waiter->wake(waiter->data);
+    }
+}
+
+void filterLimitSetMax(const size_t max) {
+    limit.max = max;
+    admitWaiting();
+}
+
+size_t filterLimitMax(void) {
+    return limit.max;
+}
+
+size_t filterLimitActive(void) {
+    return limit.active;
+}
+
+size_t filterLimitQueued(void) {
+    return limit.queued;
+}
+
+bool filterLimitAcquire(filterLimitWaiter * waiter, const filterLimitWake wake, void * data) {
+    if(waiter->admitted)
+        return true;
+    if(waiter->queued)
+        return false;
+    /** Sin cola se respeta el orden de llegada: nadie se adelanta a los que esperan. */
+    if(limit.first == NULL && hasRoom()) {
+        limit.active++;
+        limit.admitted++;
+        waiter->admitted = true;
+        return true;
+    }
+    waiter->wake   = wake;
+    waiter->data   = data;
+    waiter->next   = NULL;
+    waiter->prev   = limit.last;
+    waiter->queued = true;
+    clock_gettime(CLOCK_MONOTONIC, &waiter->since);
+    if(limit.last != NULL)
+        limit.last->next = waiter;
+    else
+        limit.first = waiter;
+    limit.last = waiter;
+    limit.queued++;
+    return false;
+}
+
+void filterLimitRelease(filterLimitWaiter * waiter) {
+    if(waiter->queued) {
+        dequeue(waiter);
+    } else if(waiter->admitted) {
+        waiter->admitted = false;
+        limit.active--;
+        admitWaiting();
+    }
+}
+
+size_t filterLimitStatistics(char * buffer, const size_t size) {
+    if(size == 0)
+        return 0;
+    const int n = snprintf(buffer, size, "filter limit: active %zu max %zu queued %zu admitted %llu waited %llu avg-wait-ms %.2f max-wait-ms %.2f\n",
+        limit.active, limit.max, limit.queued, limit.admitted, limit.waited,
+        limit.waited? limit.totalWaitMs / limit.waited : 0.0, limit.maxWaitMs);
+    if(n < 0)
+        return 0;
+    return ((size_t) n >= size)? size - 1 : (size_t) n;
+}
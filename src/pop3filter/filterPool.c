@@ -0,0 +1,352 @@
+/**
+ * filterPool.c - procesos de filtro persistentes para los RETR filtrados.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include "filterPool.h"
+#include "multiplexor.h"
+#include "processSpawn.h"
+#include "logger.h"
+
+#define FILTER_POOL_SHELL_PATH "/bin/sh"
+
+/** Estados de filterPoolScanner. */
+enum scannerState {
+    LINE_START,
+    DOT,
+    DOT_CR,
+    LINE,
+};
+
+typedef struct filterWorker {
+    int                     fd;
+    pid_t                   pid;
+    bool                    busy;
+    /** Configuración con la que se lanzó, ver `pool.generation'. */
+    unsigned                generation;
+    struct timespec         acquiredAt;
+    /** Último reemplazo porque terminó estando libre. */
+    time_t                  crashedAt;
+    unsigned long long      messages;
+    unsigned long long      restarts;
+    double                  totalMs;
+    double                  maxMs;
+} filterWorker;
+
+static struct {
+    filterWorker *          workers;
+    size_t                  count;
+    size_t                  max;
+    MultiplexorADT          mux;
+    const char *            wrapperPath;
+    /** Comando de los workers nativos, NULL en modo de compatibilidad. */
+    char *                  nativeCommand;
+    char *                  errorFile;
+    /** Cambia con `nativeCommand' o `errorFile'. */
+    unsigned                generation;
+    unsigned long long      acquired;
+    unsigned long long      fallbacks;
+} pool;
+
+static void workerRead(MultiplexorKey key);
+
+static const eventHandler workerHandler = {
+    .read = workerRead,
+};
+
+/**
+ * Lanza un worker con stdin y stdout en un extremo de un socketpair y
+ * vigila el otro extremo mientras está libre.
+ */
+static bool spawnWorker(filterWorker * worker) {
+    const char * const names[]  = {FILTER_WORKER_ENV};
+    const char * const values[] = {"1"};
+    char * const wrapperArgv[]  = {"filterWrapper", NULL};
+    char * const nativeArgv[]   = {"sh", "-c", pool.nativeCommand, NULL};
+    int fds[2];
+    pid_t pid;
+
+    worker->fd         = -1;
+    worker->pid        = 0;
+    worker->busy       = false;
+    worker->generation = pool.generation;
+    if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+        return false;
+
+    if(pool.nativeCommand != NULL)
+        pid = processSpawn(FILTER_POOL_SHELL_PATH, nativeArgv, fds[1], fds[1], pool.errorFile, names, values, 1);
+    else
+        pid = processSpawn(pool.wrapperPath, wrapperArgv, fds[1], fds[1], NULL, names, values, 1);
+    close(fds[1]);
+    if(pid < 0) {
+        close(fds[0]);
+        return false;
+    }
+    if(fdSetNIO(fds[0]) < 0 || (pool.mux != NULL && MUX_SUCCESS != registerFd(pool.mux, fds[0], &workerHandler, READ, worker))) {
+        kill(pid, SIGKILL);
+        close(fds[0]);
+        return false;
+    }
+    worker->fd  = fds[0];
+    worker->pid = pid;
+    return true;
+}
+
+static void stopWorker(filterWorker * worker) {
+    if(worker->pid > 0)
+        kill(worker->pid, SIGKILL);
+    if(worker->fd >= 0) {
+        if(pool.mux != NULL)
+            unregisterFd(pool.mux, worker->fd);
+        close(worker->fd);
+    }
+    worker->fd   = -1;
+    worker->pid  = 0;
+    worker->busy = false;
+}
+
+static void restartWorker(filterWorker * worker) {
+    stopWorker(worker);
+    worker->restarts++;
+    spawnWorker(worker);
+}
+
+/**
+ * Un worker libre no escribe nada: si su socket es legible terminó (o no
+ * respeta el protocolo) y se reemplaza.
+ */
+static void workerRead(MultiplexorKey key) {
+    filterWorker * worker = key->data;
+    const time_t now = time(NULL);
+
+    if(worker->busy)
+        return;
+    logWarn("Filter worker %d exited while idle.", (int) worker->pid);
+    if(worker->crashedAt != 0 && now - worker->crashedAt < FILTER_POOL_RESPAWN_INTERVAL) {
+        /** Se lanza recién al volver a usarlo, para no relanzar sin pausa un comando que falla. */
+        stopWorker(worker);
+        worker->restarts++;
+    } else
+        restartWorker(worker);
+    worker->crashedAt = now;
+}
+
+static bool sameString(const char * string, const char * other) {
+    return (string == NULL || other == NULL)? string == other : strcmp(string, other) == 0;
+}
+
+/** Cambia el comando de los workers. Retorna false si no hay memoria. */
+static bool setCommand(const char * nativeCommand, const char * errorFile) {
+    char * command = (nativeCommand != NULL)? strdup(nativeCommand) : NULL;
+    char * file    = (errorFile != NULL)? strdup(errorFile) : NULL;
+
+    if((nativeCommand != NULL && command == NULL) || (errorFile != NULL && file == NULL)) {
+        free(command);
+        free(file);
+        return false;
+    }
+    free(pool.nativeCommand);
+    free(pool.errorFile);
+    pool.nativeCommand = command;
+    pool.errorFile     = file;
+    pool.generation++;
+    return true;
+}
+
+bool filterPoolInit(MultiplexorADT mux, const char * wrapperPath, const char * nativeCommand,
+                    const char * errorFile, const size_t maxWorkers) {
+    memset(&pool, 0, sizeof(pool));
+    if(maxWorkers == 0)
+        return true;
+
+    pool.workers = calloc(maxWorkers, sizeof(*pool.workers));
+    if(pool.workers == NULL || !setCommand(nativeCommand, errorFile)) {
+        free(pool.workers);
+        pool.workers = NULL;
+        return false;
+    }
+    pool.max         = maxWorkers;
+    pool.mux         = mux;
+    pool.wrapperPath = wrapperPath;
+    while(pool.count < FILTER_POOL_PREFORK && pool.count < pool.max && spawnWorker(&pool.workers[pool.count]))
+        pool.count++;
+    return true;
+}
+
+void filterPoolDestroy(void) {
+    for(size_t i = 0; i < pool.count; i++)
+        stopWorker(&pool.workers[i]);
+    free(pool.workers);
+    free(pool.nativeCommand);
+    free(pool.errorFile);
+    memset(&pool, 0, sizeof(pool));
+}
+
+/** Envía el header a un worker libre y lo marca ocupado. */
+static bool startMessage(filterWorker * worker, const uint8_t * header, const size_t length) {
+    if(worker->fd < 0 || worker->generation != pool.generation
+            || send(worker->fd, header, length, MSG_NOSIGNAL) != (ssize_t) length)
+        return false;
+    if(pool.mux != NULL)
+        setInterest(pool.mux, worker->fd, NO_INTEREST);
+    worker->busy = true;
+    clock_gettime(CLOCK_MONOTONIC, &worker->acquiredAt);
+    pool.acquired++;
+    return true;
+}
+
+int filterPoolAcquire(const char * nativeCommand, const char * errorFile, const uint8_t * header,
+                      const size_t length, size_t * worker) {
+    if(pool.max == 0)
+        return -1;
+    if(!sameString(nativeCommand, pool.nativeCommand) || !sameString(errorFile, pool.errorFile)) {
+        if(!setCommand(nativeCommand, errorFile)) {
+            pool.fallbacks++;
+            return -1;
+        }
+        /** Los ocupados se reemplazan al liberarlos. */
+        for(size_t i = 0; i < pool.count; i++)
+            if(!pool.workers[i].busy) {
+                stopWorker(&pool.workers[i]);
+                spawnWorker(&pool.workers[i]);
+            }
+    }
+
+    for(size_t i = 0; i < pool.count; i++) {
+        filterWorker * candidate = &pool.workers[i];
+        if(candidate->busy)
+            continue;
+        if(!startMessage(candidate, header, length)) {
+            restartWorker(candidate);
+            if(!startMessage(candidate, header, length))
+                continue;
+        }
+        *worker = i;
+        return candidate->fd;
+    }
+    if(pool.count < pool.max && spawnWorker(&pool.workers[pool.count])
+            && startMessage(&pool.workers[pool.count], header, length)) {
+        *worker = pool.count++;
+        return pool.workers[*worker].fd;
+    }
+    pool.fallbacks++;
+    return -1;
+}
+
+pid_t filterPoolWorkerPid(const size_t worker) {
+    return (worker < pool.count)? pool.workers[worker].pid : 0;
+}
+
+void filterPoolRelease(const size_t worker, const bool completed) {
+    if(worker >= pool.count)
+        return;
+
+    filterWorker * released = &pool.workers[worker];
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if(completed) {
+        const double ms = (now.tv_sec - released->acquiredAt.tv_sec) * 1000.0
+                        + (now.tv_nsec - released->acquiredAt.tv_nsec) / 1000000.0;
+        released->messages++;
+        released->totalMs += ms;
+        if(ms > released->maxMs)
+            released->maxMs = ms;
+        released->busy = false;
+        if(released->generation != pool.generation) {
+            stopWorker(released);
+            spawnWorker(released);
+        } else if(pool.mux != NULL)
+            setInterest(pool.mux, released->fd, READ);
+    } else
+        restartWorker(released);
+}
+
+size_t filterPoolHeader(uint8_t * header, const size_t size, const char * const names[], const char * const values[], const size_t count) {
+    size_t length = 4;
+
+    if(size < length)
+        return 0;
+    for(size_t i = 0; i < count; i++) {
+        if(values[i] == NULL)
+            continue;
+        const size_t nameLength  = strlen(names[i]);
+        const size_t valueLength = strlen(values[i]);
+        if(nameLength + valueLength + 2 > size - length)
+            return 0;
+        memcpy(header + length, names[i], nameLength);
+        length += nameLength;
+        header[length++] = '=';
+        memcpy(header + length, values[i], valueLength);
+        length += valueLength;
+        header[length++] = '\0';
+    }
+    const size_t entries = length - 4;
+    header[0] = (entries >> 24) & 0xFF;
+    header[1] = (entries >> 16) & 0xFF;
+    header[2] = (entries >> 8) & 0xFF;
+    header[3] = entries & 0xFF;
+    return length;
+}
+
+void filterPoolScannerInit(filterPoolScanner * scanner) {
+    scanner->state = LINE_START;
+    scanner->done  = false;
+}
+
+bool filterPoolScannerConsume(filterPoolScanner * scanner, const uint8_t * data, const size_t length) {
+    for(size_t i = 0; i < length && !scanner->done; i++) {
+        const uint8_t c = data[i];
+        switch(scanner->state) {
+            case LINE_START:
+                scanner->state = (c == '.')? DOT : (c == '\n')? LINE_START : LINE;
+                break;
+            case DOT:
+                scanner->state = (c == '\r')? DOT_CR : (c == '\n')? LINE_START : LINE;
+                break;
+            case DOT_CR:
+                if(c == '\n')
+                    scanner->done = true;
+                else
+                    scanner->state = LINE;
+                break;
+            default:
+                if(c == '\n')
+                    scanner->state = LINE_START;
+                break;
+        }
+    }
+    return scanner->done;
+}
+
+static size_t appendStatistics(char * buffer, const size_t size, const int n) {
+    if(n < 0)
+        return 0;
+    return ((size_t) n >= size)? size - 1 : (size_t) n;
+}
+
+size_t filterPoolStatistics(char * buffer, const size_t size) {
+    size_t written = 0, busy = 0;
+
+    if(pool.max == 0 || size == 0)
+        return 0;
+    for(size_t i = 0; i < pool.count; i++)
+        busy += pool.workers[i].busy;
+    written += appendStatistics(buffer, size, snprintf(buffer, size,
+        "filter pool: %s workers %zu/%zu busy %zu acquired %llu fallbacks %llu\n",
+        (pool.nativeCommand != NULL)? "native" : "compat", pool.count, pool.max, busy, pool.acquired, pool.fallbacks));
+    for(size_t i = 0; i < pool.count && written < size - 1; i++) {
+        const filterWorker * worker = &pool.workers[i];
+        written += appendStatistics(buffer + written, size - written, snprintf(buffer + written, size - written,
+            "filter worker %zu: pid %d %s messages %llu avg-ms %.2f max-ms %.2f restarts %llu\n",
+            i, (int) worker->pid, worker->busy? "busy" : "idle", worker->messages,
+            worker->messages? worker->totalMs / worker->messages : 0.0, worker->maxMs, worker->restarts));
+    }
+    return written;
+}
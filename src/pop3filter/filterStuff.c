@@ -0,0 +1,111 @@
+/**
+ * filterStuff.c - dot-stuffing de la entrada y la salida de un filtro.
+ */
+#include <errno.h>
+#include <unistd.h>
+
+#include "filterStuff.h"
+#include "logger.h"
+
+void filterStuffReset(filterStuffStruct * stuff) {
+    stuff->input.length  = 0;
+    stuff->inputSent     = 0;
+    stuff->inputClosed   = false;
+    stuff->output.length = 0;
+    stuff->lineStart     = true;
+    stuff->lastCR        = false;
+    stuff->outputFailed  = false;
+    stuff->complete      = false;
+    bodyPop3ParserInit(&stuff->parser);
+}
+
+void filterStuffFree(filterStuffStruct * stuff) {
+    filterCacheBytesFree(&stuff->input);
+    filterCacheBytesFree(&stuff->output);
+}
+
+size_t filterUnstuff(filterStuffStruct * stuff, bufferADT body, const uint8_t * data, const size_t length) {
+    bool errored = false;
+    size_t space, n = 0;
+
+    getWritePtr(body, &space);
+    while(n < length && space >= 2) {
+        if(bodyPop3IsDone(stuff->parser.state, &errored))
+            return length;
+        bodyPop3ParserFeed(&stuff->parser, data[n++], body, true);
+        getWritePtr(body, &space);
+    }
+    return n;
+}
+
+size_t filterStuffToCommand(filterStuffStruct * stuff, bufferADT body, const int fd, const uint8_t * data, const size_t length) {
+    const uint8_t * ptr;
+    size_t consumed, size;
+    ssize_t n = 0;
+
+    if(!stuff->inputClosed && stuff->inputSent < stuff->input.length) {
+        n = write(fd, stuff->input.data + stuff->inputSent, stuff->input.length - stuff->inputSent);
+        if(n == -1 && errno == EAGAIN)
+            return 0;
+        if(n != -1 && (stuff->inputSent += n) < stuff->input.length)
+            return 0;
+    }
+    stuff->input.length = 0;
+    stuff->inputSent    = 0;
+
+    consumed = filterUnstuff(stuff, body, data, length);
+    ptr = getReadPtr(body, &size);
+    if(n != -1 && !stuff->inputClosed && size > 0) {
+        n = write(fd, ptr, size);
+        if(n == -1 && errno == EAGAIN)
+            n = 0;
+        if(n != -1 && !filterCacheBytesAppend(&stuff->input, ptr + n, size - n, SIZE_MAX))
+            n = -1;
+    }
+    if(n == -1 && !stuff->inputClosed) {
+        logWarn("Filter fail: unnable to write in pipe, the rest of the body is discarded.");
+        stuff->inputClosed = true;
+    }
+    reset(body);
+    return consumed;
+}
+
+void filterStuffWriter(const uint8_t * data, const size_t length, void * writerData) {
+    filterStuffStruct * stuff = writerData;
+    bool ok = true;
+    size_t start = 0;
+
+    if(stuff->outputFailed)
+        return;
+    for(size_t i = 0; i < length && ok; i++) {
+        if(stuff->lineStart && data[i] == '.') {
+            ok = filterCacheBytesAppend(&stuff->output, data + start, i - start, SIZE_MAX)
+              && filterCacheBytesAppend(&stuff->output, (const uint8_t *) ".", 1, SIZE_MAX);
+            start = i;
+        } else if(data[i] == '\n' && !stuff->lastCR) {
+            ok = filterCacheBytesAppend(&stuff->output, data + start, i - start, SIZE_MAX)
+              && filterCacheBytesAppend(&stuff->output, (const uint8_t *) "\r\n", 2, SIZE_MAX);
+            start = i + 1;
+        }
+        stuff->lineStart = data[i] == '\n';
+        stuff->lastCR    = data[i] == '\r';
+    }
+    if(!ok || !filterCacheBytesAppend(&stuff->output, data + start, length - start, SIZE_MAX)) {
+        logError("Filter fail: no memory for the filter output.");
+        stuff->outputFailed = true;
+    }
+}
+
+void filterStuffEnd(filterStuffStruct * stuff) {
+    if(!stuff->lineStart)
+        filterCacheBytesAppend(&stuff->output, (const uint8_t *) "\r\n", 2, SIZE_MAX);
+    filterCacheBytesAppend(&stuff->output, (const uint8_t *) ".\r\n", 3, SIZE_MAX);
+    stuff->complete = true;
+}
+
+void filterStuffOutput(filterStuffStruct * stuff, const uint8_t * data, const size_t length) {
+    if(length > 0)
+        filterStuffWriter(data, length, stuff);
+    else
+        filterStuffEnd(stuff);
+}
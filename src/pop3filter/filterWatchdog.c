@@ -0,0 +1,261 @@
+/**
+ * filterWatchdog.c - plazos para la salida del filtro externo.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "filterWatchdog.h"
+
+#define MIB (1024 * 1024)
+
+typedef struct histogram {
+    unsigned long long  counts[FILTER_WATCHDOG_BUCKETS];
+    unsigned long long  total;
+} histogram;
+
+static struct {
+    unsigned                firstByte;
+    unsigned                total;
+    unsigned                perMiB;
+    filterWatchdogFallback  fallback;
+    unsigned long long      expiredFirstByte;
+    unsigned long long      expiredTotal;
+    /** Fallbacks aplicados, por tipo. */
+    unsigned long long      applied[FILTER_FALLBACK_REPLACE + 1];
+    histogram               firstByteLatency;
+    histogram               totalLatency;
+} watch;
+
+static const char * fallbackNames[] = {
+    [FILTER_FALLBACK_PASS]    = "pass",
+    [FILTER_FALLBACK_ERROR]   = "error",
+    [FILTER_FALLBACK_REPLACE] = "replace",
+};
+
+static unsigned long long elapsedMicros(const struct timespec * from, const struct timespec * to) {
+    const long long micros = (to->tv_sec - from->tv_sec) * 1000000LL + (to->tv_nsec - from->tv_nsec) / 1000;
+    return (micros < 0)? 0 : (unsigned long long) micros;
+}
+
+/**
+ * Los valores menores a 4 tienen un intervalo propio; desde ahí cada
+ * potencia de 2 se divide en 4 intervalos iguales.
+ */
+static unsigned bucketOf(const unsigned long long micros) {
+    unsigned bit = 0;
+
+    if(micros < 4)
+        return (unsigned) micros;
+    for(unsigned long long v = micros; v > 1; v >>= 1)
+        bit++;
+    const unsigned bucket = 4 * (bit - 1) + (unsigned) ((micros >> (bit - 2)) & 3);
+    return (bucket < FILTER_WATCHDOG_BUCKETS)? bucket : FILTER_WATCHDOG_BUCKETS - 1;
+}
+
+/** Límite superior del intervalo, en microsegundos. */
+static unsigned long long bucketLimit(const unsigned bucket) {
+    if(bucket < 4)
+        return bucket + 1;
+    return (5ULL + bucket % 4) << (bucket / 4 - 1);
+}
+
+static void histogramAdd(histogram * h, const unsigned long long micros) {
+    h->counts[bucketOf(micros)]++;
+    h->total++;
+}
+
+static double histogramPercentile(const histogram * h, double percentile) {
+    unsigned long long rank, seen = 0;
+
+    if(h->total == 0)
+        return 0.0;
+    if(percentile < 0.0)
+        percentile = 0.0;
+    if(percentile > 100.0)
+        percentile = 100.0;
+    rank = (unsigned long long) (percentile / 100.0 * h->total + 0.999999);
+    if(rank == 0)
+        rank = 1;
+    for(unsigned i = 0; i < FILTER_WATCHDOG_BUCKETS; i++) {
+        seen += h->counts[i];
+        if(seen >= rank)
+            return bucketLimit(i) / 1000.0;
+    }
+    return bucketLimit(FILTER_WATCHDOG_BUCKETS - 1) / 1000.0;
+}
+
+void filterWatchdogSetDeadlines(const unsigned firstByte, const unsigned total, const unsigned perMiB) {
+    watch.firstByte = firstByte;
+    watch.total     = total;
+    watch.perMiB    = perMiB;
+}
+
+void filterWatchdogSetFallback(const filterWatchdogFallback fallback) {
+    watch.fallback = fallback;
+}
+
+filterWatchdogFallback filterWatchdogGetFallback(void) {
+    return watch.fallback;
+}
+
+bool filterWatchdogEnabled(void) {
+    return watch.firstByte > 0 || watch.total > 0;
+}
+
+/** Lee un número sin signo que termina en `*end'. */
+static bool parseUnsigned(const char * string, char ** end, unsigned * value) {
+    if(*string < '0' || *string > '9')
+        return false;
+    const unsigned long n = strtoul(string, end, 10);
+    if(n > UINT_MAX)
+        return false;
+    *value = (unsigned) n;
+    return true;
+}
+
+bool filterWatchdogParseDeadlines(const char * string, unsigned * firstByte, unsigned * total, unsigned * perMiB) {
+    char * end;
+
+    *perMiB = 0;
+    if(!parseUnsigned(string, &end, firstByte) || *end != ',')
+        return false;
+    if(!parseUnsigned(end + 1, &end, total))
+        return false;
+    if(*end == ',' && !parseUnsigned(end + 1, &end, perMiB))
+        return false;
+    return *end == '\0';
+}
+
+bool filterWatchdogParseFallback(const char * string, filterWatchdogFallback * fallback) {
+    for(unsigned i = 0; i < sizeof(fallbackNames) / sizeof(fallbackNames[0]); i++) {
+        if(strcmp(string, fallbackNames[i]) == 0) {
+            *fallback = (filterWatchdogFallback) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void filterWatchdogStart(filterWatchdog * watchdog) {
+    filterWatchdogCollect(watchdog);
+    filterWatchdogLaunch(watchdog);
+}
+
+void filterWatchdogCollect(filterWatchdog * watchdog) {
+    watchdog->running = false;
+    watchdog->output  = false;
+    watchdog->fed     = 0;
+}
+
+void filterWatchdogLaunch(filterWatchdog * watchdog) {
+    watchdog->running = true;
+    clock_gettime(CLOCK_MONOTONIC, &watchdog->start);
+}
+
+void filterWatchdogFed(filterWatchdog * watchdog, const size_t length) {
+    watchdog->fed += length;
+}
+
+void filterWatchdogOutput(filterWatchdog * watchdog) {
+    struct timespec now;
+
+    if(!watchdog->running || watchdog->output)
+        return;
+    watchdog->output = true;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    histogramAdd(&watch.firstByteLatency, elapsedMicros(&watchdog->start, &now));
+}
+
+void filterWatchdogDone(filterWatchdog * watchdog) {
+    struct timespec now;
+
+    if(!watchdog->running)
+        return;
+    watchdog->running = false;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    histogramAdd(&watch.totalLatency, elapsedMicros(&watchdog->start, &now));
+}
+
+void filterWatchdogStop(filterWatchdog * watchdog) {
+    watchdog->running = false;
+}
+
+/** Milisegundos que faltan para `deadline', o 0 si ya venció. */
+static unsigned long long remainingUntil(const unsigned long long deadline, const unsigned long long elapsed) {
+    return (elapsed >= deadline)? 0 : deadline - elapsed;
+}
+
+filterWatchdogExpiry filterWatchdogCheck(const filterWatchdog * watchdog, const struct timespec * now, unsigned * remaining) {
+    unsigned long long next = 0, left;
+
+    *remaining = 0;
+    if(!watchdog->running)
+        return FILTER_WATCHDOG_RUNNING;
+    const unsigned long long elapsed = elapsedMicros(&watchdog->start, now) / 1000;
+
+    if(watch.firstByte > 0 && !watchdog->output) {
+        if((left = remainingUntil(watch.firstByte, elapsed)) == 0)
+            return FILTER_WATCHDOG_FIRST_BYTE;
+        next = left;
+    }
+    if(watch.total > 0) {
+        const unsigned long long deadline = watch.total + (unsigned long long) watch.perMiB * watchdog->fed / MIB;
+        if((left = remainingUntil(deadline, elapsed)) == 0)
+            return FILTER_WATCHDOG_TOTAL;
+        if(next == 0 || left < next)
+            next = left;
+    }
+    *remaining = (next > UINT_MAX)? UINT_MAX : (unsigned) next;
+    return FILTER_WATCHDOG_RUNNING;
+}
+
+filterWatchdogFallback filterWatchdogExpire(filterWatchdog * watchdog, const filterWatchdogExpiry expiry, const bool canPass) {
+    filterWatchdogFallback fallback = watch.fallback;
+
+    if(expiry == FILTER_WATCHDOG_FIRST_BYTE)
+        watch.expiredFirstByte++;
+    else
+        watch.expiredTotal++;
+    if(watchdog->output)
+        fallback = FILTER_FALLBACK_ERROR;
+    else if(fallback == FILTER_FALLBACK_PASS && !canPass)
+        fallback = FILTER_FALLBACK_REPLACE;
+    watch.applied[fallback]++;
+    watchdog->running = false;
+    return fallback;
+}
+
+double filterWatchdogFirstBytePercentile(const double percentile) {
+    return histogramPercentile(&watch.firstByteLatency, percentile);
+}
+
+double filterWatchdogTotalPercentile(const double percentile) {
+    return histogramPercentile(&watch.totalLatency, percentile);
+}
+
+size_t filterWatchdogStatistics(char * buffer, const size_t size) {
+    if(size == 0)
+        return 0;
+    const int n = snprintf(buffer, size, "filter watchdog: first-byte-ms %u total-ms %u per-mib-ms %u fallback %s "
+        "expired-first-byte %llu expired-total %llu pass %llu replace %llu error %llu "
+        "first-byte-p50-ms %.2f first-byte-p90-ms %.2f first-byte-p99-ms %.2f total-p50-ms %.2f total-p90-ms %.2f total-p99-ms %.2f\n",
+        watch.firstByte, watch.total, watch.perMiB, fallbackNames[watch.fallback],
+        watch.expiredFirstByte, watch.expiredTotal, watch.applied[FILTER_FALLBACK_PASS],
+        watch.applied[FILTER_FALLBACK_REPLACE], watch.applied[FILTER_FALLBACK_ERROR],
+        filterWatchdogFirstBytePercentile(50), filterWatchdogFirstBytePercentile(90), filterWatchdogFirstBytePercentile(99),
+        filterWatchdogTotalPercentile(50), filterWatchdogTotalPercentile(90), filterWatchdogTotalPercentile(99));
+    if(n < 0)
+        return 0;
+    return ((size_t) n >= size)? size - 1 : (size_t) n;
+}
+
+void filterWatchdogReset(void) {
+    watch.expiredFirstByte = 0;
+    watch.expiredTotal     = 0;
+    memset(watch.applied, 0, sizeof(watch.applied));
+    memset(&watch.firstByteLatency, 0, sizeof(watch.firstByteLatency));
+    memset(&watch.totalLatency, 0, sizeof(watch.totalLatency));
+}
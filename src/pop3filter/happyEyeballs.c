@@ -0,0 +1,141 @@
+/**
+ * happyEyeballs.c - orden y estado de los intentos de conexión en paralelo
+ *                   a las direcciones del origin (RFC 8305).
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "happyEyeballs.h"
+#include "netutils.h"
+
+typedef struct failedAddress {
+    bool                    used;
+    struct sockaddr_storage address;
+    time_t                  failedAt;
+} failedAddress;
+
+/** Solo se accede desde el hilo del multiplexor. */
+static struct {
+    failedAddress           addresses[HAPPY_EYEBALLS_FAILURES_SIZE];
+    unsigned long long      failures;
+    unsigned long long      deferred;
+} failures;
+
+static failedAddress * findFailure(const struct sockaddr * address) {
+    for(unsigned i = 0; i < HAPPY_EYEBALLS_FAILURES_SIZE; i++)
+        if(failures.addresses[i].used && sockaddrEquals((const struct sockaddr *) &failures.addresses[i].address, address))
+            return failures.addresses + i;
+    return NULL;
+}
+
+bool happyEyeballsRecentlyFailed(const struct sockaddr * address, const time_t now) {
+    failedAddress * failure = findFailure(address);
+    if(failure == NULL)
+        return false;
+    if(now - failure->failedAt >= HAPPY_EYEBALLS_FAILURE_TTL) {
+        failure->used = false;
+        return false;
+    }
+    return true;
+}
+
+void happyEyeballsFailed(const struct sockaddr * address, const time_t now) {
+    failedAddress * failure = findFailure(address);
+
+    failures.failures++;
+    for(unsigned i = 0; failure == NULL && i < HAPPY_EYEBALLS_FAILURES_SIZE; i++)
+        if(!failures.addresses[i].used)
+            failure = failures.addresses + i;
+    if(failure == NULL) {
+        failure = failures.addresses;
+        for(unsigned i = 1; i < HAPPY_EYEBALLS_FAILURES_SIZE; i++)
+            if(failures.addresses[i].failedAt < failure->failedAt)
+                failure = failures.addresses + i;
+    }
+
+    const size_t addressSize = (address->sa_family == AF_INET6)? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+    memset(&failure->address, 0, sizeof(failure->address));
+    memcpy(&failure->address, address, addressSize);
+    failure->used     = true;
+    failure->failedAt = now;
+}
+
+void happyEyeballsSucceeded(const struct sockaddr * address) {
+    failedAddress * failure = findFailure(address);
+    if(failure != NULL)
+        failure->used = false;
+}
+
+/**
+ * Agrega a `eyeballs' las direcciones de `indexes' intercalando familias,
+ * empezando por la familia de la primera.
+ */
+static void interleave(happyEyeballsStruct * eyeballs, const struct sockaddr_storage * addresses,
+                       const socklen_t * lengths, const size_t * indexes, const size_t size) {
+    bool   taken[RESOLVER_MAX_ADDRESSES] = { false };
+    size_t added = 0;
+
+    if(size == 0)
+        return;
+    sa_family_t family = addresses[indexes[0]].ss_family;
+    while(added < size) {
+        size_t i;
+        for(i = 0; i < size && (taken[i] || addresses[indexes[i]].ss_family != family); i++)
+            ;
+        /** No quedan de la familia buscada, se toma la siguiente en orden. */
+        if(i == size)
+            for(i = 0; taken[i]; i++)
+                ;
+        taken[i] = true;
+        family   = (addresses[indexes[i]].ss_family == AF_INET6)? AF_INET : AF_INET6;
+        memcpy(eyeballs->addresses + eyeballs->count, addresses + indexes[i], lengths[indexes[i]]);
+        eyeballs->lengths[eyeballs->count] = lengths[indexes[i]];
+        eyeballs->count++;
+        added++;
+    }
+}
+
+void happyEyeballsInit(happyEyeballsStruct * eyeballs, const struct sockaddr_storage * addresses,
+                       const socklen_t * lengths, const size_t count, const time_t now) {
+    size_t healthy[RESOLVER_MAX_ADDRESSES], healthySize = 0;
+    size_t failed[RESOLVER_MAX_ADDRESSES],  failedSize  = 0;
+
+    memset(eyeballs, 0, sizeof(*eyeballs));
+    eyeballs->timerFd = -1;
+    for(size_t i = 0; i < RESOLVER_MAX_ADDRESSES; i++)
+        eyeballs->fds[i] = -1;
+
+    for(size_t i = 0; i < count && i < RESOLVER_MAX_ADDRESSES; i++) {
+        if(happyEyeballsRecentlyFailed((const struct sockaddr *) (addresses + i), now))
+            failed[failedSize++] = i;
+        else
+            healthy[healthySize++] = i;
+    }
+    failures.deferred += failedSize;
+    interleave(eyeballs, addresses, lengths, healthy, healthySize);
+    interleave(eyeballs, addresses, lengths, failed, failedSize);
+}
+
+int happyEyeballsFind(const happyEyeballsStruct * eyeballs, const int fd) {
+    for(size_t i = 0; i < eyeballs->count; i++)
+        if(eyeballs->fds[i] == fd)
+            return (int) i;
+    return -1;
+}
+
+size_t happyEyeballsStatistics(char * buffer, const size_t size) {
+    unsigned remembered = 0;
+    const time_t now = time(NULL);
+
+    if(size == 0)
+        return 0;
+    for(unsigned i = 0; i < HAPPY_EYEBALLS_FAILURES_SIZE; i++)
+        if(failures.addresses[i].used && now - failures.addresses[i].failedAt < HAPPY_EYEBALLS_FAILURE_TTL)
+            remembered++;
+
+    const int n = snprintf(buffer, size, "origin connect: failures %llu deferred %llu failed-addresses %u\n",
+        failures.failures, failures.deferred, remembered);
+    if(n < 0)
+        return 0;
+    return ((size_t) n >= size)? size - 1 : (size_t) n;
+}
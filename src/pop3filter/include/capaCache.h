@@ -0,0 +1,48 @@
+#ifndef CAPA_CACHE_H
+#define CAPA_CACHE_H
+
+#include <stdbool.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include "capaParser.h"
+
+/**
+ * capaCache.h - cache de las capacidades de cada origin server.
+ *
+ * Las entradas se identifican por la dirección resuelta del origin (host y
+ * puerto) y vencen luego de `ttl' segundos. Cuando el cache está lleno se
+ * reemplaza la entrada más antigua.
+ */
+
+/** Cantidad de origins distintos que se recuerdan. */
+#define CAPA_CACHE_SIZE 16
+
+typedef struct capaCacheCDT * capaCacheADT;
+
+capaCacheADT createCapaCache(const time_t ttl);
+
+void deleteCapaCache(capaCacheADT cache);
+
+/**
+ * Busca las capacidades del origin. Retorna false si no están o vencieron.
+ */
+bool capaCacheGet(capaCacheADT cache, const struct sockaddr * origin, const time_t now, capabilities * capas);
+
+/** Guarda las capacidades obtenidas del origin. */
+void capaCachePut(capaCacheADT cache, const struct sockaddr * origin, const capabilities * capas, const time_t now);
+
+/** Descarta todas las entradas. */
+void capaCacheInvalidate(capaCacheADT cache);
+
+unsigned long long capaCacheHits(capaCacheADT cache);
+
+unsigned long long capaCacheMisses(capaCacheADT cache);
+
+/**
+ * Escribe en `buffer' las estadísticas del cache en texto (una linea).
+ * Retorna la cantidad de bytes escritos.
+ */
+size_t capaCacheStatistics(capaCacheADT cache, char * buffer, const size_t size);
+
+#endif
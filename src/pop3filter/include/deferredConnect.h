@@ -0,0 +1,63 @@
+#ifndef DEFERRED_CONNECT_H
+#define DEFERRED_CONNECT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * deferredConnect.h - atención del cliente en el modo de conexión diferida,
+ * antes de elegir el origin server.
+ *
+ * Guarda la última respuesta completa a CAPA de cada origin. Con varios
+ * origins el que atiende a la sesión se elige recién al conectar (por
+ * ejemplo según el usuario), así que CAPA solo se contesta sin conectar si
+ * todos los origins dieron la misma respuesta: de lo contrario el cliente
+ * podría ver capacidades, como PIPELINING, de un origin que no es el suyo.
+ */
+
+typedef struct deferredCapaCDT * deferredCapaADT;
+
+/** Qué hacer con una linea del cliente antes de conectar. */
+typedef enum deferredAction {
+    /** Contestar `answer' y seguir esperando. */
+    DEFERRED_ANSWER,
+    /** Contestar `answer' y cerrar la sesión. */
+    DEFERRED_QUIT,
+    /** Contestar `answer' y recordar que el cliente usa APOP. */
+    DEFERRED_APOP,
+    /** Conectar al origin y reenviarle la linea. */
+    DEFERRED_CONNECT,
+} deferredAction;
+
+/** `origins' es la cantidad de origin servers. */
+deferredCapaADT createDeferredCapa(const size_t origins);
+
+void deleteDeferredCapa(deferredCapaADT capa);
+
+/** Guarda la respuesta positiva a CAPA del origin `origin'. */
+void deferredCapaPut(deferredCapaADT capa, const size_t origin, const uint8_t * response, const size_t length);
+
+/** Descarta las respuestas guardadas. */
+void deferredCapaInvalidate(deferredCapaADT capa);
+
+/**
+ * Retorna la respuesta a CAPA que vale para cualquier origin, o NULL si
+ * falta la de alguno o no coinciden.
+ */
+const uint8_t * deferredCapaAnswer(const deferredCapaADT capa, size_t * length);
+
+/**
+ * Decide qué hacer con la linea completa `line' del cliente. Salvo con
+ * DEFERRED_CONNECT completa `answer' y `answerLength'. `capa' puede ser
+ * NULL.
+ */
+deferredAction deferredLineAction(const deferredCapaADT capa, const uint8_t * line, const size_t length,
+                                  const uint8_t ** answer, size_t * answerLength);
+
+/**
+ * Copia en `name' (de `size' bytes, terminado en 0) el argumento de la
+ * linea USER `line'.
+ */
+void deferredUsername(const uint8_t * line, const size_t length, char * name, const size_t size);
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef FILTER_BYPASS_H
+#define FILTER_BYPASS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * filterBypass.h - RETR que se envían sin pasar por el filtro.
+ *
+ * Antes de iniciar el filtro se leen los headers del mensaje y, si es
+ * multipart, las lineas de boundary y los headers de cada parte. Si ninguna
+ * parte tiene un media type del media range el filtro no censuraría nada, y
+ * el mensaje se envía al cliente tal como lo envió el origin, sin lanzar el
+ * filtro. Solo es válido con filtros que censuran por media type.
+ *
+ * Ante cualquier duda se filtra: un Content-Type que no se puede leer o no
+ * entra en FILTER_SNIFF_HEADER_SIZE, un multipart sin boundary, más de
+ * FILTER_SNIFF_DEPTH multiparts anidados o una parte message/ (los
+ * mensajes adjuntos no se recorren). Una parte sin Content-Type es
+ * text/plain, o message/rfc822 dentro de un multipart/digest.
+ */
+
+/** Tamaño máximo de un header, con sus lineas de continuación. */
+#define FILTER_SNIFF_HEADER_SIZE 1024
+/** Tamaño máximo de un boundary (RFC 2046 Sec 5.1.1). */
+#define FILTER_SNIFF_BOUNDARY_SIZE 70
+/** Cantidad máxima de multiparts anidados. */
+#define FILTER_SNIFF_DEPTH 8
+
+typedef enum filterSniffDecision {
+    /** Todavía no se leyó lo suficiente del mensaje. */
+    FILTER_SNIFF_PENDING,
+    /** Ninguna parte está en el media range, no hace falta filtrar. */
+    FILTER_SNIFF_BYPASS,
+    /** Alguna parte puede estar en el media range. */
+    FILTER_SNIFF_FILTER,
+} filterSniffDecision;
+
+/** Boundary de un multipart abierto. */
+typedef struct filterSniffBoundary {
+    char                    value[FILTER_SNIFF_BOUNDARY_SIZE];
+    size_t                  length;
+    /** Es un multipart/digest: sus partes son message/rfc822 por defecto. */
+    bool                    digest;
+} filterSniffBoundary;
+
+/**
+ * Lector incremental del cuerpo de un RETR, tal como lo envía el origin
+ * (con dot-stuffing).
+ */
+typedef struct filterSniffer {
+    filterSniffDecision     decision;
+    /** Se leen los headers de una parte (o del mensaje). */
+    bool                    headers;
+    /** Header actual, sin el fin de linea de sus lineas. */
+    char                    field[FILTER_SNIFF_HEADER_SIZE];
+    size_t                  fieldLength;
+    bool                    fieldOverflow;
+    /** Linea actual del cuerpo de una parte, solo para buscar boundaries. */
+    char                    line[FILTER_SNIFF_BOUNDARY_SIZE + 8];
+    size_t                  lineLength;
+    bool                    lineOverflow;
+    /** Se está al comienzo de una linea. */
+    bool                    lineStart;
+    /** La linea actual empieza con un '.' de dot-stuffing (o es la de terminación). */
+    bool                    lineDot;
+    /** Datos del Content-Type de la parte actual. */
+    bool                    typed;
+    bool                    multipart;
+    bool                    digest;
+    filterSniffBoundary     boundary;
+    /** Multiparts abiertos, el último es el más interno. */
+    filterSniffBoundary     stack[FILTER_SNIFF_DEPTH];
+    size_t                  depth;
+} filterSniffer;
+
+/** Prepara `sniffer' para el cuerpo de un nuevo RETR. */
+void filterSnifferInit(filterSniffer * sniffer);
+
+/**
+ * Lee `length' bytes más del cuerpo y retorna la decisión, que una vez
+ * tomada no cambia. Llegar a la linea de terminación sin encontrar una parte
+ * en `mediaRange' es FILTER_SNIFF_BYPASS. Sin media range se filtra.
+ */
+filterSniffDecision filterSnifferConsume(filterSniffer * sniffer, const char * mediaRange, const uint8_t * data, const size_t length);
+
+/**
+ * Indica si `type'/`subtype' está en `mediaRange', una lista de media types
+ * separados por ',' en la que '*' acepta cualquier tipo o subtipo. Sin
+ * distinguir mayúsculas, los parámetros se ignoran. Una entrada sin '/'
+ * acepta cualquier media type.
+ */
+bool filterMediaRangeMatches(const char * mediaRange, const char * type, const size_t typeLength,
+                             const char * subtype, const size_t subtypeLength);
+
+/** Cuenta un RETR enviado sin filtrar (`bypassed') o filtrado tras leerlo. */
+void filterBypassRecord(const bool bypassed, const size_t sniffedBytes);
+
+/**
+ * Escribe en `buffer' los mensajes enviados sin filtrar y los filtrados.
+ * Retorna los bytes escritos.
+ */
+size_t filterBypassStatistics(char * buffer, const size_t size);
+
+#endif
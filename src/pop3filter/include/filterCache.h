@@ -0,0 +1,116 @@
+#ifndef FILTER_CACHE_H
+#define FILTER_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sha256.h"
+
+/**
+ * filterCache.h - cache de la salida del filtro para cada mensaje.
+ *
+ * Las entradas se identifican por el SHA-256 del cuerpo que envió el
+ * origin, su largo y un hash de todo lo que recibe el filtro además del cuerpo:
+ * comando, media types, mensaje de reemplazo y servidores con sus etags, y
+ * el usuario y el origin server de la sesión. Se asume que el filtro es
+ * determinístico para un mismo cuerpo y entorno; como el entorno incluye
+ * al usuario, dos usuarios nunca comparten una entrada. El hash FNV-1a del
+ * cuerpo solo elige la lista del índice: un acierto exige el mismo SHA-256,
+ * así un cuerpo armado para chocar con otro no recibe la salida ajena.
+ *
+ * Las entradas viven en memoria mientras entren en `memoryLimit' bytes, la
+ * menos usada recientemente pasa al disco si se indicó un directorio o se
+ * descarta. Las entradas del disco se leen con read y vuelven a memoria al
+ * ser usadas; las menos usadas se borran al superar `diskLimit' bytes.
+ * Los cuerpos y salidas que juntan las sesiones para el cache se reservan
+ * con filterCacheSpoolReserve: entre todas usan a lo sumo `memoryLimit'.
+ * Solo se accede desde el hilo del multiplexor.
+ */
+
+/** Cantidad de listas del índice de entradas. */
+#define FILTER_CACHE_BUCKETS 1024
+/** Una entrada puede ocupar como máximo esta fracción de la memoria. */
+#define FILTER_CACHE_ENTRY_FRACTION 4
+/** Valor inicial del hash de un cuerpo o configuración. */
+#define FILTER_CACHE_HASH_SEED 0xcbf29ce484222325ULL
+
+typedef struct filterCacheCDT * filterCacheADT;
+
+typedef struct filterCacheKey {
+    /** Hash FNV-1a de los bytes del cuerpo tal como los envió el origin. */
+    uint64_t                body;
+    /** SHA-256 de los mismos bytes. */
+    uint8_t                 digest[SHA256_DIGEST_SIZE];
+    /** Hash de la configuración del filtro. */
+    uint64_t                config;
+    size_t                  length;
+} filterCacheKey;
+
+/** Bytes acumulados por una sesión. */
+typedef struct filterCacheBytes {
+    uint8_t *               data;
+    size_t                  length;
+    size_t                  capacity;
+} filterCacheBytes;
+
+/**
+ * Crea el cache. Si `directory' es NULL no hay nivel en disco. Retorna
+ * NULL si `memoryLimit' es 0 o el directorio no es accesible.
+ */
+filterCacheADT createFilterCache(const size_t memoryLimit, const char * directory, const size_t diskLimit);
+
+/** Libera el cache y borra sus archivos. */
+void deleteFilterCache(filterCacheADT cache);
+
+/** Tamaño máximo de la salida (y del cuerpo) que se guarda. */
+size_t filterCacheMaxEntry(filterCacheADT cache);
+
+/** Continúa el hash `hash' con `length' bytes de `data'. */
+uint64_t filterCacheHash(uint64_t hash, const uint8_t * data, const size_t length);
+
+/**
+ * Agrega al hash de configuración `config' el usuario y el origin server
+ * de la sesión, que el filtro recibe en POP3_USERNAME y POP3_SERVER.
+ * `username' o `origin' pueden ser NULL.
+ */
+uint64_t filterCacheSessionConfig(const uint64_t config, const char * username, const char * origin);
+
+/**
+ * Copia en `output' la salida guardada para `key'. Retorna false, sin
+ * modificar `output', si no está.
+ */
+bool filterCacheGet(filterCacheADT cache, const filterCacheKey * key, filterCacheBytes * output);
+
+/** Guarda una copia de la salida del filtro para `key'. */
+void filterCachePut(filterCacheADT cache, const filterCacheKey * key, const uint8_t * data, const size_t length);
+
+/** Un cuerpo no se pudo guardar por superar filterCacheMaxEntry. */
+void filterCacheOversized(filterCacheADT cache);
+
+/**
+ * Reserva `length' bytes de la memoria que comparten las sesiones para
+ * juntar cuerpos y salidas. Retorna false, sin reservar, si el total de
+ * las sesiones superaría el límite de memoria del cache.
+ */
+bool filterCacheSpoolReserve(filterCacheADT cache, const size_t length);
+
+/** Devuelve `length' bytes reservados con filterCacheSpoolReserve. */
+void filterCacheSpoolRelease(filterCacheADT cache, const size_t length);
+
+/**
+ * Escribe en `buffer' las estadísticas del cache en texto (una linea).
+ * Retorna la cantidad de bytes escritos.
+ */
+size_t filterCacheStatistics(filterCacheADT cache, char * buffer, const size_t size);
+
+/**
+ * Agrega `length' bytes al final de `bytes'. Retorna false, sin agregar
+ * nada, si el total superaría `limit'.
+ */
+bool filterCacheBytesAppend(filterCacheBytes * bytes, const uint8_t * data, const size_t length, const size_t limit);
+
+/** Libera los bytes acumulados. */
+void filterCacheBytesFree(filterCacheBytes * bytes);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef FILTER_LIMIT_H
+#define FILTER_LIMIT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+/**
+ * filterLimit.h - límite de filtros externos ejecutándose a la vez.
+ *
+ * Cada RETR filtrado por un comando externo (o un worker del pool) ocupa un
+ * lugar desde que se inicia el filtro hasta que se cierra. Con todos los
+ * lugares ocupados la sesión espera en una cola FIFO y, al liberarse un
+ * lugar, se admite a la primera y se la despierta con su `wake'. El máximo
+ * se puede cambiar en ejecución; con 0 no hay límite. Solo se accede desde
+ * el hilo del multiplexor.
+ */
+
+typedef void (*filterLimitWake)(void * data);
+
+/**
+ * Lugar de una sesión en el límite. Se guarda en la sesión, fuera de la
+ * cola no ocupa memoria.
+ */
+typedef struct filterLimitWaiter {
+    struct filterLimitWaiter *  next;
+    struct filterLimitWaiter *  prev;
+    /** Espera en la cola. */
+    bool                        queued;
+    /** Ocupa un lugar. */
+    bool                        admitted;
+    /** Momento en que entró a la cola. */
+    struct timespec             since;
+    filterLimitWake             wake;
+    void *                      data;
+} filterLimitWaiter;
+
+/**
+ * Cambia la cantidad máxima de filtros a la vez, 0 es sin límite. Si hay
+ * más lugares se admiten (y despiertan) las sesiones en espera.
+ */
+void filterLimitSetMax(const size_t max);
+
+size_t filterLimitMax(void);
+
+/** Cantidad de filtros que ocupan un lugar. */
+size_t filterLimitActive(void);
+
+/** Cantidad de sesiones en la cola. */
+size_t filterLimitQueued(void);
+
+/**
+ * Pide un lugar para `waiter'. Retorna true si lo ocupa (ya lo tenía o había
+ * uno libre). Si no, queda en la cola, o sigue en ella, y se llama a
+ * `wake' con `data' cuando se lo admite.
+ */
+bool filterLimitAcquire(filterLimitWaiter * waiter, const filterLimitWake wake, void * data);
+
+/**
+ * Libera el lugar de `waiter' o lo saca de la cola. Si se liberó un lugar
+ * se admite a la primera sesión en espera. No hace nada si `waiter' no
+ * ocupa un lugar ni espera.
+ */
+void filterLimitRelease(filterLimitWaiter * waiter);
+
+/**
+ * Escribe en `buffer' los filtros activos, la cola y el tiempo de espera.
+ * Retorna los bytes escritos.
+ */
+size_t filterLimitStatistics(char * buffer, const size_t size);
+
+#endif
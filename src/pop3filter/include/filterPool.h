@@ -0,0 +1,105 @@
+#ifndef FILTER_POOL_H
+#define FILTER_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "multiplexor.h"
+#include "filterFrame.h"
+
+/**
+ * filterPool.h - procesos de filtro persistentes para los RETR filtrados.
+ *
+ * Cada worker está conectado al proxy por un socketpair y atiende un
+ * mensaje tras otro con el protocolo de filterFrame.h: el proxy envía un
+ * header y luego el cuerpo tal como lo envió el origin; el worker responde
+ * la salida con dot-stuffing, terminada en ".\r\n". El header lleva
+ * FILTER_FRAME_COMMAND y FILTER_FRAME_ERROR_FILE, el comando y el archivo de
+ * stderr, y las variables de entorno del comando.
+ *
+ * En modo nativo el worker es el mismo comando de filtro, lanzado con
+ * `/bin/sh -c' una sola vez, que implementa el protocolo. En modo de
+ * compatibilidad es un filterWrapper que ejecuta el comando por mensaje con
+ * el mismo contrato que sin pool.
+ *
+ * Se lanzan FILTER_POOL_PREFORK workers al iniciar y se agregan a medida que
+ * hay más mensajes filtrándose a la vez, hasta el máximo configurado; con
+ * todos ocupados el mensaje se filtra sin pool. Los workers libres se
+ * vigilan en el multiplexor: uno que termina se reemplaza en el momento,
+ * salvo que ya se hubiera reemplazado hace menos de
+ * FILTER_POOL_RESPAWN_INTERVAL, en cuyo caso se lanza al volver a usarlo.
+ * También se reemplaza uno cuyo mensaje se abandona. Solo se accede desde
+ * el hilo del multiplexor.
+ */
+
+/** Ejecutable de los workers de compatibilidad, relativo al directorio de trabajo. */
+#define FILTER_WRAPPER_PATH "./Proxy/FilterWrapper/filterWrapper.out"
+/** Cantidad de workers que se lanzan al iniciar (como mucho el máximo). */
+#define FILTER_POOL_PREFORK 2
+/** Segundos entre dos reemplazos inmediatos de un mismo worker. */
+#define FILTER_POOL_RESPAWN_INTERVAL 1
+
+/**
+ * Busca la linea de terminación en la salida de un worker. La salida tiene
+ * dot-stuffing, por lo que solo la linea de terminación es ".\r\n".
+ */
+typedef struct filterPoolScanner {
+    unsigned            state;
+    bool                done;
+} filterPoolScanner;
+
+/**
+ * Lanza los primeros workers del pool, que crece hasta `maxWorkers'. Con
+ * `nativeCommand' NULL los workers son el filterWrapper de `wrapperPath';
+ * si no, ese comando, con stderr en `errorFile'. Los workers libres se
+ * vigilan en `mux', que puede ser NULL. Con `maxWorkers' 0 no hay pool.
+ * Retorna false si no se pudo reservar memoria.
+ */
+bool filterPoolInit(MultiplexorADT mux, const char * wrapperPath, const char * nativeCommand,
+                    const char * errorFile, const size_t maxWorkers);
+
+/** Termina los workers y libera el pool. */
+void filterPoolDestroy(void);
+
+/**
+ * Toma un worker libre (o lanza uno nuevo) y le envía `header'. Si
+ * `nativeCommand' o `errorFile' no son los de los workers, estos se
+ * reemplazan. Retorna el fd del worker, que sigue siendo del pool, y en
+ * `worker' su número; o -1 si no hay pool o no hay workers disponibles.
+ */
+int filterPoolAcquire(const char * nativeCommand, const char * errorFile, const uint8_t * header,
+                      const size_t length, size_t * worker);
+
+/** Pid del proceso del worker. */
+pid_t filterPoolWorkerPid(const size_t worker);
+
+/**
+ * Devuelve el worker al pool. Si `completed' es false (el mensaje no llegó a
+ * su linea de terminación) o cambió el comando, el worker se reemplaza.
+ */
+void filterPoolRelease(const size_t worker, const bool completed);
+
+/**
+ * Arma en `header' un header con las `count' entradas `names'/`values'.
+ * Los valores NULL se omiten. Retorna el largo, o 0 si no entra en `size'.
+ */
+size_t filterPoolHeader(uint8_t * header, const size_t size, const char * const names[], const char * const values[], const size_t count);
+
+/** Inicia la búsqueda de la linea de terminación de una salida nueva. */
+void filterPoolScannerInit(filterPoolScanner * scanner);
+
+/**
+ * Procesa `length' bytes de la salida. Retorna true si con ellos se completó
+ * la linea de terminación.
+ */
+bool filterPoolScannerConsume(filterPoolScanner * scanner, const uint8_t * data, const size_t length);
+
+/**
+ * Escribe en `buffer' las estadísticas del pool y de cada worker en texto.
+ * Retorna la cantidad de bytes escritos.
+ */
+size_t filterPoolStatistics(char * buffer, const size_t size);
+
+#endif
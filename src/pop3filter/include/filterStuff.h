@@ -0,0 +1,78 @@
+#ifndef FILTER_STUFF_H
+#define FILTER_STUFF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "buffer.h"
+#include "bodyPop3Parser.h"
+#include "filterCache.h"
+
+/**
+ * filterStuff.h - dot-stuffing de la entrada y la salida de un filtro.
+ *
+ * El cuerpo de un RETR se le entrega al filtro sin dot-stuffing y sin la
+ * linea de terminación. La salida del filtro se guarda con dot-stuffing,
+ * con "\r\n" como fin de linea, y se le agrega la linea de terminación.
+ */
+
+typedef struct filterStuffStruct {
+    /** Quita el dot-stuffing del cuerpo. */
+    bodyPop3Parser      parser;
+    /** Cuerpo sin dot-stuffing que el comando externo todavía no aceptó. */
+    filterCacheBytes    input;
+    size_t              inputSent;
+    /** El comando cerró su entrada, el resto del cuerpo se descarta. */
+    bool                inputClosed;
+    filterCacheBytes    output;
+    /** La salida está al comienzo de una linea. */
+    bool                lineStart;
+    /** El último byte de la salida fue un '\r'. */
+    bool                lastCR;
+    /** No hubo memoria para la salida, se descarta el resto del cuerpo. */
+    bool                outputFailed;
+    /** Llegó todo el cuerpo y `output' termina en la linea de terminación. */
+    bool                complete;
+} filterStuffStruct;
+
+/** Prepara `stuff' para un cuerpo nuevo, conservando la memoria reservada. */
+void filterStuffReset(filterStuffStruct * stuff);
+
+/** Libera la memoria de `stuff'. */
+void filterStuffFree(filterStuffStruct * stuff);
+
+/**
+ * Quita el dot-stuffing de los bytes del cuerpo que entran en `body', que
+ * necesita un byte más que lo que se copia. Retorna cuántos se consumieron.
+ * Terminado el cuerpo, o si es inválido, el resto se consume sin copiarlo.
+ */
+size_t filterUnstuff(filterStuffStruct * stuff, bufferADT body, const uint8_t * data, const size_t length);
+
+/**
+ * Escribe en `fd', la entrada del comando de filtro, los bytes del cuerpo
+ * sin dot-stuffing. Primero se envía lo que el comando no aceptó antes; lo
+ * que no acepta ahora queda para la próxima. Si el comando cerró su
+ * entrada el resto del cuerpo se consume sin enviarlo. Retorna cuántos
+ * bytes del cuerpo se consumieron.
+ */
+size_t filterStuffToCommand(filterStuffStruct * stuff, bufferADT body, const int fd, const uint8_t * data, const size_t length);
+
+/**
+ * Agrega a la salida, con dot-stuffing, bytes del filtro. A un '\n' sin
+ * '\r' le agrega "\r\n". Recibe un filterStuffStruct, para usarse como
+ * writer del stripmime.
+ */
+void filterStuffWriter(const uint8_t * data, const size_t length, void * writerData);
+
+/** Termina la salida con la linea de terminación. */
+void filterStuffEnd(filterStuffStruct * stuff);
+
+/**
+ * Agrega a la salida lo que leyó del comando de filtro; al terminar la
+ * salida (`length' 0) la termina.
+ */
+void filterStuffOutput(filterStuffStruct * stuff, const uint8_t * data, const size_t length);
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef FILTER_WATCHDOG_H
+#define FILTER_WATCHDOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+/**
+ * filterWatchdog.h - plazos para la salida del filtro externo.
+ *
+ * Desde que se inicia el filtro de un RETR se mide cuánto tarda en dar el
+ * primer byte de salida y en terminar; en modo batch, desde que se lanza
+ * con el cuerpo completo. El plazo total crece con los bytes
+ * del cuerpo entregados al filtro, así un mensaje grande no vence como uno
+ * chico. Al vencer un plazo el proxy mata el filtro y sigue según el
+ * fallback configurado. Las latencias se guardan en histogramas de los
+ * que se obtienen percentiles. Solo se accede desde el hilo del
+ * multiplexor.
+ */
+
+/** Cantidad de intervalos del histograma, 4 por potencia de 2 de microsegundos. */
+#define FILTER_WATCHDOG_BUCKETS 128
+
+/** Máximo del cuerpo que se guarda para enviarlo sin filtrar si vence un plazo. */
+#define FILTER_WATCHDOG_RETAIN_SIZE (4 * 1024 * 1024)
+
+/** Qué se envía al cliente cuando vence un plazo del filtro. */
+typedef enum filterWatchdogFallback {
+    /** El cuerpo sin filtrar. */
+    FILTER_FALLBACK_PASS,
+    /** Un -ERR y se cierra la sesión, el +OK ya se envió. */
+    FILTER_FALLBACK_ERROR,
+    /** El mensaje de reemplazo en lugar del cuerpo. */
+    FILTER_FALLBACK_REPLACE,
+} filterWatchdogFallback;
+
+typedef enum filterWatchdogExpiry {
+    FILTER_WATCHDOG_RUNNING,
+    FILTER_WATCHDOG_FIRST_BYTE,
+    FILTER_WATCHDOG_TOTAL,
+} filterWatchdogExpiry;
+
+/** Filtro de un RETR bajo vigilancia. Se guarda en la sesión. */
+typedef struct filterWatchdog {
+    /** Se inició el filtro y no terminó. */
+    bool                running;
+    /** El filtro ya dio salida. */
+    bool                output;
+    struct timespec     start;
+    /** Bytes del cuerpo entregados al filtro. */
+    size_t              fed;
+} filterWatchdog;
+
+/**
+ * Cambia los plazos en milisegundos: hasta el primer byte de salida y
+ * total, más `perMiB' por cada MiB entregado al filtro. 0 no tiene plazo.
+ */
+void filterWatchdogSetDeadlines(const unsigned firstByte, const unsigned total, const unsigned perMiB);
+
+void filterWatchdogSetFallback(const filterWatchdogFallback fallback);
+
+filterWatchdogFallback filterWatchdogGetFallback(void);
+
+/** Indica si hay algún plazo configurado. */
+bool filterWatchdogEnabled(void);
+
+/**
+ * Lee "<primer-byte>,<total>[,<por-MiB>]". Retorna false si el formato es
+ * inválido.
+ */
+bool filterWatchdogParseDeadlines(const char * string, unsigned * firstByte, unsigned * total, unsigned * perMiB);
+
+/** Lee "pass", "error" o "replace". Retorna false si no es ninguno. */
+bool filterWatchdogParseFallback(const char * string, filterWatchdogFallback * fallback);
+
+/** Comienza a medir el filtro de un RETR. */
+void filterWatchdogStart(filterWatchdog * watchdog);
+
+/**
+ * Prepara la medición de un filtro que se lanza después de juntar el
+ * cuerpo (modo batch): cuenta los bytes entregados pero los plazos no
+ * corren hasta filterWatchdogLaunch.
+ */
+void filterWatchdogCollect(filterWatchdog * watchdog);
+
+/** Se lanzó el filtro: los plazos y las latencias se miden desde ahora. */
+void filterWatchdogLaunch(filterWatchdog * watchdog);
+
+/** Se entregaron `length' bytes del cuerpo al filtro. */
+void filterWatchdogFed(filterWatchdog * watchdog, const size_t length);
+
+/** El filtro dio salida. La primera vez se guarda la latencia del primer byte. */
+void filterWatchdogOutput(filterWatchdog * watchdog);
+
+/** El filtro terminó su salida. Guarda la latencia total. */
+void filterWatchdogDone(filterWatchdog * watchdog);
+
+/** Deja de medir sin guardar la latencia, el filtro se cerró por otro motivo. */
+void filterWatchdogStop(filterWatchdog * watchdog);
+
+/**
+ * Revisa los plazos en `now'. Si ninguno venció guarda en `remaining' los
+ * milisegundos hasta el más próximo, 0 si no hay.
+ */
+filterWatchdogExpiry filterWatchdogCheck(const filterWatchdog * watchdog, const struct timespec * now, unsigned * remaining);
+
+/**
+ * Registra el vencimiento y deja de medir. Retorna el fallback a aplicar:
+ * si el filtro ya dio salida el cuerpo no se puede completar y es
+ * FILTER_FALLBACK_ERROR, y sin el cuerpo guardado (`canPass') pass pasa a
+ * ser replace.
+ */
+filterWatchdogFallback filterWatchdogExpire(filterWatchdog * watchdog, const filterWatchdogExpiry expiry, const bool canPass);
+
+/** Percentil `percentile' (0 a 100) de la latencia, en milisegundos. */
+double filterWatchdogFirstBytePercentile(const double percentile);
+
+double filterWatchdogTotalPercentile(const double percentile);
+
+/**
+ * Escribe en `buffer' los plazos, los vencimientos y los percentiles de
+ * latencia. Retorna los bytes escritos.
+ */
+size_t filterWatchdogStatistics(char * buffer, const size_t size);
+
+/** Vacía los histogramas y contadores. */
+void filterWatchdogReset(void);
+
+#endif
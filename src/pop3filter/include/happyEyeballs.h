@@ -0,0 +1,66 @@
+#ifndef HAPPY_EYEBALLS_H
+#define HAPPY_EYEBALLS_H
+
+#include <stdbool.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include "resolver.h"
+
+/**
+ * happyEyeballs.h - orden y estado de los intentos de conexión en paralelo
+ *                   a las direcciones del origin (RFC 8305).
+ *
+ * Las direcciones se intercalan por familia empezando por la primera que
+ * devolvió el resolver. Las que fallaron hace menos de
+ * HAPPY_EYEBALLS_FAILURE_TTL segundos se dejan al final. Cada intento se
+ * inicia HAPPY_EYEBALLS_ATTEMPT_DELAY_MS milisegundos después del anterior,
+ * o apenas falla el anterior.
+ */
+
+/** Demora entre el inicio de dos intentos de conexión. */
+#define HAPPY_EYEBALLS_ATTEMPT_DELAY_MS 250
+/** Segundos durante los que se recuerda una dirección que falló. */
+#define HAPPY_EYEBALLS_FAILURE_TTL 30
+/** Cantidad de direcciones fallidas que se recuerdan. */
+#define HAPPY_EYEBALLS_FAILURES_SIZE 32
+
+typedef struct happyEyeballsStruct {
+    struct sockaddr_storage addresses[RESOLVER_MAX_ADDRESSES];
+    socklen_t               lengths[RESOLVER_MAX_ADDRESSES];
+    /** Socket del intento de cada dirección, -1 si no hay uno en curso. */
+    int                     fds[RESOLVER_MAX_ADDRESSES];
+    size_t                  count;
+    /** Siguiente dirección a intentar. */
+    size_t                  next;
+    /** Cantidad de intentos en curso. */
+    size_t                  pending;
+    /** timerfd que marca el próximo intento, -1 si no se creó. */
+    int                     timerFd;
+} happyEyeballsStruct;
+
+/**
+ * Ordena las direcciones para intentar la conexión. Las direcciones que no
+ * entran se descartan.
+ */
+void happyEyeballsInit(happyEyeballsStruct * eyeballs, const struct sockaddr_storage * addresses,
+                       const socklen_t * lengths, const size_t count, const time_t now);
+
+/** Retorna el índice del intento cuyo socket es `fd', o -1. */
+int happyEyeballsFind(const happyEyeballsStruct * eyeballs, const int fd);
+
+/** Recuerda que no se pudo conectar a `address'. */
+void happyEyeballsFailed(const struct sockaddr * address, const time_t now);
+
+/** Olvida un fallo anterior de `address'. */
+void happyEyeballsSucceeded(const struct sockaddr * address);
+
+bool happyEyeballsRecentlyFailed(const struct sockaddr * address, const time_t now);
+
+/**
+ * Escribe en `buffer' las estadísticas de las conexiones en texto (una linea).
+ * Retorna la cantidad de bytes escritos.
+ */
+size_t happyEyeballsStatistics(char * buffer, const size_t size);
+
+#endif
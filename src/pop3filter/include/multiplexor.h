@@ -3,6 +3,7 @@
 #define MULTIPLEXOR_H
 
 #include <sys/time.h>
+#include <sys/socket.h>
 #include <stdbool.h>
 #include <stdlib.h>
 
@@ -68,12 +69,28 @@ multiplexorStatus setInterest(MultiplexorADT mux, int fd, fdInterest interest);
 
 multiplexorStatus setInterestKey(MultiplexorKey key, fdInterest interest);
 
+/**
+ * Pide que se llame al handler `block' de `fd' en el hilo principal. Se
+ * puede llamar desde cualquier hilo y no reserva memoria. Varias
+ * notificaciones a un fd antes de atenderlas producen una sola llamada, y
+ * las pendientes se descartan al desregistrar el fd.
+ */
 multiplexorStatus notifyBlock(MultiplexorADT  mux, const int fd);
 
 multiplexorStatus muxSelect(MultiplexorADT mux);
 
 int fdSetNIO(const int fd);
 
+/** Marca el descriptor para que no lo hereden los procesos que se ejecutan. */
+int fdSetCloexec(const int fd);
+
+/**
+ * Acepta una conexión de `fd' ya no bloqueante y con CLOEXEC, con accept4
+ * para que ningún hijo lanzado mientras tanto la herede. Retorna -1 si
+ * falla.
+ */
+int fdAccept(const int fd, struct sockaddr * address, socklen_t * length);
+
 void checkTimeout(MultiplexorADT mux);
 
 #endif
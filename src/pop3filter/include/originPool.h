@@ -0,0 +1,75 @@
+#ifndef ORIGIN_POOL_H
+#define ORIGIN_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "multiplexor.h"
+#include "netutils.h"
+#include "capaParser.h"
+
+/**
+ * originPool.h - pool de conexiones "tibias" con un origin server.
+ *
+ * Cada conexión del pool ya leyó el saludo del origin y la respuesta a CAPA,
+ * por lo que un cliente nuevo puede pasar directo a COPY sin esperar los
+ * round trips de CONNECTING, HELLO y CHECK_CAPABILITIES.
+ *
+ * El tamaño objetivo del pool se calcula a partir de la tasa de accepts
+ * reciente (acotado por el máximo configurado) y las conexiones que superan
+ * la edad máxima de inactividad se descartan para no entregar sockets que el
+ * origin ya cerró por timeout.
+ */
+
+/** Segundos de inactividad tras los cuales se descarta una conexión del pool. */
+#define ORIGIN_POOL_MAX_IDLE_AGE 30
+/** Tamaño máximo del saludo del origin que se guarda para el cliente. */
+#define ORIGIN_POOL_GREETING_SIZE 512
+
+typedef struct originPoolCDT * originPoolADT;
+
+/**
+ * Conexión entregada por el pool. El fd ya no está registrado en el
+ * multiplexor y pasa a ser responsabilidad de quien lo recibe.
+ */
+typedef struct pooledOrigin {
+    int                 fd;
+    uint8_t             greeting[ORIGIN_POOL_GREETING_SIZE];
+    size_t              greetingLength;
+    capabilities        capabilities;
+} pooledOrigin;
+
+/**
+ * Crea un pool para el origin indicado. Si la dirección es un nombre, el
+ * pool no abre conexiones hasta recibir una dirección con
+ * `originPoolSetAddress'.
+ */
+originPoolADT createOriginPool(MultiplexorADT mux, const addressData * origin, const size_t maxSize, const time_t maxIdleAge);
+
+/** Cierra todas las conexiones del pool y libera sus recursos. */
+void deleteOriginPool(originPoolADT pool);
+
+/** Actualiza la dirección ya resuelta del origin server. */
+void originPoolSetAddress(originPoolADT pool, const addressData * origin);
+
+/**
+ * Registra un accept para estimar la tasa de conexiones y completa el pool
+ * hasta el tamaño objetivo.
+ */
+void originPoolAccepted(originPoolADT pool);
+
+/**
+ * Entrega la conexión lista más reciente. Retorna false si no hay ninguna.
+ */
+bool originPoolTake(originPoolADT pool, pooledOrigin * origin);
+
+/**
+ * Escribe en `buffer' las estadísticas del pool en texto (una linea).
+ * Retorna la cantidad de bytes escritos.
+ */
+size_t originPoolStatistics(originPoolADT pool, char * buffer, const size_t size);
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef ORIGIN_SET_H
+#define ORIGIN_SET_H
+
+#include <stdbool.h>
+#include <time.h>
+#include <netinet/in.h>
+
+#include "multiplexor.h"
+#include "netutils.h"
+
+/**
+ * originSet.h - conjunto de origin servers entre los que se reparten las
+ *               sesiones.
+ *
+ * Cada sesión elige su origin con "power of two choices": se toman dos
+ * origins sanos al azar y se usa el que tiene menos sesiones activas. Con
+ * más de un origin se chequea la salud de cada uno en el loop del
+ * multiplexor (conexión más saludo). Un origin que falla
+ * ORIGIN_HEALTH_FAILS veces seguidas, en chequeos o en sesiones, deja de
+ * recibir sesiones hasta pasar ORIGIN_HEALTH_PASSES chequeos seguidos. Si
+ * ninguno está sano se usan todos.
+ *
+ * Con afinidad por usuario el origin sale de un anillo de hashing
+ * consistente sobre el nombre de usuario, de modo que un usuario vuelve al
+ * mismo origin y al agregar o quitar uno solo se mueven sus usuarios. Si el
+ * origin del usuario no está sano se usa el siguiente sano del anillo.
+ */
+
+/** Cantidad máxima de origins. */
+#define ORIGIN_SET_MAX_SIZE 16
+/** Segundos entre chequeos de un mismo origin. */
+#define ORIGIN_HEALTH_INTERVAL 5
+/** Segundos que puede tardar un chequeo en recibir el saludo. */
+#define ORIGIN_HEALTH_TIMEOUT 3
+/** Fallos seguidos para dejar de usar un origin. */
+#define ORIGIN_HEALTH_FAILS 2
+/** Chequeos exitosos seguidos para volver a usar un origin. */
+#define ORIGIN_HEALTH_PASSES 2
+
+typedef struct originSetCDT * originSetADT;
+
+/**
+ * Crea el conjunto a partir de una lista de direcciones o nombres
+ * separados por coma, todos con el puerto `port'. Retorna NULL si la lista
+ * es inválida.
+ */
+originSetADT createOriginSet(const char * list, const in_port_t port);
+
+/** Detiene los chequeos y libera el conjunto. Requiere el multiplexor vivo. */
+void deleteOriginSet(originSetADT set);
+
+size_t originSetSize(originSetADT set);
+
+const addressData * originSetAddress(originSetADT set, const size_t index);
+
+/** Nombre o dirección del origin `index' tal como figura en la lista. */
+const char * originSetName(originSetADT set, const size_t index);
+
+/** Inicia los chequeos periódicos de salud en el multiplexor. */
+bool originSetStartHealthChecks(originSetADT set, MultiplexorADT mux);
+
+/** Elige el origin para una sesión nueva y la cuenta como activa. */
+size_t originSetAcquire(originSetADT set);
+
+/**
+ * Elige el origin de la clave `key' (el usuario) en el anillo y la cuenta
+ * como activa. Si no hay origins sanos se comporta como originSetAcquire.
+ */
+size_t originSetAcquireFor(originSetADT set, const char * key, const size_t length);
+
+/** La sesión que usaba el origin `index' terminó. */
+void originSetRelease(originSetADT set, const size_t index);
+
+/** Se conectó al origin `index', tardando `milliseconds'. */
+void originSetConnected(originSetADT set, const size_t index, const double milliseconds);
+
+/** No se pudo conectar al origin `index'. */
+void originSetFailed(originSetADT set, const size_t index);
+
+bool originSetIsHealthy(originSetADT set, const size_t index);
+
+/**
+ * Escribe en `buffer' las estadísticas de cada origin en texto (una linea
+ * por origin). Retorna la cantidad de bytes escritos.
+ */
+size_t originSetStatistics(originSetADT set, char * buffer, const size_t size);
+
+#endif
@@ -1,7 +1,14 @@
 #ifndef PROXY_POPV3_NIO_H
 #define PROXY_POPV3_NIO_H
 
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
 #include "multiplexor.h"
+#include "netutils.h"
+#include "originSet.h"
+#include "filterWatchdog.h"
 
 #define VERSION_NUMBER "1.0"
 #define TIMEOUT 120.0
@@ -10,6 +17,26 @@
 
 typedef struct conf {
     bool                 filterActivated;
+    bool                 deferredConnection;
+    bool                 usernameAffinity;
+    bool                 filterBatch;
+    bool                 filterNative;
+    bool                 filterInline;
+    size_t               warmPoolSize;
+    size_t               filterWorkers;
+    size_t               prefetchSize;
+    size_t               filterCacheSize;
+    size_t               filterCacheDiskSize;
+    size_t               filterBypassSize;
+    size_t               filterPipeSize;
+    size_t               filterLimit;
+    unsigned             filterFirstByteTimeout;
+    unsigned             filterTotalTimeout;
+    unsigned             filterTimeoutPerMiB;
+    filterWatchdogFallback filterFallback;
+    char *               filterCacheDirectory;
+    time_t               capaCacheTtl;
+    time_t               resolverTtl;
     char *               stdErrorFilePath;
     char *               replaceMsg;
     char *               filterCommand;
@@ -68,6 +95,7 @@ typedef enum etagIndex {
     replaceMsgSizeEtag      = 8,
     credentialEtag          = 9,
     bufferSizeEtag          = 10,
+    filterLimitEtag         = 11,
 } etagIndex;
 
 
@@ -77,5 +105,26 @@ metrics proxyMetrics;
 void poolProxyPopv3Destroy(void);
 void proxyPopv3PassiveAccept(MultiplexorKey key);
 
+/**
+ * Establece los origins entre los que se reparten las sesiones. Con un único
+ * origin crea el pool de conexiones pre-saludadas, si está configurado; con
+ * varios inicia los chequeos de salud.
+ */
+void proxyPopv3OriginsInit(MultiplexorADT mux, originSetADT origins);
+/**
+ * Cierra las conexiones del pool y libera los origins, debe llamarse antes
+ * de destruir el multiplexor.
+ */
+void proxyPopv3OriginsDestroy(void);
+
+/**
+ * Escribe en `buffer' las estadísticas de los componentes del proxy en texto.
+ * Retorna la cantidad de bytes escritos.
+ */
+size_t proxyPopv3Statistics(char * buffer, const size_t size);
+
+/** Descarta las capacidades de los origin servers guardadas en cache. */
+void proxyPopv3InvalidateCapabilities(void);
+
 #endif
 
@@ -0,0 +1,87 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <stdbool.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "multiplexor.h"
+
+/**
+ * resolver.h - resolución de nombres asincrónica para el proxy.
+ *
+ * Un conjunto fijo de hilos ejecuta `getaddrinfo'. Los pedidos por un mismo
+ * nombre y puerto mientras hay una resolución en curso se agrupan en una
+ * única consulta, y los resultados (positivos y negativos) se guardan en un
+ * cache con TTL. Al terminar una consulta se notifica a cada interesado por
+ * medio de `notifyBlock', de modo que el resultado se procesa en el handler
+ * `block' del fd registrado.
+ */
+
+/** Cantidad de hilos que resuelven nombres. */
+#define RESOLVER_WORKERS 4
+/** Cantidad máxima de direcciones que se guardan por nombre. */
+#define RESOLVER_MAX_ADDRESSES 8
+/** TTL máximo en segundos de una resolución fallida. */
+#define RESOLVER_NEGATIVE_TTL 5
+
+typedef enum resolverStatus {
+    RESOLVER_DONE,
+    RESOLVER_PENDING,
+    RESOLVER_FAILED,
+} resolverStatus;
+
+typedef struct resolverAnswer {
+    struct sockaddr_storage addresses[RESOLVER_MAX_ADDRESSES];
+    socklen_t               lengths[RESOLVER_MAX_ADDRESSES];
+    size_t                  count;
+} resolverAnswer;
+
+/**
+ * Pedido de resolución. Lo aloja quien pide la resolución y debe
+ * mantenerse válido hasta recibir la notificación o cancelarlo.
+ */
+typedef struct resolverRequest {
+    MultiplexorADT              mux;
+    int                         fd;
+    resolverStatus              status;
+    resolverAnswer              answer;
+    /******** zona privada *****************/
+    struct resolverLookup *     lookup;
+    struct resolverRequest *    next;
+} resolverRequest;
+
+/**
+ * Inicia los hilos del resolver. `ttl' es la cantidad de segundos que se
+ * recuerda una resolución exitosa, las fallidas se recuerdan como mucho
+ * RESOLVER_NEGATIVE_TTL segundos.
+ */
+bool resolverInit(const size_t workers, const time_t ttl);
+
+/** Detiene los hilos y libera los recursos del resolver. */
+void resolverDestroy(void);
+
+/**
+ * Resuelve `name'. Si el resultado está en cache retorna RESOLVER_DONE o
+ * RESOLVER_FAILED y completa `request'. Si no, retorna RESOLVER_PENDING y
+ * al terminar completa `request' y llama a `notifyBlock(mux, fd)'.
+ */
+resolverStatus resolverResolve(resolverRequest * request, MultiplexorADT mux, const int fd, const char * name, const in_port_t port);
+
+/**
+ * Retorna el estado de un pedido. Permite consultar un pedido desde un
+ * handler `block' que puede haber sido notificado por otro pedido.
+ */
+resolverStatus resolverPoll(const resolverRequest * request);
+
+/** Cancela un pedido pendiente, no se notificará su resultado. */
+void resolverCancel(resolverRequest * request);
+
+/**
+ * Escribe en `buffer' las estadísticas del resolver en texto (una linea).
+ * Retorna la cantidad de bytes escritos.
+ */
+size_t resolverStatistics(char * buffer, const size_t size);
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef RETR_PREFETCH_H
+#define RETR_PREFETCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "buffer.h"
+#include "queue.h"
+#include "commandParser.h"
+#include "responseParser.h"
+
+/**
+ * retrPrefetch.h - pedido especulativo del siguiente RETR.
+ *
+ * Cuando el cliente envía RETR n y no tiene otros comandos pendientes, se
+ * envía al origin RETR n+1 sin que el cliente lo pida. Los comandos que el
+ * cliente envíe después se retienen hasta saber si coinciden:
+ *  - Si el cliente pide RETR n+1, la linea no se reenvía y recibe la
+ *    respuesta especulativa, ya guardada o en camino.
+ *  - Si pide otra cosa, la respuesta especulativa se descarta y su comando
+ *    se reenvía al origin.
+ *
+ * La respuesta especulativa se guarda en un buffer propio de la sesión, de
+ * a lo sumo `capacity' bytes. Mientras el buffer está lleno no se lee más
+ * del origin. Solo tiene sentido con origins que soportan PIPELINING.
+ *
+ * El primer comando especulativo de la sesión es LIST, cuya respuesta se
+ * descarta como la de un RETR no pedido guardando el tamaño de cada
+ * mensaje. Solo se pide RETR n+1 si según LIST el mensaje es menor que
+ * `capacity', de modo que una respuesta que el cliente no quiere no hace
+ * leer y descartar mucho más que el buffer.
+ */
+
+/** Tamaño máximo de la linea RETR especulativa y de las lineas de LIST que se leen. */
+#define RETR_PREFETCH_LINE_SIZE 32
+/** Cantidad máxima de mensajes cuyo tamaño se recuerda. */
+#define RETR_PREFETCH_MAX_MESSAGES 65536
+
+typedef enum retrPrefetchState {
+    /** No hay un RETR especulativo en curso. */
+    PREFETCH_IDLE,
+    /** Se encoló el RETR especulativo, todavía no llega su respuesta. */
+    PREFETCH_SENT,
+    /** La respuesta especulativa se guarda en el buffer. */
+    PREFETCH_HOLDING,
+    /** El cliente pidió otra cosa, se descarta la respuesta especulativa. */
+    PREFETCH_DISCARDING,
+    /** Se pasa el contenido del buffer a las respuestas hacia el cliente. */
+    PREFETCH_DRAINING,
+} retrPrefetchState;
+
+typedef struct retrPrefetchStruct {
+    retrPrefetchState       state;
+    /** Tamaño del buffer, 0 si el prefetch está deshabilitado. */
+    size_t                  capacity;
+    /** Se crea con el primer RETR especulativo. */
+    bufferADT               buffer;
+    /** Comando especulativo en la cola, NULL si ya lo adoptó el cliente. */
+    const commandStruct *   command;
+    /** Mensaje pedido especulativamente. */
+    unsigned long           message;
+    /** Mensaje a pedir cuando no haya otro en curso, 0 si ninguno. */
+    unsigned long           next;
+    /** Bytes de la linea especulativa que falta enviar al origin. */
+    size_t                  pending;
+    /** El cliente pidió otra cosa antes de que llegue la respuesta. */
+    bool                    missed;
+    /** Ya se envió el LIST especulativo. */
+    bool                    listed;
+    /** El comando especulativo en curso es el LIST. */
+    bool                    listing;
+    /** Tamaño de cada mensaje según LIST, UINT32_MAX si no se conoce. */
+    uint32_t *              sizes;
+    /** Mensajes con tamaño en `sizes' y lugar reservado para ellos. */
+    size_t                  messages;
+    size_t                  sizesCapacity;
+    /** Linea de la respuesta a LIST que todavía no terminó. */
+    char                    line[RETR_PREFETCH_LINE_SIZE];
+    size_t                  lineLength;
+} retrPrefetchStruct;
+
+/** Inicializa el prefetch de una sesión, `capacity' 0 lo deshabilita. */
+void retrPrefetchInit(retrPrefetchStruct * prefetch, const size_t capacity);
+
+/** Libera el buffer y los tamaños de la sesión. */
+void retrPrefetchDestroy(retrPrefetchStruct * prefetch);
+
+/**
+ * Si la linea es "RETR n" completa deja n en `message'.
+ */
+bool retrPrefetchParseRetr(const uint8_t * line, const size_t length, unsigned long * message);
+
+/**
+ * Se enviaron al origin `length' bytes de `requests'. Descuenta la linea
+ * especulativa o, si la última linea enviada es RETR n, recuerda n+1.
+ */
+void retrPrefetchRequestSent(retrPrefetchStruct * prefetch, const uint8_t * data, const size_t length);
+
+/**
+ * Si no hay otro en curso y el cliente no tiene nada pendiente en
+ * `requests', escribe allí el RETR especulativo y lo encola. La primera
+ * vez encola LIST en su lugar; después, si el mensaje no es menor que
+ * `capacity' no se pide.
+ */
+bool retrPrefetchStart(retrPrefetchStruct * prefetch, bufferADT requests, commandParser * parser, queueADT commands);
+
+/** Los comandos del cliente esperan a saber si piden el RETR especulativo. */
+bool retrPrefetchHoldsClient(const retrPrefetchStruct * prefetch);
+
+/** Cantidad de los `size' bytes de `requests' que pueden enviarse al origin. */
+size_t retrPrefetchSendable(const retrPrefetchStruct * prefetch, const size_t size);
+
+/**
+ * Compara la primera linea del cliente sin procesar con el RETR
+ * especulativo. Si coincide la quita de `requests'.
+ */
+void retrPrefetchClientRequest(retrPrefetchStruct * prefetch, bufferADT requests);
+
+/** Descarta el RETR especulativo como si el cliente hubiera pedido otra cosa. */
+void retrPrefetchCancel(retrPrefetchStruct * prefetch);
+
+/** Buffer en el que deben guardarse los bytes leídos del origin. */
+bufferADT retrPrefetchOriginBuffer(retrPrefetchStruct * prefetch, bufferADT responses);
+
+/**
+ * Avanza con los bytes leídos del origin. Las respuestas previas a la
+ * especulativa quedan procesadas en `responses'; al terminar, lo que queda
+ * sin procesar en `responses' debe pasarse al parser normalmente. Retorna
+ * false si la respuesta del origin es inválida.
+ */
+bool retrPrefetchProcess(retrPrefetchStruct * prefetch, bufferADT responses, responseParser * parser, queueADT commands);
+
+/**
+ * Escribe en `buffer' las estadísticas del prefetch en texto (una linea).
+ * Retorna la cantidad de bytes escritos.
+ */
+size_t retrPrefetchStatistics(char * buffer, const size_t size);
+
+#endif
@@ -34,8 +34,14 @@
 #include "errorslib.h"
 #include "proxyPopv3nio.h"
 #include "adminnio.h"
+#include "resolver.h"
+#include "originSet.h"
+#include "filterPool.h"
+#include "filterLimit.h"
+#include "filterWatchdog.h"
+#include "processSpawn.h"
 
-#define HAS_REQUIRED_ARGUMENTS(k) ((k) == 'e' || (k) == 'l' || (k) == 'L' || (k) == 'm' || (k) == 'M' || (k) == 'o' || (k) == 'p' || (k) == 'P' || (k) == 't')
+#define HAS_REQUIRED_ARGUMENTS(k) ((k) == 'b' || (k) == 'c' || (k) == 'C' || (k) == 'd' || (k) == 'e' || (k) == 'f' || (k) == 'F' || (k) == 'l' || (k) == 'L' || (k) == 'm' || (k) == 'M' || (k) == 'o' || (k) == 'p' || (k) == 'P' || (k) == 'r' || (k) == 'R' || (k) == 's' || (k) == 't' || (k) == 'T' || (k) == 'w' || (k) == 'W' || (k) == 'x')
 
 #define BACKLOG 20
 #define SELECT_TIMEOUT 10
@@ -56,7 +62,7 @@ static addressData proxyAddr;
 static addressData adminProxyAddr;
 
 
-static addressData originAddrData;
+static in_port_t originPort;
     
 /**
  * Manejador de la señal SIGTERM.
@@ -74,7 +80,7 @@ static void sigTermHandler(const int signal) {
  * Manejador de la señal SIGCHILD.
  */
 static void sigChildHandler(const int signal) {
-    while(waitpid(-1, 0, WNOHANG) != -1);
+    while(waitpid(-1, 0, WNOHANG) > 0);
 }
 
 /**
@@ -82,7 +88,7 @@ static void sigChildHandler(const int signal) {
  */
 static void help(int argc) {
     if(argc == 2) {
-        printf("Pop3Filter Help\n\nOptions:\n\t-e <error-file> : set the file for stderr.\n\t-h for help.\n\t-l <pop3-address> : set the address for pop3Filter service\n\t-L <admin-address> : set the address for management service.\n\t-m <replace-message> : set the replace message for the filter.\n\t-M <media-range> : list of media types for filter.\n\t-o <management-port> : set the port for management service.\n\t-p <local-port> : set the port of service Pop3Filter\n\t-P <origin-port> : set the port of the origin server.\n\t-t <command> the command for filters.\n\t-v to get the version number of the Pop3Filter.\n\n");
+        printf("Pop3Filter Help\n\nOptions:\n\t-A route each user to the same origin (implies -D).\n\t-b <sniff-bytes> : send unfiltered the messages without parts in the media range, reading up to this many bytes to decide, 0 disables it.\n\t-B hand each whole message to the filter command in a memfd.\n\t-c <filter-cache-bytes> : keep the filtered messages in memory up to this many bytes, 0 disables the cache.\n\t-C <capa-ttl> : seconds to cache the origin capabilities, 0 disables the cache.\n\t-d <filter-cache-dir> : move the filtered messages evicted from memory to this directory.\n\t-D defer the origin connection until the client sends USER.\n\t-e <error-file> : set the file for stderr.\n\t-f <pass|error|replace> : what to send when a filter deadline expires, pass by default.\n\t-F <pipe-bytes> : capacity of the pipes to the filter command, 0 keeps the system default.\n\t-h for help.\n\t-i filter in-process with the built-in stripmime, using -M and -m, instead of running -t.\n\t-l <pop3-address> : set the address for pop3Filter service\n\t-L <admin-address> : set the address for management service.\n\t-m <replace-message> : set the replace message for the filter.\n\t-M <media-range> : list of media types for filter.\n\t-n the filter command is a native worker of -w, started once and fed every message.\n\t-o <management-port> : set the port for management service.\n\t-p <local-port> : set the port of service Pop3Filter\n\t-P <origin-port> : set the port of the origin server.\n\t-r <resolver-ttl> : seconds to cache the origin name resolution, 0 disables the cache.\n\t-R <prefetch-bytes> : request the next message after each RETR, buffering up to this many bytes per session.\n\t-s <filter-cache-disk-bytes> : size of the filter cache directory.\n\t-t <command> the command for filters.\n\t-T <first-byte-ms>,<total-ms>[,<ms-per-MiB>] : kill the filter if it takes longer to give its first byte or to finish, 0 disables a deadline.\n\t-v to get the version number of the Pop3Filter.\n\t-w <filter-workers> : filter messages in up to this many persistent workers.\n\t-W <warm-pool-size> : keep up to this many pre-greeted origin connections.\n\t-x <max-filters> : run up to this many filter commands at once, queueing the rest, 0 is unlimited.\n\n");
         exit(0);
     }
     fprintf(stderr, "Invalid use of -h option.\n");
@@ -112,15 +118,46 @@ static void parseOptionArguments(int argc, const char * argv[]) {
     }
     proxyAddr.port = 1110;
     adminProxyAddr.port = 9090;
-    originAddrData.port   = 110;
+    originPort            = 110;
     proxyConf.messageCount = 0;
     int optionArg;
-    while ((optionArg = getopt(argc, (char * const *)argv, "e:hl:L:m:M:o:p:P:t:v")) != -1) {
+    while ((optionArg = getopt(argc, (char * const *)argv, "Ab:Bc:C:d:De:f:F:hil:L:m:M:no:p:P:r:R:s:t:T:vw:W:x:")) != -1) {
 
         switch(optionArg) {
+            case 'A':
+                proxyConf.usernameAffinity   = true;
+                proxyConf.deferredConnection = true;
+                break;
+            case 'b':
+                proxyConf.filterBypassSize = strtoul(optarg, NULL, 10);
+                break;
+            case 'B':
+                proxyConf.filterBatch = true;
+                break;
+            case 'c':
+                proxyConf.filterCacheSize = strtoul(optarg, NULL, 10);
+                break;
+            case 'C':
+                proxyConf.capaCacheTtl = atoi(optarg);
+                break;
+            case 'd':
+                proxyConf.filterCacheDirectory = optarg;
+                break;
+            case 'D':
+                proxyConf.deferredConnection = true;
+                break;
             case 'e':
                 proxyConf.stdErrorFilePath = optarg;
                 break;
+            case 'f':
+                if(!filterWatchdogParseFallback(optarg, &proxyConf.filterFallback)) {
+                    fprintf(stderr, "Invalid filter fallback `%s', use pass, error or replace.\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'F':
+                proxyConf.filterPipeSize = strtoul(optarg, NULL, 10);
+                break;
             case 'h':
                 help(argc);
                 break;
@@ -160,15 +197,46 @@ static void parseOptionArguments(int argc, const char * argv[]) {
                 proxyAddr.port = atoi(optarg);
                 break;
             case 'P':
-                originAddrData.port = atoi(optarg);
+                originPort = atoi(optarg);
+                break;
+            case 'r':
+                proxyConf.resolverTtl = atoi(optarg);
+                break;
+            case 'R':
+                proxyConf.prefetchSize = atoi(optarg);
+                break;
+            case 's':
+                proxyConf.filterCacheDiskSize = strtoul(optarg, NULL, 10);
                 break;
             case 't':
                 proxyConf.filterCommand = optarg;
                 proxyConf.filterActivated = true;
                 break;
+            case 'T':
+                if(!filterWatchdogParseDeadlines(optarg, &proxyConf.filterFirstByteTimeout, &proxyConf.filterTotalTimeout, &proxyConf.filterTimeoutPerMiB)) {
+                    fprintf(stderr, "Invalid filter deadlines `%s', use <first-byte-ms>,<total-ms>[,<ms-per-MiB>].\n", optarg);
+                    exit(1);
+                }
+                break;
             case 'v':
                 printVersion(argc);
                 break;
+            case 'i':
+                proxyConf.filterInline    = true;
+                proxyConf.filterActivated = true;
+                break;
+            case 'n':
+                proxyConf.filterNative = true;
+                break;
+            case 'w':
+                proxyConf.filterWorkers = atoi(optarg);
+                break;
+            case 'W':
+                proxyConf.warmPoolSize = atoi(optarg);
+                break;
+            case 'x':
+                proxyConf.filterLimit = strtoul(optarg, NULL, 10);
+                break;
             case '?':
                 if (HAS_REQUIRED_ARGUMENTS(optopt))
                     fprintf (stderr, "Option -%c requires an argument.\n", optopt);
@@ -184,7 +252,7 @@ static void parseOptionArguments(int argc, const char * argv[]) {
         }
     }
     if(argc - optind != 1) {
-        fprintf(stderr, "Pop3filter - Invalid Arguments! Please use: pop3Filter [POSIX style options] <origin-address>\n");
+        fprintf(stderr, "Pop3filter - Invalid Arguments! Please use: pop3Filter [POSIX style options] <origin-address[,origin-address...]>\n");
         exit(1);
     }
 
@@ -206,9 +274,12 @@ static void loggerInit(int * fds) {
     FILE * errors  = fopen("./../errors.log", "w+");
     FILE * metrics = fopen("./../metrics.log", "w+");
     loggerClearFiles();
-    if(metrics != NULL)
+    if(metrics != NULL) {
+        fdSetCloexec(fileno(metrics));
         loggerSetFileByLevel(metrics, LOG_LEVEL_METRIC);
+    }
     if(errors != NULL) {
+        fdSetCloexec(fileno(errors));
         loggerSetFileByLevel(errors, LOG_LEVEL_WARN);
         loggerSetFileByLevel(errors, LOG_LEVEL_ERROR);
         loggerSetFileByLevel(errors, LOG_LEVEL_FATAL);
@@ -225,6 +296,26 @@ static void loggerInit(int * fds) {
  */
 static void setUpConfigurations(void) {
     proxyConf.filterActivated = false;
+    proxyConf.deferredConnection = false;
+    proxyConf.usernameAffinity = false;
+    proxyConf.filterBatch = false;
+    proxyConf.filterNative = false;
+    proxyConf.filterInline = false;
+    proxyConf.warmPoolSize = 0;
+    proxyConf.filterWorkers = 0;
+    proxyConf.prefetchSize = 0;
+    proxyConf.filterCacheSize = 0;
+    proxyConf.filterCacheDiskSize = 64 * 1024 * 1024;
+    proxyConf.filterBypassSize = 0;
+    proxyConf.filterPipeSize = 0;
+    proxyConf.filterLimit = 0;
+    proxyConf.filterFirstByteTimeout = 0;
+    proxyConf.filterTotalTimeout = 0;
+    proxyConf.filterTimeoutPerMiB = 0;
+    proxyConf.filterFallback = FILTER_FALLBACK_PASS;
+    proxyConf.filterCacheDirectory = NULL;
+    proxyConf.capaCacheTtl = 300;
+    proxyConf.resolverTtl = 60;
     proxyConf.stdErrorFilePath = "/dev/null";
     proxyConf.replaceMsg = "Parte remplazada";
     proxyConf.filterCommand = NULL;
@@ -254,6 +345,9 @@ typedef struct pack {
 static void errorHandler(void * data) {
     pack * dataPack = (pack *)data;
     logFatal("An error ocurred.");
+    proxyPopv3OriginsDestroy();
+    resolverDestroy();
+    filterPoolDestroy();
     if(dataPack->mux != NULL) {
         deleteMultiplexorADT(dataPack->mux);
     }
@@ -295,6 +389,7 @@ int main(const int argc, const char ** argv) {
     lastTimeout = time(NULL);
     multiplexorStatus status = MUX_SUCCESS;
     MultiplexorADT mux = NULL;
+    originSetADT origins = NULL;
     pack dataPack = {.status = &status, .mux = mux, .retVal = 1}; 
 
 
@@ -305,8 +400,8 @@ int main(const int argc, const char ** argv) {
     checkAreNotEquals(adminProxyAddr.type, ADDR_DOMAIN, "Invalid Arguments.");
 
 
-    proxy      = socket(proxyAddr.domain, SOCK_STREAM, IPPROTO_TCP);
-    adminProxy = socket(adminProxyAddr.domain, SOCK_STREAM, IPPROTO_SCTP);
+    proxy      = socket(proxyAddr.domain, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    adminProxy = socket(adminProxyAddr.domain, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_SCTP);
 
     checkFailWithFinally(proxy, errorHandler, &dataPack, "Unable to create proxy popv3 socket.");
     checkFailWithFinally(adminProxy, errorHandler, &dataPack, "Unable to create admin socket.");
@@ -343,12 +438,35 @@ int main(const int argc, const char ** argv) {
     signal(SIGTERM,  sigTermHandler);
     signal(SIGINT,   sigTermHandler);
     signal(SIGCHLD, sigChildHandler);
+    /**
+     * SIGCHLD solo se atiende en el pselect del multiplexor, que desbloquea
+     * todas las señales: los hilos que se creen después lo heredan
+     * bloqueado y un filtro recién lanzado no se espera antes de abrir su
+     * pidfd.
+     */
+    sigset_t childSet;
+    sigemptyset(&childSet);
+    sigaddset(&childSet, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &childSet, NULL);
+    /** Si el comando de filtro termina sin leer todo el cuerpo, escribirle falla con EPIPE. */
+    signal(SIGPIPE, SIG_IGN);
 
     result = fdSetNIO(proxy);
     checkFailWithFinally(result, errorHandler, &dataPack, "fdSetNIO() in proxy popv3 socket failed.");
 
     result = fdSetNIO(adminProxy);
     checkFailWithFinally(result, errorHandler, &dataPack, "fdSetNIO() in admin socket failed.");
+    if(proxyConf.filterBatch) {
+        const int pidfd = processPidfd(getpid());
+        if(pidfd < 0) {
+            logWarn("Unable to open pidfds (%s), -B is ignored.", strerror(errno));
+            proxyConf.filterBatch = false;
+        } else
+            close(pidfd);
+    }
+    filterLimitSetMax(proxyConf.filterLimit);
+    filterWatchdogSetDeadlines(proxyConf.filterFirstByteTimeout, proxyConf.filterTotalTimeout, proxyConf.filterTimeoutPerMiB);
+    filterWatchdogSetFallback(proxyConf.filterFallback);
 
     const struct multiplexorInit conf = {
         .signal = SIGALRM,
@@ -361,6 +479,14 @@ int main(const int argc, const char ** argv) {
     checkAreEqualsWithFinally(multiplexorInit(&conf), 0, errorHandler, &dataPack, "Initializing Multiplexor");
     mux = createMultiplexorADT(SELECT_SET_SIZE);
     checkIsNotNullWithFinally(mux, errorHandler, &dataPack, "Unable to create MultiplexorADT");
+    checkAreEqualsWithFinally(resolverInit(RESOLVER_WORKERS, proxyConf.resolverTtl), true, errorHandler, &dataPack, "Initializing resolver");
+    if(proxyConf.filterNative && (proxyConf.filterWorkers == 0 || proxyConf.filterCommand == NULL)) {
+        logWarn("-n needs -w and -t, it is ignored.");
+        proxyConf.filterNative = false;
+    }
+    checkAreEqualsWithFinally(filterPoolInit(mux, FILTER_WRAPPER_PATH, proxyConf.filterNative? proxyConf.filterCommand : NULL,
+                                             proxyConf.stdErrorFilePath, proxyConf.filterWorkers),
+                              true, errorHandler, &dataPack, "Initializing filter pool");
 
     const eventHandler popv3 = {
         .read       = proxyPopv3PassiveAccept,
@@ -378,9 +504,19 @@ int main(const int argc, const char ** argv) {
         .timeout    = NULL, 
     };
 
-    setAddress(&originAddrData, proxyConf.stringServer);
+    const adminProxyOperations adminOperations = {
+        .statistics             = proxyPopv3Statistics,
+        .invalidateCapabilities = proxyPopv3InvalidateCapabilities,
+        .filterLimitMax         = filterLimitMax,
+        .filterLimitSetMax      = filterLimitSetMax,
+    };
+    adminRegisterProxy(&adminOperations);
+
+    origins = createOriginSet(proxyConf.stringServer, originPort);
+    checkIsNotNullWithFinally(origins, errorHandler, &dataPack, "Invalid origin server list");
+    proxyPopv3OriginsInit(mux, origins);
 
-    status = registerFd(mux, proxy, &popv3, READ, &originAddrData);
+    status = registerFd(mux, proxy, &popv3, READ, NULL);
     checkAreEqualsWithFinally(status, MUX_SUCCESS, errorHandler, &dataPack, "Registering fd for proxy popv3");
     logInfo("Passive socket registered in fd: %d", proxy);
 
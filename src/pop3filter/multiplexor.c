@@ -1,3 +1,5 @@
+/* accept4 es una extensión de glibc. */
+#define _GNU_SOURCE
 #include <assert.h>  
 #include <stdio.h>  
 #include <string.h> 
@@ -27,13 +29,6 @@ typedef struct fdType {
     void *               data;
 } fdType;
 
-typedef struct blockingTask {
-    MultiplexorADT        mux;
-    int                   fd;
-    void *                data;
-    struct blockingTask * next;
-}blockingTask;
-
 typedef struct MultiplexorCDT {
     fdType * fds;
     size_t   size;
@@ -49,7 +44,15 @@ typedef struct MultiplexorCDT {
 
     volatile pthread_t muxThread;
     pthread_mutex_t    resolutionMutex;
-    blockingTask *     resolutionTasks;
+    /**
+     * fds con una notificación de notifyBlock pendiente, protegidos por
+     * resolutionMutex. Un flag por fd: notificar no reserva memoria y las
+     * notificaciones a un mismo fd se agrupan.
+     */
+    bool               blockPending[FDS_MAX_SIZE];
+    bool               anyBlockPending;
+    /** Notificaciones que está despachando el hilo principal. */
+    bool               blockDispatch[FDS_MAX_SIZE];
 } MultiplexorCDT;
 
 // señal a usar para las notificaciones de resolución
@@ -234,7 +237,8 @@ MultiplexorADT createMultiplexorADT (const size_t initialElements) {
         mux->prototipicTimeout.tv_sec  = conf.selectTimeout.tv_sec;
         mux->prototipicTimeout.tv_nsec = conf.selectTimeout.tv_nsec;
         assert(mux->maxFd == 0);
-        mux->resolutionTasks  = 0;
+        /** Se puede notificar antes del primer muxSelect. */
+        mux->muxThread = pthread_self();
         pthread_mutex_init(&mux->resolutionMutex, 0);
         if(0 != ensureCapacity(mux, initialElements)) {
             deleteMultiplexorADT(mux);
@@ -253,11 +257,6 @@ void deleteMultiplexorADT(MultiplexorADT mux) {
                 }
             }
             pthread_mutex_destroy(&mux->resolutionMutex);
-            blockingTask * t, *next;
-            for(t = mux->resolutionTasks; t != NULL; t = next) {
-                next = t->next;
-                free(t);
-            }
             free(mux->fds);
             mux->fds = NULL;
             mux->size = 0;
@@ -324,6 +323,14 @@ multiplexorStatus unregisterFd(MultiplexorADT mux, const int fd) {
         };
         newFdType->handler->close(&key);
     }
+    /**
+     * Las notificaciones pendientes eran para quien cerró el fd, no para
+     * quien lo registre después.
+     */
+    pthread_mutex_lock(&mux->resolutionMutex);
+    mux->blockPending[fd] = false;
+    pthread_mutex_unlock(&mux->resolutionMutex);
+    mux->blockDispatch[fd] = false;
 
     newFdType->interest = NO_INTEREST;
     updateSet(mux, newFdType);
@@ -400,42 +407,50 @@ static void manageIteration(MultiplexorADT mux) {
     }
 }
 
+/**
+ * Despacha las notificaciones pendientes sin el mutex tomado: los handlers
+ * pueden llamar a funciones que toman sus propios mutex y notifican con
+ * ellos tomados, como el resolver.
+ */
 static void manageBlockNotifications(MultiplexorADT mux) {
     MultiplexorKeyCDT key = {
         .mux = mux,
     };
-    pthread_mutex_lock(&mux->resolutionMutex);
 
-    blockingTask * t, * next;
-    for(t = mux->resolutionTasks; t != NULL ; t = next) {
+    pthread_mutex_lock(&mux->resolutionMutex);
+    const bool pending = mux->anyBlockPending;
+    if(pending) {
+        memcpy(mux->blockDispatch, mux->blockPending, sizeof(mux->blockDispatch));
+        memset(mux->blockPending, 0, sizeof(mux->blockPending));
+        mux->anyBlockPending = false;
+    }
+    pthread_mutex_unlock(&mux->resolutionMutex);
+    if(!pending)
+        return;
 
-        fdType * currentFdType = mux->fds + t->fd;
-        if(USED_FD_TYPE(currentFdType)) {
+    for(size_t i = 0; i < mux->size && i < FDS_MAX_SIZE; i++) {
+        if(!mux->blockDispatch[i])
+            continue;
+        mux->blockDispatch[i] = false;
+        fdType * currentFdType = mux->fds + i;
+        if(USED_FD_TYPE(currentFdType) && currentFdType->handler->block != NULL) {
             key.fd   = currentFdType->fd;
             key.data = currentFdType->data;
             currentFdType->handler->block(&key);
         }
-        
-        next = t->next;
-        free(t);
     }
-    mux->resolutionTasks = 0;
-    pthread_mutex_unlock(&mux->resolutionMutex);
 }
 
 multiplexorStatus notifyBlock(MultiplexorADT  mux, const int fd) {
     multiplexorStatus retVal = MUX_SUCCESS;
 
-    blockingTask * task = malloc(sizeof(*task));
-    if(task == NULL) {
-        retVal = MUX_NO_MEMORY;
+    if(NULL == mux || INVALID_FD(fd)) {
+        retVal = MUX_INVALID_ARGUMENTS;
         goto finally;
     }
-    task->mux  = mux;
-    task->fd = fd;
     pthread_mutex_lock(&mux->resolutionMutex);
-    task->next = mux->resolutionTasks;
-    mux->resolutionTasks = task;
+    mux->blockPending[fd] = true;
+    mux->anyBlockPending  = true;
     pthread_mutex_unlock(&mux->resolutionMutex);
 
     // notificamos al hilo principal
@@ -502,6 +517,25 @@ int fdSetNIO(const int fd) {
     return ret;
 }
 
+int fdSetCloexec(const int fd) {
+    const int flags = fcntl(fd, F_GETFD, 0);
+    if(flags == -1 || fcntl(fd, F_SETFD, flags | FD_CLOEXEC) == -1)
+        return -1;
+    return 0;
+}
+
+int fdAccept(const int fd, struct sockaddr * address, socklen_t * length) {
+#ifdef SOCK_CLOEXEC
+    return accept4(fd, address, length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+    const int clientFd = accept(fd, address, length);
+    if(clientFd != -1 && (fdSetNIO(clientFd) == -1 || fdSetCloexec(clientFd) == -1)) {
+        close(clientFd);
+        return -1;
+    }
+    return clientFd;
+#endif
+}
 
 void checkTimeout(MultiplexorADT mux) {
     if(mux == NULL)
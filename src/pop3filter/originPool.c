@@ -0,0 +1,431 @@
+/**
+ * originPool.c - pool de conexiones con el origin server que ya leyeron el
+ *                saludo y la respuesta a CAPA.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "originPool.h"
+#include "buffer.h"
+#include "logger.h"
+#include "helloParser.h"
+
+/** Ventana en segundos para estimar la tasa de accepts. */
+#define POOL_RATE_WINDOW 10
+/** Segundos de accepts que se intenta tener listos en el pool. */
+#define POOL_RATE_HORIZON 2
+/** Segundos que puede tardar una conexión en quedar lista. */
+#define POOL_WARMUP_TIMEOUT 10
+#define POOL_BUFFER_SIZE 512
+
+/**
+ * Estados de una conexión del pool.
+ */
+typedef enum pooledState {
+    POOLED_FREE,
+    POOLED_CONNECTING,
+    POOLED_HELLO,
+    POOLED_CAPA_WRITE,
+    POOLED_CAPA_READ,
+    POOLED_READY,
+} pooledState;
+
+typedef struct pooledConnection {
+    int                 fd;
+    pooledState         state;
+    /** Inicio de la conexión o momento en que quedó lista. */
+    time_t              since;
+    size_t              capaSent;
+    bufferADT           buffer;
+    helloParser         helloParser;
+    capaParser          capaParser;
+    pooledOrigin        origin;
+    originPoolADT       pool;
+} pooledConnection;
+
+struct originPoolCDT {
+    MultiplexorADT      mux;
+    addressData         origin;
+    bool                resolved;
+    size_t              maxSize;
+    time_t              maxIdleAge;
+    pooledConnection *  connections;
+
+    /** Estimación de la tasa de accepts. */
+    time_t              windowStart;
+    unsigned            windowAccepts;
+    unsigned            lastWindowAccepts;
+    size_t              target;
+
+    /** Métricas. */
+    unsigned long long  hits;
+    unsigned long long  misses;
+    unsigned long long  created;
+    unsigned long long  failed;
+    unsigned long long  expired;
+    unsigned long long  dropped;
+    unsigned long long  hitAgeSum;
+    time_t              hitAgeMax;
+};
+
+static void pooledRead(MultiplexorKey key);
+static void pooledWrite(MultiplexorKey key);
+static void pooledTimeout(MultiplexorKey key);
+
+static const eventHandler pooledHandler = {
+    .read    = pooledRead,
+    .write   = pooledWrite,
+    .block   = NULL,
+    .close   = NULL,
+    .timeout = pooledTimeout,
+};
+
+static const char   *capaMsg     = "CAPA\r\n";
+static const size_t  capaMsgSize = 6;
+
+originPoolADT createOriginPool(MultiplexorADT mux, const addressData * origin, const size_t maxSize, const time_t maxIdleAge) {
+    originPoolADT pool = calloc(1, sizeof(*pool));
+    if(pool == NULL)
+        return NULL;
+
+    pool->connections = calloc(maxSize, sizeof(*pool->connections));
+    if(pool->connections == NULL) {
+        free(pool);
+        return NULL;
+    }
+    for(size_t i = 0; i < maxSize; i++) {
+        pool->connections[i].fd     = -1;
+        pool->connections[i].pool   = pool;
+        pool->connections[i].buffer = createBuffer(POOL_BUFFER_SIZE);
+    }
+    pool->mux         = mux;
+    pool->maxSize     = maxSize;
+    pool->maxIdleAge  = maxIdleAge;
+    pool->windowStart = time(NULL);
+    originPoolSetAddress(pool, origin);
+    return pool;
+}
+
+/**
+ * Cierra una conexión del pool y libera su lugar.
+ */
+static void discardConnection(pooledConnection * connection) {
+    if(connection->fd != -1) {
+        unregisterFd(connection->pool->mux, connection->fd);
+        close(connection->fd);
+    }
+    connection->fd    = -1;
+    connection->state = POOLED_FREE;
+}
+
+void deleteOriginPool(originPoolADT pool) {
+    if(pool == NULL)
+        return;
+    for(size_t i = 0; i < pool->maxSize; i++) {
+        discardConnection(pool->connections + i);
+        deleteBuffer(pool->connections[i].buffer);
+    }
+    free(pool->connections);
+    free(pool);
+}
+
+void originPoolSetAddress(originPoolADT pool, const addressData * origin) {
+    pool->origin   = *origin;
+    pool->resolved = origin->type != ADDR_DOMAIN;
+}
+
+/**
+ * Abre una conexión no bloqueante con el origin en el lugar indicado.
+ */
+static bool startConnection(originPoolADT pool, pooledConnection * connection) {
+    const addressData * origin = &pool->origin;
+
+    connection->fd = socket(origin->domain, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    if(connection->fd == -1)
+        goto fail;
+    if(fdSetNIO(connection->fd) == -1)
+        goto fail;
+    if(connect(connection->fd, (const struct sockaddr *) &origin->addr.addrStorage, origin->addrLength) == -1 && errno != EINPROGRESS)
+        goto fail;
+    if(MUX_SUCCESS != registerFd(pool->mux, connection->fd, &pooledHandler, WRITE, connection))
+        goto fail;
+
+    connection->state                 = POOLED_CONNECTING;
+    connection->since                 = time(NULL);
+    connection->capaSent              = 0;
+    connection->origin.fd             = connection->fd;
+    connection->origin.greetingLength = 0;
+    memset(&connection->origin.capabilities, 0, sizeof(connection->origin.capabilities));
+    reset(connection->buffer);
+    helloParserInit(&connection->helloParser);
+    capaParserInit(&connection->capaParser, &connection->origin.capabilities);
+    pool->created++;
+    return true;
+
+fail:
+    if(connection->fd != -1)
+        close(connection->fd);
+    connection->fd = -1;
+    pool->failed++;
+    return false;
+}
+
+/**
+ * Recalcula el tamaño objetivo a partir de los accepts de la última ventana.
+ */
+static void updateTarget(originPoolADT pool, const time_t now) {
+    const time_t elapsed = now - pool->windowStart;
+
+    if(elapsed >= POOL_RATE_WINDOW) {
+        pool->lastWindowAccepts = (elapsed < 2 * POOL_RATE_WINDOW)? pool->windowAccepts : 0;
+        pool->windowAccepts     = 0;
+        pool->windowStart       = now;
+    }
+    const unsigned accepts = (pool->windowAccepts > pool->lastWindowAccepts)? pool->windowAccepts : pool->lastWindowAccepts;
+    size_t target = (accepts * POOL_RATE_HORIZON + POOL_RATE_WINDOW - 1) / POOL_RATE_WINDOW;
+    pool->target  = (target > pool->maxSize)? pool->maxSize : target;
+}
+
+/**
+ * Abre conexiones hasta alcanzar el tamaño objetivo. Ante un fallo deja de
+ * intentar hasta el próximo evento para no insistir con un origin caído.
+ */
+static void refill(originPoolADT pool) {
+    size_t used = 0;
+
+    if(!pool->resolved)
+        return;
+    for(size_t i = 0; i < pool->maxSize; i++)
+        if(pool->connections[i].state != POOLED_FREE)
+            used++;
+    for(size_t i = 0; i < pool->maxSize && used < pool->target; i++) {
+        if(pool->connections[i].state == POOLED_FREE) {
+            if(!startConnection(pool, pool->connections + i))
+                return;
+            used++;
+        }
+    }
+}
+
+void originPoolAccepted(originPoolADT pool) {
+    if(pool == NULL)
+        return;
+    updateTarget(pool, time(NULL));
+    pool->windowAccepts++;
+    updateTarget(pool, time(NULL));
+    refill(pool);
+}
+
+bool originPoolTake(originPoolADT pool, pooledOrigin * origin) {
+    pooledConnection * best = NULL;
+    const time_t       now  = time(NULL);
+
+    if(pool == NULL)
+        return false;
+    for(size_t i = 0; i < pool->maxSize; i++) {
+        pooledConnection * connection = pool->connections + i;
+        if(connection->state != POOLED_READY)
+            continue;
+        if(now - connection->since >= pool->maxIdleAge) {
+            pool->expired++;
+            discardConnection(connection);
+        } else if(best == NULL || connection->since > best->since)
+            best = connection;
+    }
+
+    if(best == NULL) {
+        pool->misses++;
+        refill(pool);
+        return false;
+    }
+
+    const time_t age = now - best->since;
+    pool->hits++;
+    pool->hitAgeSum += age;
+    if(age > pool->hitAgeMax)
+        pool->hitAgeMax = age;
+
+    /** El fd deja de pertenecer al pool antes de desregistrarlo. */
+    const int fd = best->fd;
+    best->fd     = -1;
+    best->state  = POOLED_FREE;
+    unregisterFd(pool->mux, fd);
+    *origin      = best->origin;
+
+    refill(pool);
+    return true;
+}
+
+size_t originPoolStatistics(originPoolADT pool, char * buffer, const size_t size) {
+    size_t ready = 0, warming = 0;
+    char   originString[50] = "unresolved";
+
+    if(pool == NULL || size == 0)
+        return 0;
+    for(size_t i = 0; i < pool->maxSize; i++) {
+        if(pool->connections[i].state == POOLED_READY)
+            ready++;
+        else if(pool->connections[i].state != POOLED_FREE)
+            warming++;
+    }
+    if(pool->resolved)
+        sockaddrToString(originString, sizeof(originString), (const struct sockaddr *) &pool->origin.addr.addrStorage);
+
+    const unsigned long long lookups = pool->hits + pool->misses;
+    const int n = snprintf(buffer, size,
+        "warm pool %s: ready %zu warming %zu target %zu max %zu hits %llu misses %llu hit-rate %llu%% "
+        "avg-age %llus max-age %llds expired %llu dropped %llu failed %llu\n",
+        originString, ready, warming, pool->target, pool->maxSize, pool->hits, pool->misses,
+        (lookups == 0)? 0 : pool->hits * 100 / lookups,
+        (pool->hits == 0)? 0 : pool->hitAgeSum / pool->hits, (long long) pool->hitAgeMax,
+        pool->expired, pool->dropped, pool->failed);
+    if(n < 0)
+        return 0;
+    return ((size_t) n >= size)? size - 1 : (size_t) n;
+}
+
+/**
+ * Descarta la conexión por un error del origin.
+ */
+static void connectionFailed(pooledConnection * connection) {
+    logDebug("Warm pool connection failed in state %d.", connection->state);
+    connection->pool->failed++;
+    discardConnection(connection);
+}
+
+static void pooledWrite(MultiplexorKey key) {
+    pooledConnection * connection = (pooledConnection *) key->data;
+    int                error;
+    socklen_t          length = sizeof(error);
+
+    switch(connection->state) {
+        case POOLED_CONNECTING:
+            if(getsockopt(key->fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0 ||
+               MUX_SUCCESS != setInterestKey(key, READ)) {
+                connectionFailed(connection);
+                return;
+            }
+            connection->state = POOLED_HELLO;
+            break;
+        case POOLED_CAPA_WRITE: {
+            const ssize_t n = send(key->fd, capaMsg + connection->capaSent, capaMsgSize - connection->capaSent, MSG_NOSIGNAL);
+            if(n <= 0) {
+                connectionFailed(connection);
+                return;
+            }
+            connection->capaSent += n;
+            if(connection->capaSent == capaMsgSize) {
+                if(MUX_SUCCESS != setInterestKey(key, READ)) {
+                    connectionFailed(connection);
+                    return;
+                }
+                connection->state = POOLED_CAPA_READ;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/**
+ * Lee el saludo del origin, guardándolo para entregarlo al cliente.
+ */
+static bool readHello(MultiplexorKey key, pooledConnection * connection) {
+    pooledOrigin * origin = &connection->origin;
+    bufferADT      buffer = connection->buffer;
+    bool           error  = false;
+    size_t         count;
+    uint8_t *      writePtr = getWritePtr(buffer, &count);
+    const ssize_t  n        = recv(key->fd, writePtr, count, 0);
+
+    if(n <= 0 || origin->greetingLength + n > ORIGIN_POOL_GREETING_SIZE)
+        return false;
+    memcpy(origin->greeting + origin->greetingLength, writePtr, n);
+    origin->greetingLength += n;
+    updateWritePtr(buffer, n);
+
+    const helloState state = helloConsume(&connection->helloParser, buffer, &error);
+    if(error)
+        return false;
+    if(helloIsDone(state, 0)) {
+        /** El origin no debería enviar nada más hasta recibir un comando. */
+        if(canProcess(buffer) || MUX_SUCCESS != setInterestKey(key, WRITE))
+            return false;
+        connection->state = POOLED_CAPA_WRITE;
+    }
+    reset(buffer);
+    return true;
+}
+
+static bool readCapabilities(MultiplexorKey key, pooledConnection * connection) {
+    bufferADT      buffer = connection->buffer;
+    bool           error  = false;
+    size_t         count;
+    uint8_t *      writePtr = getWritePtr(buffer, &count);
+    const ssize_t  n        = recv(key->fd, writePtr, count, 0);
+
+    if(n <= 0)
+        return false;
+    updateWriteAndProcessPtr(buffer, n);
+
+    const capaState state = capaParserConsume(&connection->capaParser, buffer, &error);
+    if(error)
+        return false;
+    if(capaParserIsDone(state, 0)) {
+        if(canRead(buffer))
+            return false;
+        connection->state = POOLED_READY;
+        connection->since = time(NULL);
+    }
+    return true;
+}
+
+static void pooledRead(MultiplexorKey key) {
+    pooledConnection * connection = (pooledConnection *) key->data;
+    bool               alive      = false;
+
+    switch(connection->state) {
+        case POOLED_HELLO:
+            alive = readHello(key, connection);
+            break;
+        case POOLED_CAPA_READ:
+            alive = readCapabilities(key, connection);
+            break;
+        case POOLED_READY:
+            /** Una conexión lista solo se vuelve legible si el origin la cerró. */
+            connection->pool->dropped++;
+            discardConnection(connection);
+            return;
+        default:
+            break;
+    }
+    if(!alive)
+        connectionFailed(connection);
+}
+
+/**
+ * Descarta las conexiones inactivas por demasiado tiempo o que no terminaron
+ * de prepararse y ajusta el pool al tamaño objetivo.
+ */
+static void pooledTimeout(MultiplexorKey key) {
+    pooledConnection * connection = (pooledConnection *) key->data;
+    originPoolADT      pool       = connection->pool;
+    const time_t       now        = time(NULL);
+
+    if(connection->state == POOLED_READY && now - connection->since >= pool->maxIdleAge) {
+        pool->expired++;
+        discardConnection(connection);
+    } else if(connection->state != POOLED_READY && now - connection->since >= POOL_WARMUP_TIMEOUT)
+        connectionFailed(connection);
+    else
+        return;
+
+    updateTarget(pool, now);
+    refill(pool);
+}
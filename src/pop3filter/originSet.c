@@ -0,0 +1,430 @@
+/**
+ * originSet.c - conjunto de origin servers con balanceo de sesiones y
+ *               chequeos de salud.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "originSet.h"
+#include "resolver.h"
+#include "logger.h"
+#include "hashRing.h"
+#include "timerFd.h"
+
+/** Peso de cada medición nueva en la latencia promedio. */
+#define LATENCY_WEIGHT 0.2
+#define PROBE_BUFFER_SIZE 512
+/** Puntos de cada origin en el anillo de afinidad. */
+#define RING_VIRTUAL_NODES 160
+/** Cada cuánto se revisan los chequeos pendientes y sus plazos. */
+#define HEALTH_TICK_MS 1000
+
+typedef enum probeState {
+    PROBE_IDLE,
+    PROBE_RESOLVING,
+    PROBE_CONNECTING,
+    PROBE_HELLO,
+} probeState;
+
+typedef struct originEntry {
+    char                    name[0xFF];
+    addressData             address;
+    bool                    healthy;
+    unsigned                consecutiveFails;
+    unsigned                consecutivePasses;
+
+    unsigned long long      activeSessions;
+    unsigned long long      totalSessions;
+    unsigned long long      failures;
+    unsigned long long      probes;
+    unsigned long long      failedProbes;
+    unsigned long long      ejections;
+    /** Promedio móvil de la latencia de conexión, en milisegundos. */
+    double                  latency;
+
+    /** Chequeo de salud en curso. */
+    probeState              probe;
+    int                     probeFd;
+    struct timespec         probeStart;
+    time_t                  probeDeadline;
+    time_t                  nextProbe;
+    resolverRequest         resolution;
+    char                    greeting[PROBE_BUFFER_SIZE];
+    size_t                  greetingLength;
+
+    struct originSetCDT *   set;
+} originEntry;
+
+struct originSetCDT {
+    originEntry             origins[ORIGIN_SET_MAX_SIZE];
+    size_t                  size;
+    MultiplexorADT          mux;
+    int                     timerFd;
+    /** Anillo de hashing consistente para la afinidad por usuario. */
+    hashRingADT             ring;
+    unsigned long long      affinityHits;
+    unsigned long long      affinityMisses;
+};
+
+static void probeRead(MultiplexorKey key);
+static void probeWrite(MultiplexorKey key);
+static void healthTick(MultiplexorKey key);
+static void healthResolved(MultiplexorKey key);
+
+static const eventHandler probeHandler = {
+    .read    = probeRead,
+    .write   = probeWrite,
+    .block   = NULL,
+    .close   = NULL,
+    .timeout = NULL,
+};
+
+static const eventHandler healthHandler = {
+    .read    = healthTick,
+    .write   = NULL,
+    .block   = healthResolved,
+    .close   = NULL,
+    .timeout = NULL,
+};
+
+static const char * quitMsg = "QUIT\r\n";
+
+originSetADT createOriginSet(const char * list, const in_port_t port) {
+    char   copy[ORIGIN_SET_MAX_SIZE * 0xFF];
+    char * savePtr = NULL;
+
+    if(list == NULL || strlen(list) >= sizeof(copy))
+        return NULL;
+    originSetADT set = calloc(1, sizeof(*set));
+    if(set == NULL)
+        return NULL;
+    set->timerFd = -1;
+    strcpy(copy, list);
+
+    /** strtok_r ignora los tokens vacíos, se verifican antes. */
+    if(list[0] == ',' || list[strlen(list) - 1] == ',' || strstr(list, ",,") != NULL)
+        goto fail;
+    for(char * token = strtok_r(copy, ",", &savePtr); token != NULL; token = strtok_r(NULL, ",", &savePtr)) {
+        if(set->size == ORIGIN_SET_MAX_SIZE || strlen(token) >= sizeof(set->origins[0].name))
+            goto fail;
+        originEntry * origin = set->origins + set->size++;
+        strcpy(origin->name, token);
+        origin->address.port = port;
+        setAddress(&origin->address, token);
+        origin->healthy = true;
+        origin->probeFd = -1;
+        origin->set     = set;
+    }
+    if(set->size == 0)
+        goto fail;
+    set->ring = createHashRing(RING_VIRTUAL_NODES);
+    if(set->ring == NULL)
+        goto fail;
+    for(size_t i = 0; i < set->size; i++)
+        if(!hashRingAdd(set->ring, i, set->origins[i].name))
+            goto fail;
+    return set;
+
+fail:
+    deleteHashRing(set->ring);
+    free(set);
+    return NULL;
+}
+
+/**
+ * Cierra el chequeo en curso del origin, si hay uno.
+ */
+static void closeProbe(originEntry * origin) {
+    if(origin->probe == PROBE_RESOLVING)
+        resolverCancel(&origin->resolution);
+    if(origin->probeFd != -1) {
+        unregisterFd(origin->set->mux, origin->probeFd);
+        close(origin->probeFd);
+    }
+    origin->probeFd = -1;
+    origin->probe   = PROBE_IDLE;
+}
+
+void deleteOriginSet(originSetADT set) {
+    if(set == NULL)
+        return;
+    for(size_t i = 0; i < set->size; i++)
+        closeProbe(set->origins + i);
+    if(set->timerFd != -1) {
+        unregisterFd(set->mux, set->timerFd);
+        close(set->timerFd);
+    }
+    deleteHashRing(set->ring);
+    free(set);
+}
+
+size_t originSetSize(originSetADT set) {
+    return set->size;
+}
+
+const addressData * originSetAddress(originSetADT set, const size_t index) {
+    return &set->origins[index].address;
+}
+
+const char * originSetName(originSetADT set, const size_t index) {
+    return set->origins[index].name;
+}
+
+bool originSetIsHealthy(originSetADT set, const size_t index) {
+    return set->origins[index].healthy;
+}
+
+bool originSetStartHealthChecks(originSetADT set, MultiplexorADT mux) {
+    set->mux     = mux;
+    set->timerFd = timerFdCreate();
+    if(set->timerFd == -1)
+        return false;
+    if(timerFdArmPeriodic(set->timerFd, HEALTH_TICK_MS) == -1 ||
+       MUX_SUCCESS != registerFd(mux, set->timerFd, &healthHandler, READ, set)) {
+        close(set->timerFd);
+        set->timerFd = -1;
+        return false;
+    }
+    return true;
+}
+
+
+size_t originSetAcquire(originSetADT set) {
+    size_t candidates[ORIGIN_SET_MAX_SIZE], size = 0;
+
+    for(size_t i = 0; i < set->size; i++)
+        if(set->origins[i].healthy)
+            candidates[size++] = i;
+    /** Sin origins sanos se prueba con todos. */
+    if(size == 0)
+        for(; size < set->size; size++)
+            candidates[size] = size;
+
+    size_t chosen = candidates[0];
+    if(size > 1) {
+        const size_t first  = (size_t) rand() % size;
+        const size_t second = (first + 1 + (size_t) rand() % (size - 1)) % size;
+        /** A igualdad de sesiones activas queda la primera elección al azar. */
+        chosen = (set->origins[candidates[second]].activeSessions < set->origins[candidates[first]].activeSessions)?
+                    candidates[second] : candidates[first];
+    }
+    set->origins[chosen].activeSessions++;
+    set->origins[chosen].totalSessions++;
+    return chosen;
+}
+
+static bool ringAcceptsHealthy(const size_t node, void * data) {
+    return ((originSetADT) data)->origins[node].healthy;
+}
+
+size_t originSetAcquireFor(originSetADT set, const char * key, const size_t length) {
+    size_t chosen, preferred;
+
+    if(!hashRingLookup(set->ring, (const uint8_t *) key, length, &preferred) ||
+       !hashRingLookupFiltered(set->ring, (const uint8_t *) key, length, ringAcceptsHealthy, set, &chosen))
+        return originSetAcquire(set);
+    if(chosen == preferred)
+        set->affinityHits++;
+    else
+        set->affinityMisses++;
+    set->origins[chosen].activeSessions++;
+    set->origins[chosen].totalSessions++;
+    return chosen;
+}
+
+void originSetRelease(originSetADT set, const size_t index) {
+    if(set->origins[index].activeSessions > 0)
+        set->origins[index].activeSessions--;
+}
+
+static void updateLatency(originEntry * origin, const double milliseconds) {
+    origin->latency = (origin->latency == 0)? milliseconds :
+                        origin->latency + LATENCY_WEIGHT * (milliseconds - origin->latency);
+}
+
+void originSetConnected(originSetADT set, const size_t index, const double milliseconds) {
+    originEntry * origin = set->origins + index;
+    updateLatency(origin, milliseconds);
+    origin->consecutiveFails = 0;
+}
+
+/**
+ * Registra un fallo y deja de usar el origin si se acumularon demasiados.
+ */
+static void markFailure(originEntry * origin) {
+    origin->consecutivePasses = 0;
+    if(++origin->consecutiveFails >= ORIGIN_HEALTH_FAILS && origin->healthy) {
+        origin->healthy = false;
+        origin->ejections++;
+        logWarn("Origin %s is unhealthy, no new sessions will use it.", origin->name);
+    }
+}
+
+void originSetFailed(originSetADT set, const size_t index) {
+    set->origins[index].failures++;
+    markFailure(set->origins + index);
+}
+
+static void probeFinished(originEntry * origin, const bool passed) {
+    struct timespec now;
+
+    closeProbe(origin);
+    origin->nextProbe = time(NULL) + ORIGIN_HEALTH_INTERVAL;
+    if(!passed) {
+        origin->failedProbes++;
+        markFailure(origin);
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    updateLatency(origin, (now.tv_sec - origin->probeStart.tv_sec) * 1000.0 +
+                          (now.tv_nsec - origin->probeStart.tv_nsec) / 1000000.0);
+    origin->consecutiveFails = 0;
+    if(++origin->consecutivePasses >= ORIGIN_HEALTH_PASSES && !origin->healthy) {
+        origin->healthy = true;
+        logInfo("Origin %s is healthy again.", origin->name);
+    }
+}
+
+static void probeConnect(originEntry * origin, const struct sockaddr * address, const socklen_t length) {
+    origin->probeFd = socket(address->sa_family, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    if(origin->probeFd == -1 || fdSetNIO(origin->probeFd) == -1 ||
+       (connect(origin->probeFd, address, length) == -1 && errno != EINPROGRESS)) {
+        if(origin->probeFd != -1)
+            close(origin->probeFd);
+        origin->probeFd = -1;
+        probeFinished(origin, false);
+        return;
+    }
+    if(MUX_SUCCESS != registerFd(origin->set->mux, origin->probeFd, &probeHandler, WRITE, origin)) {
+        close(origin->probeFd);
+        origin->probeFd = -1;
+        probeFinished(origin, false);
+        return;
+    }
+    origin->probe          = PROBE_CONNECTING;
+    origin->greetingLength = 0;
+}
+
+/**
+ * Conecta el chequeo a la primera dirección resuelta.
+ */
+static void probeResolved(originEntry * origin) {
+    if(origin->resolution.status != RESOLVER_DONE || origin->resolution.answer.count == 0) {
+        origin->probe = PROBE_IDLE;
+        probeFinished(origin, false);
+        return;
+    }
+    probeConnect(origin, (const struct sockaddr *) &origin->resolution.answer.addresses[0],
+                 origin->resolution.answer.lengths[0]);
+}
+
+static void startProbe(originEntry * origin) {
+    const addressData * address = &origin->address;
+
+    origin->probes++;
+    origin->probeDeadline = time(NULL) + ORIGIN_HEALTH_TIMEOUT;
+    clock_gettime(CLOCK_MONOTONIC, &origin->probeStart);
+    if(address->type != ADDR_DOMAIN) {
+        probeConnect(origin, (const struct sockaddr *) &address->addr.addrStorage, address->addrLength);
+        return;
+    }
+    origin->probe = PROBE_RESOLVING;
+    if(RESOLVER_PENDING != resolverResolve(&origin->resolution, origin->set->mux, origin->set->timerFd,
+                                           address->addr.fqdn, address->port))
+        probeResolved(origin);
+}
+
+static void healthTick(MultiplexorKey key) {
+    originSetADT set = (originSetADT) key->data;
+    const time_t now = time(NULL);
+
+    if(!timerFdClear(key->fd))
+        logError("Problem reading health check timer.");
+    for(size_t i = 0; i < set->size; i++) {
+        originEntry * origin = set->origins + i;
+        if(origin->probe == PROBE_IDLE && now >= origin->nextProbe)
+            startProbe(origin);
+        else if(origin->probe != PROBE_IDLE && now >= origin->probeDeadline)
+            probeFinished(origin, false);
+    }
+}
+
+/**
+ * El resolver notifica al timer; se continúan los chequeos ya resueltos.
+ */
+static void healthResolved(MultiplexorKey key) {
+    originSetADT set = (originSetADT) key->data;
+
+    for(size_t i = 0; i < set->size; i++) {
+        originEntry * origin = set->origins + i;
+        if(origin->probe == PROBE_RESOLVING && RESOLVER_PENDING != resolverPoll(&origin->resolution))
+            probeResolved(origin);
+    }
+}
+
+static void probeWrite(MultiplexorKey key) {
+    originEntry * origin = (originEntry *) key->data;
+    int           error;
+    socklen_t     length = sizeof(error);
+
+    if(getsockopt(key->fd, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0 ||
+       MUX_SUCCESS != setInterestKey(key, READ)) {
+        probeFinished(origin, false);
+        return;
+    }
+    origin->probe = PROBE_HELLO;
+}
+
+/**
+ * Lee el saludo del origin. El chequeo pasa si la primera linea es +OK.
+ */
+static void probeRead(MultiplexorKey key) {
+    originEntry * origin = (originEntry *) key->data;
+    const size_t  space  = sizeof(origin->greeting) - origin->greetingLength;
+    const ssize_t n      = recv(key->fd, origin->greeting + origin->greetingLength, space, 0);
+
+    if(n <= 0) {
+        probeFinished(origin, false);
+        return;
+    }
+    origin->greetingLength += n;
+    if(memchr(origin->greeting, '\n', origin->greetingLength) == NULL) {
+        if(origin->greetingLength == sizeof(origin->greeting))
+            probeFinished(origin, false);
+        return;
+    }
+    const bool passed = origin->greetingLength >= 3 && strncmp(origin->greeting, "+OK", 3) == 0;
+    /** Se despide sin esperar la respuesta. */
+    if(passed && send(key->fd, quitMsg, strlen(quitMsg), MSG_NOSIGNAL) < 0)
+        logDebug("Unable to send QUIT to origin %s.", origin->name);
+    probeFinished(origin, passed);
+}
+
+size_t originSetStatistics(originSetADT set, char * buffer, const size_t size) {
+    size_t written = 0;
+
+    if(set == NULL || size == 0)
+        return 0;
+    for(size_t i = 0; i < set->size && written < size - 1; i++) {
+        const originEntry * origin = set->origins + i;
+        const int n = snprintf(buffer + written, size - written,
+            "origin %s: %s sessions %llu total %llu failures %llu latency %.1fms probes %llu failed-probes %llu ejections %llu\n",
+            origin->name, origin->healthy? "healthy" : "unhealthy", origin->activeSessions, origin->totalSessions,
+            origin->failures, origin->latency, origin->probes, origin->failedProbes, origin->ejections);
+        if(n < 0)
+            break;
+        written += ((size_t) n >= size - written)? size - written - 1 : (size_t) n;
+    }
+    if(set->affinityHits + set->affinityMisses > 0 && written < size - 1) {
+        const int n = snprintf(buffer + written, size - written, "origin affinity: hits %llu moved %llu\n",
+            set->affinityHits, set->affinityMisses);
+        if(n >= 0)
+            written += ((size_t) n >= size - written)? size - written - 1 : (size_t) n;
+    }
+    return written;
+}
@@ -28,11 +28,29 @@
 #include "commandParser.h"
 #include "responseParser.h"
 #include "netutils.h"
+#include "originPool.h"
+#include "capaCache.h"
+#include "resolver.h"
+#include "happyEyeballs.h"
+#include "originSet.h"
+#include "retrPrefetch.h"
+#include "filterCache.h"
+#include "filterPool.h"
+#include "filterBypass.h"
+#include "filterLimit.h"
+#include "filterWatchdog.h"
+#include "bodyPop3Parser.h"
+#include "stripmimeEngine.h"
+#include "processSpawn.h"
+#include "timerFd.h"
+#include "deferredConnect.h"
+#include "filterStuff.h"
 
 /**
  * Estados para la máquina de estados.
  */
 typedef enum proxyPopv3State {
+    LOCAL_AUTHORIZATION,
     CONNECTION_RESOLV,
     CONNECTING,
     HELLO,
@@ -49,7 +67,18 @@ typedef enum proxyPopv3State {
 /** Tamaño maximo de un argumento en POP3.                 */
 #define MAX_ARGS_LENGTH 40
 
-#define SLAVE_BUFFER_SIZE 1
+/** Shell con el que se ejecuta el comando de filtro. */
+#define FILTER_SHELL_PATH "/bin/sh"
+/**
+ * Bytes del cuerpo que se le entregan al stripmime o al comando por vez, o
+ * la capacidad de los pipes del comando si es mayor.
+ */
+#define FILTER_INLINE_CHUNK 4096
+
+/** Tamaño maximo de la respuesta a CAPA que se guarda para responder localmente. */
+#define CAPA_RESPONSE_SIZE 1024
+/** Cantidad de clientes APOP recordados para conectarlos sin demora. */
+#define APOP_CLIENTS_SIZE 64
 
 /**
  * Estructura de una sesión, guarda el nombre de usuario logeado en la sesion
@@ -82,8 +111,26 @@ typedef struct checkCapabilitiesStruct {
     ssize_t             sentSize;
     capabilities *      capabilities;
     capaParser          parser;
+    /** Copia de la respuesta cruda, para responder CAPA sin el origin. */
+    uint8_t             response[CAPA_RESPONSE_SIZE];
+    size_t              responseLength;
+    bool                responseOverflow;
 } checkCapabilitiesStruct;
 
+/**
+ * Estructura con lo necesario para atender al cliente antes de conectarse
+ * con el origin server (modo de conexión diferida).
+ */
+typedef struct deferredStruct {
+    /** El cliente ya recibió el saludo del proxy, se descarta el del origin. */
+    bool                    localGreeting;
+    /** Hay un comando en el readBuffer que debe reenviarse al origin. */
+    bool                    connectPending;
+    /** El cliente envió QUIT, se cierra al terminar de responder. */
+    bool                    quit;
+    struct sockaddr_storage clientAddr;
+} deferredStruct;
+
 /**
  * Posibles objetivos para el estado COPY.
  */
@@ -126,6 +173,25 @@ typedef enum filterState {
     FILTER_ALL_SENT,
     FILTER_STARTING,
     FILTER_FILTERING,
+    /**
+     * Se junta el cuerpo del RETR para buscarlo en el cache del filtro o
+     * para decidir si hace falta filtrarlo.
+     */
+    FILTER_SPOOLING,
+    /**
+     * Se envía al cliente la salida guardada en el cache del filtro o, sin
+     * filtrar, el comienzo de un cuerpo que no hace falta filtrar.
+     */
+    FILTER_CACHED,
+    /** El cuerpo se filtra con el stripmime del proxy. */
+    FILTER_INLINE,
+    /** El cuerpo juntado espera un lugar en filterLimit para iniciar el filtro. */
+    FILTER_QUEUED,
+    /**
+     * Venció un plazo del filtro y se envía el mensaje de reemplazo: se
+     * descarta lo que falta del cuerpo y luego se sigue como FILTER_CACHED.
+     */
+    FILTER_DISCARDING,
 } filterState;
 
 /**
@@ -136,8 +202,60 @@ typedef struct filterDataStruct {
     int                 outfd[2];
     pid_t               slavePid;
     filterState         state;
+    /** El filtro es un worker del pool de filtros. */
+    bool                pooled;
+    size_t              worker;
+    filterPoolScanner   end;
+    /**
+     * Modo batch: el cuerpo sin dot-stuffing se junta en un memfd (infd[1])
+     * y el comando se lanza al completarse, con el memfd como entrada y
+     * `batchOutput' como salida. outfd[0] es el pidfd del comando: cuando es
+     * legible el comando terminó y su salida se lee de `batchOutput'.
+     */
+    bool                batch;
+    bool                batchExited;
+    int                 batchOutput;
+    off_t               batchOffset;
 } filterDataStruct;
 
+/**
+ * Cuerpo del RETR que se filtra, para buscar o guardar en el cache del
+ * filtro la salida que le corresponde.
+ */
+typedef struct filterSpoolStruct {
+    filterCacheKey      key;
+    /** SHA-256 del cuerpo en curso, se vuelca en `key.digest' al completarse. */
+    sha256Context       digest;
+    /** Cuerpo enviado por el origin o, si estaba en cache, la salida guardada. */
+    filterCacheBytes    body;
+    /** Bytes de `body' ya entregados al filtro o al cliente. */
+    size_t              sent;
+    /** No llegan más bytes del cuerpo, todos están en `body'. */
+    bool                complete;
+    /** La salida del filtro se junta en `output' para guardarla. */
+    bool                capture;
+    filterCacheBytes    output;
+    /** Bytes de `body' y `output' reservados en el cache con filterCacheSpoolReserve. */
+    size_t              reserved;
+    /** Decide si el cuerpo se envía sin filtrar. */
+    filterSniffer       sniffer;
+} filterSpoolStruct;
+
+/**
+ * Filtro stripmime ejecutado en el proxy. El cuerpo se le entrega sin
+ * dot-stuffing y su salida se guarda, con dot-stuffing, hasta que entra en
+ * el filterBuffer. Con un comando externo (sin pool) se usa igual: el
+ * cuerpo sin dot-stuffing va a la entrada del comando y su salida se guarda
+ * con dot-stuffing.
+ */
+typedef struct filterInlineStruct {
+    /** NULL si no se pudo crear o tuvo un error, el resto del cuerpo se descarta. */
+    stripmimeADT        stripmime;
+    filterStuffStruct   stuff;
+    /** Bytes de `stuff.output' ya copiados al filterBuffer. */
+    size_t              sent;
+} filterInlineStruct;
+
 /**
  * Estructura con lo necesario para parsear commands enviados por
  * un cliente.
@@ -172,13 +290,27 @@ typedef struct proxyPopv3 {
 
     copyState                      copyState;
     filterDataStruct               filterData;
+    filterSpoolStruct              filterSpool;
+    filterInlineStruct             filterInline;
+    /** Lugar del filtro en filterLimit, se libera al cerrar el filtro. */
+    filterLimitWaiter              filterSlot;
+    MultiplexorADT                 filterSlotMux;
+    /** Plazos del filtro, con un timerfd que se crea con el primer filtro. */
+    filterWatchdog                 watchdog;
+    int                            watchdogFd;
+    /** Cuerpo entregado al filtro desde el writeBuffer, para el fallback pass. */
+    filterCacheBytes               watchdogInput;
+    bool                           watchdogInputFailed;
     requestStruct                  request;
 
     commandParser                  commandParser;
     responseParser                 responseParser;
 
     capabilities                   originCapabilities;
+    /** Las capacidades del origin ya se conocen, no se envía CAPA. */
+    bool                           capabilitiesKnown;
     errorContainer                 errorSender;
+    deferredStruct                 deferred;
 
     /** Estados para el clientFd. */
     union {    
@@ -198,11 +330,18 @@ typedef struct proxyPopv3 {
         copyStruct                 copy;
     } filter;
 
+    /** Origin elegido para la sesión. */
+    size_t                         originIndex;
+    bool                           originAcquired;
     addressData                    originAddrData;
+    /** Inicio de la conexión con el origin, para medir su latencia. */
+    struct timespec                connectStart;
     /** Resolución de la dirección del origin server. */
-    struct addrinfo               *originResolution;
-    /** Intento actual de la dirección del origin server. */
-    struct addrinfo               *originResolutionCurrent;
+    resolverRequest                resolution;
+    /** Intentos de conexión en curso con el origin server. */
+    happyEyeballsStruct            eyeballs;
+    /** RETR pedido al origin antes de que lo pida el cliente. */
+    retrPrefetchStruct             prefetch;
 
     /** Maquinas de estados. */
     struct stateMachineCDT stm;
@@ -223,12 +362,41 @@ static const unsigned       maxPool  = 50; // Tamaño máximo.
 static unsigned             poolSize = 0;  // Tamaño actual.
 static struct proxyPopv3 *  pool     = 0;  // Pool propiamente dicho.
 
+/**
+ * Última respuesta completa a CAPA de cada origin server. Permite contestar
+ * CAPA en el modo de conexión diferida sin contactar al origin.
+ */
+static deferredCapaADT      deferredCapa = NULL;
+
+/**
+ * Clientes que intentaron usar APOP en modo diferido. El saludo local no
+ * tiene el timestamp del origin, por lo que se los conecta sin demora.
+ */
+static struct sockaddr_storage  apopClients[APOP_CLIENTS_SIZE];
+static unsigned                 apopClientsSize = 0;
+static unsigned                 apopClientsNext = 0;
+
+/** Origins entre los que se reparten las sesiones. */
+static originSetADT             originSet = NULL;
+/** Conexiones con el origin que ya leyeron el saludo y CAPA. */
+static originPoolADT            warmPool = NULL;
+/** Capacidades conocidas de cada origin, se crea al primer uso. */
+static capaCacheADT             capaCache = NULL;
+/** Salida del filtro para cada mensaje, se crea al primer uso. */
+static filterCacheADT           filterCache = NULL;
+static bool                     filterCacheFailed = false;
+/** Cuerpo sin dot-stuffing para el stripmime del proxy o el comando de filtro, se crea al primer uso. */
+static bufferADT                filterInlineBody = NULL;
+/** Ya se avisó que no se pudo cambiar la capacidad de los pipes del filtro. */
+static bool                     pipeSizeFailed = false;
+
 static const struct stateDefinition * proxyPopv3DescribeStates(void);
+static void filterSpoolRelease(filterSpoolStruct * spool);
 
 /** 
  * Crea un nuevo `proxyPopv3' 
  */
-static proxyPopv3 * newProxyPopv3(int clientFd, addressData originAddrData, size_t bufferSize) {
+static proxyPopv3 * newProxyPopv3(int clientFd, size_t bufferSize) {
    
     struct proxyPopv3 * ret;
     bufferADT readBuffer, writeBuffer, filterBuffer;
@@ -257,6 +425,7 @@ static proxyPopv3 * newProxyPopv3(int clientFd, addressData originAddrData, size
 
     ret->clientFd           = clientFd;
     ret->originFd           = -1;
+    ret->watchdogFd         = -1;
     ret->readBuffer         = readBuffer;
     ret->writeBuffer        = writeBuffer;
     ret->filterBuffer       = filterBuffer;
@@ -266,7 +435,7 @@ static proxyPopv3 * newProxyPopv3(int clientFd, addressData originAddrData, size
     responseParserInit(&ret->responseParser);
 
     ret->session.lastUse        = time(NULL);
-    ret->originAddrData         = originAddrData;
+    happyEyeballsInit(&ret->eyeballs, NULL, NULL, 0, 0);
 
     ret->stm.initial            = CONNECTION_RESOLV;
     ret->stm.maxState           = ERROR;
@@ -292,11 +461,6 @@ static void realDeleteProxyPopv3(proxyPopv3 * proxy) {
     for(;current != NULL; current = poll(proxy->request.commands))
         deleteCommand(current);
     deleteQueue(proxy->request.commands);
-
-    if(proxy->originResolution != NULL) {
-        freeaddrinfo(proxy->originResolution);
-        proxy->originResolution = 0;
-    }
     free(proxy);
 }
 
@@ -307,6 +471,12 @@ static void realDeleteProxyPopv3(proxyPopv3 * proxy) {
 static void deleteProxyPopv3(proxyPopv3 * proxy) {
     if(proxy != NULL) {
         if(proxy->references == 1) {
+            retrPrefetchDestroy(&proxy->prefetch);
+            filterSpoolRelease(&proxy->filterSpool);
+            filterCacheBytesFree(&proxy->filterSpool.body);
+            filterCacheBytesFree(&proxy->filterSpool.output);
+            filterStuffFree(&proxy->filterInline.stuff);
+            filterCacheBytesFree(&proxy->watchdogInput);
             if(poolSize < maxPool) {
                 proxy->next = pool;
                 pool        = proxy;
@@ -327,8 +497,117 @@ static void deleteProxyPopv3(proxyPopv3 * proxy) {
     }
 }
 
+void proxyPopv3OriginsInit(MultiplexorADT mux, originSetADT origins) {
+    originSet = origins;
+    deferredCapa = createDeferredCapa(originSetSize(origins));
+    if(deferredCapa == NULL)
+        logError("Unable to keep the origin capabilities, CAPA will not be answered locally.");
+    if(originSetSize(origins) > 1) {
+        if(proxyConf.warmPoolSize > 0)
+            logWarn("The warm pool is only available with a single origin server.");
+        if(!originSetStartHealthChecks(origins, mux))
+            logError("Unable to start the origin health checks.");
+    } else if(proxyConf.warmPoolSize > 0)
+        warmPool = createOriginPool(mux, originSetAddress(origins, 0), proxyConf.warmPoolSize, ORIGIN_POOL_MAX_IDLE_AGE);
+}
+
+void proxyPopv3OriginsDestroy(void) {
+    deleteOriginPool(warmPool);
+    warmPool = NULL;
+    deleteOriginSet(originSet);
+    originSet = NULL;
+    deleteDeferredCapa(deferredCapa);
+    deferredCapa = NULL;
+}
+
+size_t proxyPopv3Statistics(char * buffer, const size_t size) {
+    size_t written = originSetStatistics(originSet, buffer, size);
+    written += originPoolStatistics(warmPool, buffer + written, size - written);
+    written += capaCacheStatistics(capaCache, buffer + written, size - written);
+    written += resolverStatistics(buffer + written, size - written);
+    written += happyEyeballsStatistics(buffer + written, size - written);
+    written += retrPrefetchStatistics(buffer + written, size - written);
+    written += filterCacheStatistics(filterCache, buffer + written, size - written);
+    written += filterPoolStatistics(buffer + written, size - written);
+    written += filterBypassStatistics(buffer + written, size - written);
+    written += filterLimitStatistics(buffer + written, size - written);
+    written += filterWatchdogStatistics(buffer + written, size - written);
+    return written;
+}
+
+void proxyPopv3InvalidateCapabilities(void) {
+    capaCacheInvalidate(capaCache);
+    deferredCapaInvalidate(deferredCapa);
+}
+
+static capaCacheADT getCapaCache(void) {
+    if(capaCache == NULL && proxyConf.capaCacheTtl > 0)
+        capaCache = createCapaCache(proxyConf.capaCacheTtl);
+    return capaCache;
+}
+
+static filterCacheADT getFilterCache(void) {
+    if(filterCache == NULL && !filterCacheFailed && proxyConf.filterCacheSize > 0) {
+        filterCache = createFilterCache(proxyConf.filterCacheSize, proxyConf.filterCacheDirectory, proxyConf.filterCacheDiskSize);
+        if(filterCache == NULL) {
+            logError("Unable to create the filter cache, filtering without it.");
+            filterCacheFailed = true;
+        }
+    }
+    return filterCache;
+}
+
+/**
+ * Origin server de la sesión como figura en la lista de origins, el que
+ * recibe el filtro en POP3_SERVER.
+ */
+static const char * sessionServer(const proxyPopv3 * proxy) {
+    return proxy->originAcquired? originSetName(originSet, proxy->originIndex) : proxyConf.stringServer;
+}
+
+/**
+ * Hash de lo que determina la salida del filtro además del cuerpo: comando,
+ * media types, mensaje de reemplazo y servidor de la sesión, con sus etags,
+ * y el usuario y la dirección del origin server de la sesión, que el filtro
+ * recibe en su entorno.
+ */
+static uint64_t filterConfigHash(const proxyPopv3 * proxy) {
+    const int etags[]      = {proxyConf.etags[transformCommandEtag], proxyConf.etags[mediaRangeEtag],
+                              proxyConf.etags[replaceMsgEtag], proxyConf.etags[stringServerEtag]};
+    const char * values[]  = {proxyConf.filterCommand, proxyConf.mediaRange, proxyConf.replaceMsg, sessionServer(proxy)};
+    uint64_t hash = filterCacheHash(FILTER_CACHE_HASH_SEED, (const uint8_t *) etags, sizeof(etags));
+
+    for(unsigned i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        if(values[i] != NULL)
+            hash = filterCacheHash(hash, (const uint8_t *) values[i], strlen(values[i]) + 1);
+        else
+            hash = filterCacheHash(hash, (const uint8_t *) "\xff", 1);
+    }
+    return filterCacheSessionConfig(hash, proxy->session.name, proxy->session.originString);
+}
+
+/** Se filtra con el stripmime del proxy (-i). */
+static bool isInlineFilter(void) {
+    return proxyConf.filterInline;
+}
+
+/**
+ * El cuerpo del RETR se junta antes de iniciar el filtro: para el cache del
+ * filtro o para enviar sin filtrar los mensajes que no lo necesitan.
+ */
+static bool isFilterSpooled(void) {
+    return getFilterCache() != NULL || proxyConf.filterBypassSize > 0;
+}
+
 void poolProxyPopv3Destroy(void) {
     proxyPopv3 * next, * current;
+    deleteCapaCache(capaCache);
+    capaCache = NULL;
+    deleteFilterCache(filterCache);
+    filterCache = NULL;
+    if(filterInlineBody != NULL)
+        deleteBuffer(filterInlineBody);
+    filterInlineBody = NULL;
     for(current = pool; current != NULL ; current = next) {
         next = current->next;
         realDeleteProxyPopv3(current);
@@ -366,8 +645,13 @@ static const eventHandler proxyPopv3Handler = {
  * Declaración forward de los handlers de selección de una conexión
  * establecida entre un cliente y el proxy.
  */
-static void * resolvBlocking(void * data);
+static unsigned useResolution(MultiplexorADT mux, proxyPopv3 * proxy);
 static unsigned connecting(MultiplexorADT mux, proxyPopv3  * proxy);
+static void closeConnectionAttempts(MultiplexorADT mux, proxyPopv3 * proxy);
+static unsigned originConnect(MultiplexorADT mux, proxyPopv3 * proxy);
+static unsigned pooledOriginConnect(MultiplexorADT mux, proxyPopv3 * proxy, pooledOrigin * pooled);
+static unsigned localGreeting(MultiplexorADT mux, proxyPopv3 * proxy);
+static bool isApopClient(const struct sockaddr * client);
 
 /**
  * Intenta aceptar la nueva conexión entrante.
@@ -376,21 +660,16 @@ void proxyPopv3PassiveAccept(MultiplexorKey key) {
 
     struct sockaddr_storage       clientAddr;
     socklen_t                     clientAddrSize = sizeof(clientAddr);
-    addressData *                 originAddrData = (addressData *) key->data;
     proxyPopv3 *                  proxy          = NULL;
-    pthread_t                     tid;
     
     proxyMetrics.activeConnections++;
     proxyMetrics.totalConnections++;
 
-    const int clientFd = accept(key->fd, (struct sockaddr*) &clientAddr, &clientAddrSize);
+    const int clientFd = fdAccept(key->fd, (struct sockaddr*) &clientAddr, &clientAddrSize);
     if(clientFd == -1) {
         goto fail;
     }
-    if(fdSetNIO(clientFd) == -1) {
-        goto fail;
-    }
-    proxy = newProxyPopv3(clientFd, *originAddrData, proxyConf.bufferSize);
+    proxy = newProxyPopv3(clientFd, proxyConf.bufferSize);
 
     if(proxy == NULL) {
         /** 
@@ -410,30 +689,14 @@ void proxyPopv3PassiveAccept(MultiplexorKey key) {
         goto fail;
     }
 
-    if(originAddrData->type != ADDR_DOMAIN) 
-        proxy->stm.initial = connecting(key->mux, proxy);
-    else {
-        logInfo("Need to resolv the domain name: %s.", originAddrData->addr.fqdn);
-        MultiplexorKey blockingKey = malloc(sizeof(*blockingKey));
-        if(blockingKey == NULL)
-            goto fail2;
-
-        blockingKey->mux  = key->mux;
-        blockingKey->fd   = clientFd;
-        blockingKey->data = proxy;
-        if(-1 == pthread_create(&tid, 0, resolvBlocking, blockingKey)) {            
-            logError("Unable to create a new thread. Client Address: %s", proxy->session.clientString);
-            
-            proxy->errorSender.message = "-ERR Unable to connect.\r\n";
-            if(MUX_SUCCESS != setInterest(key->mux, proxy->clientFd, WRITE))
-                goto fail2;
-            proxy->stm.initial = SEND_ERROR_MSG;
-        }
-    }
+    memcpy(&proxy->deferred.clientAddr, &clientAddr, clientAddrSize);
+    originPoolAccepted(warmPool);
+    if(proxyConf.deferredConnection && !isApopClient(client))
+        proxy->stm.initial = localGreeting(key->mux, proxy);
+    else
+        proxy->stm.initial = originConnect(key->mux, proxy);
     return;
 
-fail2:
-    unregisterFd(key->mux, clientFd);
 fail:    
     logError("Proxy passive accept fail. Client Address: %s", proxy->session.clientString);
     proxyMetrics.activeConnections--;
@@ -443,141 +706,452 @@ fail:
     deleteProxyPopv3(proxy);
 }
 
+/**
+ * Pasa a COPY una vez conocidas las capacidades del origin. En modo diferido
+ * el comando que disparó la conexión espera en el readBuffer.
+ */
+static unsigned enterCopy(MultiplexorADT mux, proxyPopv3 * proxy) {
+    const fdInterest originInterest = canProcess(proxy->readBuffer) ? READ | WRITE : READ;
+    if(MUX_SUCCESS != setInterest(mux, proxy->originFd, originInterest) ||
+       MUX_SUCCESS != setInterest(mux, proxy->clientFd, READ))
+        return ERROR;
+    return COPY;
+}
+
+/**
+ * Utiliza una conexión del warm pool, que ya leyó el saludo y la respuesta
+ * a CAPA. El saludo guardado se reenvía al cliente salvo que ya haya recibido
+ * el saludo local. Retorna CONNECTION_RESOLV si la conexión no pudo usarse.
+ */
+static unsigned pooledOriginConnect(MultiplexorADT mux, proxyPopv3 * proxy, pooledOrigin * pooled) {
+    struct sockaddr_storage originAddr;
+    socklen_t               originAddrSize = sizeof(originAddr);
+    size_t                  count;
+    uint8_t *               writePtr       = getWritePtr(proxy->writeBuffer, &count);
+
+    if((!proxy->deferred.localGreeting && count < pooled->greetingLength) ||
+       MUX_SUCCESS != registerFd(mux, pooled->fd, &proxyPopv3Handler, NO_INTEREST, proxy)) {
+        close(pooled->fd);
+        return CONNECTION_RESOLV;
+    }
+    proxy->originFd           = pooled->fd;
+    proxy->originCapabilities = pooled->capabilities;
+    proxy->capabilitiesKnown  = true;
+    proxy->references        += 1;
+    if(getpeername(proxy->originFd, (struct sockaddr *) &originAddr, &originAddrSize) == 0)
+        sockaddrToString(proxy->session.originString, MAX_STRING_IP_LENGTH, (const struct sockaddr *) &originAddr);
+    logInfo("Connection taken from warm pool. Client Address: %s; Origin Address: %s.", proxy->session.clientString, proxy->session.originString);
+
+    if(proxy->deferred.localGreeting)
+        return enterCopy(mux, proxy);
+
+    /** HELLO parsea el saludo pendiente al iniciar y lo envía al cliente. */
+    memcpy(writePtr, pooled->greeting, pooled->greetingLength);
+    updateWritePtr(proxy->writeBuffer, pooled->greetingLength);
+    if(MUX_SUCCESS != setInterest(mux, proxy->clientFd, WRITE))
+        return ERROR;
+    return HELLO;
+}
+
+/**
+ * Inicia la conexión con el origin server, resolviendo antes el nombre
+ * en un hilo aparte si es necesario.
+ */
+static unsigned originConnect(MultiplexorADT mux, proxyPopv3 * proxy) {
+    pooledOrigin pooled;
+
+    if(!proxy->originAcquired) {
+        const size_t nameLength = strlen(proxy->session.name);
+        proxy->originIndex    = (proxyConf.usernameAffinity && nameLength > 0)?
+                                    originSetAcquireFor(originSet, proxy->session.name, nameLength) :
+                                    originSetAcquire(originSet);
+        proxy->originAcquired = true;
+        proxy->originAddrData = *originSetAddress(originSet, proxy->originIndex);
+    }
+
+    if(originPoolTake(warmPool, &pooled)) {
+        const unsigned ret = pooledOriginConnect(mux, proxy, &pooled);
+        if(ret != CONNECTION_RESOLV)
+            return ret;
+    }
+
+    if(proxy->originAddrData.type != ADDR_DOMAIN) {
+        happyEyeballsInit(&proxy->eyeballs, &proxy->originAddrData.addr.addrStorage,
+                          &proxy->originAddrData.addrLength, 1, time(NULL));
+        return connecting(mux, proxy);
+    }
+
+    logInfo("Need to resolv the domain name: %s.", proxy->originAddrData.addr.fqdn);
+    switch(resolverResolve(&proxy->resolution, mux, proxy->clientFd,
+                proxy->originAddrData.addr.fqdn, proxy->originAddrData.port)) {
+        case RESOLVER_PENDING:
+            if(MUX_SUCCESS != setInterest(mux, proxy->clientFd, NO_INTEREST))
+                return ERROR;
+            return CONNECTION_RESOLV;
+        default:
+            return useResolution(mux, proxy);
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
-// CONNECTION_RESOLV
+// LOCAL_AUTHORIZATION
 ////////////////////////////////////////////////////////////////////////////////
 
+static const char * localGreetingMsg    = "+OK POP3 proxy ready.\r\n";
+
 /**
- * Realiza la resolución de DNS bloqueante.
- *
- * Una vez resuelto notifica al selector para que el evento esté
- * disponible en la próxima iteración.
+ * Copia un mensaje completo al buffer. Retorna false si no hay lugar.
  */
-static void * resolvBlocking(void * data) {
-    MultiplexorKey key = (MultiplexorKey) data;
-    proxyPopv3 * proxy = ATTACHMENT(key);
+static bool writeMessage(bufferADT buffer, const uint8_t * message, const size_t length) {
+    size_t    count;
+    uint8_t * writePtr = getWritePtr(buffer, &count);
+
+    if(count < length)
+        return false;
+    memcpy(writePtr, message, length);
+    updateWriteAndProcessPtr(buffer, length);
+    return true;
+}
 
-    pthread_detach(pthread_self());
-    proxy->originResolution = 0;
-    struct addrinfo hints = {
-        .ai_family    = AF_UNSPEC,    
-        /** Permite IPv4 o IPv6. */
-        .ai_socktype  = SOCK_STREAM,  
-        .ai_flags     = AI_PASSIVE,   
-        .ai_protocol  = 0,        
-        .ai_canonname = NULL,
-        .ai_addr      = NULL,
-        .ai_next      = NULL,
-    };
+static bool isApopClient(const struct sockaddr * client) {
+    for(unsigned i = 0; i < apopClientsSize; i++)
+        if(sockaddrSameHost((const struct sockaddr *) &apopClients[i], client))
+            return true;
+    return false;
+}
 
-    char buff[7];
-    snprintf(buff, sizeof(buff), "%d", proxy->originAddrData.port);
-    getaddrinfo(proxy->originAddrData.addr.fqdn, buff, &hints, &proxy->originResolution);
-    notifyBlock(key->mux, key->fd);
+static void rememberApopClient(const struct sockaddr_storage * client) {
+    if(isApopClient((const struct sockaddr *) client))
+        return;
+    apopClients[apopClientsNext] = *client;
+    apopClientsNext = (apopClientsNext + 1) % APOP_CLIENTS_SIZE;
+    if(apopClientsSize < APOP_CLIENTS_SIZE)
+        apopClientsSize++;
+}
 
-    free(data);
-    return 0;
+/**
+ * Envía al cliente el saludo del proxy sin contactar al origin server.
+ */
+static unsigned localGreeting(MultiplexorADT mux, proxyPopv3 * proxy) {
+    proxy->deferred.localGreeting = true;
+    writeMessage(proxy->writeBuffer, (const uint8_t *) localGreetingMsg, strlen(localGreetingMsg));
+    if(MUX_SUCCESS != setInterest(mux, proxy->clientFd, WRITE))
+        return ERROR;
+    return LOCAL_AUTHORIZATION;
 }
 
 /**
- * Procesa el resultado de la resolución de nombres. 
+ * Atiende las lineas completas enviadas por el cliente hasta recibir un
+ * comando que requiera al origin server. Ese comando queda sin consumir
+ * en el readBuffer para reenviarlo una vez establecida la conexión.
  */
-static unsigned resolvDone(MultiplexorKey key) {
-    proxyPopv3 * proxy = ATTACHMENT(key);
-    if(proxy->originResolution != 0) {
-        proxy->originAddrData.domain = proxy->originResolution->ai_family;
-        proxy->originAddrData.addrLength = proxy->originResolution->ai_addrlen;
-        memcpy(&proxy->originAddrData.addr.addrStorage,
-                proxy->originResolution->ai_addr,
-                proxy->originResolution->ai_addrlen);
-        freeaddrinfo(proxy->originResolution);
-        proxy->originResolution = 0;
-    } else {
-        proxy->errorSender.message = "-ERR Connection refused.\r\n";
+static unsigned localAuthorizationProcess(MultiplexorKey key) {
+    proxyPopv3 *     proxy  = ATTACHMENT(key);
+    bufferADT        buffer = proxy->readBuffer;
+    deferredStruct * deferred = &proxy->deferred;
+    uint8_t *        line;
+    uint8_t *        end    = NULL;
+    size_t           count;
+
+    while(!deferred->connectPending && !deferred->quit) {
+        line = getProcessPtr(buffer, &count);
+        end  = memchr(line, '\n', count);
+        if(end == NULL)
+            break;
+
+        const size_t    lineLength = end - line + 1;
+        const uint8_t * answer     = NULL;
+        size_t          answerLength = 0;
+
+        const deferredAction action = deferredLineAction(deferredCapa, line, lineLength, &answer, &answerLength);
+        if(action == DEFERRED_CONNECT) {
+            /** Guarda el argumento de USER para elegir el origin según el usuario. */
+            if(commandParserLookup(line, lineLength) == CMD_USER)
+                deferredUsername(line, lineLength, proxy->session.name, sizeof(proxy->session.name));
+            deferred->connectPending = true;
+            break;
+        }
+        if(!writeMessage(proxy->writeBuffer, answer, answerLength))
+            break;
+        if(action == DEFERRED_APOP)
+            rememberApopClient(&deferred->clientAddr);
+        deferred->quit = (action == DEFERRED_QUIT);
+        updateProcessPtr(buffer, lineLength);
+        updateReadPtr(buffer, lineLength);
+    }
+
+    if(canRead(proxy->writeBuffer)) {
+        if(MUX_SUCCESS != setInterest(key->mux, proxy->clientFd, WRITE))
+            return ERROR;
+        return LOCAL_AUTHORIZATION;
+    }
+    if(deferred->connectPending) {
+        logInfo("Connecting deferred client %s to origin server.", proxy->session.clientString);
+        return originConnect(key->mux, proxy);
+    }
+    if(end == NULL && !canWrite(buffer)) {
+        proxy->errorSender.message = "-ERR Line too long.\r\n";
         if(MUX_SUCCESS != setInterest(key->mux, proxy->clientFd, WRITE))
             return ERROR;
         return SEND_ERROR_MSG;
     }
+    if(MUX_SUCCESS != setInterest(key->mux, proxy->clientFd, READ))
+        return ERROR;
+    return LOCAL_AUTHORIZATION;
+}
+
+/**
+ * Lee los comandos del cliente antes de que se conecte al origin server.
+ */
+static unsigned localAuthorizationRead(MultiplexorKey key) {
+    proxyPopv3 * proxy  = ATTACHMENT(key);
+    bufferADT    buffer = proxy->readBuffer;
+    uint8_t *    writePtr;
+    size_t       count;
+    ssize_t      n;
 
-    return connecting(key->mux, proxy);
+    writePtr = getWritePtr(buffer, &count);
+    n = recv(key->fd, writePtr, count, 0);
+    if(n <= 0)
+        return DONE;
+
+    proxyMetrics.bytesReadBuffer += n;
+    proxyMetrics.writesQtyReadBuffer++;
+    updateWritePtr(buffer, n);
+    return localAuthorizationProcess(key);
 }
 
-/** 
- * Intenta establecer una conexión con el origin server. 
+/**
+ * Escribe al cliente las respuestas generadas por el proxy.
  */
-static unsigned connecting(MultiplexorADT mux, proxyPopv3  * proxy) {
-    addressData originAddrData = proxy->originAddrData;
-    
-    proxy->originFd = socket(originAddrData.domain, SOCK_STREAM, IPPROTO_TCP);
-
-    if(proxy->originFd == -1)
-        goto finally;
-    if(fdSetNIO(proxy->originFd) == -1)
-        goto finally;
-
-    if(connect(proxy->originFd, (const struct sockaddr *) &originAddrData.addr.addrStorage, originAddrData.addrLength) == -1) {
-        if(errno == EINPROGRESS) {
-            /**
-             * Es esperable,  tenemos que esperar a la conexión.
-             * Dejamos de pollear el socket del cliente.
-             */
-            multiplexorStatus status = setInterest(mux, proxy->clientFd, NO_INTEREST);
-            if(status != MUX_SUCCESS) 
-                goto finally;
-
-            /** Esperamos la conexion en el nuevo socket. */
-            status = registerFd(mux, proxy->originFd, &proxyPopv3Handler, WRITE, proxy);
-            if(status != MUX_SUCCESS) 
-                goto finally;
-        
-            proxy->references += 1;
+static unsigned localAuthorizationWrite(MultiplexorKey key) {
+    proxyPopv3 * proxy  = ATTACHMENT(key);
+    bufferADT    buffer = proxy->writeBuffer;
+    uint8_t *    readPtr;
+    size_t       count;
+    ssize_t      n;
+
+    readPtr = getReadPtr(buffer, &count);
+    n = send(key->fd, readPtr, count, MSG_NOSIGNAL);
+    if(n == -1) {
+        shutdown(key->fd, SHUT_WR);
+        return ERROR;
+    }
+    updateReadPtr(buffer, n);
+    proxyMetrics.totalBytesToClient += n;
+    proxyMetrics.readsQtyWriteBuffer++;
+
+    if(canRead(buffer))
+        return LOCAL_AUTHORIZATION;
+    if(proxy->deferred.quit)
+        return DONE;
+    return localAuthorizationProcess(key);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CONNECTION_RESOLV
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Intenta conectarse a las direcciones resueltas por el resolver.
+ */
+static unsigned useResolution(MultiplexorADT mux, proxyPopv3 * proxy) {
+    const resolverRequest * resolution = &proxy->resolution;
+
+    if(resolution->status != RESOLVER_DONE || resolution->answer.count == 0) {
+        originSetFailed(originSet, proxy->originIndex);
+        proxy->errorSender.message = "-ERR Connection refused.\r\n";
+        if(MUX_SUCCESS != setInterest(mux, proxy->clientFd, WRITE))
+            return ERROR;
+        return SEND_ERROR_MSG;
+    }
+
+    happyEyeballsInit(&proxy->eyeballs, resolution->answer.addresses, resolution->answer.lengths,
+                      resolution->answer.count, time(NULL));
+    return connecting(mux, proxy);
+}
+
+/**
+ * Procesa el resultado de la resolución de nombres. 
+ */
+static unsigned resolvDone(MultiplexorKey key) {
+    return useResolution(key->mux, ATTACHMENT(key));
+}
+
+/**
+ * Cierra el intento de conexión con la dirección `i'.
+ */
+static void closeConnectionAttempt(MultiplexorADT mux, proxyPopv3 * proxy, const size_t i) {
+    happyEyeballsStruct * eyeballs = &proxy->eyeballs;
+    const int             fd       = eyeballs->fds[i];
+
+    eyeballs->fds[i] = -1;
+    eyeballs->pending--;
+    if(MUX_SUCCESS != unregisterFd(mux, fd))
+        logError("Problem trying to unregister a fd: %d.", fd);
+    close(fd);
+}
+
+/**
+ * Cierra los intentos de conexión que no ganaron y el timer que los espacia.
+ */
+static void closeConnectionAttempts(MultiplexorADT mux, proxyPopv3 * proxy) {
+    happyEyeballsStruct * eyeballs = &proxy->eyeballs;
+    const int             timerFd  = eyeballs->timerFd;
+
+    for(size_t i = 0; i < eyeballs->count; i++)
+        if(eyeballs->fds[i] != -1)
+            closeConnectionAttempt(mux, proxy, i);
+    if(timerFd != -1) {
+        eyeballs->timerFd = -1;
+        if(MUX_SUCCESS != unregisterFd(mux, timerFd))
+            logError("Problem trying to unregister a fd: %d.", timerFd);
+        close(timerFd);
+    }
+}
+
+/**
+ * Inicia un intento de conexión con la siguiente dirección. Las direcciones
+ * que fallan en el acto se descartan sin esperar al timer. Si ya no quedan
+ * direcciones ni intentos en curso se informa el error al cliente.
+ */
+static unsigned nextConnectionAttempt(MultiplexorADT mux, proxyPopv3 * proxy) {
+    happyEyeballsStruct * eyeballs = &proxy->eyeballs;
+
+    while(eyeballs->next < eyeballs->count) {
+        const size_t            i       = eyeballs->next++;
+        const struct sockaddr * address = (const struct sockaddr *) (eyeballs->addresses + i);
+        const int               fd      = socket(address->sa_family, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+
+        if(fd == -1)
+            continue;
+        if(fdSetNIO(fd) == -1) {
+            close(fd);
+            continue;
         }
-    } else {
-        /**
-         * Estamos conectados sin esperar... no parece posible
-         * Saltaríamos directamente a COPY.
-         */
-        logError("Problem: connected to origin server without wait. Client Address: %s", proxy->session.clientString);
+        if(connect(fd, address, eyeballs->lengths[i]) == -1 && errno != EINPROGRESS) {
+            happyEyeballsFailed(address, time(NULL));
+            close(fd);
+            continue;
+        }
+        /** Si conectó sin esperar el fd queda listo para escribir de inmediato. */
+        if(MUX_SUCCESS != registerFd(mux, fd, &proxyPopv3Handler, WRITE, proxy)) {
+            close(fd);
+            continue;
+        }
+        eyeballs->fds[i] = fd;
+        eyeballs->pending++;
+        proxy->references += 1;
+        if(eyeballs->timerFd != -1 && eyeballs->next < eyeballs->count)
+            timerFdArm(eyeballs->timerFd, HAPPY_EYEBALLS_ATTEMPT_DELAY_MS);
+        return CONNECTING;
     }
-    
-    return CONNECTING;
+    if(eyeballs->pending > 0)
+        return CONNECTING;
 
-finally:    
     logError("Problem connecting to origin server. Client Address: %s", proxy->session.clientString);
+    originSetFailed(originSet, proxy->originIndex);
     proxy->errorSender.message = "-ERR Connection refused.\r\n";
     if(MUX_SUCCESS != setInterest(mux, proxy->clientFd, WRITE))
         return ERROR;
     return SEND_ERROR_MSG;
 }
 
+/** 
+ * Intenta establecer una conexión con el origin server. Con más de una
+ * dirección los intentos se espacian con un timerfd y gana el primero
+ * que conecta (RFC 8305).
+ */
+static unsigned connecting(MultiplexorADT mux, proxyPopv3  * proxy) {
+    happyEyeballsStruct * eyeballs = &proxy->eyeballs;
+
+    /** Dejamos de pollear el socket del cliente. */
+    if(MUX_SUCCESS != setInterest(mux, proxy->clientFd, NO_INTEREST))
+        return ERROR;
+    clock_gettime(CLOCK_MONOTONIC, &proxy->connectStart);
+
+    if(eyeballs->count > 1) {
+        /** Sin timer los intentos son secuenciales. */
+        eyeballs->timerFd = timerFdCreate();
+        if(eyeballs->timerFd != -1) {
+            if(MUX_SUCCESS == registerFd(mux, eyeballs->timerFd, &proxyPopv3Handler, READ, proxy)) {
+                proxy->references += 1;
+            } else {
+                close(eyeballs->timerFd);
+                eyeballs->timerFd = -1;
+            }
+        }
+    }
+    return nextConnectionAttempt(mux, proxy);
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // CONNECTING
 ////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * Vence la demora entre intentos, se inicia el siguiente.
+ */
+static unsigned connectionTimer(MultiplexorKey key) {
+    if(!timerFdClear(key->fd))
+        logError("Problem reading connection timer. Client Address: %s", ATTACHMENT(key)->session.clientString);
+    return nextConnectionAttempt(key->mux, ATTACHMENT(key));
+}
+
 static unsigned connectionReady(MultiplexorKey key) {    
-    proxyPopv3 * proxy = ATTACHMENT(key);
+    proxyPopv3 *          proxy    = ATTACHMENT(key);
+    happyEyeballsStruct * eyeballs = &proxy->eyeballs;
+    const int             i        = happyEyeballsFind(eyeballs, key->fd);
     int error;
     socklen_t len = sizeof(error);
-    unsigned  ret = ERROR;
     
+    if(i == -1)
+        return CONNECTING;
+    const struct sockaddr * address = (const struct sockaddr *) (eyeballs->addresses + i);
     if (getsockopt(key->fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0)
         error = 1;
 
     if(error != 0) {
-        logError("Problem connecting to origin server. Client Address: %s", proxy->session.clientString);
-        proxy->errorSender.message = "-ERR Connection refused.\r\n";
-        if(MUX_SUCCESS == setInterest(key->mux, proxy->clientFd, WRITE))
-            ret = SEND_ERROR_MSG;
-        else
-            ret = ERROR;
-    } else if(MUX_SUCCESS == setInterestKey(key, READ)) {
-        const struct sockaddr * origin = (const struct sockaddr *) &proxy->originAddrData.addr.addrStorage;
-        sockaddrToString(proxy->session.originString, MAX_STRING_IP_LENGTH, origin);
-        logInfo("Connection established. Client Address: %s; Origin Address: %s.", proxy->session.clientString, proxy->session.originString);
-        ret = HELLO;
+        sockaddrToString(proxy->session.originString, MAX_STRING_IP_LENGTH, address);
+        logInfo("Problem connecting to origin server. Client Address: %s; Origin Address: %s.", proxy->session.clientString, proxy->session.originString);
+        happyEyeballsFailed(address, time(NULL));
+        closeConnectionAttempt(key->mux, proxy, i);
+        return nextConnectionAttempt(key->mux, proxy);
     }
-    return ret;
+
+    /** Gana este intento, el resto se cierra al salir de CONNECTING. */
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    originSetConnected(originSet, proxy->originIndex, (now.tv_sec - proxy->connectStart.tv_sec) * 1000.0 +
+                                                      (now.tv_nsec - proxy->connectStart.tv_nsec) / 1000000.0);
+    eyeballs->fds[i] = -1;
+    eyeballs->pending--;
+    proxy->originFd = key->fd;
+    happyEyeballsSucceeded(address);
+    if(proxy->originAddrData.type == ADDR_DOMAIN && warmPool != NULL) {
+        addressData resolved = proxy->originAddrData;
+        resolved.type        = (address->sa_family == AF_INET)? ADDR_IPV4 : ADDR_IPV6;
+        resolved.domain      = address->sa_family;
+        resolved.addrLength  = eyeballs->lengths[i];
+        memcpy(&resolved.addr.addrStorage, address, eyeballs->lengths[i]);
+        originPoolSetAddress(warmPool, &resolved);
+    }
+    proxy->originAddrData.domain     = address->sa_family;
+    proxy->originAddrData.addrLength = eyeballs->lengths[i];
+    memcpy(&proxy->originAddrData.addr.addrStorage, address, eyeballs->lengths[i]);
+
+    if(MUX_SUCCESS != setInterestKey(key, READ))
+        return ERROR;
+    const struct sockaddr * origin = (const struct sockaddr *) &proxy->originAddrData.addr.addrStorage;
+    sockaddrToString(proxy->session.originString, MAX_STRING_IP_LENGTH, origin);
+    proxy->capabilitiesKnown = capaCacheGet(getCapaCache(), origin, time(NULL), &proxy->originCapabilities);
+    logInfo("Connection established. Client Address: %s; Origin Address: %s.", proxy->session.clientString, proxy->session.originString);
+    return HELLO;
+}
+
+static void connectingDeparture(const unsigned state, MultiplexorKey key) {
+    closeConnectionAttempts(key->mux, ATTACHMENT(key));
 }
 
 
@@ -591,6 +1165,8 @@ static void helloReadInit(const unsigned state, MultiplexorKey key) {
 
     helloParserInit(&hello->parser);
     hello->writeBuffer   = proxy->writeBuffer;
+    /** Un saludo tomado del warm pool ya está en el buffer. */
+    helloConsume(&hello->parser, hello->writeBuffer, NULL);
 }
 
 /** 
@@ -613,7 +1189,18 @@ static unsigned helloRead(MultiplexorKey key) {
         proxyMetrics.writesQtyWriteBuffer++;
         updateWritePtr(buffer, n);
         helloConsume(&hello->parser, buffer, &error);
-        if(!error && MUX_SUCCESS == setInterest(key->mux, ATTACHMENT(key)->originFd, NO_INTEREST) &&
+        if(!error && proxy->deferred.localGreeting) {
+            /** El cliente ya recibió el saludo local, se descarta el del origin. */
+            if(helloIsDone(hello->parser.state, 0)) {
+                reset(buffer);
+                if(proxy->capabilitiesKnown)
+                    ret = enterCopy(key->mux, proxy);
+                else if(MUX_SUCCESS == setInterestKey(key, WRITE))
+                    ret = CHECK_CAPABILITIES;
+                else
+                    error = true;
+            }
+        } else if(!error && MUX_SUCCESS == setInterest(key->mux, ATTACHMENT(key)->originFd, NO_INTEREST) &&
              MUX_SUCCESS == setInterest(key->mux, ATTACHMENT(key)->clientFd, WRITE)) {
             ret = HELLO;
         } else
@@ -655,7 +1242,10 @@ static unsigned helloWrite(MultiplexorKey key) {
         updateReadPtr(buffer, n);
         proxyMetrics.totalBytesToClient += n;
         proxyMetrics.readsQtyWriteBuffer++;
-        if(helloIsDone(hello->parser.state, 0)) {
+        if(helloIsDone(hello->parser.state, 0) && ATTACHMENT(key)->capabilitiesKnown) {
+            logDebug("Hello is done, capabilities already known.");
+            ret = enterCopy(key->mux, ATTACHMENT(key));
+        } else if(helloIsDone(hello->parser.state, 0)) {
             logDebug("Hello is done.");
             if(MUX_SUCCESS == setInterest(key->mux, ATTACHMENT(key)->originFd, WRITE) &&
                MUX_SUCCESS == setInterestKey(key, NO_INTEREST))
@@ -680,7 +1270,9 @@ static void checkCapabilitiesInit(const unsigned state, MultiplexorKey key) {
     checkCapabilitiesStruct * check = &ATTACHMENT(key)->origin.checkCapabilities;
 
     check->sentSize                 = 0;
-    check->readBuffer               = check->readBuffer;
+    check->readBuffer               = ATTACHMENT(key)->writeBuffer;
+    check->responseLength           = 0;
+    check->responseOverflow         = false;
     check->capabilities             = &ATTACHMENT(key)->originCapabilities;
     capaParserInit(&check->parser, check->capabilities);
 }
@@ -735,6 +1327,11 @@ static unsigned checkCapabilitiesRead(MultiplexorKey key) {
         proxyMetrics.bytesReadBuffer += n;
         proxyMetrics.writesQtyReadBuffer++;
         updateWriteAndProcessPtr(buffer, n);
+        if(check->responseLength + n <= CAPA_RESPONSE_SIZE) {
+            memcpy(check->response + check->responseLength, writePtr, n);
+            check->responseLength += n;
+        } else
+            check->responseOverflow = true;
         const capaState state = capaParserConsume(&check->parser, buffer, &error);
         if(error) {
             logError("Capa response has an error. Client Address: %s", proxy->session.clientString);
@@ -744,12 +1341,11 @@ static unsigned checkCapabilitiesRead(MultiplexorKey key) {
             else
                 ret = ERROR;  
         } else if(capaParserIsDone(state, 0)) {
-            if(MUX_SUCCESS == setInterestKey(key, READ) &&
-               MUX_SUCCESS == setInterest(key->mux, proxy->clientFd, READ)) {    
-                logInfo("Capa Pipelining: %s", (check->capabilities->pipelining)? "AVAILABLE" : "UNAVAILABLE");
-                ret = COPY;
-            } else
-                ret = ERROR;
+            if(!check->responseOverflow)
+                deferredCapaPut(deferredCapa, proxy->originIndex, check->response, check->responseLength);
+            capaCachePut(getCapaCache(), (const struct sockaddr *) &proxy->originAddrData.addr.addrStorage, check->capabilities, time(NULL));
+            logInfo("Capa Pipelining: %s", (check->capabilities->pipelining)? "AVAILABLE" : "UNAVAILABLE");
+            ret = enterCopy(key->mux, proxy);
         }
     } else {
         shutdown(key->fd, SHUT_RD);
@@ -789,6 +1385,12 @@ static void copyInit(const unsigned state, MultiplexorKey key) {
     copy->duplex       = READ | WRITE;
     copy->target       = COPY_FILTER;
     copy->state        = &proxy->copyState;
+
+    /** El RETR especulativo viaja en el pipeline de comandos del origin. */
+    size_t prefetchSize = 0;
+    if(proxyConf.prefetchSize > 0 && proxy->originCapabilities.pipelining)
+        prefetchSize = (proxyConf.prefetchSize < proxyConf.bufferSize)? proxyConf.bufferSize : proxyConf.prefetchSize;
+    retrPrefetchInit(&proxy->prefetch, prefetchSize);
 }
 
 /**
@@ -797,7 +1399,7 @@ static void copyInit(const unsigned state, MultiplexorKey key) {
 static inline fdInterest clientComputeInterests(MultiplexorADT mux, copyStruct * copy, copyStruct * copyFilter, filterState state) {
     fdInterest ret = NO_INTEREST;
     const bool wantWriteFromOrigin = canRead(copy->writeBuffer) && (state == FILTER_STARTING || state == FILTER_CLOSE);
-    const bool wantWriteFromFilter = canRead(copyFilter->readBuffer) && (state == FILTER_FILTERING || state == FILTER_ALL_SENT);
+    const bool wantWriteFromFilter = canRead(copyFilter->readBuffer) && (state == FILTER_FILTERING || state == FILTER_ALL_SENT || state == FILTER_CACHED || state == FILTER_INLINE);
 
     if ((copy->duplex & READ)  &&  canWrite(copy->readBuffer))
         ret |= READ;
@@ -816,7 +1418,7 @@ static inline fdInterest clientComputeInterests(MultiplexorADT mux, copyStruct *
  */
 static inline fdInterest originComputeInterests(MultiplexorADT mux, copyStruct * copy, bool read, bool write) {
     fdInterest ret = NO_INTEREST;
-    if (read  && (copy->duplex & READ)  &&  canWrite(copy->readBuffer))
+    if (read  && (copy->duplex & READ))
         ret |= READ;
     if (write && (copy->duplex & WRITE) && (canRead(copy->writeBuffer) || canProcess(copy->writeBuffer)))
         ret |= WRITE;
@@ -829,19 +1431,24 @@ static inline fdInterest originComputeInterests(MultiplexorADT mux, copyStruct *
 }
 
 /**
- *
+ * `pendingInput' indica que hay bytes para el filtro fuera del writeBuffer
+ * y `pendingOutput' que la salida anterior del filtro todavía no entró en
+ * el filterBuffer.
  */
-static inline fdInterest filterComputeInterest(MultiplexorADT mux, copyStruct * copy, filterDataStruct * filterData) {
+static inline fdInterest filterComputeInterest(MultiplexorADT mux, copyStruct * copy, filterDataStruct * filterData, const bool pendingInput, const bool pendingOutput) {
     fdInterest retWrite = NO_INTEREST, retRead = NO_INTEREST;
 
     if(filterData->state == FILTER_FILTERING) {
-        if(canRead(copy->writeBuffer) || canProcess(copy->writeBuffer)) //para saber si vino el .\r\n
+        if(pendingInput || canRead(copy->writeBuffer) || canProcess(copy->writeBuffer)) //para saber si vino el .\r\n
             retWrite = WRITE;    
         if(MUX_SUCCESS != setInterest(mux, filterData->infd[1], retWrite))
             fail("Problem trying to set interest: %d, to multiplexor in filter, in pipe.", retWrite);       
     }
-    if(canWrite(copy->readBuffer)) 
+    if(canWrite(copy->readBuffer) && !filterData->end.done && !pendingOutput) 
         retRead = READ;        
+    /** En modo batch no hay salida hasta que se lanza el comando. */
+    if(filterData->outfd[0] == -1)
+        return retWrite;
         
     if(MUX_SUCCESS != setInterest(mux, filterData->outfd[0], retRead))
         fail("Problem trying to set interest: %d, to multiplexor in filter, out pipe.", retRead);
@@ -902,7 +1509,45 @@ static unsigned analizeAndProcessResponse(proxyPopv3 * proxy, bufferADT buffer,
 }
 
 static void filterInit(MultiplexorKey key);
+static bool filterAdmit(MultiplexorKey key);
+static bool filterBatchStart(MultiplexorKey key);
 static void filterClose(MultiplexorKey key);
+static void filterWatchdogArm(proxyPopv3 * proxy);
+static void filterInlineOutput(proxyPopv3 * proxy);
+static unsigned filterOutputStep(MultiplexorKey key);
+static unsigned filterWatchdogRead(MultiplexorKey key);
+
+/**
+ * Avanza el RETR especulativo con lo último que se leyó o escribió y, si
+ * el cliente quedó esperando un RETR, pide el siguiente.
+ */
+static unsigned prefetchStep(proxyPopv3 * proxy) {
+    retrPrefetchStruct * prefetch = &proxy->prefetch;
+    unsigned ret = COPY;
+    bool newResponse = false;
+
+    if(prefetch->capacity == 0)
+        return ret;
+    /** Con el filtro activo las respuestas deben pasar por el filtro. */
+    if(proxyConf.filterActivated)
+        retrPrefetchCancel(prefetch);
+    else
+        retrPrefetchClientRequest(prefetch, proxy->readBuffer);
+
+    if(!retrPrefetchProcess(prefetch, proxy->writeBuffer, &proxy->responseParser, proxy->request.commands)) {
+        proxy->errorSender.message = "-ERR Unexpected event\r\n";
+        return SEND_ERROR_MSG;
+    }
+    if(prefetch->state == PREFETCH_IDLE || prefetch->state == PREFETCH_DRAINING) {
+        if(proxy->filterData.state == FILTER_CLOSE)
+            ret = analizeAndProcessResponse(proxy, proxy->writeBuffer, proxyConf.filterActivated, false);
+    } else {
+        analizeResponse(proxy, proxy->request.commands, &newResponse);
+    }
+    if(ret == COPY && proxy->session.isAuth && !proxyConf.filterActivated)
+        retrPrefetchStart(prefetch, proxy->readBuffer, &proxy->commandParser, proxy->request.commands);
+    return ret;
+}
 
 /**
  * Computa los intereses en base a:
@@ -914,28 +1559,44 @@ static void filterClose(MultiplexorKey key);
  */
 static void computeInterestsCopy(MultiplexorKey key) {
     proxyPopv3 * proxy = ATTACHMENT(key);
-    const bool originWantWrite = (proxy->originCapabilities.pipelining || !proxy->request.waitingResponse);
+    const bool originWantWrite = (proxy->originCapabilities.pipelining || !proxy->request.waitingResponse) &&
+                                 retrPrefetchSendable(&proxy->prefetch, 1) > 0;
+    const bool originWantRead  = canWrite(retrPrefetchOriginBuffer(&proxy->prefetch, proxy->writeBuffer));
+    const bool pendingInput    = proxy->filterSpool.sent < proxy->filterSpool.body.length ||
+                                 proxy->filterInline.stuff.inputSent < proxy->filterInline.stuff.input.length;
+    const bool pendingOutput   = !proxy->filterData.pooled &&
+                                 (proxy->filterInline.stuff.complete || proxy->filterInline.sent < proxy->filterInline.stuff.output.length);
 
     if(proxyConf.filterActivated) {
         switch(proxy->filterData.state) {
             case FILTER_STARTING:
-                if(proxy->filterData.slavePid == 0)
+                /** Si se junta el cuerpo o con el stripmime del proxy, el filtro se inicia en su step. */
+                if(isInlineFilter() || isFilterSpooled())
+                    break;
+                if(proxy->filterData.slavePid == 0 && !proxy->filterData.batch) {
+                    /** Sin lugar para el filtro el cuerpo espera en el writeBuffer, que al llenarse frena al origin. */
+                    if(!filterAdmit(key))
+                        break;
                     filterInit(key);
+                }
                 if(!canRead(proxy->writeBuffer) && canProcess(proxy->writeBuffer)) {
                     proxy->filterData.state = FILTER_FILTERING;
                     proxyMetrics.commandsFilteredQty++;
-                    filterComputeInterest(key->mux, &proxy->filter.copy, &proxy->filterData);
+                    filterComputeInterest(key->mux, &proxy->filter.copy, &proxy->filterData, pendingInput, pendingOutput);
                 }
                 break;
 
             case FILTER_ALL_SENT:
+                /** En modo batch el comando se lanza al tener el cuerpo completo. */
+                if(proxy->filterData.batch && !filterBatchStart(key))
+                    break;
                 if(proxy->filterData.infd[1] != -1) {
                     unregisterFd(key->mux, proxy->filterData.infd[1]);
                     close(proxy->filterData.infd[1]);
                     proxy->filterData.infd[1] = -1;
                 }
             case FILTER_FILTERING:
-                filterComputeInterest(key->mux, &proxy->filter.copy, &proxy->filterData);
+                filterComputeInterest(key->mux, &proxy->filter.copy, &proxy->filterData, pendingInput, pendingOutput);
                 break;
 
             case FILTER_ENDING:
@@ -947,7 +1608,7 @@ static void computeInterestsCopy(MultiplexorKey key) {
         }
     }
     clientComputeInterests(key->mux, &proxy->client.copy, &proxy->filter.copy, proxy->filterData.state);    
-    originComputeInterests(key->mux, &proxy->origin.copy, true, originWantWrite);
+    originComputeInterests(key->mux, &proxy->origin.copy, originWantRead, originWantWrite);
 }
 
 /**
@@ -1024,7 +1685,7 @@ static unsigned receiveFromOrigin(int fd, copyStruct * copy, uint8_t * ptr, size
         proxyMetrics.bytesWriteBuffer += n;
         proxyMetrics.writesQtyWriteBuffer++;
         updateWritePtr(buffer, n);
-        if(proxy->filterData.state == FILTER_CLOSE) 
+        if(proxy->filterData.state == FILTER_CLOSE && proxy->prefetch.state == PREFETCH_IDLE) 
             ret = analizeAndProcessResponse(proxy, buffer, interestRetr, toNewCommand);
 
         logMetric("Coppied from origin to proxy, total copied: %zd bytes.", n);
@@ -1033,31 +1694,454 @@ static unsigned receiveFromOrigin(int fd, copyStruct * copy, uint8_t * ptr, size
 }
 
 /**
- *
+ * Agrega `length' bytes a `bytes' del spool reservándolos en el cache. Si
+ * no entran en `limit' se cuenta como un cuerpo que no se puede guardar.
  */
-static unsigned receiveFromFilter(int fd, copyStruct * copy, uint8_t * ptr, size_t size, bufferADT buffer, proxyPopv3 * proxy, MultiplexorKey key) { 
+static bool filterSpoolAppend(filterSpoolStruct * spool, filterCacheBytes * bytes, const uint8_t * data, const size_t length, const size_t limit) {
+    if(!filterCacheSpoolReserve(filterCache, length))
+        return false;
+    if(!filterCacheBytesAppend(bytes, data, length, limit)) {
+        filterCacheSpoolRelease(filterCache, length);
+        filterCacheOversized(filterCache);
+        return false;
+    }
+    spool->reserved += length;
+    return true;
+}
+
+/**
+ * Devuelve al cache la memoria reservada por el spool y libera los bytes
+ * que la ocupaban, para que una sesión no la retenga hasta terminar.
+ */
+static void filterSpoolRelease(filterSpoolStruct * spool) {
+    if(spool->reserved == 0)
+        return;
+    filterCacheSpoolRelease(filterCache, spool->reserved);
+    spool->reserved = 0;
+    spool->sent     = 0;
+    filterCacheBytesFree(&spool->body);
+    filterCacheBytesFree(&spool->output);
+}
+
+/**
+ * Guarda en el cache la salida que se juntó del filtro. Una salida completa
+ * termina con la linea de terminación que agrega el proxy o el worker.
+ */
+static void filterSpoolStore(filterSpoolStruct * spool) {
+    const filterCacheBytes * output = &spool->output;
+
+    if(spool->capture && output->length >= 3 && memcmp(output->data + output->length - 3, ".\r\n", 3) == 0)
+        filterCachePut(filterCache, &spool->key, output->data, output->length);
+    spool->capture = false;
+    filterSpoolRelease(spool);
+}
+
+/**
+ * Cierra el filtro al terminar su salida y procesa las respuestas que
+ * esperaban al filtro.
+ */
+static unsigned filterOutputEnd(MultiplexorKey key, copyStruct * copy, bufferADT buffer) {
+    proxyPopv3 * proxy = ATTACHMENT(key);
     unsigned ret = COPY;
     bool interestRetr = proxyConf.filterActivated, toNewCommand = false;
 
-    ssize_t n = read(fd, ptr, size);
+    logDebug("Filter send EOF.");     
+    filterWatchdogDone(&proxy->watchdog);
+    filterSpoolStore(&proxy->filterSpool);
+    filterClose(key);       
+    ret = analizeAndProcessResponse(proxy, proxy->writeBuffer, interestRetr, toNewCommand);
+    if(*copy->state == ORIGIN_READ_DOWN && !canRead(buffer) && !canRead(proxy->writeBuffer)) {
+        *copy->state = CLIENT_WRITE_DOWN;
+        shutDownCopy(&proxy->origin.copy, false, true, true);
+        copy->duplex = NO_INTEREST;
+    }
+    return ret;
+}
+
+/**
+ * Guarda con dot-stuffing la salida del comando de filtro y copia al
+ * filterBuffer la que entre. Al terminar la salida (`length' 0) le agrega
+ * la linea de terminación.
+ */
+static void filterCommandOutput(proxyPopv3 * proxy, const uint8_t * data, const size_t length) {
+    filterInlineStruct * filterInline = &proxy->filterInline;
+    filterSpoolStruct  * spool        = &proxy->filterSpool;
+    const size_t start = filterInline->stuff.output.length;
+
+    filterStuffOutput(&filterInline->stuff, data, length);
+    if(filterInline->stuff.outputFailed)
+        spool->capture = false;
+    if(spool->capture && !filterSpoolAppend(spool, &spool->output, filterInline->stuff.output.data + start,
+                                            filterInline->stuff.output.length - start, filterCacheMaxEntry(filterCache)))
+        spool->capture = false;
+    filterInlineOutput(proxy);
+}
+
+/**
+ * Lee la salida de un comando en modo batch. Hasta que termina el proceso
+ * del pidfd outfd[0] falla con EAGAIN; después lee de a `size' bytes la
+ * salida que dejó en `batchOutput'. Los procesos que haya creado el comando
+ * no se esperan.
+ */
+static ssize_t filterBatchRead(filterDataStruct * filterData, uint8_t * ptr, const size_t size) {
+    if(!filterData->batchExited) {
+        if(!processExited(filterData->outfd[0])) {
+            errno = EAGAIN;
+            return -1;
+        }
+        filterData->batchExited = true;
+    }
+    const ssize_t n = pread(filterData->batchOutput, ptr, size, filterData->batchOffset);
+    if(n > 0)
+        filterData->batchOffset += n;
+    return n;
+}
+
+/**
+ * Lee la salida del filtro. La de un worker del pool ya tiene dot-stuffing
+ * y su linea de terminación; la de un comando se lee recién cuando el
+ * filterBuffer tomó la anterior.
+ */
+static unsigned receiveFromFilter(int fd, copyStruct * copy, uint8_t * ptr, size_t size, bufferADT buffer, proxyPopv3 * proxy, MultiplexorKey key) { 
+    unsigned ret = COPY;
+    filterSpoolStruct * spool = &proxy->filterSpool;
+
+    if(!proxy->filterData.pooled)
+        ptr = getWritePtr(filterInlineBody, &size);
+    ssize_t n = (proxy->filterData.batch)? filterBatchRead(&proxy->filterData, ptr, size) : read(fd, ptr, size);
+    if(n == -1 && proxy->filterData.batch && errno == EAGAIN)
+        return ret;
     if(n == -1) {
         logFatal("Se rompio el filter mientras el proxy recibia.");
         proxy->filterData.state = FILTER_ENDING;
-    } else if(n == 0) {
-        logDebug("Filter send EOF.");     
-        filterClose(key);       
-        ret = analizeAndProcessResponse(proxy, proxy->writeBuffer, interestRetr, toNewCommand);
-        if(*copy->state == ORIGIN_READ_DOWN && !canRead(buffer) && !canRead(proxy->writeBuffer)) {
-            *copy->state = CLIENT_WRITE_DOWN;
-            shutDownCopy(&proxy->origin.copy, false, true, true);
-            copy->duplex = NO_INTEREST;
-        }
-    } else {
+        spool->capture = false;
+    } else if(!proxy->filterData.pooled) {
+        if(n == 0)
+            logDebug("Filter send EOF.");
+        else
+            filterWatchdogOutput(&proxy->watchdog);
+        filterCommandOutput(proxy, ptr, n);
+        logMetric("Coppied from filter to proxy, total copied: %zd bytes.", n);
+    } else if(n > 0) {
+        filterWatchdogOutput(&proxy->watchdog);
         proxyMetrics.bytesFilterBuffer += n;
         proxyMetrics.writesQtyFilterBuffer++;
+        if(spool->capture && !filterSpoolAppend(spool, &spool->output, ptr, n, filterCacheMaxEntry(filterCache)))
+            spool->capture = false;
         updateWriteAndProcessPtr(buffer, n);
         logMetric("Coppied from filter to proxy, total copied: %zd bytes.", n);
-    } 
+        /* Un worker del pool no cierra la salida, se cierra en copyWrite al enviar su linea de terminación. */
+        filterPoolScannerConsume(&proxy->filterData.end, ptr, n);
+    } else
+        ret = filterOutputEnd(key, copy, buffer);
+    return ret;
+}
+
+/**
+ * Inicia el filtro para el cuerpo juntado. Se le envía primero `body' y
+ * luego, si no está completo, el resto como siempre. Sin lugar para el
+ * filtro se espera en FILTER_QUEUED.
+ */
+static void filterSpoolStart(MultiplexorKey key) {
+    proxyPopv3 * proxy = ATTACHMENT(key);
+
+    if(!filterAdmit(key)) {
+        proxy->filterData.state = FILTER_QUEUED;
+        return;
+    }
+    filterInit(key);
+    proxy->filterData.state = FILTER_FILTERING;
+    proxyMetrics.commandsFilteredQty++;
+}
+
+/**
+ * Con el cache del filtro, junta el cuerpo del RETR antes de filtrarlo. Si
+ * al completarse su salida está en el cache la envía al cliente sin iniciar
+ * el filtro; si no, inicia el filtro con el cuerpo juntado y guarda la
+ * salida. Un cuerpo que no entra en el cache se filtra como siempre.
+ *
+ * Con filterBypassSize, mientras se junta se leen sus headers. Si ninguna
+ * parte puede estar en el media range se envía lo juntado sin filtrar y el
+ * resto del cuerpo pasa como en un RETR sin filtro. Si hay que leer más de
+ * filterBypassSize bytes para saberlo se filtra.
+ */
+static unsigned filterSpoolStep(MultiplexorKey key) {
+    proxyPopv3        * proxy  = ATTACHMENT(key);
+    filterSpoolStruct * spool  = &proxy->filterSpool;
+    bufferADT           buffer = proxy->writeBuffer;
+    unsigned ret = COPY;
+    bool errored = false, caching;
+    size_t size;
+    uint8_t * ptr;
+
+    if(!proxyConf.filterActivated)
+        return ret;
+    /** Sin juntar el cuerpo solo se llega a estos estados por el fallback de filterWatchdog. */
+    if(!isFilterSpooled() && proxy->filterData.state != FILTER_CACHED && proxy->filterData.state != FILTER_DISCARDING)
+        return ret;
+    if(proxy->filterData.state == FILTER_STARTING && isInlineFilter())
+        return ret;
+
+    switch(proxy->filterData.state) {
+        case FILTER_STARTING:
+            /** Se espera a que el cliente reciba la primera linea de la respuesta. */
+            if(proxy->filterData.slavePid != 0 || canRead(buffer))
+                break;
+            filterSpoolRelease(spool);
+            spool->key.body     = FILTER_CACHE_HASH_SEED;
+            spool->key.config   = filterConfigHash(proxy);
+            spool->key.length   = 0;
+            sha256Init(&spool->digest);
+            spool->body.length  = 0;
+            spool->output.length = 0;
+            spool->sent         = 0;
+            spool->complete     = false;
+            spool->capture      = false;
+            filterSnifferInit(&spool->sniffer);
+            if(proxyConf.filterBypassSize == 0)
+                spool->sniffer.decision = FILTER_SNIFF_FILTER;
+            proxy->filterData.state = FILTER_SPOOLING;
+
+        case FILTER_SPOOLING:
+            responseParserConsumeUntil(&proxy->responseParser, buffer, proxy->request.commands, false, true, &errored);
+            if(errored) {
+                proxy->errorSender.message = "-ERR Unexpected event\r\n";
+                return SEND_ERROR_MSG;
+            }
+            ptr = getReadPtr(buffer, &size);
+            if(spool->sniffer.decision == FILTER_SNIFF_PENDING) {
+                filterSnifferConsume(&spool->sniffer, proxyConf.mediaRange, ptr, size);
+                if(spool->sniffer.decision == FILTER_SNIFF_PENDING && spool->body.length + size > proxyConf.filterBypassSize)
+                    spool->sniffer.decision = FILTER_SNIFF_FILTER;
+                if(spool->sniffer.decision != FILTER_SNIFF_PENDING)
+                    filterBypassRecord(spool->sniffer.decision == FILTER_SNIFF_BYPASS, spool->body.length + size);
+            }
+            caching = filterCache != NULL && spool->sniffer.decision != FILTER_SNIFF_BYPASS;
+            /** Si no entra en el cache o en la memoria de las sesiones, se filtra sin guardar. */
+            if(caching? !filterSpoolAppend(spool, &spool->body, ptr, size,
+                                           (spool->sniffer.decision == FILTER_SNIFF_FILTER)? filterCacheMaxEntry(filterCache) : SIZE_MAX)
+                      : !filterCacheBytesAppend(&spool->body, ptr, size, SIZE_MAX)) {
+                filterSpoolStart(key);
+                break;
+            }
+            if(caching) {
+                spool->key.body    = filterCacheHash(spool->key.body, ptr, size);
+                spool->key.length += size;
+                sha256Update(&spool->digest, ptr, size);
+            }
+            updateReadPtr(buffer, size);
+
+            if(spool->sniffer.decision == FILTER_SNIFF_BYPASS) {
+                /** Lo que falta del cuerpo se envía como en un RETR sin filtro. */
+                spool->complete = proxy->responseParser.state == RESPONSE_INIT;
+                proxy->filterData.state = FILTER_CACHED;
+                reset(proxy->filterBuffer);
+            } else if(spool->sniffer.decision == FILTER_SNIFF_FILTER && !caching) {
+                spool->complete = proxy->responseParser.state == RESPONSE_INIT;
+                filterSpoolStart(key);
+                break;
+            } else if(proxy->responseParser.state == RESPONSE_INIT) {
+                spool->complete = true;
+                sha256Final(&spool->digest, spool->key.digest);
+                if(filterCacheGet(filterCache, &spool->key, &spool->body)) {
+                    proxy->filterData.state = FILTER_CACHED;
+                    proxyMetrics.commandsFilteredQty++;
+                    reset(proxy->filterBuffer);
+                } else {
+                    spool->capture = true;
+                    filterSpoolStart(key);
+                    break;
+                }
+            } else if(proxy->copyState == ORIGIN_READ_DOWN) {
+                /** El origin cerró antes de terminar el cuerpo, no se guarda. */
+                spool->complete = true;
+                filterSpoolStart(key);
+                break;
+            } else
+                break;
+
+        case FILTER_CACHED:
+            while(spool->sent < spool->body.length && canWrite(proxy->filterBuffer)) {
+                ptr = getWritePtr(proxy->filterBuffer, &size);
+                if(size > spool->body.length - spool->sent)
+                    size = spool->body.length - spool->sent;
+                memcpy(ptr, spool->body.data + spool->sent, size);
+                updateWriteAndProcessPtr(proxy->filterBuffer, size);
+                spool->sent += size;
+            }
+            if(spool->sent < spool->body.length || canRead(proxy->filterBuffer))
+                break;
+            proxy->filterData.state = FILTER_CLOSE;
+            ret = analizeAndProcessResponse(proxy, buffer, proxyConf.filterActivated, false);
+            if(proxy->copyState == ORIGIN_READ_DOWN && !canRead(buffer)) {
+                proxy->copyState = CLIENT_WRITE_DOWN;
+                shutDownCopy(&proxy->origin.copy, false, true, true);
+            }
+            break;
+
+        case FILTER_QUEUED:
+            filterSpoolStart(key);
+            break;
+
+        case FILTER_DISCARDING:
+            responseParserConsumeUntil(&proxy->responseParser, buffer, proxy->request.commands, false, true, &errored);
+            if(errored) {
+                proxy->errorSender.message = "-ERR Unexpected event\r\n";
+                return SEND_ERROR_MSG;
+            }
+            getReadPtr(buffer, &size);
+            updateReadPtr(buffer, size);
+            if(proxy->responseParser.state != RESPONSE_INIT && proxy->copyState != ORIGIN_READ_DOWN)
+                break;
+            /** Sigue como FILTER_CACHED, con el mensaje de reemplazo en `body'. */
+            spool->complete = true;
+            proxy->filterData.state = FILTER_CACHED;
+            reset(proxy->filterBuffer);
+            ret = filterSpoolStep(key);
+            break;
+
+        default:
+            break;
+    }
+    return ret;
+}
+
+/**
+ * Prepara el dot-stuffing de la entrada y la salida de un filtro. Retorna
+ * false si no hay memoria para el cuerpo sin dot-stuffing.
+ */
+static bool filterStuffInit(filterInlineStruct * filterInline) {
+    filterInline->stripmime = NULL;
+    filterInline->sent      = 0;
+    filterStuffReset(&filterInline->stuff);
+    if(filterInlineBody == NULL) {
+        const size_t chunk = (proxyConf.filterPipeSize > FILTER_INLINE_CHUNK)? proxyConf.filterPipeSize : FILTER_INLINE_CHUNK;
+        /* el parser para consumir necesita un espacio mas en el buffer destino */
+        filterInlineBody = createBuffer(chunk + 1);
+    }
+    return filterInlineBody != NULL;
+}
+
+/** Inicia el stripmime para el cuerpo que empieza en el writeBuffer. */
+static void filterInlineInit(proxyPopv3 * proxy) {
+    filterInlineStruct * filterInline = &proxy->filterInline;
+
+    logDebug("Filter init, inline stripmime.");
+    reset(proxy->filterBuffer);
+    if(filterStuffInit(filterInline))
+        filterInline->stripmime = createStripmime(proxyConf.mediaRange, proxyConf.replaceMsg, filterStuffWriter, &filterInline->stuff);
+    if(filterInline->stripmime == NULL)
+        logError("Filter fail: cannot create the inline stripmime, the body is discarded.");
+}
+
+/** Libera el stripmime del mensaje, si lo hay. */
+static void filterInlineClose(proxyPopv3 * proxy) {
+    deleteStripmime(proxy->filterInline.stripmime);
+    proxy->filterInline.stripmime = NULL;
+}
+
+/**
+ * Entrega al stripmime, sin dot-stuffing, los bytes del cuerpo que hay en
+ * `buffer'. Al terminar el cuerpo agrega la linea de terminación a la salida.
+ */
+static void filterInlineConsume(proxyPopv3 * proxy, bufferADT buffer, const bool bodyEnded) {
+    filterInlineStruct * filterInline = &proxy->filterInline;
+    size_t size, space, n;
+    const uint8_t * ptr = getReadPtr(buffer, &size);
+
+    if(filterInlineBody != NULL) {
+        n   = filterUnstuff(&filterInline->stuff, filterInlineBody, ptr, size);
+        ptr = getReadPtr(filterInlineBody, &space);
+        if(filterInline->stripmime != NULL && !stripmimeFeed(filterInline->stripmime, ptr, space)) {
+            logError("Filter fail: stripmime fatal error, the rest of the body is discarded.");
+            filterInlineClose(proxy);
+        }
+        if(filterInline->stuff.outputFailed)
+            filterInlineClose(proxy);
+        reset(filterInlineBody);
+    } else
+        n = size;
+    updateReadPtr(buffer, n);
+    proxyMetrics.readsQtyWriteBuffer++;
+    proxyMetrics.totalBytesToFilter += n;
+
+    if(bodyEnded && !canRead(buffer)) {
+        filterInlineClose(proxy);
+        filterStuffEnd(&filterInline->stuff);
+    }
+}
+
+/** Copia al filterBuffer la salida del stripmime que entre. */
+static void filterInlineOutput(proxyPopv3 * proxy) {
+    filterInlineStruct * filterInline = &proxy->filterInline;
+    size_t size;
+    uint8_t * ptr;
+
+    while(filterInline->sent < filterInline->stuff.output.length && canWrite(proxy->filterBuffer)) {
+        ptr = getWritePtr(proxy->filterBuffer, &size);
+        if(size > filterInline->stuff.output.length - filterInline->sent)
+            size = filterInline->stuff.output.length - filterInline->sent;
+        memcpy(ptr, filterInline->stuff.output.data + filterInline->sent, size);
+        updateWriteAndProcessPtr(proxy->filterBuffer, size);
+        filterInline->sent += size;
+        proxyMetrics.bytesFilterBuffer += size;
+        proxyMetrics.writesQtyFilterBuffer++;
+    }
+    if(filterInline->sent == filterInline->stuff.output.length) {
+        filterInline->stuff.output.length = 0;
+        filterInline->sent          = 0;
+    }
+}
+
+/**
+ * Con el stripmime del proxy como filtro, filtra el cuerpo del RETR a medida
+ * que llega, sin procesos ni pipes. Solo se lee más del cuerpo cuando la
+ * salida pendiente entra en el filterBuffer, así el origin no se adelanta al
+ * cliente. Al enviarse la linea de terminación se siguen procesando las
+ * respuestas como al cerrar el filtro.
+ */
+static unsigned filterInlineStep(MultiplexorKey key) {
+    proxyPopv3         * proxy        = ATTACHMENT(key);
+    filterInlineStruct * filterInline = &proxy->filterInline;
+    bufferADT            buffer       = proxy->writeBuffer;
+    unsigned ret = COPY;
+    bool bodyEnded;
+
+    switch(proxy->filterData.state) {
+        case FILTER_STARTING:
+            /** Se espera a que el cliente reciba la primera linea de la respuesta. */
+            if(!proxyConf.filterActivated || !isInlineFilter() || canRead(buffer))
+                break;
+            filterInlineInit(proxy);
+            proxy->filterData.state = FILTER_INLINE;
+            proxyMetrics.commandsFilteredQty++;
+
+        case FILTER_INLINE:
+            filterInlineOutput(proxy);
+            while(!filterInline->stuff.complete && filterInline->stuff.output.length - filterInline->sent <= proxyConf.bufferSize) {
+                ret = analizeAndProcessResponse(proxy, buffer, false, true);
+                if(ret != COPY)
+                    return ret;
+                bodyEnded = proxy->responseParser.state == RESPONSE_INIT
+                         || (proxy->copyState == ORIGIN_READ_DOWN && !canProcess(buffer));
+                if(!canRead(buffer) && !bodyEnded)
+                    break;
+                filterInlineConsume(proxy, buffer, bodyEnded);
+                filterInlineOutput(proxy);
+            }
+            if(!filterInline->stuff.complete || filterInline->stuff.output.length > 0 || canRead(proxy->filterBuffer))
+                break;
+            filterClose(key);
+            ret = analizeAndProcessResponse(proxy, buffer, proxyConf.filterActivated, false);
+            if(proxy->copyState == ORIGIN_READ_DOWN && !canRead(buffer)) {
+                proxy->copyState = CLIENT_WRITE_DOWN;
+                shutDownCopy(&proxy->origin.copy, false, true, true);
+            }
+            break;
+
+        default:
+            break;
+    }
     return ret;
 }
 
@@ -1065,12 +2149,17 @@ static unsigned receiveFromFilter(int fd, copyStruct * copy, uint8_t * ptr, size
  *
  */
 static unsigned copyRead(MultiplexorKey key) {
+    if(key->fd == ATTACHMENT(key)->watchdogFd)
+        return filterWatchdogRead(key);
+
     copyStruct * copy  = copyPtr(key);       
     proxyPopv3 * proxy = ATTACHMENT(key);
 
     unsigned ret = COPY;
     size_t size;
     bufferADT buffer = copy->readBuffer;
+    if(copy->target == COPY_ORIGIN)
+        buffer = retrPrefetchOriginBuffer(&proxy->prefetch, buffer);
     uint8_t *ptr = getWritePtr(buffer, &size);
 
     switch(copy->target) {
@@ -1084,6 +2173,14 @@ static unsigned copyRead(MultiplexorKey key) {
             ret = receiveFromFilter(key->fd, copy, ptr, size, buffer, proxy, key);
             break;
     }
+    if(ret == COPY)
+        ret = filterOutputStep(key);
+    if(ret == COPY)
+        ret = filterSpoolStep(key);
+    if(ret == COPY)
+        ret = filterInlineStep(key);
+    if(ret == COPY)
+        ret = prefetchStep(proxy);
     computeInterestsCopy(key);
 
     if(copy->duplex == NO_INTEREST && (*copy->state == ORIGIN_WRITE_DOWN || proxy->filterData.state == FILTER_CLOSE))
@@ -1098,7 +2195,7 @@ static unsigned sendToClient(int fd, copyStruct * copy, uint8_t * ptr, size_t si
     unsigned ret = COPY;    
     ssize_t n;
     const filterState state = proxy->filterData.state;
-    const bool wantSendFromFilter = state == FILTER_FILTERING || state == FILTER_ALL_SENT;
+    const bool wantSendFromFilter = state == FILTER_FILTERING || state == FILTER_ALL_SENT || state == FILTER_CACHED || state == FILTER_INLINE;
 
     if(wantSendFromFilter) {
         logDebug("Sending to Client a filter body.");
@@ -1133,8 +2230,11 @@ static unsigned sendToOrigin(int fd, copyStruct * copy, uint8_t * ptr, size_t si
     unsigned ret = COPY;    
     ssize_t n;
     
-    commandParserConsume(&proxy->commandParser, buffer, proxy->request.commands, proxy->originCapabilities.pipelining, &proxy->request.waitingResponse);
-    ptr = getReadPtr(buffer, &size);
+    /** Mientras se espera saber si pide el RETR especulativo, el cliente no avanza. */
+    if(!retrPrefetchHoldsClient(&proxy->prefetch))
+        commandParserConsume(&proxy->commandParser, buffer, proxy->request.commands, proxy->originCapabilities.pipelining, &proxy->request.waitingResponse);
+    ptr  = getReadPtr(buffer, &size);
+    size = retrPrefetchSendable(&proxy->prefetch, size);
 
     n = send(fd, ptr, size, MSG_NOSIGNAL);
     if(n == -1) {
@@ -1144,6 +2244,7 @@ static unsigned sendToOrigin(int fd, copyStruct * copy, uint8_t * ptr, size_t si
     } else {
         proxyMetrics.readsQtyWriteBuffer++;
         proxyMetrics.totalBytesToOrigin += n;
+        retrPrefetchRequestSent(&proxy->prefetch, ptr, n);
         updateReadPtr(buffer, n);
         logMetric("Coppied from proxy to origin, total copied: %zd bytes.", n);
         if(*copy->state == CLIENT_READ_DOWN && !(canProcess(buffer) || canRead(buffer))) {
@@ -1154,34 +2255,103 @@ static unsigned sendToOrigin(int fd, copyStruct * copy, uint8_t * ptr, size_t si
     return ret;
 }
 
+/**
+ * Escribe en la entrada del filtro. Si el worker del pool se cayó, el
+ * socket no genera SIGPIPE. Retorna cuántos bytes del cuerpo se consumieron.
+ */
+static ssize_t writeToFilter(proxyPopv3 * proxy, int fd, const uint8_t * ptr, size_t size) {
+    if(proxy->filterData.pooled)
+        return send(fd, ptr, size, MSG_NOSIGNAL);
+    return filterStuffToCommand(&proxy->filterInline.stuff, filterInlineBody, fd, ptr, size);
+}
+
+/**
+ * Con el fallback pass guarda los bytes del cuerpo que se entregan al
+ * filtro desde el writeBuffer, hasta que el filtro da salida. Si no entran
+ * en FILTER_WATCHDOG_RETAIN_SIZE el fallback es replace.
+ */
+static void filterWatchdogRetain(proxyPopv3 * proxy, const uint8_t * data, const size_t length) {
+    if(!filterWatchdogEnabled() || filterWatchdogGetFallback() != FILTER_FALLBACK_PASS)
+        return;
+    if(proxy->watchdogInputFailed || proxy->watchdog.output)
+        return;
+    if(!filterCacheBytesAppend(&proxy->watchdogInput, data, length, FILTER_WATCHDOG_RETAIN_SIZE))
+        proxy->watchdogInputFailed = true;
+}
+
 /**
  *
  */
+
 static unsigned sendToFilter(int fd, copyStruct * copy, uint8_t * ptr, size_t size, bufferADT buffer, proxyPopv3 * proxy) { 
     unsigned ret = COPY;    
     ssize_t n;
     bool interestRetr = false, toNewCommand = true, allReceived;
+    filterSpoolStruct  * spool        = &proxy->filterSpool;
+    filterInlineStruct * filterInline = &proxy->filterInline;
+
+    /** Primero se envía el cuerpo juntado para el cache del filtro. */
+    if(spool->sent < spool->body.length) {
+        n = writeToFilter(proxy, fd, spool->body.data + spool->sent, spool->body.length - spool->sent);
+        if(n == -1) {
+            proxy->filterData.state = FILTER_ALL_SENT;
+            spool->capture = false;
+            logWarn("Filter fail: unnable to write in pipe.");
+        } else {
+            proxyMetrics.totalBytesToFilter += n;
+            filterWatchdogFed(&proxy->watchdog, n);
+            spool->sent += n;
+            if(spool->complete && spool->sent == spool->body.length && filterInline->stuff.inputSent == filterInline->stuff.input.length)
+                proxy->filterData.state = FILTER_ALL_SENT;
+        }
+        return ret;
+    }
 
     ret = analizeAndProcessResponse(proxy, buffer, interestRetr, toNewCommand);
     allReceived = proxy->responseParser.state == RESPONSE_INIT;
     ptr = getReadPtr(buffer, &size);
 
-    n = write(fd, ptr, size);
+    n = writeToFilter(proxy, fd, ptr, size);
     if(n == -1) {
         proxy->filterData.state = FILTER_ALL_SENT;
         logWarn("Filter fail: unnable to write in pipe.");
     } else {    
         proxyMetrics.readsQtyWriteBuffer++;
         proxyMetrics.totalBytesToFilter += n;
+        filterWatchdogFed(&proxy->watchdog, n);
+        filterWatchdogRetain(proxy, ptr, n);
         updateReadPtr(buffer, n);    
 
-        if(allReceived && !canRead(buffer)) 
+        if(allReceived && !canRead(buffer) && filterInline->stuff.inputSent == filterInline->stuff.input.length) 
             proxy->filterData.state = FILTER_ALL_SENT;
         logMetric("Coppied from proxy to filter, total copied: %zd bytes.", n);
     }
     return ret;
 }
 
+/**
+ * Copia al filterBuffer la salida del comando que esperaba lugar. El filtro
+ * se cierra cuando el cliente recibió la linea de terminación y, con un
+ * comando, cuando se consumió todo el cuerpo.
+ */
+static unsigned filterOutputStep(MultiplexorKey key) {
+    proxyPopv3       * proxy      = ATTACHMENT(key);
+    filterDataStruct * filterData = &proxy->filterData;
+    bool ended;
+
+    if(filterData->state != FILTER_FILTERING && filterData->state != FILTER_ALL_SENT)
+        return COPY;
+    if(filterData->pooled)
+        ended = filterData->end.done;
+    else {
+        filterInlineOutput(proxy);
+        ended = filterData->state == FILTER_ALL_SENT && proxy->filterInline.stuff.complete && proxy->filterInline.stuff.output.length == 0;
+    }
+    if(!ended || canRead(proxy->filter.copy.readBuffer))
+        return COPY;
+    return filterOutputEnd(key, &proxy->filter.copy, proxy->filter.copy.readBuffer);
+}
+
 /**
  *
  */
@@ -1205,6 +2375,14 @@ static unsigned copyWrite(MultiplexorKey key) {
             ret = sendToFilter(key->fd, copy, ptr, size, buffer, proxy);
             break;
     }
+    if(ret == COPY)
+        ret = filterOutputStep(key);
+    if(ret == COPY)
+        ret = filterSpoolStep(key);
+    if(ret == COPY)
+        ret = filterInlineStep(key);
+    if(ret == COPY)
+        ret = prefetchStep(proxy);
 
     computeInterestsCopy(key);
     if(copy->duplex == NO_INTEREST) {
@@ -1213,6 +2391,17 @@ static unsigned copyWrite(MultiplexorKey key) {
     return ret;
 }
 
+/**
+ * La sesión obtuvo un lugar en filterLimit (ver filterSlotReady): se inicia
+ * el filtro que esperaba.
+ */
+static unsigned copyBlock(MultiplexorKey key) {
+    unsigned ret = filterSpoolStep(key);
+
+    computeInterestsCopy(key);
+    return ret;
+}
+
 /**
  * Manejador de errores para el estado de filter.
  */
@@ -1222,34 +2411,329 @@ static void errorFilterHandler(void * data) {
 
     logDebug("Filter have some error.");
     proxy->filterData.state = FILTER_ENDING;
+    proxy->filterSpool.capture = false;
     filterClose(key);
 }
 
 /**
- * Setea las variables de entorno para el programa de filtro externo.
+ * Lanza el comando de filtro con `/bin/sh -c', los `fdCount' descriptores
+ * de `fds' (entrada, salida, ...) y las variables de entorno para el
+ * programa de filtro externo. Retorna su pid, o -1 si no se pudo ejecutar.
  */
-static void setEnvironment(const proxyPopv3 * proxy) {
+static pid_t spawnFilter(const proxyPopv3 * proxy, const int fds[], const size_t fdCount) {
     char bufferSizeStr[10] = {0};
     snprintf(bufferSizeStr, 10, "%zu", proxyConf.bufferSize);
 
-    if(proxyConf.mediaRange != NULL)
-        setenv("FILTER_MEDIAS", proxyConf.mediaRange, 1);
-    setenv("FILTER_MSG", proxyConf.replaceMsg, 1);
-    setenv("POP3FILTER_VERSION", VERSION_NUMBER, 1);
-    setenv("POP3_USERNAME",proxy->session.name, 1);
-    setenv("POP3_SERVER", proxyConf.stringServer, 1);
-    setenv("BUFFER_SIZE", bufferSizeStr, 1);
+    const char * const names[] = {
+        "FILTER_MEDIAS", "FILTER_MSG", "POP3FILTER_VERSION", "POP3_USERNAME", "POP3_SERVER", "BUFFER_SIZE",
+    };
+    const char * const values[] = {
+        proxyConf.mediaRange, proxyConf.replaceMsg, VERSION_NUMBER, proxy->session.name, sessionServer(proxy), bufferSizeStr,
+    };
+    char * const argv[] = {"sh", "-c", proxyConf.filterCommand, NULL};
+    return processSpawnFds(FILTER_SHELL_PATH, argv, fds, fdCount, proxyConf.stdErrorFilePath,
+                           names, values, sizeof(names) / sizeof(names[0]));
 }
 
-static void workBlockingSlave(void * data) {
-    uint8_t dataBuffer[SLAVE_BUFFER_SIZE];
-    ssize_t n;
-    do {
-        n = read(STDIN_FILENO, dataBuffer, sizeof(dataBuffer));
-        if(n > 0)
-            write(STDOUT_FILENO, dataBuffer, n);
-    } while(n > 0);
-    errorFilterHandler(data);
+/** Sin el comando, copia la entrada en la salida. */
+static void workBlockingSlave(void) {
+    processCopy(STDIN_FILENO, STDOUT_FILENO);
+    _exit(1);
+}
+
+/**
+ * Inicia el filtro en un worker del pool. Retorna false si no hay pool o
+ * no hay workers disponibles, y el filtro se inicia como siempre.
+ */
+static bool filterWorkerInit(MultiplexorKey key) {
+    proxyPopv3       * proxy      = ATTACHMENT(key);
+    filterDataStruct * filterData = &proxy->filterData;
+    uint8_t header[FILTER_FRAME_HEADER_SIZE];
+    char bufferSizeStr[10] = {0};
+    multiplexorStatus status;
+
+    snprintf(bufferSizeStr, 10, "%zu", proxyConf.bufferSize);
+    const char * const names[] = {
+        FILTER_FRAME_COMMAND, FILTER_FRAME_ERROR_FILE, "FILTER_MEDIAS", "FILTER_MSG",
+        "POP3FILTER_VERSION", "POP3_USERNAME", "POP3_SERVER", "BUFFER_SIZE",
+    };
+    const char * const values[] = {
+        proxyConf.filterCommand, proxyConf.stdErrorFilePath, proxyConf.mediaRange, proxyConf.replaceMsg,
+        VERSION_NUMBER, proxy->session.name, sessionServer(proxy), bufferSizeStr,
+    };
+    const size_t length = filterPoolHeader(header, sizeof(header), names, values, sizeof(names) / sizeof(names[0]));
+    if(length == 0)
+        return false;
+
+    const int fd = filterPoolAcquire(proxyConf.filterNative? proxyConf.filterCommand : NULL, proxyConf.stdErrorFilePath,
+                                     header, length, &filterData->worker);
+    if(fd < 0)
+        return false;
+    filterData->pooled = true;
+    filterPoolScannerInit(&filterData->end);
+    /* El fd del worker es del pool, el filtro usa copias. */
+    filterData->infd[1]  = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    filterData->outfd[0] = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    filterData->slavePid = filterPoolWorkerPid(filterData->worker);
+    if(filterData->infd[1] < 0 || filterData->outfd[0] < 0) {
+        logError("Filter fail: cannot dup worker socket.");
+        errorFilterHandler(&key);
+        return true;
+    }
+
+    status = registerFd(key->mux, filterData->infd[1], &proxyPopv3Handler, NO_INTEREST, proxy);
+    checkAreEqualsWithFinally(status, MUX_SUCCESS, errorFilterHandler, &key, "Filter fail: cannot register IN worker socket in multiplexor.");
+    proxy->references++;
+    status = registerFd(key->mux, filterData->outfd[0], &proxyPopv3Handler, NO_INTEREST, proxy);
+    checkAreEqualsWithFinally(status, MUX_SUCCESS, errorFilterHandler, &key, "Filter fail: cannot register OUT worker socket in multiplexor.");
+    proxy->references++;
+    return true;
+}
+
+/**
+ * Prepara el filtro en modo batch: el memfd donde se junta el cuerpo. El
+ * comando se lanza en filterBatchStart.
+ */
+static void filterBatchInit(MultiplexorKey key) {
+    proxyPopv3       * proxy      = ATTACHMENT(key);
+    filterDataStruct * filterData = &proxy->filterData;
+    multiplexorStatus status;
+
+    filterData->batch       = true;
+    filterData->batchOutput = -1;
+    filterData->infd[1]     = processMemfd("pop3filter-body");
+    if(filterData->infd[1] < 0) {
+        logError("Filter fail: cannot create the batch memfd: %s.", strerror(errno));
+        errorFilterHandler(&key);
+        return;
+    }
+
+    status = registerFd(key->mux, filterData->infd[1], &proxyPopv3Handler, NO_INTEREST, proxy);
+    checkAreEqualsWithFinally(status, MUX_SUCCESS, errorFilterHandler, &key, "Filter fail: cannot register the batch memfd in multiplexor.");
+    proxy->references++;
+}
+
+/**
+ * Lanza el comando en modo batch con el cuerpo completo: el memfd del
+ * cuerpo como entrada y otro memfd como salida. Su pidfd queda en outfd[0].
+ * SIGCHLD solo se atiende en el pselect del multiplexor, así que el hijo no
+ * se espera antes de abrir el pidfd. Retorna false si hubo un error y se
+ * cerró el filtro.
+ */
+static bool filterBatchStart(MultiplexorKey key) {
+    proxyPopv3       * proxy      = ATTACHMENT(key);
+    filterDataStruct * filterData = &proxy->filterData;
+    multiplexorStatus status;
+
+    if(filterData->slavePid != 0)
+        return true;
+    filterData->batchOutput = processMemfd("pop3filter-output");
+    if(filterData->batchOutput < 0 || lseek(filterData->infd[1], 0, SEEK_SET) < 0) {
+        logError("Filter fail: cannot create the batch output memfd: %s.", strerror(errno));
+        errorFilterHandler(&key);
+        return false;
+    }
+
+    const int fds[] = {filterData->infd[1], filterData->batchOutput};
+    pid_t pid = spawnFilter(proxy, fds, 2);
+    if(pid < 0) {
+        logError("Filter fail: cannot execute %s, the body is sent unfiltered.", FILTER_SHELL_PATH);
+        pid = fork();
+        if(pid == 0) {
+            dup2(filterData->infd[1], STDIN_FILENO);
+            dup2(filterData->batchOutput, STDOUT_FILENO);
+            processCloseFrom(STDERR_FILENO + 1);
+            workBlockingSlave();
+        }
+    }
+    if(pid < 0) {
+        logError("Filter fail: cannot fork.");
+        errorFilterHandler(&key);
+        return false;
+    }
+    filterData->slavePid = pid;
+    filterData->outfd[0] = processPidfd(pid);
+    if(filterData->outfd[0] < 0) {
+        logError("Filter fail: cannot open the batch command pidfd: %s.", strerror(errno));
+        errorFilterHandler(&key);
+        return false;
+    }
+
+    status = registerFd(key->mux, filterData->outfd[0], &proxyPopv3Handler, NO_INTEREST, proxy);
+    if(status != MUX_SUCCESS) {
+        logError("Filter fail: cannot register the batch command pidfd in multiplexor.");
+        errorFilterHandler(&key);
+        return false;
+    }
+    proxy->references++;
+    /** Juntar el cuerpo depende del origin, no del comando. */
+    filterWatchdogLaunch(&proxy->watchdog);
+    filterWatchdogArm(proxy);
+    return true;
+}
+
+/** Despierta a la sesión que obtuvo un lugar en filterLimit. */
+static void filterSlotReady(void * data) {
+    proxyPopv3 * proxy = data;
+
+    if(MUX_SUCCESS != notifyBlock(proxy->filterSlotMux, proxy->clientFd))
+        logError("Unable to wake up a session waiting for a filter.");
+}
+
+/**
+ * Pide un lugar en filterLimit para el filtro de la sesión. Retorna false
+ * si la sesión quedó esperando; filterSlotReady la despierta al obtenerlo.
+ * El stripmime del proxy no ocupa lugar.
+ */
+static bool filterAdmit(MultiplexorKey key) {
+    proxyPopv3 * proxy = ATTACHMENT(key);
+
+    proxy->filterSlotMux = key->mux;
+    return filterLimitAcquire(&proxy->filterSlot, filterSlotReady, proxy);
+}
+
+/** Arma el timer con el plazo más próximo del filtro, o lo desarma si no hay. */
+static void filterWatchdogArm(proxyPopv3 * proxy) {
+    struct timespec now;
+    unsigned remaining;
+
+    if(proxy->watchdogFd == -1)
+        return;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    filterWatchdogCheck(&proxy->watchdog, &now, &remaining);
+    if(timerFdArm(proxy->watchdogFd, remaining) < 0)
+        logError("Unable to arm the filter watchdog: %s.", strerror(errno));
+}
+
+/**
+ * Comienza a medir el filtro del RETR; en modo batch los plazos corren
+ * recién desde filterBatchStart. Con plazos configurados el timer se crea
+ * con el primer filtro de la sesión y queda registrado hasta que termina;
+ * sin timer el filtro no tiene plazos.
+ */
+static void filterWatchdogInit(MultiplexorKey key) {
+    proxyPopv3 * proxy = ATTACHMENT(key);
+
+    proxy->watchdogInput.length = 0;
+    proxy->watchdogInputFailed  = false;
+    if(proxyConf.filterBatch)
+        filterWatchdogCollect(&proxy->watchdog);
+    else
+        filterWatchdogStart(&proxy->watchdog);
+    if(!filterWatchdogEnabled())
+        return;
+    if(proxy->watchdogFd == -1) {
+        proxy->watchdogFd = timerFdCreate();
+        if(proxy->watchdogFd == -1) {
+            logError("Unable to create the filter watchdog: %s.", strerror(errno));
+            return;
+        }
+        if(MUX_SUCCESS != registerFd(key->mux, proxy->watchdogFd, &proxyPopv3Handler, READ, proxy)) {
+            logError("Unable to register the filter watchdog in multiplexor.");
+            close(proxy->watchdogFd);
+            proxy->watchdogFd = -1;
+            return;
+        }
+        proxy->references += 1;
+    }
+    filterWatchdogArm(proxy);
+}
+
+/** Cierra el timer de los plazos del filtro, si se creó. */
+static void filterWatchdogClose(MultiplexorADT mux, proxyPopv3 * proxy) {
+    const int fd = proxy->watchdogFd;
+
+    if(fd == -1)
+        return;
+    proxy->watchdogFd = -1;
+    if(MUX_SUCCESS != unregisterFd(mux, fd))
+        logError("Problem trying to unregister a fd: %d.", fd);
+    close(fd);
+}
+
+/**
+ * Arma en `body' lo que se entregó al filtro para enviarlo sin filtrar: lo
+ * juntado para el cache del filtro seguido de lo que se guardó del
+ * writeBuffer. Retorna false si no se guardó todo.
+ */
+static bool filterFallbackPassBody(proxyPopv3 * proxy) {
+    filterSpoolStruct * spool = &proxy->filterSpool;
+
+    if(proxy->watchdogInputFailed || proxy->watchdog.output)
+        return false;
+    if(!isFilterSpooled())
+        spool->body.length = 0;
+    return filterCacheBytesAppend(&spool->body, proxy->watchdogInput.data, proxy->watchdogInput.length, SIZE_MAX);
+}
+
+/**
+ * Arma en `body' el mensaje de reemplazo con dot-stuffing y la linea de
+ * terminación. Retorna false si no hay memoria.
+ */
+static bool filterFallbackReplaceBody(proxyPopv3 * proxy) {
+    filterStuffStruct replace = {
+        .output    = proxy->filterSpool.body,
+        .lineStart = true,
+    };
+
+    replace.output.length = 0;
+    filterStuffWriter((const uint8_t *) proxyConf.replaceMsg, strlen(proxyConf.replaceMsg), &replace);
+    filterStuffEnd(&replace);
+    proxy->filterSpool.body = replace.output;
+    return !replace.outputFailed;
+}
+
+/**
+ * Venció el timer del filtro. Si el plazo se extendió por los bytes
+ * entregados se vuelve a armar; si venció se mata el filtro y se aplica el
+ * fallback. Con pass y replace se reutiliza FILTER_CACHED para enviar el
+ * cuerpo sin filtrar o el mensaje de reemplazo. Con error, o si el filtro
+ * ya dio salida, el +OK ya se envió y la sesión termina con un -ERR.
+ */
+static unsigned filterWatchdogRead(MultiplexorKey key) {
+    proxyPopv3        * proxy = ATTACHMENT(key);
+    filterSpoolStruct * spool = &proxy->filterSpool;
+    filterWatchdogFallback fallback;
+    struct timespec now;
+    unsigned remaining, ret = COPY;
+
+    if(!timerFdClear(key->fd))
+        logError("Unable to read the filter watchdog: %s.", strerror(errno));
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const filterWatchdogExpiry expiry = filterWatchdogCheck(&proxy->watchdog, &now, &remaining);
+    if(expiry == FILTER_WATCHDOG_RUNNING) {
+        if(remaining > 0)
+            timerFdArm(key->fd, remaining);
+        return ret;
+    }
+
+    const bool canPass = filterWatchdogGetFallback() == FILTER_FALLBACK_PASS && filterFallbackPassBody(proxy);
+    fallback = filterWatchdogExpire(&proxy->watchdog, expiry, canPass);
+    logWarn("Filter fail: the %s deadline expired, the filter is killed.", (expiry == FILTER_WATCHDOG_FIRST_BYTE)? "first byte" : "total");
+    spool->capture = false;
+    filterClose(key);
+
+    if(fallback == FILTER_FALLBACK_REPLACE && !filterFallbackReplaceBody(proxy))
+        fallback = FILTER_FALLBACK_ERROR;
+    if(fallback == FILTER_FALLBACK_ERROR) {
+        proxy->errorSender.message = "-ERR Filter timed out.\r\n";
+        if(proxy->originFd != -1 && MUX_SUCCESS != setInterest(key->mux, proxy->originFd, NO_INTEREST))
+            return ERROR;
+        if(MUX_SUCCESS != setInterest(key->mux, proxy->clientFd, WRITE))
+            return ERROR;
+        return SEND_ERROR_MSG;
+    }
+
+    spool->sent = 0;
+    if(fallback == FILTER_FALLBACK_PASS) {
+        spool->complete = proxy->responseParser.state == RESPONSE_INIT;
+        proxy->filterData.state = FILTER_CACHED;
+        reset(proxy->filterBuffer);
+    } else
+        proxy->filterData.state = FILTER_DISCARDING;
+    ret = filterSpoolStep(key);
+    computeInterestsCopy(key);
+    return ret;
 }
 
 /**
@@ -1261,6 +2745,7 @@ static void filterInit(MultiplexorKey key) {
     multiplexorStatus status;
 
     logDebug("Filter init.");
+    filterWatchdogInit(key);
 
     for(int i = 0; i < 2; i++) {
         filterData->infd[i]  = -1;
@@ -1268,45 +2753,56 @@ static void filterInit(MultiplexorKey key) {
     }
     
     reset(proxy->filterBuffer);
+    if(!filterStuffInit(&proxy->filterInline)) {
+        logError("Filter fail: cannot allocate the unstuffed body buffer.");
+        errorFilterHandler(&key);
+        return;
+    }
+    if(proxyConf.filterBatch) {
+        filterBatchInit(key);
+        return;
+    }
+    if(filterWorkerInit(key))
+        return;
 
-    checkFailWithFinally(pipe(filterData->infd), errorFilterHandler, &key, "Filter fail: cannot open a pipe.");
-    checkFailWithFinally(pipe(filterData->outfd), errorFilterHandler, &key, "Filter fail: cannot open a pipe.");
-       
-    pid_t pid = fork();
-    checkFailWithFinally(pid, errorFilterHandler, &key, "Filter fail: cannot fork.");
-    if(pid == 0) {       
-        filterData->slavePid = -1;
-        close(filterData->infd[1]);
-        close(filterData->outfd[0]);
-        dup2(filterData->infd[0], STDIN_FILENO);
-        close(filterData->infd[0]);
-        dup2(filterData->outfd[1], STDOUT_FILENO);
-        close(filterData->outfd[1]);
-        close(STDERR_FILENO);
-        open(proxyConf.stdErrorFilePath, O_WRONLY | O_APPEND);
-        for(int i = 3; i < 1024; i++)
-            close(i);
-
-        setEnvironment(proxy);
-        execl("./Proxy/FilterWrapper/filterWrapper.out", proxyConf.filterCommand, proxyConf.stdErrorFilePath, (char *)0);
-        workBlockingSlave(&key);
-    } else {
-        filterData->slavePid = pid;
-        close(filterData->infd[0]);
-        close(filterData->outfd[1]);
-        filterData->infd[0]  = -1;
-        filterData->outfd[1] = -1;
+    checkFailWithFinally(processPipe(filterData->infd), errorFilterHandler, &key, "Filter fail: cannot open a pipe.");
+    checkFailWithFinally(processPipe(filterData->outfd), errorFilterHandler, &key, "Filter fail: cannot open a pipe.");
 
-        checkFailWithFinally(fdSetNIO(filterData->infd[1]), errorFilterHandler, &key, "Filter fail: cannot set nio IN pipe.");
-        checkFailWithFinally(fdSetNIO(filterData->outfd[0]), errorFilterHandler, &key, "Filter fail: cannot set nio OUT pipe.");
+    /** Con pipes más grandes el comando y el proxy se despiertan menos veces por mensaje. */
+    if(proxyConf.filterPipeSize > 0 && (processSetPipeSize(filterData->infd[1], proxyConf.filterPipeSize) < 0 ||
+                                        processSetPipeSize(filterData->outfd[0], proxyConf.filterPipeSize) < 0) && !pipeSizeFailed) {
+        logWarn("Unable to set the filter pipes capacity: %s.", strerror(errno));
+        pipeSizeFailed = true;
+    }
 
-        status = registerFd(key->mux, filterData->infd[1], &proxyPopv3Handler, NO_INTEREST, proxy);        
-        checkAreEqualsWithFinally(status, MUX_SUCCESS, errorFilterHandler, &key, "Filter fail: cannot register IN pipe in multiplexor.");
-        proxy->references++;
-        status = registerFd(key->mux, filterData->outfd[0], &proxyPopv3Handler, NO_INTEREST, proxy);
-        checkAreEqualsWithFinally(status, MUX_SUCCESS, errorFilterHandler, &key, "Filter fail: cannot register OUT pipe in multiplexor.");
-        proxy->references++;
+    const int fds[] = {filterData->infd[0], filterData->outfd[1]};
+    pid_t pid = spawnFilter(proxy, fds, 2);
+    if(pid < 0) {
+        logError("Filter fail: cannot execute %s, the body is sent unfiltered.", FILTER_SHELL_PATH);
+        pid = fork();
+        checkFailWithFinally(pid, errorFilterHandler, &key, "Filter fail: cannot fork.");
+        if(pid == 0) {
+            dup2(filterData->infd[0], STDIN_FILENO);
+            dup2(filterData->outfd[1], STDOUT_FILENO);
+            processCloseFrom(STDERR_FILENO + 1);
+            workBlockingSlave();
+        }
     }
+    filterData->slavePid = pid;
+    close(filterData->infd[0]);
+    close(filterData->outfd[1]);
+    filterData->infd[0]  = -1;
+    filterData->outfd[1] = -1;
+
+    checkFailWithFinally(fdSetNIO(filterData->infd[1]), errorFilterHandler, &key, "Filter fail: cannot set nio IN pipe.");
+    checkFailWithFinally(fdSetNIO(filterData->outfd[0]), errorFilterHandler, &key, "Filter fail: cannot set nio OUT pipe.");
+
+    status = registerFd(key->mux, filterData->infd[1], &proxyPopv3Handler, NO_INTEREST, proxy);        
+    checkAreEqualsWithFinally(status, MUX_SUCCESS, errorFilterHandler, &key, "Filter fail: cannot register IN pipe in multiplexor.");
+    proxy->references++;
+    status = registerFd(key->mux, filterData->outfd[0], &proxyPopv3Handler, NO_INTEREST, proxy);
+    checkAreEqualsWithFinally(status, MUX_SUCCESS, errorFilterHandler, &key, "Filter fail: cannot register OUT pipe in multiplexor.");
+    proxy->references++;
 }
 
 /**
@@ -1316,7 +2812,14 @@ static void filterClose(MultiplexorKey key) {
     proxyPopv3       * proxy      = ATTACHMENT(key);
     filterDataStruct * filterData = &proxy->filterData;
  
-    if(filterData->slavePid > 0) 
+    filterInlineClose(proxy);
+    filterLimitRelease(&proxy->filterSlot);
+    filterWatchdogStop(&proxy->watchdog);
+    filterWatchdogArm(proxy);
+    /** El worker se reutiliza solo si recibió todo el cuerpo y envió toda la salida. */
+    if(filterData->pooled)
+        filterPoolRelease(filterData->worker, filterData->end.done && filterData->state == FILTER_ALL_SENT);
+    else if(filterData->slavePid > 0) 
         kill(filterData->slavePid, SIGKILL);
     else if(filterData->slavePid == -1)
         exit(1);
@@ -1331,6 +2834,8 @@ static void filterClose(MultiplexorKey key) {
             close(filterData->outfd[i]);
         }
     }
+    if(filterData->batch && filterData->batchOutput > 0)
+        close(filterData->batchOutput);
     memset(filterData, 0, sizeof(filterDataStruct));
 
     proxy->filterData.state = FILTER_CLOSE;
@@ -1372,10 +2877,16 @@ static unsigned writeErrorMsg(MultiplexorKey key) {
  */
 static const struct stateDefinition clientStatbl[] = {
     {
+        .state            = LOCAL_AUTHORIZATION,
+        .onReadReady      = localAuthorizationRead,
+        .onWriteReady     = localAuthorizationWrite,
+    }, {
         .state            = CONNECTION_RESOLV,
         .onBlockReady     = resolvDone,
     }, {
         .state            = CONNECTING,
+        .onDeparture      = connectingDeparture,
+        .onReadReady      = connectionTimer,
         .onWriteReady     = connectionReady,
     }, {
         .state            = HELLO,
@@ -1392,6 +2903,7 @@ static const struct stateDefinition clientStatbl[] = {
         .onArrival        = copyInit,
         .onReadReady      = copyRead,
         .onWriteReady     = copyWrite,
+        .onBlockReady     = copyBlock,
     }, {
         .state            = SEND_ERROR_MSG,
         .onWriteReady     = writeErrorMsg,
@@ -1479,6 +2991,13 @@ static void proxyPopv3Done(MultiplexorKey key) {
     };
     if(ATTACHMENT(key)->filterData.state != FILTER_CLOSE)
         filterClose(key);
+    resolverCancel(&ATTACHMENT(key)->resolution);
+    closeConnectionAttempts(key->mux, ATTACHMENT(key));
+    filterWatchdogClose(key->mux, ATTACHMENT(key));
+    if(ATTACHMENT(key)->originAcquired) {
+        ATTACHMENT(key)->originAcquired = false;
+        originSetRelease(originSet, ATTACHMENT(key)->originIndex);
+    }
     for(unsigned i = 0; i < N(fds); i++) {
         if(fds[i] != -1) {
             if(MUX_SUCCESS != unregisterFd(key->mux, fds[i])) {
@@ -0,0 +1,348 @@
+/**
+ * resolver.c - resolución de nombres con un pool fijo de hilos, agrupamiento
+ *              de consultas y cache positivo/negativo.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include "resolver.h"
+#include "logger.h"
+
+/** Cantidad de nombres distintos que se recuerdan. */
+#define RESOLVER_CACHE_SIZE 32
+#define RESOLVER_NAME_SIZE 0xFF
+
+/**
+ * Consulta en curso o en espera de un hilo. Todos los pedidos por el
+ * mismo nombre y puerto se agregan a `waiters'.
+ */
+typedef struct resolverLookup {
+    char                        name[RESOLVER_NAME_SIZE];
+    in_port_t                   port;
+    resolverRequest *           waiters;
+    struct resolverLookup *     next;
+} resolverLookup;
+
+typedef struct resolverCacheEntry {
+    bool                        used;
+    char                        name[RESOLVER_NAME_SIZE];
+    in_port_t                   port;
+    resolverStatus              status;
+    resolverAnswer              answer;
+    time_t                      expires;
+} resolverCacheEntry;
+
+static struct {
+    bool                        initialized;
+    bool                        shutdown;
+    pthread_mutex_t             mutex;
+    pthread_cond_t              condition;
+    pthread_t *                 workers;
+    size_t                      workersSize;
+    time_t                      ttl;
+
+    /** Consultas sin hilo asignado y consultas en curso. */
+    resolverLookup *            queued;
+    resolverLookup *            running;
+
+    resolverCacheEntry          cache[RESOLVER_CACHE_SIZE];
+
+    unsigned long long          cacheHits;
+    unsigned long long          coalesced;
+    unsigned long long          lookups;
+    unsigned long long          failures;
+} resolver;
+
+static void * resolverWorker(void * data);
+
+bool resolverInit(const size_t workers, const time_t ttl) {
+    if(resolver.initialized)
+        return true;
+
+    resolver.workers = calloc(workers, sizeof(*resolver.workers));
+    if(resolver.workers == NULL)
+        return false;
+    pthread_mutex_init(&resolver.mutex, NULL);
+    pthread_cond_init(&resolver.condition, NULL);
+    resolver.ttl      = ttl;
+    resolver.shutdown = false;
+
+    for(resolver.workersSize = 0; resolver.workersSize < workers; resolver.workersSize++) {
+        if(0 != pthread_create(resolver.workers + resolver.workersSize, NULL, resolverWorker, NULL)) {
+            logError("Unable to create resolver worker %zu.", resolver.workersSize);
+            break;
+        }
+    }
+    resolver.initialized = true;
+    if(resolver.workersSize == 0) {
+        resolverDestroy();
+        return false;
+    }
+    return true;
+}
+
+static void freeLookups(resolverLookup * lookup) {
+    resolverLookup * next;
+    for(; lookup != NULL; lookup = next) {
+        next = lookup->next;
+        free(lookup);
+    }
+}
+
+void resolverDestroy(void) {
+    if(!resolver.initialized)
+        return;
+
+    pthread_mutex_lock(&resolver.mutex);
+    resolver.shutdown = true;
+    pthread_cond_broadcast(&resolver.condition);
+    pthread_mutex_unlock(&resolver.mutex);
+    for(size_t i = 0; i < resolver.workersSize; i++)
+        pthread_join(resolver.workers[i], NULL);
+
+    freeLookups(resolver.queued);
+    freeLookups(resolver.running);
+    resolver.queued  = NULL;
+    resolver.running = NULL;
+    free(resolver.workers);
+    resolver.workers = NULL;
+    pthread_cond_destroy(&resolver.condition);
+    pthread_mutex_destroy(&resolver.mutex);
+    resolver.initialized = false;
+}
+
+static bool sameName(const char * name, const in_port_t port, const char * otherName, const in_port_t otherPort) {
+    return port == otherPort && strcmp(name, otherName) == 0;
+}
+
+/** Busca una resolución vigente en el cache. Requiere el mutex. */
+static resolverCacheEntry * cacheFind(const char * name, const in_port_t port, const time_t now) {
+    for(unsigned i = 0; i < RESOLVER_CACHE_SIZE; i++) {
+        resolverCacheEntry * entry = resolver.cache + i;
+        if(entry->used && sameName(entry->name, entry->port, name, port)) {
+            if(now < entry->expires)
+                return entry;
+            entry->used = false;
+        }
+    }
+    return NULL;
+}
+
+/** Guarda una resolución reemplazando la más próxima a vencer. Requiere el mutex. */
+static void cacheStore(const resolverLookup * lookup, const resolverStatus status, const resolverAnswer * answer, const time_t now) {
+    resolverCacheEntry * entry = NULL;
+    const time_t ttl = (status == RESOLVER_DONE || resolver.ttl < RESOLVER_NEGATIVE_TTL)? resolver.ttl : RESOLVER_NEGATIVE_TTL;
+
+    if(ttl <= 0)
+        return;
+    for(unsigned i = 0; i < RESOLVER_CACHE_SIZE; i++) {
+        resolverCacheEntry * current = resolver.cache + i;
+        if(!current->used || sameName(current->name, current->port, lookup->name, lookup->port)) {
+            entry = current;
+            break;
+        }
+        if(entry == NULL || current->expires < entry->expires)
+            entry = current;
+    }
+    entry->used    = true;
+    entry->port    = lookup->port;
+    entry->status  = status;
+    entry->answer  = *answer;
+    entry->expires = now + ttl;
+    strcpy(entry->name, lookup->name);
+}
+
+static resolverLookup * findLookup(resolverLookup * lookup, const char * name, const in_port_t port) {
+    for(; lookup != NULL; lookup = lookup->next)
+        if(sameName(lookup->name, lookup->port, name, port))
+            return lookup;
+    return NULL;
+}
+
+resolverStatus resolverResolve(resolverRequest * request, MultiplexorADT mux, const int fd, const char * name, const in_port_t port) {
+    resolverStatus ret = RESOLVER_PENDING;
+
+    if(!resolver.initialized || strlen(name) >= RESOLVER_NAME_SIZE)
+        return request->status = RESOLVER_FAILED;
+
+    request->mux    = mux;
+    request->fd     = fd;
+    request->status = RESOLVER_PENDING;
+    request->lookup = NULL;
+    request->next   = NULL;
+
+    pthread_mutex_lock(&resolver.mutex);
+    resolverCacheEntry * entry = cacheFind(name, port, time(NULL));
+    if(entry != NULL) {
+        resolver.cacheHits++;
+        request->status = ret = entry->status;
+        request->answer = entry->answer;
+        goto finally;
+    }
+    resolverLookup * lookup = findLookup(resolver.running, name, port);
+    if(lookup == NULL)
+        lookup = findLookup(resolver.queued, name, port);
+    if(lookup != NULL)
+        resolver.coalesced++;
+    else {
+        lookup = calloc(1, sizeof(*lookup));
+        if(lookup == NULL) {
+            request->status = ret = RESOLVER_FAILED;
+            goto finally;
+        }
+        strcpy(lookup->name, name);
+        lookup->port    = port;
+        lookup->next    = resolver.queued;
+        resolver.queued = lookup;
+        pthread_cond_signal(&resolver.condition);
+    }
+    request->lookup = lookup;
+    request->next   = lookup->waiters;
+    lookup->waiters = request;
+
+finally:
+    pthread_mutex_unlock(&resolver.mutex);
+    return ret;
+}
+
+resolverStatus resolverPoll(const resolverRequest * request) {
+    resolverStatus status;
+
+    if(!resolver.initialized)
+        return request->status;
+    pthread_mutex_lock(&resolver.mutex);
+    status = request->status;
+    pthread_mutex_unlock(&resolver.mutex);
+    return status;
+}
+
+void resolverCancel(resolverRequest * request) {
+    if(!resolver.initialized)
+        return;
+
+    pthread_mutex_lock(&resolver.mutex);
+    if(request->lookup != NULL) {
+        resolverRequest ** current = &request->lookup->waiters;
+        for(; *current != NULL; current = &(*current)->next) {
+            if(*current == request) {
+                *current = request->next;
+                break;
+            }
+        }
+        request->lookup = NULL;
+    }
+    pthread_mutex_unlock(&resolver.mutex);
+}
+
+/** Ejecuta la consulta bloqueante y completa `answer'. */
+static resolverStatus blockingLookup(const resolverLookup * lookup, resolverAnswer * answer) {
+    struct addrinfo * resolution = NULL;
+    struct addrinfo hints = {
+        .ai_family    = AF_UNSPEC,
+        /** Permite IPv4 o IPv6. */
+        .ai_socktype  = SOCK_STREAM,
+        .ai_flags     = AI_PASSIVE,
+        .ai_protocol  = 0,
+        .ai_canonname = NULL,
+        .ai_addr      = NULL,
+        .ai_next      = NULL,
+    };
+    char service[7];
+
+    snprintf(service, sizeof(service), "%d", lookup->port);
+    answer->count = 0;
+    if(0 != getaddrinfo(lookup->name, service, &hints, &resolution))
+        return RESOLVER_FAILED;
+
+    for(struct addrinfo * current = resolution; current != NULL && answer->count < RESOLVER_MAX_ADDRESSES; current = current->ai_next) {
+        if(current->ai_addrlen > sizeof(answer->addresses[0]))
+            continue;
+        memcpy(answer->addresses + answer->count, current->ai_addr, current->ai_addrlen);
+        answer->lengths[answer->count] = current->ai_addrlen;
+        answer->count++;
+    }
+    freeaddrinfo(resolution);
+    return (answer->count > 0)? RESOLVER_DONE : RESOLVER_FAILED;
+}
+
+static void removeLookup(resolverLookup ** list, resolverLookup * lookup) {
+    for(; *list != NULL; list = &(*list)->next) {
+        if(*list == lookup) {
+            *list = lookup->next;
+            return;
+        }
+    }
+}
+
+static void * resolverWorker(void * data) {
+    resolverAnswer answer;
+
+    pthread_mutex_lock(&resolver.mutex);
+    while(!resolver.shutdown) {
+        if(resolver.queued == NULL) {
+            pthread_cond_wait(&resolver.condition, &resolver.mutex);
+            continue;
+        }
+        resolverLookup * lookup = resolver.queued;
+        resolver.queued  = lookup->next;
+        lookup->next     = resolver.running;
+        resolver.running = lookup;
+        resolver.lookups++;
+        pthread_mutex_unlock(&resolver.mutex);
+
+        const resolverStatus status = blockingLookup(lookup, &answer);
+
+        pthread_mutex_lock(&resolver.mutex);
+        removeLookup(&resolver.running, lookup);
+        if(status != RESOLVER_DONE)
+            resolver.failures++;
+        cacheStore(lookup, status, &answer, time(NULL));
+
+        /**
+         * Se notifica con el mutex tomado: un pedido cancelado ya no está en
+         * la lista, y uno que sigue en ella no puede liberarse mientras
+         * tanto. notifyBlock no reserva memoria y el multiplexor no toma su
+         * mutex mientras despacha, por lo que no hay espera circular.
+         */
+        for(resolverRequest * waiter = lookup->waiters; waiter != NULL; waiter = waiter->next) {
+            waiter->status = status;
+            waiter->answer = answer;
+            waiter->lookup = NULL;
+            if(MUX_SUCCESS != notifyBlock(waiter->mux, waiter->fd))
+                logError("Unable to notify the resolution of %s to fd %d.", lookup->name, waiter->fd);
+        }
+        free(lookup);
+    }
+    pthread_mutex_unlock(&resolver.mutex);
+    return NULL;
+}
+
+size_t resolverStatistics(char * buffer, const size_t size) {
+    unsigned positive = 0, negative = 0;
+
+    if(!resolver.initialized || size == 0)
+        return 0;
+
+    pthread_mutex_lock(&resolver.mutex);
+    const time_t now = time(NULL);
+    for(unsigned i = 0; i < RESOLVER_CACHE_SIZE; i++) {
+        if(resolver.cache[i].used && now < resolver.cache[i].expires) {
+            if(resolver.cache[i].status == RESOLVER_DONE)
+                positive++;
+            else
+                negative++;
+        }
+    }
+    const int n = snprintf(buffer, size,
+        "resolver: workers %zu ttl %llds lookups %llu failures %llu cache-hits %llu coalesced %llu cached %u negative %u\n",
+        resolver.workersSize, (long long) resolver.ttl, resolver.lookups, resolver.failures,
+        resolver.cacheHits, resolver.coalesced, positive, negative);
+    pthread_mutex_unlock(&resolver.mutex);
+    if(n < 0)
+        return 0;
+    return ((size_t) n >= size)? size - 1 : (size_t) n;
+}
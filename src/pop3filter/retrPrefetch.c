@@ -0,0 +1,355 @@
+/**
+ * retrPrefetch.c - pedido especulativo del siguiente RETR.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+
+#include "retrPrefetch.h"
+
+/** Solo se accede desde el hilo del multiplexor. */
+static struct {
+    unsigned long long      sent;
+    unsigned long long      hits;
+    unsigned long long      misses;
+    unsigned long long      skipped;
+    unsigned long long      heldBytes;
+    unsigned long long      wastedBytes;
+} statistics;
+
+void retrPrefetchInit(retrPrefetchStruct * prefetch, const size_t capacity) {
+    bufferADT    buffer        = prefetch->buffer;
+    uint32_t *   sizes         = prefetch->sizes;
+    const size_t sizesCapacity = prefetch->sizesCapacity;
+
+    memset(prefetch, 0, sizeof(*prefetch));
+    prefetch->state         = PREFETCH_IDLE;
+    prefetch->capacity      = capacity;
+    prefetch->buffer        = buffer;
+    prefetch->sizes         = sizes;
+    prefetch->sizesCapacity = sizesCapacity;
+    reset(buffer);
+}
+
+void retrPrefetchDestroy(retrPrefetchStruct * prefetch) {
+    if(prefetch->buffer != NULL)
+        deleteBuffer(prefetch->buffer);
+    free(prefetch->sizes);
+    prefetch->buffer        = NULL;
+    prefetch->sizes         = NULL;
+    prefetch->messages      = 0;
+    prefetch->sizesCapacity = 0;
+    prefetch->state         = PREFETCH_IDLE;
+}
+
+bool retrPrefetchParseRetr(const uint8_t * line, const size_t length, unsigned long * message) {
+    unsigned long value = 0;
+    size_t        i = 4, digits = 0;
+
+    if(commandParserLookup(line, length) != CMD_RETR || i >= length || line[i] != ' ')
+        return false;
+    while(i < length && line[i] == ' ')
+        i++;
+    for(; i < length && isdigit(line[i]); i++, digits++) {
+        if(value > (ULONG_MAX - 9) / 10)
+            return false;
+        value = value * 10 + (line[i] - '0');
+    }
+    while(i < length && line[i] == ' ')
+        i++;
+    if(i < length && line[i] == '\r')
+        i++;
+    if(digits == 0 || value == 0 || i != length - 1 || line[i] != '\n')
+        return false;
+    *message = value;
+    return true;
+}
+
+void retrPrefetchRequestSent(retrPrefetchStruct * prefetch, const uint8_t * data, const size_t length) {
+    size_t        start, size = length;
+    unsigned long message;
+
+    if(prefetch->capacity == 0)
+        return;
+    if(prefetch->pending > 0) {
+        const size_t own = (size < prefetch->pending)? size : prefetch->pending;
+        prefetch->pending -= own;
+        data += own;
+        size -= own;
+    }
+    if(size == 0)
+        return;
+    /** Solo se especula si lo último que envió el cliente es un RETR completo. */
+    prefetch->next = 0;
+    if(data[size - 1] != '\n')
+        return;
+    for(start = size - 1; start > 0 && data[start - 1] != '\n'; start--)
+        ;
+    if(retrPrefetchParseRetr(data + start, size - start, &message) && message < ULONG_MAX)
+        prefetch->next = message + 1;
+}
+
+/** Indica si según LIST el mensaje `message' entra en el buffer. */
+static bool fits(const retrPrefetchStruct * prefetch, const unsigned long message) {
+    return message <= prefetch->messages && prefetch->sizes[message - 1] < prefetch->capacity;
+}
+
+bool retrPrefetchStart(retrPrefetchStruct * prefetch, bufferADT requests, commandParser * parser, queueADT commands) {
+    char    line[RETR_PREFETCH_LINE_SIZE];
+    size_t  space;
+    bool    newCommand = false;
+    int     length;
+
+    if(prefetch->capacity == 0 || prefetch->state != PREFETCH_IDLE || prefetch->next == 0 ||
+       canRead(requests) || canProcess(requests) || parser->lineSize != 0)
+        return false;
+    if(prefetch->listed && !fits(prefetch, prefetch->next)) {
+        statistics.skipped++;
+        prefetch->next = 0;
+        return false;
+    }
+    if(prefetch->buffer == NULL && (prefetch->buffer = createBuffer(prefetch->capacity)) == NULL)
+        return false;
+
+    if(prefetch->listed)
+        length = snprintf(line, sizeof(line), "RETR %lu\r\n", prefetch->next);
+    else
+        length = snprintf(line, sizeof(line), "LIST\r\n");
+    uint8_t * ptr = getWritePtr(requests, &space);
+    if(length < 0 || (size_t) length >= sizeof(line) || (size_t) length > space)
+        return false;
+    memcpy(ptr, line, length);
+    updateWritePtr(requests, length);
+    commandParserConsume(parser, requests, commands, true, &newCommand);
+
+    prefetch->command = peekLast(commands);
+    prefetch->pending = length;
+    prefetch->state   = PREFETCH_SENT;
+    reset(prefetch->buffer);
+    if(!prefetch->listed) {
+        /** El cliente no espera su respuesta; `next' se pide al terminar si sigue sin pedir otra cosa. */
+        prefetch->listed     = true;
+        prefetch->listing    = true;
+        prefetch->missed     = true;
+        prefetch->messages   = 0;
+        prefetch->lineLength = 0;
+        return true;
+    }
+    prefetch->listing = false;
+    prefetch->message = prefetch->next;
+    prefetch->next    = 0;
+    prefetch->missed  = false;
+    statistics.sent++;
+    return true;
+}
+
+bool retrPrefetchHoldsClient(const retrPrefetchStruct * prefetch) {
+    return (prefetch->state == PREFETCH_SENT && !prefetch->missed) || prefetch->state == PREFETCH_HOLDING;
+}
+
+size_t retrPrefetchSendable(const retrPrefetchStruct * prefetch, const size_t size) {
+    if(!retrPrefetchHoldsClient(prefetch))
+        return size;
+    return (size < prefetch->pending)? size : prefetch->pending;
+}
+
+void retrPrefetchClientRequest(retrPrefetchStruct * prefetch, bufferADT requests) {
+    unsigned long message;
+    size_t        count;
+
+    if(!retrPrefetchHoldsClient(prefetch) || prefetch->pending > 0)
+        return;
+    const uint8_t * line = getProcessPtr(requests, &count);
+    const uint8_t * end  = memchr(line, '\n', count);
+    if(end == NULL)
+        return;
+
+    const size_t length = end - line + 1;
+    if(retrPrefetchParseRetr(line, length, &message) && message == prefetch->message) {
+        /** El cliente adopta el comando especulativo, su linea no se envía. */
+        updateProcessPtr(requests, length);
+        updateReadPtr(requests, length);
+        statistics.hits++;
+        prefetch->command = NULL;
+        prefetch->next    = (message < ULONG_MAX)? message + 1 : 0;
+        prefetch->state   = (prefetch->state == PREFETCH_SENT)? PREFETCH_IDLE : PREFETCH_DRAINING;
+    } else
+        retrPrefetchCancel(prefetch);
+}
+
+void retrPrefetchCancel(retrPrefetchStruct * prefetch) {
+    if(!retrPrefetchHoldsClient(prefetch))
+        return;
+    statistics.misses++;
+    if(prefetch->state == PREFETCH_SENT)
+        prefetch->missed = true;
+    else
+        prefetch->state  = PREFETCH_DISCARDING;
+}
+
+bufferADT retrPrefetchOriginBuffer(retrPrefetchStruct * prefetch, bufferADT responses) {
+    switch(prefetch->state) {
+        case PREFETCH_HOLDING:
+        case PREFETCH_DISCARDING:
+        case PREFETCH_DRAINING:
+            return prefetch->buffer;
+        default:
+            return responses;
+    }
+}
+
+/**
+ * Parsea los bytes de `buffer' mientras `untilStart' indique que no se llegó
+ * al inicio de la respuesta especulativa o, si es false, hasta que termine.
+ */
+static bool feed(retrPrefetchStruct * prefetch, bufferADT buffer, responseParser * parser, queueADT commands, const bool untilStart) {
+    size_t size;
+
+    while(canProcess(buffer)) {
+        const bool current = peekProcessed(commands) == prefetch->command;
+        if((untilStart && current && parser->state == RESPONSE_INIT) || (!untilStart && !current))
+            break;
+        const uint8_t * ptr = getProcessPtr(buffer, &size);
+        const size_t    n   = responseParserFeedSpan(parser, ptr, size, commands);
+        updateProcessPtr(buffer, n);
+        if(!untilStart && !prefetch->listing)
+            statistics.heldBytes += n;
+        if(parser->state == RESPONSE_ERROR)
+            return false;
+    }
+    return true;
+}
+
+/** Guarda el tamaño de una linea "n tamaño" de la respuesta a LIST. */
+static void listLine(retrPrefetchStruct * prefetch, const char * line) {
+    char * end;
+
+    if(!isdigit((unsigned char) line[0]))
+        return;
+    const unsigned long message = strtoul(line, &end, 10);
+    if(message == 0 || message > RETR_PREFETCH_MAX_MESSAGES || *end != ' ')
+        return;
+    const char * digits = end;
+    const unsigned long long size = strtoull(digits, &end, 10);
+    if(end == digits)
+        return;
+    if(message > prefetch->sizesCapacity) {
+        size_t capacity = (prefetch->sizesCapacity > 0)? prefetch->sizesCapacity * 2 : 64;
+        if(capacity < message)
+            capacity = message;
+        uint32_t * grown = realloc(prefetch->sizes, capacity * sizeof(*grown));
+        if(grown == NULL)
+            return;
+        prefetch->sizes         = grown;
+        prefetch->sizesCapacity = capacity;
+    }
+    /** Los mensajes que LIST no nombra no se piden. */
+    while(prefetch->messages < message)
+        prefetch->sizes[prefetch->messages++] = UINT32_MAX;
+    prefetch->sizes[message - 1] = (size < UINT32_MAX)? (uint32_t) size : UINT32_MAX;
+}
+
+/** Separa en lineas los bytes ya parseados de la respuesta a LIST. */
+static void listScan(retrPrefetchStruct * prefetch, const uint8_t * data, size_t length) {
+    while(length > 0) {
+        const uint8_t * newline = memchr(data, '\n', length);
+        const size_t    n       = (newline == NULL)? length : (size_t) (newline - data);
+        const size_t    room    = sizeof(prefetch->line) - 1 - prefetch->lineLength;
+        const size_t    copied  = (n < room)? n : room;
+
+        memcpy(prefetch->line + prefetch->lineLength, data, copied);
+        prefetch->lineLength += copied;
+        if(newline == NULL)
+            return;
+        prefetch->line[prefetch->lineLength] = 0;
+        listLine(prefetch, prefetch->line);
+        prefetch->lineLength = 0;
+        data   += n + 1;
+        length -= n + 1;
+    }
+}
+
+/**
+ * Pasa el contenido del buffer a `responses' sin alterar el orden: primero
+ * lo ya parseado y luego lo que falta parsear.
+ */
+static void drain(retrPrefetchStruct * prefetch, bufferADT responses) {
+    size_t size, space;
+
+    while(canRead(prefetch->buffer) && !canProcess(responses) && canWrite(responses)) {
+        const uint8_t * src = getReadPtr(prefetch->buffer, &size);
+        uint8_t *       dst = getWritePtr(responses, &space);
+        const size_t    n   = (size < space)? size : space;
+        memcpy(dst, src, n);
+        updateWriteAndProcessPtr(responses, n);
+        updateReadPtr(prefetch->buffer, n);
+    }
+    if(!canRead(prefetch->buffer))
+        moveUnprocessed(prefetch->buffer, responses);
+    if(!canRead(prefetch->buffer) && !canProcess(prefetch->buffer)) {
+        reset(prefetch->buffer);
+        prefetch->state = PREFETCH_IDLE;
+    }
+}
+
+bool retrPrefetchProcess(retrPrefetchStruct * prefetch, bufferADT responses, responseParser * parser, queueADT commands) {
+    size_t size;
+    const uint8_t * ptr;
+
+    while(true) {
+        switch(prefetch->state) {
+            case PREFETCH_SENT:
+                if(!feed(prefetch, responses, parser, commands, true))
+                    return false;
+                if(peekProcessed(commands) != prefetch->command || parser->state != RESPONSE_INIT)
+                    return true;
+                /** Empieza la respuesta especulativa, se aparta de las del cliente. */
+                moveUnprocessed(responses, prefetch->buffer);
+                prefetch->state = prefetch->missed? PREFETCH_DISCARDING : PREFETCH_HOLDING;
+                break;
+
+            case PREFETCH_HOLDING:
+                return feed(prefetch, prefetch->buffer, parser, commands, false);
+
+            case PREFETCH_DISCARDING:
+                if(!feed(prefetch, prefetch->buffer, parser, commands, false))
+                    return false;
+                ptr = getReadPtr(prefetch->buffer, &size);
+                if(prefetch->listing)
+                    listScan(prefetch, ptr, size);
+                else
+                    statistics.wastedBytes += size;
+                updateReadPtr(prefetch->buffer, size);
+                if(peekProcessed(commands) == prefetch->command)
+                    return true;
+                prefetch->command = NULL;
+                prefetch->listing = false;
+                prefetch->state   = PREFETCH_DRAINING;
+                break;
+
+            case PREFETCH_DRAINING:
+                drain(prefetch, responses);
+                return true;
+
+            default:
+                return true;
+        }
+    }
+}
+
+size_t retrPrefetchStatistics(char * buffer, const size_t size) {
+    const unsigned long long decided = statistics.hits + statistics.misses;
+
+    if(size == 0)
+        return 0;
+    const int n = snprintf(buffer, size,
+        "retr prefetch: sent %llu hits %llu misses %llu hit-ratio %.2f skipped %llu held-bytes %llu wasted-bytes %llu waste-ratio %.2f\n",
+        statistics.sent, statistics.hits, statistics.misses, decided? (double) statistics.hits / decided : 0.0, statistics.skipped,
+        statistics.heldBytes, statistics.wastedBytes,
+        statistics.heldBytes? (double) statistics.wastedBytes / statistics.heldBytes : 0.0);
+    if(n < 0)
+        return 0;
+    return ((size_t) n >= size)? size - 1 : (size_t) n;
+}
@@ -2,53 +2,60 @@
 #define MEDIA_TYPE_CONTAINER_H
 
 #include <stdbool.h>
-
-#include "parser.h"
-#include "parserUtils.h"
+#include <stdint.h>
+#include <limits.h>
+
+/**
+ * mediaTypeContainer.h - media range compilado en un trie.
+ *
+ * Cada "tipo/subtipo" insertado es un camino del trie, sin distinguir
+ * mayúsculas. Con el subtipo comodín el nodo que sigue a la '/' acepta
+ * cualquier subtipo. Un media type se reconoce de a un caracter con
+ * `mediaTypeContainerMatch', que consulta una tabla por nodo: el costo por
+ * caracter no depende de cuántos media types tenga el media range y no
+ * reserva memoria.
+ */
 
 typedef struct mediaType_t {
 	char * type;
 	char * subtype;
 } mediaType_t;
 
-typedef enum findCriteria {
-	TYPE,
-	SUBTYPE,
-} findCriteria;
-
 typedef enum mediaTypeStatus {
 	MEDIA_TYPE_SUCCESS,
 	MEDIA_TYPE_ERROR,
 } mediaTypeStatus;
 
+/** Estado antes del primer caracter de un media type. */
+#define MEDIA_TYPE_MATCH_START 0U
 
-typedef struct mediaTypeNodeCDT * mediaTypeNode;
+/** El media type ya no coincide con ninguno del container. */
+#define MEDIA_TYPE_MATCH_FAILED UINT_MAX
 
 typedef struct mediaTypeContainerCDT * mediaTypeContainer;
 
-typedef struct mediaTypeNodeCDT {
-	mediaTypeNode next;
-	mediaTypeNode subtypesPtr;
-	bool allPermited;
-	const char * indicator;
-	parserDefinition parserDefinition;
-	parserADT indicatorParser;
-	const parserEvent * indicatorParserEvent;
-} mediaTypeNodeCDT;
-
-typedef struct mediaTypeContainerCDT {
-	mediaTypeNode medias;
-} mediaTypeContainerCDT;
-
-
-
+/** `allPermitedIndicator' es el subtipo comodín, por ejemplo "*". */
 mediaTypeContainer createMediaTypeContainer(const char * allPermitedIndicator);
 
 void deleteMediaTypeContainer(mediaTypeContainer container);
 
+/**
+ * Agrega `mediaType'. Retorna MEDIA_TYPE_ERROR si ya estaba (o lo cubre un
+ * comodín), si el tipo es el comodín, si tiene caracteres que no pueden
+ * estar en un media type o si no hay memoria.
+ */
 mediaTypeStatus insertMediaType(mediaTypeContainer container, mediaType_t mediaType);
 
-void mediaTypeContainerParserReset(mediaTypeContainer container);
+/** Indica si no se insertó ningún media type. */
+bool mediaTypeContainerIsEmpty(const mediaTypeContainer container);
 
-#endif
+/**
+ * Avanza `state' con `character'. El tipo y el subtipo se separan con '/'.
+ * Una vez en MEDIA_TYPE_MATCH_FAILED no se sale.
+ */
+unsigned mediaTypeContainerMatch(const mediaTypeContainer container, const unsigned state, const uint8_t character);
 
+/** Indica si lo consumido hasta `state' es un media type del container. */
+bool mediaTypeContainerMatches(const mediaTypeContainer container, const unsigned state);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef MIME_HEADER_NAME_H
+#define MIME_HEADER_NAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * mimeHeaderName.c - clasificación de los nombres de header que le
+ * interesan a stripmime.
+ *
+ * El nombre se acumula en minúsculas mientras se calcula su hash, y al
+ * terminar se busca una sola vez en una tabla de hash de los headers
+ * conocidos. Agregar un header es agregar una entrada a la tabla, no una
+ * pasada más por caracter.
+ */
+
+/** Largo máximo de un nombre conocido, los más largos no se acumulan. */
+#define MIME_HEADER_NAME_SIZE 32
+
+typedef enum mimeHeader {
+    MIME_HEADER_OTHER,
+    MIME_HEADER_CONTENT_TYPE,
+    MIME_HEADER_CONTENT_TRANSFER_ENCODING,
+    MIME_HEADER_CONTENT_DISPOSITION,
+    MIME_HEADER_CONTENT_ID,
+} mimeHeader;
+
+typedef struct mimeHeaderName {
+    char        name[MIME_HEADER_NAME_SIZE];
+    size_t      length;
+    uint32_t    hash;
+} mimeHeaderName;
+
+/** Prepara `headerName' para un nombre nuevo. */
+void mimeHeaderNameReset(mimeHeaderName * headerName);
+
+/** Agrega un caracter del nombre. */
+void mimeHeaderNameFeed(mimeHeaderName * headerName, const uint8_t character);
+
+/** Clasifica el nombre acumulado, sin distinguir mayúsculas. */
+mimeHeader mimeHeaderNameClassify(const mimeHeaderName * headerName);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef STRIPMIME_ENGINE_H
+#define STRIPMIME_ENGINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * stripmimeEngine.h - censura de partes MIME por media type, sin entrada
+ * ni salida propias.
+ *
+ * Recibe el mensaje (sin dot-stuffing) de a corridas de bytes con
+ * `stripmimeFeed' y entrega la salida por el `stripmimeWriter' indicado,
+ * también de a corridas. Cada mensaje usa su propio `stripmimeADT', por lo
+ * que puede usarse desde el proxy para varios mensajes a la vez.
+ */
+
+typedef struct stripmimeCDT * stripmimeADT;
+
+/** Recibe una corrida de bytes de la salida. */
+typedef void (*stripmimeWriter)(const uint8_t * data, const size_t length, void * writerData);
+
+/**
+ * Crea el estado para filtrar un mensaje. Las partes cuyo media type está
+ * en `mediaRange' (lista separada por comas, el subtipo puede ser `*') se
+ * reemplazan por `replaceMessage'. Retorna NULL si `mediaRange' es NULL
+ * o inválido, o si no se pudo reservar memoria.
+ */
+stripmimeADT createStripmime(const char * mediaRange, const char * replaceMessage, stripmimeWriter writer, void * writerData);
+
+/**
+ * Procesa `length' bytes del mensaje, escribiendo la salida que generan.
+ * Los bytes sueltos y los headers se juntan en corridas de hasta 4 KiB; toda
+ * la salida se entrega al writer antes de retornar.
+ * Retorna false ante un error fatal (por ejemplo un header demasiado largo);
+ * desde entonces no se procesa ni escribe nada más.
+ */
+bool stripmimeFeed(stripmimeADT stripmime, const uint8_t * data, const size_t length);
+
+/** Libera los recursos del mensaje. */
+void deleteStripmime(stripmimeADT stripmime);
+
+#endif
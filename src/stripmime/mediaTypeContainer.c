@@ -2,180 +2,135 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 
+/** Columnas de la tabla: '!' a '~' con las mayúsculas plegadas, 0 es inválida. */
+#define COLUMNS ('~' - ' ' + 1)
+/** Los estados se guardan en 16 bits. */
+#define MAX_NODES UINT16_MAX
+#define INITIAL_NODES 16
 
-static const char * allPermitedIndicatorString;
+typedef struct trieNode {
+	/** Nodo siguiente por columna, 0 si no hay: ninguna transición vuelve a la raíz. */
+	uint16_t next[COLUMNS];
+	/** Termina un media type insertado. */
+	bool accept;
+	/** Sigue a la '/' de un tipo con el subtipo comodín, acepta cualquier subtipo. */
+	bool anySubtype;
+} trieNode;
 
-static mediaTypeNode createMediaTypeNode(const char * indicator, bool allPermited);
+struct mediaTypeContainerCDT {
+	const char * allPermitedIndicator;
+	trieNode * nodes;
+	unsigned nodesQty;
+	unsigned nodesSize;
+	unsigned mediaTypesQty;
+};
 
-static void deleteMediaTypeNode(mediaTypeNode node);
+static unsigned column(const uint8_t character);
 
-static mediaTypeNode findByCriteria(mediaTypeNode node, const char * indicator, bool * locate, findCriteria criteria);
-
-static void deleteMediaTypeNodeSubtypePtr(mediaTypeNode node);
+static bool insertString(mediaTypeContainer container, unsigned * node, const char * string);
 
 
 
 mediaTypeContainer createMediaTypeContainer(const char * allPermitedIndicator) {
 	if(allPermitedIndicator == NULL)
 		return NULL;
-	allPermitedIndicatorString = allPermitedIndicator;
-	return calloc(1, sizeof(mediaTypeNodeCDT));
+	mediaTypeContainer container = calloc(1, sizeof(*container));
+	if(container == NULL)
+		return NULL;
+	container->nodes = calloc(INITIAL_NODES, sizeof(trieNode));
+	if(container->nodes == NULL) {
+		free(container);
+		return NULL;
+	}
+	container->allPermitedIndicator = allPermitedIndicator;
+	container->nodesSize = INITIAL_NODES;
+	/** La raíz. */
+	container->nodesQty = 1;
+	return container;
 }
 
 void deleteMediaTypeContainer(mediaTypeContainer container) {
-	mediaTypeNode node = container->medias;
-	mediaTypeNode aux, subtypePtr;
-
-	while(node != NULL) {
-		subtypePtr = node->subtypesPtr;
-		while(subtypePtr != NULL) {
-			aux = subtypePtr;
-			if(aux->indicatorParser != NULL) {
-				destroyParser(aux->indicatorParser);
-				destroyStringCompareParserUtils(&aux->parserDefinition);
-			}
-			subtypePtr = subtypePtr->next;
-			free(aux);
-		}
-		aux = node;
-		if(node->indicatorParser != NULL) {
-			destroyParser(node->indicatorParser);
-			destroyStringCompareParserUtils(&node->parserDefinition);
-		}
-		node = node->next;
-		free(aux);
-	}
-
+	if(container == NULL)
+		return;
+	free(container->nodes);
 	free(container);
 }
 
 mediaTypeStatus insertMediaType(mediaTypeContainer container, mediaType_t mediaType) {
 	if(container == NULL || mediaType.type == NULL || mediaType.subtype == NULL)
 		return MEDIA_TYPE_ERROR;
-	bool allPermited = false;
-	if(container->medias == NULL) {
-		if(strcmp(allPermitedIndicatorString, mediaType.type) == 0)
-			return MEDIA_TYPE_ERROR;
-		allPermited = strcmp(mediaType.subtype, allPermitedIndicatorString) == 0 ? true : false;
-		container->medias = createMediaTypeNode(mediaType.type, false);
-		container->medias->subtypesPtr = createMediaTypeNode(mediaType.subtype, allPermited);
-		return MEDIA_TYPE_SUCCESS;
-	}
-	bool locate = false;
-	allPermited = strcmp(allPermitedIndicatorString, mediaType.subtype) == 0 ? true : false;
-	mediaTypeNode node = findByCriteria(container->medias, mediaType.type, &locate, TYPE);
-	if(locate) {
-		if(allPermited) {
-			deleteMediaTypeNodeSubtypePtr(node);
-			node->subtypesPtr = createMediaTypeNode(allPermitedIndicatorString, allPermited);
-		} else {
-			bool locateSubtype = false;
-			node = findByCriteria(node->subtypesPtr, mediaType.subtype, &locateSubtype, SUBTYPE);
-			if(!locateSubtype) {
-				node->next = createMediaTypeNode(mediaType.subtype, false);
-				return MEDIA_TYPE_SUCCESS;
-			} else {
-				return MEDIA_TYPE_ERROR;
-			}
-		}
-	} else {
-		node->next = createMediaTypeNode(mediaType.type, false);
-		node->next = createMediaTypeNode(mediaType.subtype, allPermited);
+	if(strcmp(container->allPermitedIndicator, mediaType.type) == 0)
+		return MEDIA_TYPE_ERROR;
+
+	unsigned node = MEDIA_TYPE_MATCH_START;
+	if(!insertString(container, &node, mediaType.type) || !insertString(container, &node, "/"))
+		return MEDIA_TYPE_ERROR;
+	if(container->nodes[node].anySubtype)
+		return MEDIA_TYPE_ERROR;
+
+	/** Los subtipos que ya tenía el tipo quedan sin uso, el comodín se revisa primero. */
+	if(strcmp(container->allPermitedIndicator, mediaType.subtype) == 0) {
+		container->nodes[node].anySubtype = true;
+		container->mediaTypesQty++;
 		return MEDIA_TYPE_SUCCESS;
 	}
-	return MEDIA_TYPE_ERROR;
+	if(!insertString(container, &node, mediaType.subtype) || container->nodes[node].accept)
+		return MEDIA_TYPE_ERROR;
+	container->nodes[node].accept = true;
+	container->mediaTypesQty++;
+	return MEDIA_TYPE_SUCCESS;
 }
 
-void mediaTypeContainerParserReset(mediaTypeContainer container) {
-    mediaTypeNode node = container->medias;
-    mediaTypeNode subtypePtr;
-    while(node != NULL) {
-        subtypePtr = node->subtypesPtr;
-        while(subtypePtr != NULL) {
-			if (!subtypePtr->allPermited)
-				resetParser(subtypePtr->indicatorParser);
-            subtypePtr = subtypePtr->next;
-        }
-        resetParser(node->indicatorParser);
-        node = node->next;
-    }
+bool mediaTypeContainerIsEmpty(const mediaTypeContainer container) {
+	return container->mediaTypesQty == 0;
 }
 
-static mediaTypeNode createMediaTypeNode(const char * indicator, bool allPermited) {
-	mediaTypeNode newNode = calloc(1, sizeof(mediaTypeNodeCDT));
-	if(newNode == NULL || indicator == NULL)
-		return NULL;
-	newNode->indicator = indicator;
-	newNode->allPermited = allPermited;
-	if(allPermited)
-		return newNode;
-	newNode->parserDefinition = stringCompareParserUtils(indicator);
-	newNode->indicatorParser = initializeParser(noClassesParser(), &newNode->parserDefinition);
-	return newNode;
-} 
-
-static void deleteMediaTypeNode(mediaTypeNode node) {
-	if(node != NULL && !node->allPermited) {
-		destroyStringCompareParserUtils(&node->parserDefinition);
-		destroyParser(node->indicatorParser);
-	}
-	if(node != NULL)
-		free(node);
+unsigned mediaTypeContainerMatch(const mediaTypeContainer container, const unsigned state, const uint8_t character) {
+	if(state == MEDIA_TYPE_MATCH_FAILED)
+		return MEDIA_TYPE_MATCH_FAILED;
+	const trieNode * node = container->nodes + state;
+	if(node->anySubtype)
+		return state;
+	const unsigned next = node->next[column(character)];
+	return (next == 0)? MEDIA_TYPE_MATCH_FAILED : next;
 }
 
-
-static mediaTypeNode findByCriteria(mediaTypeNode node, const char * indicator, bool * locate, findCriteria criteria) {
-	switch(criteria) {
-			case TYPE:
-				if(strcmp(indicator, node->indicator) == 0) {
-					*locate = true;
-					return node;
-				}
-				break;
-			case SUBTYPE:
-				if(node->allPermited || strcmp(indicator, node->indicator) == 0) {
-					*locate = true;
-					return node;
-				}
-				break;
-			default:
-				break;
-		}
-	while(node->next != NULL) {
-		node = node->next;
-		switch(criteria) {
-			case TYPE:
-				if(strcmp(indicator, node->indicator) == 0) {
-					*locate = true;
-					return node;
-				}
-				break;
-			case SUBTYPE:
-				if(node->allPermited || strcmp(indicator, node->indicator) == 0) {
-					*locate = true;
-					return node;
-				}
-				break;
-			default:
-				break;
-		}
-	}
-	return node;
+bool mediaTypeContainerMatches(const mediaTypeContainer container, const unsigned state) {
+	if(state == MEDIA_TYPE_MATCH_FAILED)
+		return false;
+	return container->nodes[state].accept || container->nodes[state].anySubtype;
 }
 
+static unsigned column(const uint8_t character) {
+	if(character <= ' ' || character > '~')
+		return 0;
+	return tolower(character) - ' ';
+}
 
-static void deleteMediaTypeNodeSubtypePtr(mediaTypeNode node) {
-
-	mediaTypeNode subtypePtr = node->subtypesPtr;
-	mediaTypeNode aux;
-
-	while (subtypePtr != NULL) {
-		aux = subtypePtr;
-		subtypePtr = subtypePtr->next;
-		deleteMediaTypeNode(aux);
+/** Recorre `string' desde `node' creando los nodos que falten. */
+static bool insertString(mediaTypeContainer container, unsigned * node, const char * string) {
+	for(; *string != 0; string++) {
+		const unsigned col = column((uint8_t) *string);
+		if(col == 0)
+			return false;
+		if(container->nodes[*node].next[col] != 0) {
+			*node = container->nodes[*node].next[col];
+			continue;
+		}
+		if(container->nodesQty == MAX_NODES)
+			return false;
+		if(container->nodesQty == container->nodesSize) {
+			trieNode * nodes = realloc(container->nodes, 2 * container->nodesSize * sizeof(trieNode));
+			if(nodes == NULL)
+				return false;
+			memset(nodes + container->nodesSize, 0, container->nodesSize * sizeof(trieNode));
+			container->nodes      = nodes;
+			container->nodesSize *= 2;
+		}
+		container->nodes[*node].next[col] = container->nodesQty;
+		*node = container->nodesQty++;
 	}
-	subtypePtr->subtypesPtr = NULL;
+	return true;
 }
-
-
@@ -0,0 +1,81 @@
+/**
+ * mimeHeaderName.c - clasificación de los nombres de header que le
+ * interesan a stripmime.
+ */
+#include <string.h>
+#include <ctype.h>
+
+#include "mimeHeaderName.h"
+
+/** Potencia de 2 mayor que la cantidad de headers conocidos. */
+#define BUCKETS 16
+#define FNV_OFFSET 2166136261U
+#define FNV_PRIME 16777619U
+
+typedef struct knownHeader {
+    const char *    name;
+    mimeHeader      header;
+} knownHeader;
+
+static const knownHeader knownHeaders[] = {
+    { "content-type",              MIME_HEADER_CONTENT_TYPE              },
+    { "content-transfer-encoding", MIME_HEADER_CONTENT_TRANSFER_ENCODING },
+    { "content-disposition",       MIME_HEADER_CONTENT_DISPOSITION       },
+    { "content-id",                MIME_HEADER_CONTENT_ID                },
+};
+
+#define KNOWN_HEADERS (sizeof(knownHeaders) / sizeof(knownHeaders[0]))
+
+/**
+ * Indice + 1 en `knownHeaders' por intervalo, 0 si está vacío. Se arma en la
+ * primera búsqueda; stripmime se usa desde un solo hilo.
+ */
+static uint8_t buckets[BUCKETS];
+static bool bucketsReady = false;
+
+static uint32_t hashStep(const uint32_t hash, const uint8_t character) {
+    return (hash ^ character) * FNV_PRIME;
+}
+
+/** Ubica cada header conocido en su intervalo o en el primero libre que le sigue. */
+static void fillBuckets(void) {
+    for(size_t i = 0; i < KNOWN_HEADERS; i++) {
+        uint32_t hash = FNV_OFFSET;
+        for(const char * c = knownHeaders[i].name; *c != 0; c++)
+            hash = hashStep(hash, (uint8_t) *c);
+        size_t bucket = hash % BUCKETS;
+        while(buckets[bucket] != 0)
+            bucket = (bucket + 1) % BUCKETS;
+        buckets[bucket] = (uint8_t) (i + 1);
+    }
+    bucketsReady = true;
+}
+
+void mimeHeaderNameReset(mimeHeaderName * headerName) {
+    headerName->length = 0;
+    headerName->hash   = FNV_OFFSET;
+}
+
+void mimeHeaderNameFeed(mimeHeaderName * headerName, const uint8_t character) {
+    const uint8_t lower = (uint8_t) tolower(character);
+
+    /** Uno más largo que el tamaño no es conocido, se cuenta pero no se guarda. */
+    if(headerName->length < MIME_HEADER_NAME_SIZE)
+        headerName->name[headerName->length] = (char) lower;
+    headerName->length++;
+    headerName->hash = hashStep(headerName->hash, lower);
+}
+
+mimeHeader mimeHeaderNameClassify(const mimeHeaderName * headerName) {
+    if(headerName->length == 0 || headerName->length >= MIME_HEADER_NAME_SIZE)
+        return MIME_HEADER_OTHER;
+    if(!bucketsReady)
+        fillBuckets();
+
+    for(size_t bucket = headerName->hash % BUCKETS; buckets[bucket] != 0; bucket = (bucket + 1) % BUCKETS) {
+        const knownHeader * known = knownHeaders + buckets[bucket] - 1;
+        if(strlen(known->name) == headerName->length && memcmp(known->name, headerName->name, headerName->length) == 0)
+            return known->header;
+    }
+    return MIME_HEADER_OTHER;
+}
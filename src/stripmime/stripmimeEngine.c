@@ -0,0 +1,762 @@
+/**
+ * stripmimeEngine.c - censura de partes MIME por media type.
+ */
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "parser.h"
+#include "parserUtils.h"
+#include "mimeCharacters.h"
+
+#include "stack.h"
+#include "mediaTypeContainer.h"
+#include "mimeMessage.h"
+#include "mediaType.h"
+#include "mimeHeaderName.h"
+#include "stripmimeEngine.h"
+
+#define BOUNDARY_MAX_LENGTH 70 + 2 + 2 
+/** 70 es el maximo  para el valor del argumento del boundary  y 2 es el size de "--" */
+#define REPLACE_CONTENT_TYPE "text/plain; charset=\"UTF-8\""
+#define REPLACE_CONTENT_TRANSFER_ENCODING " quoted-printable"
+#define VALUE_LENGTH 2048
+/** Cantidad de eventos que se obtienen del parser por cada span */
+#define SPAN_EVENTS 256
+/** Bytes de salida que se juntan antes de entregarlos al writer */
+#define OUTPUT_SIZE 4096
+
+typedef struct boundary_t {
+    char boundaryString[BOUNDARY_MAX_LENGTH + 1];
+    uint8_t boundarySize;
+    parserDefinition boundaryStartParserDefinition;
+    parserADT boundaryStartParser;
+    parserDefinition boundaryEndParserDefinition;
+    parserADT boundaryEndParser;
+} boundary_t;
+
+static bool trueToPoint = true;
+static bool falseToPoint = false;
+
+
+/** Mantiene el estado durante el parseo de un mensaje */
+struct stripmimeCDT {
+
+    /** Valor del header */
+    char valueData[VALUE_LENGTH];
+
+    /** Indice del valueData */
+    size_t valueDataIndex;
+
+    /** Delimitador mensaje "tipo-rfc 822" */
+    parserADT     messageParser;
+    /** Nombre del header en curso, se clasifica al terminar */
+    mimeHeaderName      headerName;
+
+    /** Detector de media type */
+    parserADT     mediaTypeParser;
+
+    /** Detector de argumentos de media type */
+    parserADT     argumentParser;
+
+    bool                messageReplaced;
+    bool                replace;
+
+    /** Container de media types censurables */
+    mediaTypeContainer  container;
+    /** Estado del reconocimiento del media type en `container' */
+    unsigned            mediaTypeState;
+
+    /** Pila de argumentos tipo boundary */
+    stackADT            boundaryStack;
+
+    /**
+     * ¿hemos detectado si el field-name que estamos procesando refiere
+     * a Content-Type?. Utilizando dentro msg para los field-name.
+     */
+    bool *              messageContentTypeFieldDetected;
+    bool *              messageToReplaceDetected;
+    bool *              boundaryArgumentDetected;
+    bool *              boundaryValueDetected;
+    bool *              boundaryValueEndDetected;
+
+    /** Definición del detector de argumentos */
+    parserDefinition    argumentDefinition;
+
+    const char *        replaceMessage;
+    bool                addEncoding;
+    bool                replaceEncoding;
+
+    /** Destino de la salida */
+    stripmimeWriter     writer;
+    void *              writerData;
+    /** Salida que todavía no se entregó al writer */
+    uint8_t             output[OUTPUT_SIZE];
+    size_t              outputLength;
+    /** El parser está al comienzo de una linea del cuerpo */
+    bool                bodyLineStart;
+    /** Hubo un error fatal, no se procesa nada más */
+    bool                failed;
+};
+
+
+/** Setea lo necesario para la detección de los delimitadores de partes "boundaries" */
+static void setBoundaryEnd(boundary_t * boundary) {
+    if(boundary == NULL)
+        return;
+
+    boundary->boundaryString[boundary->boundarySize] = 0;
+
+    if(boundary->boundaryStartParser != NULL) {
+        destroyParser(boundary->boundaryStartParser);
+        destroyStringCompareParserUtils(&boundary->boundaryStartParserDefinition);
+    }
+    boundary->boundaryStartParserDefinition = stringCompareParserUtils(boundary->boundaryString);
+    boundary->boundaryStartParser = initializeParser(initializeCharactersClass(), &boundary->boundaryStartParserDefinition);
+
+    if(boundary->boundaryStartParser == NULL)
+        destroyStringCompareParserUtils(&boundary->boundaryStartParserDefinition);
+
+    boundary->boundaryString[boundary->boundarySize] = '-';
+    boundary->boundaryString[boundary->boundarySize + 1] = '-';
+    boundary->boundaryString[boundary->boundarySize + 2] = 0;
+
+    if(boundary->boundaryEndParser != NULL) {
+        destroyParser(boundary->boundaryEndParser);
+        destroyStringCompareParserUtils(&boundary->boundaryEndParserDefinition);
+    }
+    
+    boundary->boundaryEndParserDefinition = stringCompareParserUtils(boundary->boundaryString);
+    boundary->boundaryEndParser = initializeParser(initializeCharactersClass(), &boundary->boundaryEndParserDefinition);
+    if(boundary->boundaryEndParser == NULL)
+        destroyStringCompareParserUtils(&boundary->boundaryEndParserDefinition);
+
+}
+
+/** Libera los recursos de un "boundary_t" */
+static void deleteBoundary(boundary_t * boundary) {
+    if(boundary->boundaryStartParser != NULL) {
+        destroyParser(boundary->boundaryStartParser);
+        destroyStringCompareParserUtils(&boundary->boundaryStartParserDefinition);
+    }
+
+    if(boundary->boundaryEndParser != NULL) {
+        destroyParser(boundary->boundaryEndParser);
+        destroyStringCompareParserUtils(&boundary->boundaryEndParserDefinition);
+    }
+    free(boundary);
+}
+
+/**
+ * Manejador de errores. El mensaje no puede seguir procesandose, los
+ * recursos se liberan en `deleteStripmime'.
+ */
+static void endHandler(struct stripmimeCDT * ctx) {
+    ctx->failed = true;
+}
+
+/** Entrega al writer la salida juntada. */
+static void outputFlush(struct stripmimeCDT * ctx) {
+    if(ctx->outputLength > 0)
+        ctx->writer(ctx->output, ctx->outputLength, ctx->writerData);
+    ctx->outputLength = 0;
+}
+
+/**
+ * Escribe una corrida de bytes en la salida. Las corridas chicas se juntan
+ * y una que no entra se entrega tal cual, sin copiarla.
+ */
+static void output(struct stripmimeCDT * ctx, const uint8_t * data, const size_t length) {
+    if(ctx->outputLength + length <= OUTPUT_SIZE) {
+        memcpy(ctx->output + ctx->outputLength, data, length);
+        ctx->outputLength += length;
+        return;
+    }
+    outputFlush(ctx);
+    if(length < OUTPUT_SIZE) {
+        memcpy(ctx->output, data, length);
+        ctx->outputLength = length;
+    } else
+        ctx->writer(data, length, ctx->writerData);
+}
+
+static void outputByte(struct stripmimeCDT * ctx, const uint8_t character) {
+    if(ctx->outputLength == OUTPUT_SIZE)
+        outputFlush(ctx);
+    ctx->output[ctx->outputLength++] = character;
+}
+
+static void outputString(struct stripmimeCDT * ctx, const char * string) {
+    output(ctx, (const uint8_t *) string, strlen(string));
+}
+
+/**
+ * Procesa el argumento "boundary".
+ */
+static void argumentBoundary(struct stripmimeCDT * ctx, const uint8_t character) {
+    const parserEvent * event = feedParser(ctx->argumentParser, character);
+    do {
+        switch(event->type) {
+            case STRING_CMP_EQ:
+                ctx->boundaryArgumentDetected = &trueToPoint;
+                break;
+            case STRING_CMP_NEQ:
+                ctx->boundaryArgumentDetected = &falseToPoint;
+                break;
+        }
+        event = event->next;
+    } while(event != NULL);
+}
+
+
+/**
+ * Avanza el reconocimiento del media type del header Content-Type en curso.
+ * `ctx->messageToReplaceDetected' queda en false apenas deja de coincidir
+ * con el media range; que coincida del todo se decide al terminar el valor.
+ */
+static void mediaTypeConsume(struct stripmimeCDT * ctx, const uint8_t character) {
+    ctx->mediaTypeState = mediaTypeContainerMatch(ctx->container, ctx->mediaTypeState, character);
+    ctx->messageToReplaceDetected = (ctx->mediaTypeState == MEDIA_TYPE_MATCH_FAILED)? &falseToPoint : &trueToPoint;
+}
+
+
+/**
+ *  Procesa el valor del header detectado del tipo Content-Type.
+ */
+static void contentTypeHeaderValue(struct stripmimeCDT * ctx, const uint8_t character) {
+    const parserEvent * event = feedParser(ctx->mediaTypeParser, character);
+    do {
+
+        switch(event->type) {
+            case MEDIA_TYPE_TYPE:
+            case MEDIA_TYPE_SUBTYPE:
+                for(int i = 0; i < event->n; i++)
+                    mediaTypeConsume(ctx, event->data[i]);
+                break;
+
+            case MEDIA_TYPE_TYPE_END:
+                mediaTypeConsume(ctx, '/');
+                break;
+
+            case MEDIA_TYPE_ARGUMENT:
+                argumentBoundary(ctx, character);
+                break;
+
+            case MEDIA_TYPE_VALUE_START:
+                if(ctx->boundaryArgumentDetected != 0 && *ctx->boundaryArgumentDetected) {
+                    boundary_t * newBoundary = malloc(sizeof(boundary_t));
+                    if(newBoundary == NULL) {
+                        endHandler(ctx);
+                        return;
+                    }
+
+                    memset(newBoundary, 0, sizeof(boundary_t));
+                    newBoundary->boundarySize = 2;
+                    newBoundary->boundaryString[0] = '-';
+                    newBoundary->boundaryString[1] = '-';
+
+                    push(ctx->boundaryStack, newBoundary);
+                }
+                break;
+
+            case MEDIA_TYPE_VALUE:
+                if(ctx->boundaryArgumentDetected != 0 && *ctx->boundaryArgumentDetected) {
+                    for(int i = 0; i < event->n; i++) {
+                        boundary_t * boundary = peekStack(ctx->boundaryStack);
+                        boundary->boundaryString[boundary->boundarySize++] = event->data[i];
+
+                    }
+                }
+                break;
+            }
+        event = event->next;
+    } while(event != NULL);
+}
+
+
+/**
+ * Procesa el comienzo de un marca o delimitador del tipo boundary.
+ */
+static void boundaryStart(struct stripmimeCDT * ctx, const uint8_t character) {
+    const parserEvent * event = feedParser(((boundary_t *)peekStack(ctx->boundaryStack))->boundaryStartParser, character);
+    do {
+        switch(event->type) {
+            case STRING_CMP_EQ:
+                ctx->boundaryValueDetected = &trueToPoint;
+                break;
+            case STRING_CMP_NEQ:
+                ctx->boundaryValueDetected = &falseToPoint;
+        }
+        event = event->next;
+    } while(event != NULL);
+}
+
+
+/**
+ * Procesa el final de un marca o delimitador del tipo boundary.
+ */
+static void boundaryEnd(struct stripmimeCDT * ctx, const uint8_t character) {
+    const parserEvent * event = feedParser(((boundary_t *)peekStack(ctx->boundaryStack))->boundaryEndParser, character);
+    do {
+        switch(event->type) {
+            case STRING_CMP_EQ:
+                ctx->boundaryValueEndDetected = &trueToPoint;
+                break;
+
+            case STRING_CMP_NEQ:
+                ctx->boundaryValueEndDetected = &falseToPoint;
+                break;
+        }
+        event = event->next;
+    } while(event != NULL);
+}
+
+
+/** Escribe el reemplazo de una parte censurada. */
+static void replacement(struct stripmimeCDT * ctx) {
+    if(!ctx->addEncoding)
+        outputString(ctx, "Content-Transfer-Encoding: quoted-printable\r\n");
+    outputString(ctx, ctx->replaceMessage);
+    outputString(ctx, "\r\n");
+    ctx->messageReplaced = true;
+}
+
+/**
+ * Procesa un evento de un mensaje `tipo-rfc822' originado por `character'.
+ * Si reconoce un al field-header-name Content-Type lo interpreta.
+ *
+ */
+static void mimeMessageEvent(struct stripmimeCDT * ctx, const unsigned type, const uint8_t * data, const uint8_t n, const uint8_t character) {
+    bool replacePrinted = false;
+    switch(type) {
+        case MIME_MSG_NAME:
+            for(int i = 0; i < n; i++)
+                mimeHeaderNameFeed(&ctx->headerName, data[i]);
+            break;
+
+        case MIME_MSG_NAME_END: {
+            const mimeHeader header = mimeHeaderNameClassify(&ctx->headerName);
+            ctx->messageContentTypeFieldDetected = (header == MIME_HEADER_CONTENT_TYPE)? &trueToPoint : &falseToPoint;
+            ctx->replaceEncoding = header == MIME_HEADER_CONTENT_TRANSFER_ENCODING;
+            mimeHeaderNameReset(&ctx->headerName);
+            break;
+        }
+
+        case MIME_MSG_VALUE:
+ 
+            for(int i = 0; i < n; i++) {
+                ctx->valueData[ctx->valueDataIndex++] = data[i];
+                if(ctx->valueDataIndex >= VALUE_LENGTH) {
+                    endHandler(ctx);
+                    return;
+                }
+
+                if(ctx->messageContentTypeFieldDetected != 0 && *ctx->messageContentTypeFieldDetected)
+                    contentTypeHeaderValue(ctx, data[i]);
+                if(ctx->failed)
+                    return;
+            }
+            break;
+
+        case MIME_MSG_VALUE_END:
+            if(ctx->messageToReplaceDetected != 0 && *ctx->messageToReplaceDetected
+                && mediaTypeContainerMatches(ctx->container, ctx->mediaTypeState)) {
+                ctx->replace = true;
+                outputString(ctx, REPLACE_CONTENT_TYPE);
+            } 
+            else {
+                if(ctx->replace && ctx->replaceEncoding){
+                    outputString(ctx, REPLACE_CONTENT_TRANSFER_ENCODING "\r\n");
+                    ctx->addEncoding = true;
+                }
+                else {
+                    outputString(ctx, ctx->valueData);
+                    outputString(ctx, "\r\n");
+                }
+            }
+            memset(ctx->valueData, 0, ctx->valueDataIndex);
+            ctx->valueDataIndex = 0;
+        
+            setBoundaryEnd((boundary_t *)peekStack(ctx->boundaryStack));
+            resetParser(ctx->mediaTypeParser);
+            ctx->mediaTypeState = MEDIA_TYPE_MATCH_START;
+            resetParser(ctx->argumentParser);
+            ctx->messageContentTypeFieldDetected = 0;
+            ctx->messageToReplaceDetected = &falseToPoint;
+            break;
+
+        case MIME_MSG_BODY:
+            if(ctx->replace && !ctx->messageReplaced) {
+                replacement(ctx);
+            } else if (!ctx->replace){
+                outputByte(ctx, character);
+                replacePrinted = true;
+            }
+            if ((ctx->boundaryArgumentDetected != 0 && *ctx->boundaryArgumentDetected) || !isEmptyStack(ctx->boundaryStack)) {
+                for(int i = 0; i < n; i++) {
+                    boundaryStart(ctx, data[i]);
+                    boundaryEnd(ctx, data[i]);
+                    if(!replacePrinted && ctx->boundaryValueEndDetected != 0 && *ctx->boundaryValueEndDetected)
+                        outputByte(ctx, character);
+                }
+            }
+            break;
+
+        case MIME_MSG_BODY_NEWLINE:
+            if(ctx->boundaryValueDetected != 0 && ctx->boundaryValueEndDetected != 0
+                && (*ctx->boundaryValueEndDetected && !*ctx->boundaryValueDetected)) {
+                boundary_t * boundary = (boundary_t *)pop(ctx->boundaryStack);
+                if(boundary != NULL) 
+                    deleteBoundary(boundary);
+            }
+            if(ctx->boundaryValueDetected != 0 && *ctx->boundaryValueDetected) {
+                ctx->replace = false;
+                ctx->messageReplaced = false;
+                ctx->messageToReplaceDetected = &falseToPoint;
+                ctx->boundaryArgumentDetected = &falseToPoint;
+                ctx->boundaryValueDetected = NULL;
+                ctx->boundaryValueEndDetected = NULL;
+                ctx->messageContentTypeFieldDetected = NULL;
+                resetParser(ctx->messageParser);
+                ctx->mediaTypeState = MEDIA_TYPE_MATCH_START;
+                resetParser(ctx->mediaTypeParser);
+                resetParser(ctx->argumentParser);
+                mimeHeaderNameReset(&ctx->headerName);
+                boundary_t * boundary = peekStack(ctx->boundaryStack);
+                resetParser(boundary->boundaryEndParser);
+                resetParser(boundary->boundaryStartParser);
+            }
+            boundary_t * aux = (boundary_t *)peekStack(ctx->boundaryStack);
+            if(aux != NULL) {
+                resetParser(aux->boundaryStartParser);
+                resetParser(aux->boundaryEndParser);
+            }
+            break;
+
+        case MIME_MSG_VALUE_FOLD:
+            for(int i = 0; i < n; i++) {
+                ctx->valueData[ctx->valueDataIndex++] = data[i];
+                if(ctx->valueDataIndex >= VALUE_LENGTH) {
+                    endHandler(ctx);
+                    return;
+                }
+            }
+            break;
+
+        default:
+            break;
+
+    }
+    if(type != MIME_MSG_BODY && type != MIME_MSG_VALUE && type != MIME_MSG_VALUE_END && type != MIME_MSG_WAIT && type != MIME_MSG_VALUE_FOLD && !replacePrinted) {
+        //if (!(( type == MIME_MSG_BODY_CR || type == MIME_MSG_BODY_NEWLINE) && ctx->messageReplaced)) {
+          //  putchar(character);
+            //replacePrinted = true;
+        //}
+        if ((character == '\r' || character == '\n') && (type == MIME_MSG_BODY_NEWLINE || type == MIME_MSG_BODY_CR) && ctx->messageReplaced) {
+            // nada por hacer
+        } else {
+            if(type != MIME_MSG_BODY_NEWLINE && character == '\n')
+               outputByte(ctx, '\r');
+
+            outputByte(ctx, character);
+            replacePrinted = true;
+        }
+    }
+}
+
+/**
+ * Procesa una corrida de bytes del cuerpo. La salida se escribe de una sola
+ * vez y solo se recorre byte a byte si hay que detectar delimitadores.
+ */
+static void mimeMessageBody(struct stripmimeCDT * ctx, const uint8_t * data, const size_t length) {
+    if(ctx->replace) {
+        if(!ctx->messageReplaced)
+            replacement(ctx);
+    } else {
+        output(ctx, data, length);
+    }
+
+    if ((ctx->boundaryArgumentDetected != 0 && *ctx->boundaryArgumentDetected) || !isEmptyStack(ctx->boundaryStack)) {
+        for(size_t i = 0; i < length; i++) {
+            boundaryStart(ctx, data[i]);
+            boundaryEnd(ctx, data[i]);
+            if(ctx->replace && ctx->boundaryValueEndDetected != 0 && *ctx->boundaryValueEndDetected)
+                outputByte(ctx, data[i]);
+        }
+    }
+}
+
+/**
+ * Procesa un evento obtenido al alimentar el parser con un span.
+ */
+static void mimeMessage(struct stripmimeCDT * ctx, const parserSpanEvent * event) {
+    if(!event->literal) {
+        mimeMessageEvent(ctx, event->type, event->data, event->n, *event->ptr);
+    } else if(event->type == MIME_MSG_BODY) {
+        mimeMessageBody(ctx, event->ptr, event->length);
+    } else {
+        for(size_t i = 0; i < event->length && !ctx->failed; i++)
+            mimeMessageEvent(ctx, event->type, event->ptr + i, 1, event->ptr[i]);
+    }
+}
+
+/**
+ * Largo del prefijo común de `line' y `pattern', sin distinguir mayúsculas,
+ * como lo compara el detector de boundaries.
+ */
+static size_t commonPrefix(const uint8_t * line, const size_t length, const char * pattern) {
+    size_t i = 0;
+    while(i < length && pattern[i] != 0 && tolower(line[i]) == tolower((uint8_t) pattern[i]))
+        i++;
+    return i;
+}
+
+/**
+ * Indica si se pueden saltear lineas de la parte en curso: se está
+ * reemplazando, el reemplazo ya se escribió y ningún detector de boundary
+ * quedó en un estado que haga algo con una linea vacía.
+ */
+static bool canSkipLines(const struct stripmimeCDT * ctx) {
+    if(!ctx->bodyLineStart || !ctx->replace || !ctx->messageReplaced)
+        return false;
+    if(ctx->boundaryValueDetected != 0 && *ctx->boundaryValueDetected)
+        return false;
+    if(ctx->boundaryValueEndDetected != 0 && *ctx->boundaryValueEndDetected)
+        return false;
+    if(isEmptyStack(ctx->boundaryStack))
+        return ctx->boundaryArgumentDetected == 0 || !*ctx->boundaryArgumentDetected;
+    const boundary_t * boundary = peekStack(ctx->boundaryStack);
+    return boundary->boundaryStartParser != NULL && boundary->boundaryEndParser != NULL;
+}
+
+/**
+ * Saltea las lineas completas de una parte reemplazada sin pasarlas por los
+ * parsers. Los finales de linea se buscan con memchr y solo se miran los
+ * primeros bytes de cada linea: se frena en la primera que el detector
+ * tomaría como delimitador (un prefijo de "--boundary" o una que empieza
+ * con él), en un CR sin LF, que el parser trata como error, o en la ultima
+ * linea incompleta. Los bytes que el detector de cierre hubiera escrito y
+ * el estado en que deja los detectores quedan igual que byte a byte.
+ * Retorna la cantidad de bytes salteados.
+ */
+static size_t skipReplacedLines(struct stripmimeCDT * ctx, const uint8_t * data, const size_t length) {
+    const boundary_t * boundary = isEmptyStack(ctx->boundaryStack)? NULL : peekStack(ctx->boundaryStack);
+    bool mismatch = false;
+    size_t skipped = 0;
+
+    while(skipped < length) {
+        const uint8_t * cr = memchr(data + skipped, '\r', length - skipped);
+        if(cr == NULL || cr + 1 == data + length || cr[1] != '\n')
+            break;
+        const size_t lineLength = cr - (data + skipped);
+        if(boundary != NULL && lineLength > 0) {
+            const size_t start  = (lineLength < boundary->boundarySize)? lineLength : boundary->boundarySize;
+            const size_t common = commonPrefix(data + skipped, start, boundary->boundaryString);
+            if(common == start)
+                break;
+            output(ctx, data + skipped, common);
+            mismatch = true;
+        }
+        skipped += lineLength + 2;
+    }
+    if(mismatch) {
+        ctx->boundaryValueDetected    = &falseToPoint;
+        ctx->boundaryValueEndDetected = &falseToPoint;
+    }
+    return skipped;
+}
+
+/** 
+ * Para evitar el argumento 'q' en el mediaRange (RFC 7231 Sec 5.3.2)
+ */ 
+static size_t stringLengthSubtype(const char * string) {
+    size_t length = 0;
+    if(string == NULL)
+        return length;
+    while(string[length] != 0 && string[length] != ';' && string[length] != ' ')
+        length++;
+    return length;
+}
+
+/**
+ * Crea y completa un "mediaTypeContainer" para almacenar el media range especificado.
+ */
+static mediaTypeContainer createAndFillMediaTypeContainer(char * mediaRange) {
+    if(mediaRange == NULL)
+        return NULL;
+
+    char  * aux = malloc(strlen(mediaRange) + 1);
+    if(aux == NULL)
+        return NULL;
+    memcpy(aux, mediaRange, strlen(mediaRange)+1);
+    mediaTypeContainer newContainer = createMediaTypeContainer("*");
+
+    if(newContainer == NULL) {
+        free(aux);
+        return newContainer;
+    }
+    const char * delimiter = ",";
+    char * mediaRangeContextLast;
+    const char * subtypeDelimiter = "/";
+    char * mediaTypeContextLast;
+
+    char * mediaTypeString = strtok_r((char *)aux, delimiter, &mediaRangeContextLast);
+
+    mediaType_t mediaType;
+    size_t length = 0;
+
+    while(mediaTypeString != NULL) {
+        length = strlen(mediaTypeString) + 1;
+        char * newString = malloc(length);
+        if(newString == NULL) {
+            deleteMediaTypeContainer(newContainer);
+            free(aux);
+            return NULL;
+        }
+        memcpy(newString, mediaTypeString, length);
+        char * type = strtok_r(newString, subtypeDelimiter, &mediaTypeContextLast);
+        if(type == NULL) {
+            free(newString);
+            deleteMediaTypeContainer(newContainer);
+            free(aux);
+            return NULL;
+        }
+        length = strlen(type) + 1;
+        mediaType.type = malloc(length);
+        if(mediaType.type == NULL) {
+            free(newString);
+            deleteMediaTypeContainer(newContainer);
+            free(aux);
+            return NULL;
+        }
+        memcpy(mediaType.type, type, strlen(type)+1);
+
+        char * subtype = strtok_r(NULL, subtypeDelimiter, &mediaTypeContextLast);
+        if(subtype == NULL) {
+            free(newString);
+            free(mediaType.type);
+            deleteMediaTypeContainer(newContainer);
+            free(aux);
+            return NULL;
+        }
+        length = stringLengthSubtype(subtype);
+        mediaType.subtype = malloc(length + 1);
+        if(mediaType.subtype == NULL) {
+            free(newString);
+            free(mediaType.type);
+            deleteMediaTypeContainer(newContainer);
+            free(aux);
+            return NULL;
+        }
+        memcpy(mediaType.subtype, subtype, length);
+        mediaType.subtype[length] = 0;
+
+        insertMediaType(newContainer, mediaType);
+        free(newString);
+        free(mediaType.type);
+        free(mediaType.subtype);
+        mediaTypeString  = strtok_r(NULL, delimiter, &mediaRangeContextLast);
+    }
+    free(aux);
+
+    return newContainer;
+}
+
+/** Libera la pila de boundaries y los parsers creados. */
+static void deleteContext(struct stripmimeCDT * ctx) {
+    if(ctx->boundaryStack != NULL) {
+        while(!isEmptyStack(ctx->boundaryStack)) {
+            boundary_t * bound = pop(ctx->boundaryStack);
+            if(bound != NULL)
+                deleteBoundary(bound);
+        }
+        deleteStack(ctx->boundaryStack);
+    }
+    if(ctx->container != NULL)
+        deleteMediaTypeContainer(ctx->container);
+    if(ctx->messageParser != NULL)
+        destroyParser(ctx->messageParser);
+    if(ctx->mediaTypeParser != NULL)
+        destroyParser(ctx->mediaTypeParser);
+    if(ctx->argumentParser != NULL)
+        destroyParser(ctx->argumentParser);
+    if(ctx->argumentDefinition.states != NULL)
+        destroyStringCompareParserUtils(&ctx->argumentDefinition);
+}
+
+/**
+ * Crea un detector de `string'. La definición queda en `definition', que
+ * tiene miembros const y por eso se copia en lugar de asignarse.
+ */
+static parserADT stringCompareParser(parserDefinition * definition, const char * string) {
+    const parserDefinition created = stringCompareParserUtils(string);
+
+    memcpy(definition, &created, sizeof(created));
+    if(definition->states == NULL)
+        return NULL;
+    return initializeParser(noClassesParser(), definition);
+}
+
+stripmimeADT createStripmime(const char * mediaRange, const char * replaceMessage, stripmimeWriter writer, void * writerData) {
+    if(mediaRange == NULL || writer == NULL)
+        return NULL;
+
+    stripmimeADT ctx = calloc(1, sizeof(*ctx));
+    if(ctx == NULL)
+        return NULL;
+
+    ctx->replaceMessage                = (replaceMessage != NULL)? replaceMessage : "";
+    ctx->writer                        = writer;
+    ctx->writerData                    = writerData;
+    ctx->container                     = createAndFillMediaTypeContainer((char *) mediaRange);
+    ctx->messageParser                 = initializeParser(initializeCharactersClass(), mimeMessageParser());
+    ctx->mediaTypeParser               = initializeParser(initializeCharactersClass(), mediaTypeParser());
+    ctx->argumentParser                = stringCompareParser(&ctx->argumentDefinition, "boundary");
+    ctx->boundaryStack                 = createStack();
+
+    mimeHeaderNameReset(&ctx->headerName);
+
+    if(ctx->container == NULL || mediaTypeContainerIsEmpty(ctx->container) || ctx->messageParser == NULL
+        || ctx->mediaTypeParser == NULL || ctx->argumentParser == NULL || ctx->boundaryStack == NULL) {
+        deleteStripmime(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+bool stripmimeFeed(stripmimeADT ctx, const uint8_t * data, const size_t length) {
+    parserSpanEvent events[SPAN_EVENTS];
+    const uint8_t * span = data;
+    size_t remaining = length;
+
+    while(!ctx->failed && remaining > 0) {
+        size_t consumed;
+        if(canSkipLines(ctx)) {
+            consumed   = skipReplacedLines(ctx, span, remaining);
+            span      += consumed;
+            remaining -= consumed;
+            if(remaining == 0)
+                break;
+        }
+        // al finalizar una linea del cuerpo se puede resetear el parser
+        const size_t eventsQty = feedParserSpan(ctx->messageParser, span, remaining, events, SPAN_EVENTS, 1U << MIME_MSG_BODY_NEWLINE, &consumed);
+        for(size_t i = 0; i < eventsQty && !ctx->failed; i++)
+            mimeMessage(ctx, events + i);
+        if(eventsQty > 0)
+            ctx->bodyLineStart = events[eventsQty - 1].type == MIME_MSG_BODY_NEWLINE;
+        span      += consumed;
+        remaining -= consumed;
+    }
+    /** La salida de cada corrida se entrega antes de volver, el proxy la espera. */
+    outputFlush(ctx);
+    return !ctx->failed;
+}
+
+void deleteStripmime(stripmimeADT ctx) {
+    if(ctx == NULL)
+        return;
+    deleteContext(ctx);
+    free(ctx);
+}